@@ -215,6 +215,11 @@ namespace qi
 
   private:
     friend class BufferReader;
+    friend class BufferView;
+
+    /// Stops sharing the data with views before a modification.
+    void detach();
+
     // CS4251
     boost::shared_ptr<BufferPrivate> _p;
   };
@@ -285,12 +290,36 @@ namespace qi
      */
     size_t position() const;
 
+    /**
+     * \brief Return the buffer being read.
+     * \return The buffer.
+     */
+    const Buffer& buffer() const;
+
   private:
     const Buffer* _buffer;
     size_t  _cursor;
     size_t  _subCursor; // position in sub-buffers
   };
 
+  /**
+   * \brief Statistics of the memory pool from which buffers are allocated.
+   * \includename{qi/buffer.hpp}
+   */
+  struct BufferPoolStatistics
+  {
+    /// Number of allocations served by memory previously released to the pool.
+    qi::uint64_t hits = 0;
+    /// Number of allocations that required new memory from the system.
+    qi::uint64_t misses = 0;
+  };
+
+  /**
+   * \brief Return the statistics of the buffer memory pool since the start of
+   * the process.
+   */
+  QI_API BufferPoolStatistics bufferPoolStatistics();
+
   namespace detail {
     QI_API void printBuffer(std::ostream& stream, const Buffer& buffer);
   }
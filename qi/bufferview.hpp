@@ -0,0 +1,141 @@
+#pragma once
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#ifndef _QI_BUFFERVIEW_HPP_
+# define _QI_BUFFERVIEW_HPP_
+
+# include <qi/api.hpp>
+# include <qi/buffer.hpp>
+# include <ka/macro.hpp>
+# include <boost/shared_ptr.hpp>
+# include <cstddef>
+# include <iosfwd>
+# include <string>
+
+KA_WARNING_PUSH()
+KA_WARNING_DISABLE(4251, )
+
+namespace qi
+{
+  /**
+   * \brief Read-only view on a range of bytes of a buffer.
+   * \includename{qi/bufferview.hpp}
+   *
+   * A view keeps the data it references alive: it stays valid after the
+   * buffer it was made from is modified or destroyed, as a buffer stops
+   * sharing its data with its views before being modified.
+   *
+   * Views only cover the content of a buffer, not its sub-buffers.
+   *
+   * Receiving a raw value as a BufferView avoids copying it out of the
+   * message it came in, at the cost of keeping the whole message alive as
+   * long as the view.
+   */
+  class QI_API BufferView
+  {
+  public:
+    /// \brief Constructs an empty view.
+    BufferView();
+
+    /**
+     * \brief Constructs a view on the content of a buffer.
+     * \param buffer The buffer to view.
+     */
+    explicit BufferView(const Buffer& buffer);
+
+    /**
+     * \brief Constructs a view on a range of the content of a buffer.
+     * Throws a std::out_of_range if the range is not within the buffer.
+     * \param buffer The buffer to view.
+     * \param offset Offset of the first byte of the range.
+     * \param size Size of the range.
+     */
+    BufferView(const Buffer& buffer, std::size_t offset, std::size_t size);
+
+    /// \brief Return a pointer to the first byte of the view.
+    const char* data() const { return _data; }
+    /// \brief Return the number of bytes in the view.
+    std::size_t size() const { return _size; }
+    /// \brief Return whether the view is empty.
+    bool empty() const { return _size == 0; }
+
+    /**
+     * \brief Return a view on a range of this view, sharing its data.
+     * Throws a std::out_of_range if the range is not within this view.
+     * \param offset Offset of the first byte of the range.
+     * \param size Size of the range.
+     */
+    BufferView slice(std::size_t offset, std::size_t size) const;
+
+    /// \brief Return a buffer holding a copy of the bytes of the view.
+    Buffer toBuffer() const;
+
+    bool operator==(const BufferView& b) const;
+    bool operator!=(const BufferView& b) const { return !(*this == b); }
+
+  private:
+    friend class StringView;
+    BufferView(boost::shared_ptr<const void> owner, const char* data, std::size_t size);
+
+    // CS4251
+    boost::shared_ptr<const void> _owner;
+    const char* _data;
+    std::size_t _size;
+  };
+
+  /**
+   * \brief Read-only view on a string, that keeps its characters alive.
+   * \includename{qi/bufferview.hpp}
+   *
+   * A StringView is serialized as a string. Receiving a string argument as a
+   * StringView avoids copying it out of the message it came in, the view then
+   * referencing the data of the message.
+   */
+  class QI_API StringView
+  {
+  public:
+    using const_iterator = const char*;
+
+    /// \brief Constructs an empty string view.
+    StringView();
+    /// \brief Constructs a view on a copy of the string.
+    StringView(const std::string& str);
+    /// \brief Constructs a view on a copy of the null-terminated string.
+    StringView(const char* str);
+    /// \brief Constructs a view on the same bytes as the buffer view.
+    explicit StringView(const BufferView& view);
+
+    /// \brief Return a pointer to the first character. The characters are
+    /// not null-terminated.
+    const char* data() const { return _data; }
+    /// \brief Return the number of characters.
+    std::size_t size() const { return _size; }
+    /// \brief Return whether the string is empty.
+    bool empty() const { return _size == 0; }
+
+    const_iterator begin() const { return _data; }
+    const_iterator end() const { return _data + _size; }
+
+    /// \brief Return a copy of the characters as a std::string.
+    std::string toString() const { return std::string(_data, _size); }
+
+  private:
+    // CS4251
+    boost::shared_ptr<const void> _owner;
+    const char* _data;
+    std::size_t _size;
+  };
+
+  QI_API bool operator==(const StringView& a, const StringView& b);
+  inline bool operator!=(const StringView& a, const StringView& b) { return !(a == b); }
+  QI_API bool operator<(const StringView& a, const StringView& b);
+
+  QI_API std::ostream& operator<<(std::ostream& o, const StringView& s);
+}
+
+KA_WARNING_POP()
+
+#endif  // _QI_BUFFERVIEW_HPP_
@@ -81,7 +81,7 @@ namespace detail {
             promise, [&continuation, &future]() mutable { return continuation(future); });
     };
 
-    _p->connect(*this, adaptedContinuation, callbackType);
+    _p->connect(*this, std::move(adaptedContinuation), callbackType);
     return promise.future();
   }
 
@@ -119,7 +119,7 @@ namespace detail {
               promise, [&continuation, &future]() mutable { return continuation(future.value()); });
     };
 
-    _p->connect(*this, adaptedContinuation, callbackType);
+    _p->connect(*this, std::move(adaptedContinuation), callbackType);
     return promise.future();
   }
 
@@ -160,17 +160,25 @@ namespace detail {
 
     template <typename T>
     FutureBaseTyped<T>::FutureBaseTyped()
-      : _value()
+      : _inlineCallbackCount(0)
+      , _onResult(nullptr)
+      , _value()
       , _async(FutureCallbackType_Auto)
+      , _settled(false)
     {
+      _handlersLock.clear();
     }
 
     template <typename T>
     FutureBaseTyped<T>::~FutureBaseTyped()
     {
-      boost::recursive_mutex::scoped_lock lock(mutex());
       if (_onDestroyed && state() == FutureState_FinishedWithValue)
         _onDestroyed(_value);
+
+      // Callbacks of a state that was never set.
+      const auto callbacks = _onResult.load();
+      if (callbacks != closedCallbacks())
+        deleteCallbacks(callbacks);
     }
 
     template <typename T>
@@ -178,14 +186,10 @@ namespace detail {
     {
       // optional necessary in case of error, see ka::invoke_catch() usage below
       auto cancelImpl = [&]() -> boost::optional<std::string> {
-        CancelCallback onCancel;
-        {
-          boost::recursive_mutex::scoped_lock lock(mutex());
-          if (isFinished())
-            return {};
-          requestCancel();
-          std::swap(onCancel, _onCancel);
-        }
+        if (_settled.load() || isFinished())
+          return {};
+        requestCancel();
+        CancelCallback onCancel = exchangeCancelCallback(CancelCallback());
         if (onCancel)
         {
           qi::Promise<T> prom(future);
@@ -204,22 +208,24 @@ namespace detail {
     template <typename T>
     void FutureBaseTyped<T>::setOnCancel(const qi::Promise<T>& promise, CancelCallback onCancel)
     {
-      bool doCancel = false;
+      // The previous callback is destroyed outside of the lock.
+      exchangeCancelCallback(std::move(onCancel));
+
+      // A concurrent cancel() either took the new callback, or requested the
+      // cancel before we stored it.
+      if (isCancelRequested())
       {
-        boost::recursive_mutex::scoped_lock lock(mutex());
-        _onCancel = onCancel;
-        doCancel = isCancelRequested();
-      }
-      qi::Future<T> fut = promise.future();
-      if (doCancel)
+        qi::Future<T> fut = promise.future();
         cancel(fut);
+      }
     }
 
     template <typename T>
-    void FutureBaseTyped<T>::executeCallbacks(bool defaultAsync, const Callbacks& callbacks, qi::Future<T>& future)
+    void FutureBaseTyped<T>::executeCallbacks(bool defaultAsync, Callback* callbacks, qi::Future<T>& future)
     {
-      for (const auto& callback : callbacks)
+      while (callbacks)
       {
+        Callback& callback = *callbacks;
         const bool async = [&]{
           if (callback.callType != FutureCallbackType_Auto)
             return callback.callType != FutureCallbackType_Sync;
@@ -245,6 +251,10 @@ namespace detail {
           {
             qiLogError("qi.future") << "Unknown exception caught in future callback";
           }
+
+        callbacks = callback.next;
+        callback.next = nullptr;
+        deleteCallbacks(&callback);
       }
     }
 
@@ -252,25 +262,28 @@ namespace detail {
     template <typename F> // FunctionObject<R()> F (R unconstrained)
     void FutureBaseTyped<T>::finish(qi::Future<T>& future, F&& finishTask)
     {
-      bool async;
-      Callbacks onResult;
+      // Only the first setter goes past this point. The state is published by
+      // `finishTask`, before the callback stack is closed, so that a concurrent
+      // connect() that finds the stack closed sees the result.
+      if (!isRunning() || _settled.exchange(true))
+        throw FutureException(FutureException::ExceptionState_PromiseAlreadySet);
+      try
       {
-        // report-ready + onResult() must be Atomic to avoid
-        // missing callbacks/double calls in case connect() is invoked at
-        // the same time
-        boost::recursive_mutex::scoped_lock lock(mutex());
-        if (!isRunning())
-          throw FutureException(FutureException::ExceptionState_PromiseAlreadySet);
         finishTask();
+      }
+      catch (...)
+      {
+        _settled = false;
+        throw;
+      }
 
-        async = (_async != FutureCallbackType_Sync ? true : false);
-        onResult = takeOutResultCallbacks();
-        clearCancelCallback();
+      const bool async = (_async != FutureCallbackType_Sync ? true : false);
+      const auto onResult = takeOutResultCallbacks();
+      clearCancelCallback();
+
+      // wake the waiting threads up
+      notifyFinish();
 
-        // wake the waiting threads up
-        notifyFinish();
-      }
-      // call the callbacks without the mutex
       executeCallbacks(async, onResult, future);
     }
 
@@ -318,50 +331,60 @@ namespace detail {
     template <typename T>
     void FutureBaseTyped<T>::setOnDestroyed(boost::function<void(ValueType)> f)
     {
-      boost::recursive_mutex::scoped_lock lock(mutex());
-      _onDestroyed = f;
+      withHandlersLock([&] {
+        using std::swap;
+        swap(_onDestroyed, f);
+      });
     }
 
     template <typename T>
     void FutureBaseTyped<T>::connect(qi::Future<T> future,
-                                  const boost::function<void(qi::Future<T>)>& callback,
+                                  boost::function<void(qi::Future<T>)> callback,
                                   FutureCallbackType type)
     {
       if (state() == FutureState_None)
         throw FutureException(FutureException::ExceptionState_FutureInvalid);
 
-      bool ready;
+      auto head = _onResult.load(std::memory_order_acquire);
+      if (head != closedCallbacks())
       {
-        boost::recursive_mutex::scoped_lock lock(mutex());
-        ready = isFinished();
-        if (!ready)
-          _onResult.push_back(Callback(callback, type));
+        Callback* const pending = newCallback(std::move(callback), type);
+        do
+        {
+          pending->next = head;
+          if (_onResult.compare_exchange_weak(head, pending,
+                                              std::memory_order_release,
+                                              std::memory_order_acquire))
+            return;
+        } while (head != closedCallbacks());
+
+        // The state was set in the meantime.
+        callback = std::move(pending->callback);
+        pending->next = nullptr;
+        deleteCallbacks(pending);
       }
 
       // result already ready, notify the callback
-      if (ready)
-      {
-        const bool async = [&]{
-          if (type != FutureCallbackType_Auto)
-            return type != FutureCallbackType_Sync;
-          else
-            return _async != FutureCallbackType_Sync;
-        }();
-
-        auto soCalledEventLoop = getEventLoop();
-        if (async && soCalledEventLoop)
-        { // if no event loop was found (for example when exiting), force sync callbacks
-          soCalledEventLoop->post(boost::bind(callback, future));
-        }
+      const bool async = [&]{
+        if (type != FutureCallbackType_Auto)
+          return type != FutureCallbackType_Sync;
         else
+          return _async != FutureCallbackType_Sync;
+      }();
+
+      auto soCalledEventLoop = getEventLoop();
+      if (async && soCalledEventLoop)
+      { // if no event loop was found (for example when exiting), force sync callbacks
+        soCalledEventLoop->post(boost::bind(callback, future));
+      }
+      else
+      {
+        try
         {
-          try
-          {
-            callback(future);
-          }
-          catch (const ::qi::PointerLockException&)
-          { /*do nothing*/
-          }
+          callback(future);
+        }
+        catch (const ::qi::PointerLockException&)
+        { /*do nothing*/
         }
       }
     }
@@ -382,18 +405,78 @@ namespace detail {
     }
 
     template <typename T>
-    auto FutureBaseTyped<T>::takeOutResultCallbacks() -> Callbacks
+    auto FutureBaseTyped<T>::closedCallbacks() -> Callback*
+    {
+      return reinterpret_cast<Callback*>(&_onResult);
+    }
+
+    template <typename T>
+    auto FutureBaseTyped<T>::newCallback(CallbackType callback, FutureCallbackType type) -> Callback*
     {
-      Callbacks onResult;
-      using std::swap;
-      swap(onResult, _onResult);
-      return onResult;
+      // Concurrent connections may overshoot the count, in which case they
+      // just fall back to the heap.
+      if (_inlineCallbackCount.load(std::memory_order_relaxed) < InlineCallbackCount)
+      {
+        const auto index = _inlineCallbackCount++;
+        if (index < InlineCallbackCount)
+          return new (&_inlineCallbacks[index]) Callback{ std::move(callback), type, nullptr, true };
+      }
+      return new Callback{ std::move(callback), type, nullptr, false };
+    }
+
+    template <typename T>
+    void FutureBaseTyped<T>::deleteCallbacks(Callback* callbacks)
+    {
+      while (callbacks)
+      {
+        Callback* const next = callbacks->next;
+        if (callbacks->isInline)
+          callbacks->~Callback();
+        else
+          delete callbacks;
+        callbacks = next;
+      }
+    }
+
+    template <typename T>
+    auto FutureBaseTyped<T>::takeOutResultCallbacks() -> Callback*
+    {
+      Callback* stack = _onResult.exchange(closedCallbacks(), std::memory_order_acq_rel);
+      Callback* ordered = nullptr;
+      while (stack)
+      {
+        Callback* const next = stack->next;
+        stack->next = ordered;
+        ordered = stack;
+        stack = next;
+      }
+      return ordered;
+    }
+
+    template <typename T>
+    template <typename F> // FunctionObject<void()> F
+    void FutureBaseTyped<T>::withHandlersLock(F&& f)
+    {
+      while (_handlersLock.test_and_set(std::memory_order_acquire))
+        std::this_thread::yield();
+      auto _ = ka::scoped([&] { _handlersLock.clear(std::memory_order_release); });
+      f();
+    }
+
+    template <typename T>
+    auto FutureBaseTyped<T>::exchangeCancelCallback(CancelCallback onCancel) -> CancelCallback
+    {
+      withHandlersLock([&] {
+        using std::swap;
+        swap(onCancel, _onCancel);
+      });
+      return onCancel;
     }
 
     template <typename T>
     void FutureBaseTyped<T>::clearCancelCallback()
     {
-      _onCancel.clear();
+      exchangeCancelCallback(CancelCallback());
     }
 
     template <typename T>
@@ -7,13 +7,16 @@
 #ifndef _QI_FUTURE_HPP_
 # define _QI_FUTURE_HPP_
 
+# include <atomic>
 # include <stdexcept>
+# include <thread>
 # include <type_traits>
 # include <vector>
 
 # include <ka/functional.hpp>
 # include <ka/errorhandling.hpp>
 # include <ka/macro.hpp>
+# include <ka/scoped.hpp>
 # include <qi/api.hpp>
 # include <qi/assert.hpp>
 # include <qi/atomic.hpp>
@@ -955,6 +958,9 @@ namespace qi {
       FutureBase();
       ~FutureBase();
 
+      FutureBase(const FutureBase&) = delete;
+      FutureBase& operator=(const FutureBase&) = delete;
+
       FutureState wait(int msecs) const;
       FutureState wait(qi::Duration duration) const;
       FutureState wait(qi::SteadyClock::time_point timepoint) const;
@@ -973,15 +979,30 @@ namespace qi {
       void reportError(const std::string &message);
       void requestCancel();
       void reportCanceled();
-      boost::recursive_mutex& mutex();
       void notifyFinish();
 
-    public:
-      FutureBasePrivate *_p;
+    private:
+      template <typename F>
+      FutureState blockingWait(F waitOnCondition) const;
+
+      /// Data only needed to block on the future, created by the first thread
+      /// that has to wait.
+      FutureBasePrivate& waitData() const;
+
+      std::atomic<FutureState> _state;
+      std::atomic<bool> _cancelRequested;
+      mutable std::atomic<unsigned int> _waiterCount;
+      std::string _error;
+      mutable std::atomic<FutureBasePrivate*> _p;
     };
 
 
     //common state shared between a Promise and multiple Futures
+    //
+    // Setting the state and connecting callbacks do not take any lock: the
+    // callbacks are pushed on a lock-free stack, that the setter closes once
+    // the state is set. The first callbacks are stored inside the state
+    // itself, so that most futures do not allocate anything but their state.
     template <typename T>
     class FutureBaseTyped : public FutureBase {
     public:
@@ -1005,7 +1026,7 @@ namespace qi {
       void setOnDestroyed(boost::function<void (ValueType)> f);
 
       void connect(qi::Future<T> future,
-          const boost::function<void (qi::Future<T>)> &callback,
+          boost::function<void (qi::Future<T>)> callback,
           FutureCallbackType type);
 
       const ValueType& value(int msecs) const;
@@ -1017,30 +1038,53 @@ namespace qi {
       {
         CallbackType callback;
         FutureCallbackType callType;
-
-        Callback(CallbackType callback, FutureCallbackType callType)
-          : callback(callback)
-          , callType(callType)
-        {}
+        Callback* next;
+        bool isInline;
       };
-      using Callbacks = std::vector<Callback>;
-      Callbacks                _onResult;
+
+      /// Number of callbacks that can be stored without allocating memory.
+      static const unsigned int InlineCallbackCount = 2;
+      using CallbackStorage =
+        typename std::aligned_storage<sizeof(Callback), alignof(Callback)>::type;
+
+      CallbackStorage          _inlineCallbacks[InlineCallbackCount];
+      std::atomic<unsigned int> _inlineCallbackCount;
+      /// Stack of the callbacks to call once the state is set, most recent
+      /// first, or `closedCallbacks()` once it is set.
+      std::atomic<Callback*>   _onResult;
       ValueType                _value;
+      /// Protects `_onCancel` and `_onDestroyed`, which are only held for the
+      /// time of a swap.
+      std::atomic_flag         _handlersLock;
       CancelCallback           _onCancel;
       boost::function<void (ValueType)> _onDestroyed;
       std::atomic<FutureCallbackType> _async;
+      std::atomic<bool>        _settled;
       qi::Atomic<unsigned int> _promiseCount;
 
       template <typename F> // FunctionObject<R()> F (R unconstrained)
       void finish(qi::Future<T>& future, F&& finishTask);
 
-      /// Take the callbacks set for handling the result and leave the member empty. Not thread-safe.
-      Callbacks takeOutResultCallbacks();
+      /// Marker stored in `_onResult` once the state is set. Never dereferenced.
+      Callback* closedCallbacks();
+
+      Callback* newCallback(CallbackType callback, FutureCallbackType type);
+      static void deleteCallbacks(Callback* callbacks);
+
+      /// Close the callback stack and return its callbacks in connection order.
+      Callback* takeOutResultCallbacks();
+
+      template <typename F> // FunctionObject<void()> F
+      void withHandlersLock(F&& f);
+
+      /// Replace the cancel callback and return the previous one, so that it
+      /// is called or destroyed without the lock.
+      CancelCallback exchangeCancelCallback(CancelCallback onCancel);
 
-      /// Clear the callback set for handling cancellation. Not thread-safe.
+      /// Clear the callback set for handling cancellation.
       void clearCancelCallback();
 
-      static void executeCallbacks(bool defaultAsync, const Callbacks& callbacks, qi::Future<T>& future);
+      static void executeCallbacks(bool defaultAsync, Callback* callbacks, qi::Future<T>& future);
     };
   }
 
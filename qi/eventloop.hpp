@@ -43,6 +43,12 @@ namespace qi
      *   - the value of the environment variable QI_EVENTLOOP_THREAD_COUNT if it's set,
      *   - the value returned by std::thread::hardware_concurrency() if it's greater than 3,
      *   - the fixed value of 3.
+     *
+     * If the environment variable QI_EVENTLOOP_WORK_STEALING is set to a true
+     * value, each thread of the event loop has its own queue of tasks and idle
+     * threads steal tasks from the others, instead of all threads sharing a
+     * single queue. Tasks posted from a thread of the event loop go to the
+     * queue of this thread.
      */
     explicit EventLoop(std::string name = "eventloop", int nthreads = 0, bool spawnOnOverload = true);
 
@@ -348,6 +348,10 @@ namespace qi {
      * \param file Filename from which this function was called (ex: __FILE__).
      * \param fct Function name from which this function was called (ex: __FUNCTION__).
      * \param line Line from which this function was called (ex: __LINE__).
+     *
+     * When logs are asynchronous, the message is copied but `file` and `fct`
+     * are not: they must stay valid until the record is dispatched, which
+     * string literals do.
      */
     QI_API void log(const qi::LogLevel verb,
                     const char*        category,
@@ -535,6 +539,10 @@ namespace qi {
      *
      * When setting to async, this function must be called after main has
      * started.
+     *
+     * Asynchronous records are buffered per thread and dispatched by a log
+     * thread. If the buffer of a thread is full, its records are dropped and a
+     * warning reporting how many were lost is logged in the "qi.log" category.
      */
     QI_API void setSynchronousLog(bool sync);
 
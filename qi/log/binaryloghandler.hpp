@@ -0,0 +1,113 @@
+#pragma once
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#ifndef _QI_LOG_BINARYLOGHANDLER_HPP_
+#define _QI_LOG_BINARYLOGHANDLER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <boost/noncopyable.hpp>
+#include <qi/log.hpp>
+
+namespace qi
+{
+namespace log
+{
+  struct PrivateBinaryLogHandler;
+
+  /**
+   * \brief Writes logs to memory-mapped files, in a compact binary format.
+   * \includename{qi/log/binaryloghandler.hpp}
+   *
+   * \verbatim
+   * Records are appended to a memory-mapped file of *fileSize* bytes, without
+   * formatting them and without flushing the file after each of them. When the
+   * file is full, it is truncated to its content and rotated: *filePath* is
+   * renamed to *filePath*.1, *filePath*.1 to *filePath*.2 and so on, keeping at
+   * most *fileCount* files.
+   *
+   * Categories and source locations are written once per file and then
+   * referred to by identifier. Files are decoded back to the text or CSV
+   * formats of the other handlers by `tools/qilogdecode.py`.
+   *
+   * File layout (integers are little-endian, varints are LEB128)::
+   *
+   *   header:   "QILOGBIN", u32 version, u32 header size, u64 end of data,
+   *             i64 base date (us), i64 base system date (us)
+   *   entries:  varint tag, followed by
+   *     0 category:  varint id, varint size, name
+   *     1 location:  varint id, varint line, varint size, file,
+   *                  varint size, function
+   *     2 record:    zigzag varint date delta (us),
+   *                  zigzag varint system date delta (us),
+   *                  varint (category id << 3 | level), varint location id,
+   *                  varint thread id, varint size, message
+   * \endverbatim
+   */
+  class QI_API BinaryLogHandler : private boost::noncopyable
+  {
+  public:
+    /**
+     * \brief Creates the file, and its directory if needed.
+     * \param filePath path to the file.
+     * \param fileSize maximum size of a file, in bytes.
+     * \param fileCount maximum number of files, including the current one.
+     *
+     * \verbatim
+     * .. warning::
+     *
+     *      If the file could not be created, it logs a warning and every log
+     *      call will silently fail.
+     * \endverbatim
+     */
+    explicit BinaryLogHandler(const std::string& filePath,
+                              std::size_t fileSize = 1024 * 1024,
+                              unsigned int fileCount = 2);
+
+    /**
+     * \brief Truncates the current file to its content and closes it.
+     */
+    virtual ~BinaryLogHandler();
+
+    /**
+     * \brief Appends the log message to the file.
+     * \param verb verbosity of the log message.
+     * \param date qi::Clock date at which the log message was issued.
+     * \param systemDate qi::SystemClock date at which the log message was issued.
+     * \param category category of the log message.
+     * \param msg message to log.
+     * \param file filename in the sources from which this log message was issued.
+     * \param fct function name from which this log message was issued.
+     * \param line line number in the issuer file.
+     */
+    void log(const qi::LogLevel verb,
+             const qi::Clock::time_point date,
+             const qi::SystemClock::time_point systemDate,
+             const char* category,
+             const char* msg,
+             const char* file,
+             const char* fct,
+             const int line);
+
+    /**
+     * \brief Return the number of records that were dropped because they
+     * would not fit in an empty file.
+     *
+     * Messages are truncated to half of the file, but records whose category
+     * or location is too long are dropped.
+     */
+    std::uint64_t droppedRecordCount() const;
+
+  private:
+    std::unique_ptr<PrivateBinaryLogHandler> _p;
+  }; // !BinaryLogHandler
+
+} // !log
+} // !qi
+
+#endif // _QI_LOG_BINARYLOGHANDLER_HPP_
@@ -117,6 +117,10 @@ namespace qi {
     qi::FutureSync<void> listen();
 
     /// Ignores the configuration listen URLs and uses the given one instead.
+    ///
+    /// Besides `tcp://` and `tcps://` URLs, `unix://<path>` listens to a unix
+    /// domain socket bound to the given path. Sessions of the same machine
+    /// connect to services through such endpoints rather than through TCP.
     qi::FutureSync<void> listen(const qi::Url &address);
 
     /// Ignores the configuration listen URLs and uses the given ones instead. If the parameter is
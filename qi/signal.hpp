@@ -33,6 +33,7 @@ namespace qi {
 
   class SignalBase;
   class SignalBasePrivate;
+  struct SignalTriggerState;
 
   using SignalLink = qi::uint64_t;
 
@@ -173,7 +174,12 @@ namespace qi {
   protected:
     boost::shared_ptr<SignalBasePrivate> _p;
     friend class SignalBasePrivate;
+    friend struct SignalTriggerState;
     friend void details_proxysignal::setUpProxy(SignalBase&, AnyWeakObject, const std::string&);
+
+  private:
+    void callSubscribersImpl(const SignalTriggerState& state,
+                             const GenericFunctionParameters& params, MetaCallType callType);
   };
 
   inline bool isValidSignalLink(SignalLink l)
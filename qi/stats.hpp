@@ -145,6 +145,72 @@ namespace qi
     MinMaxSum _user;
     MinMaxSum _system;
   };
+
+  /// Stores the median, 90th, 99th and 99.9th percentiles of a distribution.
+  class LatencyPercentiles
+  {
+  public:
+    /// Default constructor
+    LatencyPercentiles() : _p50(0), _p90(0), _p99(0), _p999(0) {}
+    /**
+     * \brief Constructor
+     * \param p50 Median value.
+     * \param p90 90th percentile.
+     * \param p99 99th percentile.
+     * \param p999 99.9th percentile.
+     */
+    LatencyPercentiles(float p50, float p90, float p99, float p999)
+      : _p50(p50), _p90(p90), _p99(p99), _p999(p999)
+    {}
+
+    /// Get median value
+    const float& p50()  const { return _p50;}
+    /// Get 90th percentile
+    const float& p90()  const { return _p90;}
+    /// Get 99th percentile
+    const float& p99()  const { return _p99;}
+    /// Get 99.9th percentile
+    const float& p999() const { return _p999;}
+  private:
+    float _p50;
+    float _p90;
+    float _p99;
+    float _p999;
+  };
+
+  /// Store the latency percentiles of method calls, in seconds.
+  class MethodPercentiles
+  {
+  public:
+    /// Constructor
+    MethodPercentiles()
+      : _count(0) {}
+    /**
+     * \brief Constructor and Set.
+     * \param count Number of calls.
+     * \param wall Wall time percentiles.
+     * \param user User time percentiles.
+     * \param system System time percentiles.
+     */
+    MethodPercentiles(unsigned count, LatencyPercentiles wall, LatencyPercentiles user,
+                      LatencyPercentiles system)
+      : _count(count), _wall(wall), _user(user), _system(system)
+    {}
+
+    /// Get number of calls.
+    const unsigned int& count() const       { return _count;}
+    /// Get wall time percentiles.
+    const LatencyPercentiles& wall() const   { return _wall;}
+    /// Get user time percentiles.
+    const LatencyPercentiles& user() const   { return _user;}
+    /// Get system time percentiles.
+    const LatencyPercentiles& system() const { return _system;}
+  private:
+    unsigned int _count;
+    LatencyPercentiles _wall;
+    LatencyPercentiles _user;
+    LatencyPercentiles _system;
+  };
 }
 
 #endif // !_QI_STATS_HPP_
@@ -47,17 +47,22 @@ public:
 
   struct Callback;
 
-  using Queue = std::deque<boost::shared_ptr<Callback>>;
+  // Lock-free queue of the callbacks waiting to be processed.
+  class Queue;
 
   qi::ExecutionContext& _executor;
   std::atomic<unsigned int> _curId;
   std::atomic<unsigned int> _aliveCount;
-  bool _processing; // protected by mutex, no need for atomic
+  // Number of callbacks pushed in the queue and not processed yet. The
+  // producer that makes it leave 0 schedules the processing, which then runs
+  // until it gets back to 0.
+  std::atomic<unsigned int> _pendingCount;
+  std::atomic<bool> _processing; // true while the processing may execute callbacks
   std::atomic<int> _processingThread;
-  boost::recursive_mutex _mutex;
+  boost::recursive_mutex _mutex; // protects the deferred tasks and the joining
   boost::condition_variable_any _processFinished;
-  bool _dying;
-  Queue _queue;
+  std::atomic<bool> _dying;
+  std::unique_ptr<Queue> _queue;
   class ScopedPromiseGroup;
   std::shared_ptr<ScopedPromiseGroup> _deferredTasksFutures; // Shared to avoid including issues
 
@@ -82,6 +87,7 @@ public:
 
   void process();
   void cancel(boost::shared_ptr<Callback> cbStruct);
+  void clearQueue();
   bool isInThisContext() const override;
 
   void postImpl(boost::function<void()> callback, ExecutionOptions options) override
@@ -95,8 +101,8 @@ public:
 
   using ExecutionContext::async;
 private:
-  void stopProcess(boost::recursive_mutex::scoped_lock& lock,
-                   bool finished);
+  void startProcess();
+  void stopProcess();
 
   bool joined = false;
 
@@ -39,6 +39,9 @@ namespace qi {
     /// @warning you should destroy the returned value or no, depending on how the AnyValue was initialized.
     AnyReference release() {
       AnyReference ref = AnyReference(_type, _value);
+      // The caller becomes the owner of the value: it cannot stay in place.
+      if (isInPlace())
+        ref = ref.clone();
       _allocated = false;
       _value = 0;
       _type = 0;
@@ -112,7 +115,20 @@ namespace qi {
 
     //we dont accept GVP here.  (block set<T> with T=GVP)
     void set(const AnyReference& t);
+
+    /// Constructs in place a copy of the value of the storage `src`, or a
+    /// default value if it is null.
+    /// @return false if values of this type cannot be constructed in place.
+    bool resetInPlace(TypeInterface* type, void* src);
+    bool isInPlace() const { return _value == &_inPlace; }
+    /// Takes the value of `b`, which was just moved from.
+    void moveInPlace(AnyValue& b);
+
     bool _allocated;
+    // Small values, such as numbers, are stored here instead of being
+    // allocated. Moving the AnyValue then moves them: references to them
+    // become invalid.
+    detail::InPlaceStorage _inPlace;
   };
 
   /// Less than operator. Will compare the values within the AnyValue.
@@ -119,12 +119,13 @@ inline AnyValue::AnyValue(AnyValue&& b) KA_NOEXCEPT(true)
 : AnyReferenceBase(std::move(b))
 , _allocated(ka::exchange(b._allocated, false))
 {
+  moveInPlace(b);
 }
 
 inline AnyValue::AnyValue(qi::TypeInterface *type)
-  : AnyReferenceBase(type)
-  , _allocated(true)
+  : _allocated(false)
 {
+  reset(type);
 }
 
 inline AnyValue::AnyValue(const AnyReference& b, bool copy, bool free)
@@ -142,7 +143,7 @@ inline AnyValue::AnyValue(const AutoAnyReference& b)
 template<typename T>
 AnyValue AnyValue::make()
 {
-  return AnyValue(AnyReference(typeOf<T>()), false, true);
+  return AnyValue(typeOf<T>());
 }
 
 inline AnyValue& AnyValue::operator=(const AnyValue& b)
@@ -162,6 +163,7 @@ inline AnyValue& AnyValue::operator=(AnyValue&& b)
   resetUnsafe();
   static_cast<AnyReferenceBase&>(*this) = std::move(b);
   _allocated = ka::exchange(b._allocated, false);
+  moveInPlace(b);
   return *this;
 }
 
@@ -178,6 +180,8 @@ inline void AnyValue::reset(const AnyReference& b)
 
 inline void AnyValue::reset(const AnyReference& b, bool copy, bool free)
 {
+  if (copy && free && b.type() && resetInPlace(b.type(), b.rawValue()))
+    return;
   reset();
   *(AnyReferenceBase*)this = b;
   _allocated = free;
@@ -187,7 +191,8 @@ inline void AnyValue::reset(const AnyReference& b, bool copy, bool free)
 
 inline void AnyValue::resetUnsafe()
 {
-  if (_allocated)
+  // Values constructed in place need no destruction.
+  if (_allocated && !isInPlace())
     AnyReferenceBase::destroy();
 }
 
@@ -200,6 +205,8 @@ inline void AnyValue::reset()
 
 inline void AnyValue::reset(qi::TypeInterface *ttype)
 {
+  if (resetInPlace(ttype, nullptr))
+    return;
   reset();
   _allocated = true;
   _type = ttype;
@@ -213,8 +220,34 @@ inline AnyValue::~AnyValue()
 
 inline void AnyValue::swap(AnyValue& b)
 {
-  std::swap((::qi::AnyReference&)*this, (::qi::AnyReference&)b);
-  std::swap(_allocated, b._allocated);
+  AnyValue tmp(std::move(b));
+  b = std::move(*this);
+  *this = std::move(tmp);
+}
+
+inline bool AnyValue::resetInPlace(TypeInterface* type, void* src)
+{
+  const std::size_t size = type->inPlaceSize();
+  if (size == 0 || size > sizeof(_inPlace))
+    return false;
+  // The source may be our own value: copy it before resetting.
+  detail::InPlaceStorage copy;
+  if (!type->initializeStorageInPlace(&copy, src))
+    return false;
+  reset();
+  _inPlace = copy;
+  _type = type;
+  _value = &_inPlace;
+  _allocated = true;
+  return true;
+}
+
+inline void AnyValue::moveInPlace(AnyValue& b)
+{
+  if (_value != &b._inPlace)
+    return;
+  _inPlace = b._inPlace;
+  _value = &_inPlace;
 }
 
 inline bool operator != (const AnyValue& a, const AnyValue& b)
@@ -16,7 +16,7 @@ namespace qi
   public:
     std::pair<char*, size_t> get(void *storage) override
     {
-      Buffer* b = (Buffer*)Methods::ptrFromStorage(&storage);
+      const Buffer* b = (const Buffer*)Methods::ptrFromStorage(&storage);
 
       // TODO: sub-buffers
       if (b->subBuffers().size() != 0)
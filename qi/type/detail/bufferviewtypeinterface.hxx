@@ -0,0 +1,57 @@
+#pragma once
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#ifndef _QITYPE_DETAIL_TYPEBUFFERVIEW_HXX_
+#define _QITYPE_DETAIL_TYPEBUFFERVIEW_HXX_
+
+#include <qi/bufferview.hpp>
+
+namespace qi
+{
+  /// Setting a view from raw data makes it own a copy of the data: only the
+  /// binary decoder makes views reference the data of a message.
+  class TypeStringViewImpl: public StringTypeInterface
+  {
+  public:
+    using Methods = DefaultTypeImplMethods<StringView, TypeByPointerPOD<StringView>>;
+    ManagedRawString get(void* storage) override
+    {
+      const StringView* s = (const StringView*)Methods::ptrFromStorage(&storage);
+      return ManagedRawString(RawString(const_cast<char*>(s->data()), s->size()), Deleter());
+    }
+    void set(void** storage, const char* ptr, size_t sz) override
+    {
+      StringView* s = (StringView*)Methods::ptrFromStorage(storage);
+      *s = StringView(std::string(ptr, sz));
+    }
+    _QI_BOUNCE_TYPE_METHODS(Methods);
+  };
+
+  template<> class TypeImpl<StringView>: public TypeStringViewImpl {};
+
+  class TypeBufferViewImpl: public RawTypeInterface
+  {
+  public:
+    using Methods = DefaultTypeImplMethods<BufferView, TypeByPointerPOD<BufferView>>;
+    std::pair<char*, size_t> get(void* storage) override
+    {
+      const BufferView* b = (const BufferView*)Methods::ptrFromStorage(&storage);
+      return std::make_pair(const_cast<char*>(b->data()), b->size());
+    }
+    void set(void** storage, const char* ptr, size_t sz) override
+    {
+      Buffer buffer;
+      buffer.write(ptr, sz);
+      BufferView* b = (BufferView*)Methods::ptrFromStorage(storage);
+      *b = BufferView(buffer);
+    }
+    _QI_BOUNCE_TYPE_METHODS(Methods);
+  };
+
+  template<> class TypeImpl<BufferView>: public TypeBufferViewImpl {};
+}
+
+#endif  // _QITYPE_DETAIL_TYPEBUFFERVIEW_HXX_
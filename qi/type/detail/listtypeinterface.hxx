@@ -7,6 +7,9 @@
 #ifndef _QITYPE_DETAIL_TYPELIST_HXX_
 #define _QITYPE_DETAIL_TYPELIST_HXX_
 
+#include <type_traits>
+#include <vector>
+
 #include <qi/atomic.hpp>
 
 #include <qi/type/detail/anyreference.hpp>
@@ -27,6 +30,8 @@ public:
   AnyIterator begin(void* storage) override;
   AnyIterator end(void* storage) override;
   void pushBack(void** storage, void* valueStorage) override;
+  void* contiguousData(void* storage) override;
+  void* resizeContiguous(void** storage, size_t size) override;
   _QI_BOUNCE_TYPE_METHODS(MethodsImpl);
   TypeInterface* _elementType;
 };
@@ -109,6 +114,59 @@ void ListTypeInterfaceImpl<T, H>::pushBack(void **storage, void* valueStorage)
   detail::pushBack(*ptr, (typename T::value_type*)_elementType->ptrFromStorage(&valueStorage));
 }
 
+namespace detail
+{
+  // Containers whose elements are arithmetic values laid out contiguously
+  // in memory, with the same representation as in the binary format.
+  template<typename T>
+  struct IsContiguousArithmeticList : std::false_type {};
+
+  template<typename E, typename A>
+  struct IsContiguousArithmeticList<std::vector<E, A>>
+    : std::integral_constant<bool,
+                             std::is_arithmetic<E>::value
+                             && !std::is_same<E, bool>::value
+                             && (sizeof(E) == 1 || sizeof(E) == 2
+                                 || sizeof(E) == 4 || sizeof(E) == 8)> {};
+
+  template<typename T>
+  void* contiguousData(T& container, std::true_type)
+  {
+    return container.data();
+  }
+  template<typename T>
+  void* contiguousData(T&, std::false_type)
+  {
+    return nullptr;
+  }
+
+  template<typename T>
+  void* resizeContiguous(T& container, size_t size, std::true_type)
+  {
+    container.resize(size);
+    return container.data();
+  }
+  template<typename T>
+  void* resizeContiguous(T&, size_t, std::false_type)
+  {
+    return nullptr;
+  }
+}
+
+template<typename T, typename H>
+void* ListTypeInterfaceImpl<T, H>::contiguousData(void* storage)
+{
+  T* ptr = (T*) ptrFromStorage(&storage);
+  return detail::contiguousData(*ptr, detail::IsContiguousArithmeticList<T>{});
+}
+
+template<typename T, typename H>
+void* ListTypeInterfaceImpl<T, H>::resizeContiguous(void** storage, size_t size)
+{
+  T* ptr = (T*) ptrFromStorage(storage);
+  return detail::resizeContiguous(*ptr, size, detail::IsContiguousArithmeticList<T>{});
+}
+
 template<typename T, typename H>
 size_t ListTypeInterfaceImpl<T, H>::size(void* storage)
 {
@@ -157,6 +215,13 @@ public:
     void* vstor = adaptStorage(storage);
     BaseClass::pushBack(&vstor, valueStorage);
   }
+  void* contiguousData(void* storage) override {
+    return BaseClass::contiguousData(adaptStorage(&storage));
+  }
+  void* resizeContiguous(void** storage, size_t size) override {
+    void* vstor = adaptStorage(storage);
+    return BaseClass::resizeContiguous(&vstor, size);
+  }
 
   //ListTypeInterface* _list;
 };
@@ -9,6 +9,7 @@
 
 #include <memory>
 #include <algorithm>
+#include <vector>
 #include <boost/function.hpp>
 
 
@@ -88,6 +89,35 @@ namespace qi {
     unsigned int     _calleeContext; // context where method runs
   };
 
+  /// Fixed-size event recorded when binary tracing is enabled on an object.
+  /// Unlike EventTrace, it does not hold the arguments, but an optional
+  /// digest of them.
+  struct CallTraceEvent
+  {
+    unsigned int          objectUid; // Manageable::traceUid() of the object
+    unsigned int          id; // process-unique, used to match call and call result
+    EventTrace::EventKind kind;
+    unsigned int          slotId;
+    qi::int64_t           timestamp; // microseconds since the epoch
+    qi::int64_t           postTimestamp; // microseconds since the epoch, 0 if not posted
+    qi::int64_t           userUsTime;
+    qi::int64_t           systemUsTime;
+    unsigned int          callerContext;
+    unsigned int          calleeContext;
+    qi::uint64_t          argumentsDigest; // 0 if the arguments were not sampled
+
+    QI_API EventTrace toEventTrace() const;
+  };
+
+  /// Moves at most \p maxCount events recorded by binary tracing into
+  /// \p events, oldest events of each thread first.
+  /// @return the number of events appended.
+  QI_API std::size_t drainCallTraceEvents(std::vector<CallTraceEvent>& events,
+                                          std::size_t maxCount = 4096);
+
+  /// @return the number of events dropped because the buffer of a thread was
+  /// full, since the previous call.
+  QI_API qi::uint64_t takeDroppedCallTraceEventCount();
 }
 
 QI_TYPE_STRUCT_AGREGATE_CONSTRUCTOR(qi::MinMaxSum,
@@ -101,6 +131,18 @@ QI_TYPE_STRUCT_AGREGATE_CONSTRUCTOR(qi::MethodStatistics,
   ("user",   user),
   ("system", system));
 
+QI_TYPE_STRUCT_AGREGATE_CONSTRUCTOR(qi::LatencyPercentiles,
+  ("p50",  p50),
+  ("p90",  p90),
+  ("p99",  p99),
+  ("p999", p999));
+
+QI_TYPE_STRUCT_AGREGATE_CONSTRUCTOR(qi::MethodPercentiles,
+  ("count",  count),
+  ("wall",   wall),
+  ("user",   user),
+  ("system", system));
+
 QI_TYPE_STRUCT_AGREGATE_CONSTRUCTOR(qi::EventTrace,
   ("id",            id),
   ("kind",          kind),
@@ -117,6 +159,7 @@ QI_TYPE_STRUCT(qi::os::timeval, tv_sec, tv_usec);
 namespace qi {
 
   using ObjectStatistics = std::map<unsigned int, MethodStatistics>;
+  using ObjectPercentiles = std::map<unsigned int, MethodPercentiles>;
 /** Per-instance context.
   */
   class QI_API Manageable
@@ -147,6 +190,10 @@ namespace qi {
     /// Push statistics information about \p slotId.
     void pushStats(int slotId, float wallTime, float userTime, float systemTime);
     ObjectStatistics stats() const;
+    /// Latency percentiles of each method, computed from histograms of the
+    /// same calls as stats(). Percentiles are known with a relative error
+    /// below 2%.
+    ObjectPercentiles statsPercentiles() const;
     /// Reset all statistical data
     void clearStats();
 
@@ -166,6 +213,24 @@ namespace qi {
     *
     */
     void enableTrace(bool enable);
+
+    ///@return if binary trace mode is enabled
+    bool isBinaryTraceEnabled() const;
+    /** Set binary trace mode state.
+    *
+    * When enabled, calls are recorded as CallTraceEvent in buffers owned by
+    * the calling threads, which are drained by drainCallTraceEvents() or
+    * TraceAnalyzer::addRecordedTraces(). This is much cheaper than the
+    * "traceObject" signal, that copies the arguments and the result of
+    * each call.
+    */
+    void enableBinaryTrace(bool enable);
+    /// Digest the arguments of one call out of \p period in binary trace
+    /// mode, never if 0 (the default).
+    void setTraceSamplingPeriod(unsigned int period);
+    unsigned int traceSamplingPeriod() const;
+    /// Process-unique identifier of the object in CallTraceEvent.
+    unsigned int traceUid() const;
     /// @}
 
     /// Starting id of features handled by Manageable
@@ -184,6 +249,8 @@ namespace qi {
     static MetaObject&      manageableMetaObject();
     static void             _build();
     int                     _nextTraceId();
+    /// @return if the arguments of the current call must be digested.
+    bool                    _sampleTraceArguments();
 
   private:
     std::unique_ptr<ManageablePrivate> _p;
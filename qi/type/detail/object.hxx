@@ -141,6 +141,10 @@ namespace detail {
     {
       return go()->stats();
     }
+    inline ObjectPercentiles statsPercentiles() const
+    {
+      return go()->statsPercentiles();
+    }
     inline void clearStats() const
     {
       return go()->clearStats();
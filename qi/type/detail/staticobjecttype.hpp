@@ -79,6 +79,10 @@ public:
   void* clone(void* inst) override;
   void destroy(void*) override;
   bool less(void* a, void* b) override;
+
+  /// @return the function of the method of the given id, or null if there is
+  /// no such method.
+  const AnyFunction* method(unsigned int id) const;
 private:
   MetaObject     _metaObject;
   ObjectTypeData _data;
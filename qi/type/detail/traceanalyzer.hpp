@@ -27,6 +27,13 @@ namespace qi
     void clear(const qi::os::timeval& limit);
     /// Add a new trace to the system. There is no order requirement between traces.
     void addTrace(const qi::EventTrace& e, unsigned int objectId);
+    /// Add an event recorded by binary tracing, see Manageable::enableBinaryTrace().
+    void addTrace(const qi::CallTraceEvent& e);
+    /** Drain the events recorded by binary tracing in all threads, in batches,
+     * and add them.
+     * @return the number of events added.
+     */
+    std::size_t addRecordedTraces();
     struct FlowLink
     {
       FlowLink(unsigned int srcObj, unsigned int srcFun, unsigned int dstObj, unsigned int dstFun, bool sync)
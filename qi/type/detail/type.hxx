@@ -50,6 +50,14 @@ namespace qi  {
     template<typename T>
     inline TypeInterface* typeOfBackend()
     {
+      // The type is resolved once per thread, and again only if types were
+      // registered since, so that lookups neither lock nor contend.
+      static thread_local TypeInterface* resolved = nullptr;
+      static thread_local unsigned int resolvedVersion = 0;
+      const unsigned int version = typeRegistryVersion();
+      if (resolved && resolvedVersion == version)
+        return resolved;
+
       TypeInterface* result = getType(qi::typeId<T>());
       if (!result)
       {
@@ -58,6 +66,8 @@ namespace qi  {
         QI_ONCE(initializeType<T>(defaultResult));
         result = defaultResult;
       }
+      resolved = result;
+      resolvedVersion = version;
       return result;
     }
 
@@ -124,6 +124,17 @@ namespace qi
     template<typename T>
     struct TypeManager<const T>: public TypeManager<T>{};
 
+    /// Whether values of T can be constructed in place by AnyValue.
+    template<typename T, bool = boost::is_pod<T>::value && !std::is_array<T>::value>
+    struct IsInPlaceConstructible : std::false_type
+    {};
+
+    template<typename T>
+    struct IsInPlaceConstructible<T, true>
+      : std::integral_constant<bool, sizeof(T) <= sizeof(InPlaceStorage)
+                                       && alignof(T) <= alignof(InPlaceStorage)>
+    {};
+
   }
 
   /* To avoid the diamond inheritance problem (interface inheritance between
@@ -167,6 +178,24 @@ namespace qi
       T* ptr = (T*)ptrFromStorage(&src);
       Manager::destroy(ptr);
     }
+
+    static std::size_t inPlaceSize()
+    {
+      return detail::IsInPlaceConstructible<T>::value ? sizeof(T) : 0;
+    }
+
+    static void* initializeStorageInPlace(void* buffer, void* src)
+    {
+      if (!detail::IsInPlaceConstructible<T>::value)
+        return nullptr;
+      // The storage of a value is a pointer to it, which can as well point
+      // to the buffer.
+      if (src)
+        Manager::cloneInPlace(buffer, ptrFromStorage(&src));
+      else
+        Manager::createInPlace(buffer);
+      return buffer;
+    }
   };
 
   // const ward
@@ -212,6 +241,16 @@ namespace qi
       T* ptr = (T*)ptrFromStorage(&storage);
       ptr->~T();
     }
+
+    static std::size_t inPlaceSize()
+    {
+      return 0;
+    }
+
+    static void* initializeStorageInPlace(void*, void*)
+    {
+      return nullptr;
+    }
   };
 
   // const ward
@@ -256,6 +295,16 @@ namespace qi
       Access::destroy(ptr);
     }
 
+    static std::size_t inPlaceSize()
+    {
+      return Access::inPlaceSize();
+    }
+
+    static void* initializeStorageInPlace(void* buffer, void* src)
+    {
+      return Access::initializeStorageInPlace(buffer, src);
+    }
+
     static bool less(void* a, void* b)
     {
       return ::qi::detail::Less<T>()((T*)ptrFromStorage(&a), (T*)ptrFromStorage(&b));
@@ -269,11 +318,20 @@ namespace qi
   void* ptrFromStorage(void**s) override { return Bounce::ptrFromStorage(s);}                       \
   bool  less(void* a, void* b) override { return Bounce::less(a, b);}
 
+  ///Implement in-place construction as bouncers to Bouncer. Only for types
+  ///which also bounce clone/destroy: values constructed in place are never
+  ///destroyed.
+#define _QI_BOUNCE_TYPE_METHODS_INPLACE(Bounce)                                                     \
+  std::size_t inPlaceSize() override { return Bounce::inPlaceSize();}                               \
+  void* initializeStorageInPlace(void* buffer, void* src = nullptr) override                        \
+  { return Bounce::initializeStorageInPlace(buffer, src);}
+
   ///Implement all methods of Type as bouncers to Bouncer
 #define _QI_BOUNCE_TYPE_METHODS(Bounce)                                                             \
   _QI_BOUNCE_TYPE_METHODS_NOCLONE(Bounce)                                                           \
   void* clone(void* ptr) override { return Bounce::clone(ptr);}                                     \
-  void destroy(void* ptr) override { Bounce::destroy(ptr);}
+  void destroy(void* ptr) override { Bounce::destroy(ptr);}                                         \
+  _QI_BOUNCE_TYPE_METHODS_INPLACE(Bounce)
 
   ///Implement all methods of Type except info() as bouncers to Bouncer.
 #define _QI_BOUNCE_TYPE_METHODS_NOINFO(Bounce)                                                    \
@@ -281,7 +339,8 @@ namespace qi
   void* ptrFromStorage(void**s) override { return Bounce::ptrFromStorage(s);}                     \
   void* clone(void* ptr) override { return Bounce::clone(ptr);}                                   \
   void  destroy(void* ptr) override { Bounce::destroy(ptr);}                                      \
-  bool  less(void* a, void* b) override { return Bounce::less(a, b);}
+  bool  less(void* a, void* b) override { return Bounce::less(a, b);}                             \
+  _QI_BOUNCE_TYPE_METHODS_INPLACE(Bounce)
 
   template < typename T, typename _Access = TypeByPointer<T> >
   class DefaultTypeImpl
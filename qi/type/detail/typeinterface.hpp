@@ -9,7 +9,9 @@
 
 #include <boost/optional.hpp>
 #include <boost/type_index.hpp>
+#include <cstddef>
 #include <string>
+#include <type_traits>
 #include <qi/api.hpp>
 #include <qi/signature.hpp>
 #include <qi/type/fwd.hpp>
@@ -37,6 +39,13 @@ namespace qi {
     return boost::typeindex::type_id_runtime(val);
   }
 
+  namespace detail
+  {
+    /// Buffer in which an AnyValue constructs small values in place instead of
+    /// allocating them. See TypeInterface::initializeStorageInPlace().
+    using InPlaceStorage = std::aligned_storage<16, alignof(double)>::type;
+  }
+
   /** This class is used to uniquely identify a type.
    *
    */
@@ -188,6 +197,28 @@ namespace qi {
 
     ///@return a Type on which signature() returns sig.
     static TypeInterface* fromSignature(const qi::Signature& sig);
+
+    // Added in libqi 3.0.0. Declaring them last keeps the slots of the methods
+    // above, but not those of the methods of derived interfaces, and AnyValue
+    // grows by its in-place storage: this breaks the ABI (see CHANGELOG.md).
+    /**
+     * @return the size of the values of this type if they can be constructed
+     * in place by initializeStorageInPlace(), 0 otherwise.
+     *
+     * Such values are plain old data: they are copied and moved as bytes and
+     * need no destruction.
+     */
+    virtual std::size_t inPlaceSize() { return 0; }
+
+    /**
+     * Construct a value in `buffer`, aligned like detail::InPlaceStorage and
+     * of at least inPlaceSize() bytes, as a copy of the value of the storage
+     * `src`, or as a default value if `src` is null.
+     *
+     * @return the storage of the value, which is `buffer`, or null if values
+     * of this type cannot be constructed in place.
+     */
+    virtual void* initializeStorageInPlace(void* /*buffer*/, void* /*src*/ = nullptr) { return nullptr; }
   };
 
   /// Runtime Type factory getter. Used by typeOf<T>()
@@ -196,6 +227,10 @@ namespace qi {
   /// Runtime Type factory setter.
   QI_API bool registerType(const TypeIndex& typeId, TypeInterface* type);
 
+  /// @return a number which changes each time a type is registered, so that
+  /// results of getType() can be reused as long as it stays the same.
+  QI_API unsigned int typeRegistryVersion();
+
   /** Get type from a type. Will return a static TypeImpl<T> if T is not registered
    */
   template<typename T> TypeInterface* typeOf();
@@ -203,6 +203,20 @@ namespace qi{
     /// Get the element at index
     virtual void* element(void* storage, int index);
     TypeKind kind() override { return TypeKind_List;}
+
+    // Added in libqi 3.0.0, after the existing methods. They still extend the
+    // vtable of the list interfaces, so binaries built against older headers
+    // are not compatible (see CHANGELOG.md).
+    /// Return a pointer to the elements if they are arithmetic values stored
+    /// contiguously in memory, or null otherwise.
+    /// The default implementation returns null.
+    virtual void* contiguousData(void* storage);
+    /// Resize the list to `size` elements and return a pointer to their
+    /// contiguous storage, or return null and leave the list unchanged if the
+    /// elements are not arithmetic values stored contiguously in memory.
+    /// New elements are value-initialized.
+    /// The default implementation returns null.
+    virtual void* resizeContiguous(void** storage, size_t size);
   };
 
   /**
@@ -437,6 +451,7 @@ namespace detail
 #include <qi/type/detail/pointertypeinterface.hxx>
 #include <qi/type/detail/structtypeinterface.hxx>
 #include <qi/type/detail/buffertypeinterface.hxx>
+#include <qi/type/detail/bufferviewtypeinterface.hxx>
 #include <qi/type/detail/dynamictypeinterface.hxx>
 #include <qi/type/detail/optionaltypeinterface.hxx>
 
@@ -0,0 +1,337 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#include <qi/log/binaryloghandler.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <qi/os.hpp>
+
+qiLogCategory("qi.log.binaryloghandler");
+
+namespace qi
+{
+namespace log
+{
+  namespace
+  {
+    const char magic[] = { 'Q', 'I', 'L', 'O', 'G', 'B', 'I', 'N' };
+    const std::uint32_t formatVersion = 1;
+    const std::size_t headerSize = 40;
+    const std::size_t dataEndOffset = 16;
+    const std::size_t minFileSize = 4096;
+
+    enum Tag
+    {
+      Tag_Category = 0,
+      Tag_Location = 1,
+      Tag_Record = 2,
+    };
+
+    using Bytes = std::vector<unsigned char>;
+
+    void putVarint(Bytes& out, std::uint64_t value)
+    {
+      while (value >= 0x80)
+      {
+        out.push_back(static_cast<unsigned char>(value | 0x80));
+        value >>= 7;
+      }
+      out.push_back(static_cast<unsigned char>(value));
+    }
+
+    void putZigzag(Bytes& out, std::int64_t value)
+    {
+      putVarint(out, (static_cast<std::uint64_t>(value) << 1)
+                     ^ static_cast<std::uint64_t>(value >> 63));
+    }
+
+    void putString(Bytes& out, const char* str, std::size_t size)
+    {
+      putVarint(out, size);
+      out.insert(out.end(), str, str + size);
+    }
+
+    void storeLittleEndian(unsigned char* dst, std::uint64_t value, std::size_t size)
+    {
+      for (std::size_t i = 0; i < size; ++i)
+        dst[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+
+    template <typename TimePoint>
+    std::int64_t microseconds(TimePoint date)
+    {
+      return boost::chrono::duration_cast<qi::MicroSeconds>(date.time_since_epoch()).count();
+    }
+
+    const char* orEmpty(const char* str)
+    {
+      return str ? str : "";
+    }
+  }
+
+  struct PrivateBinaryLogHandler
+  {
+    struct InternedCategory
+    {
+      std::uint32_t id;
+      std::string name;
+    };
+
+    struct InternedLocation
+    {
+      std::uint32_t id;
+      std::string file;
+      std::string function;
+    };
+
+    // Strings are interned by address, as they usually are literals. Their
+    // content is checked to detect an address reused for another string.
+    using LocationKey = std::tuple<const char*, int, const char*>;
+
+    std::string filePath;
+    std::size_t fileSize;
+    unsigned int fileCount;
+
+    boost::interprocess::mapped_region region;
+    std::size_t dataEnd = 0;
+    std::int64_t lastDate = 0;
+    std::int64_t lastSystemDate = 0;
+
+    std::map<const char*, InternedCategory> categories;
+    std::map<LocationKey, InternedLocation> locations;
+    std::uint32_t nextCategoryId = 0;
+    std::uint32_t nextLocationId = 0;
+    Bytes entry;
+    std::uint64_t droppedCount = 0;
+
+    boost::mutex mutex;
+
+    unsigned char* data() const
+    {
+      return static_cast<unsigned char*>(region.get_address());
+    }
+
+    /// @throws A `boost::interprocess::interprocess_exception` or a
+    /// `boost::filesystem::filesystem_error` if the file cannot be created.
+    void open(std::int64_t date, std::int64_t systemDate)
+    {
+      {
+        std::ofstream file(filePath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file)
+          throw boost::filesystem::filesystem_error(
+            "cannot create the binary log file", filePath,
+            boost::system::errc::make_error_code(boost::system::errc::io_error));
+      }
+      boost::filesystem::resize_file(filePath, fileSize);
+      boost::interprocess::file_mapping mapping(filePath.c_str(), boost::interprocess::read_write);
+      region = boost::interprocess::mapped_region(mapping, boost::interprocess::read_write, 0,
+                                                  fileSize);
+
+      auto* header = data();
+      std::memcpy(header, magic, sizeof(magic));
+      storeLittleEndian(header + 8, formatVersion, 4);
+      storeLittleEndian(header + 12, headerSize, 4);
+      storeLittleEndian(header + 24, static_cast<std::uint64_t>(date), 8);
+      storeLittleEndian(header + 32, static_cast<std::uint64_t>(systemDate), 8);
+      setDataEnd(headerSize);
+
+      lastDate = date;
+      lastSystemDate = systemDate;
+      categories.clear();
+      locations.clear();
+      nextCategoryId = 0;
+      nextLocationId = 0;
+    }
+
+    void setDataEnd(std::size_t end)
+    {
+      dataEnd = end;
+      storeLittleEndian(data() + dataEndOffset, dataEnd, 8);
+    }
+
+    /// Unmaps the file and truncates it to its content.
+    void close()
+    {
+      if (!data())
+        return;
+      region.flush();
+      region = boost::interprocess::mapped_region();
+      boost::system::error_code ec;
+      boost::filesystem::resize_file(filePath, dataEnd, ec);
+    }
+
+    void rotate(std::int64_t date, std::int64_t systemDate)
+    {
+      close();
+      boost::system::error_code ec;
+      for (unsigned int i = fileCount - 1; i > 0; --i)
+      {
+        const auto source = i == 1 ? filePath : filePath + "." + std::to_string(i - 1);
+        if (boost::filesystem::exists(source, ec))
+          boost::filesystem::rename(source, filePath + "." + std::to_string(i), ec);
+      }
+
+      // Failures cannot be logged from a log handler: the following records
+      // are silently dropped.
+      try
+      {
+        open(date, systemDate);
+      }
+      catch (const std::exception&)
+      {
+        region = boost::interprocess::mapped_region();
+      }
+    }
+
+    std::uint32_t categoryId(const char* name)
+    {
+      const auto it = categories.find(name);
+      if (it != categories.end() && it->second.name == name)
+        return it->second.id;
+
+      InternedCategory interned{ nextCategoryId++, name };
+      putVarint(entry, Tag_Category);
+      putVarint(entry, interned.id);
+      putString(entry, name, interned.name.size());
+      const auto id = interned.id;
+      categories[name] = std::move(interned);
+      return id;
+    }
+
+    std::uint32_t locationId(const char* file, const char* function, int line)
+    {
+      const auto it = locations.find(LocationKey{ file, line, function });
+      if (it != locations.end() && it->second.file == file && it->second.function == function)
+        return it->second.id;
+
+      InternedLocation interned{ nextLocationId++, file, function };
+      putVarint(entry, Tag_Location);
+      putVarint(entry, interned.id);
+      putVarint(entry, static_cast<std::uint32_t>(line));
+      putString(entry, file, interned.file.size());
+      putString(entry, function, interned.function.size());
+      const auto id = interned.id;
+      locations[LocationKey{ file, line, function }] = std::move(interned);
+      return id;
+    }
+
+    /// Encodes the record, preceded by the definitions it needs, into `entry`.
+    void encode(qi::LogLevel verb,
+                std::int64_t date,
+                std::int64_t systemDate,
+                const char* category,
+                const char* msg,
+                const char* file,
+                const char* fct,
+                int line)
+    {
+      entry.clear();
+      const auto categoryIndex = categoryId(category);
+      const auto locationIndex = locationId(file, fct, line);
+      const auto maxMessageSize = (fileSize - headerSize) / 2;
+
+      putVarint(entry, Tag_Record);
+      putZigzag(entry, date - lastDate);
+      putZigzag(entry, systemDate - lastSystemDate);
+      putVarint(entry, (static_cast<std::uint64_t>(categoryIndex) << 3) | (verb & 7));
+      putVarint(entry, locationIndex);
+      putVarint(entry, static_cast<std::uint32_t>(qi::os::gettid()));
+      putString(entry, msg, std::min(std::strlen(msg), maxMessageSize));
+    }
+  };
+
+  BinaryLogHandler::BinaryLogHandler(const std::string& filePath,
+                                     std::size_t fileSize,
+                                     unsigned int fileCount)
+    : _p(new PrivateBinaryLogHandler)
+  {
+    boost::filesystem::path fPath(filePath);
+    _p->filePath = fPath.make_preferred().string();
+    _p->fileSize = std::max(fileSize, minFileSize);
+    _p->fileCount = std::max(fileCount, 1u);
+
+    try
+    {
+      if (!boost::filesystem::exists(fPath.parent_path()))
+        boost::filesystem::create_directories(fPath.parent_path());
+      _p->open(microseconds(qi::Clock::now()), microseconds(qi::SystemClock::now()));
+    }
+    catch (const std::exception& e)
+    {
+      _p->region = boost::interprocess::mapped_region();
+      qiLogWarning() << "Cannot open " << filePath << ": " << e.what();
+    }
+  }
+
+  BinaryLogHandler::~BinaryLogHandler()
+  {
+    _p->close();
+  }
+
+  void BinaryLogHandler::log(const qi::LogLevel verb,
+                             const qi::Clock::time_point date,
+                             const qi::SystemClock::time_point systemDate,
+                             const char* category,
+                             const char* msg,
+                             const char* file,
+                             const char* fct,
+                             const int line)
+  {
+    boost::mutex::scoped_lock scopedLock(_p->mutex);
+
+    if (verb > qi::log::logLevel() || !_p->data())
+      return;
+
+    category = orEmpty(category);
+    msg = orEmpty(msg);
+    file = orEmpty(file);
+    fct = orEmpty(fct);
+    const auto dateUs = microseconds(date);
+    const auto systemDateUs = microseconds(systemDate);
+
+    _p->encode(verb, dateUs, systemDateUs, category, msg, file, fct, line);
+    if (_p->dataEnd + _p->entry.size() > _p->fileSize && _p->dataEnd > headerSize)
+    {
+      _p->rotate(dateUs, systemDateUs);
+      if (!_p->data())
+        return;
+      _p->encode(verb, dateUs, systemDateUs, category, msg, file, fct, line);
+    }
+    if (_p->dataEnd + _p->entry.size() > _p->fileSize)
+    {
+      // Even an empty file cannot hold the record, because of the size of its
+      // category or location. The definitions it carried are not written
+      // either, so the next records must define their strings again.
+      _p->categories.clear();
+      _p->locations.clear();
+      ++_p->droppedCount;
+      return;
+    }
+
+    std::memcpy(_p->data() + _p->dataEnd, _p->entry.data(), _p->entry.size());
+    _p->setDataEnd(_p->dataEnd + _p->entry.size());
+    _p->lastDate = dateUs;
+    _p->lastSystemDate = systemDateUs;
+  }
+
+  std::uint64_t BinaryLogHandler::droppedRecordCount() const
+  {
+    boost::mutex::scoped_lock scopedLock(_p->mutex);
+    return _p->droppedCount;
+  }
+}
+}
@@ -18,6 +18,7 @@
 #include <boost/utility/compare_pointees.hpp>
 
 #include "buffer_p.hpp"
+#include "bufferpool_p.hpp"
 
 
 qiLogCategory("qi.Buffer");
@@ -28,53 +29,56 @@ namespace qi
 
   BufferPrivate::~BufferPrivate()
   {
-    if (_bigdata)
-    {
-      free(_bigdata);
-      _bigdata = NULL;
-    }
+    releaseBigData();
   }
 
   BufferPrivate::BufferPrivate(const BufferPrivate& b)
     : _bigdata(nullptr)
     , _cachedSubBufferTotalSize(b._cachedSubBufferTotalSize)
-    , used(b.used)
-    , available(b.available)
     , _subBuffers(b._subBuffers)
   {
-    if (b._bigdata)
-    {
-      _bigdata = static_cast<unsigned char*>(malloc(b.used));
-      ::memcpy(_bigdata, b._bigdata, b.used);
-    }
-    else
-    {
-      ::memcpy(_data, b._data, b.used);
-    }
+    copyData(b);
   }
 
   BufferPrivate& BufferPrivate::operator=(const BufferPrivate& b)
   {
     if (&b == this) return *this;
     _cachedSubBufferTotalSize = b._cachedSubBufferTotalSize;
-    used = b.used;
-    available = b.available;
     _subBuffers = b._subBuffers;
-    if (_bigdata)
+    releaseBigData();
+    copyData(b);
+    return *this;
+  }
+
+  void BufferPrivate::copyData(const BufferPrivate& b)
+  {
+    QI_ASSERT(!_bigdata);
+    // Small contents are copied in the inline storage, even if they were
+    // stored in big data in the source buffer.
+    if (b.used > std::extent<decltype(_data)>::value)
     {
-      free(_bigdata);
-      _bigdata = NULL;
+      _bigdata = static_cast<unsigned char*>(detail::bufferpool::allocate(b.used));
+      if (!_bigdata)
+        throw std::bad_alloc();
+      available = detail::bufferpool::capacityFor(b.used);
     }
-    if (b._bigdata)
+    else
     {
-      _bigdata = static_cast<unsigned char*>(malloc(b.used));
-      ::memcpy(_bigdata, b._bigdata, b.used);
+      available = std::extent<decltype(_data)>::value;
     }
-    else
+    used = b.used;
+    if (used)
+      ::memcpy(data(), b.data(), used);
+  }
+
+  void BufferPrivate::releaseBigData()
+  {
+    if (_bigdata)
     {
-      ::memcpy(_data, b._data, b.used);
+      detail::bufferpool::release(_bigdata, available);
+      _bigdata = nullptr;
+      available = std::extent<decltype(_data)>::value;
     }
-    return *this;
   }
 
   boost::optional<size_t> BufferPrivate::indexOfSubBuffer(size_t offset) const
@@ -122,34 +126,49 @@ namespace qi
 
   bool BufferPrivate::resize(size_t neededSize)
   {
-    neededSize += BLOCK; // Should be enough in most cases;
-
-    qiLogDebug() << "Resizing buffer from " << available << " to " << neededSize;
-    unsigned char *newBigdata;
-
-    newBigdata = static_cast<unsigned char *>(realloc(_bigdata, neededSize));
+    neededSize = std::max<size_t>(neededSize, BLOCK); // Should be enough in most cases;
+    // Grow geometrically, so that appending to a buffer in small chunks takes
+    // amortized linear time. This matters above the largest class of the pool,
+    // whose blocks have exactly the requested size.
+    neededSize = std::max<size_t>(neededSize, 2 * available);
+
+    const size_t newAvailable = detail::bufferpool::capacityFor(neededSize);
+    qiLogDebug() << "Resizing buffer from " << available << " to " << newAvailable;
+    auto newBigdata = static_cast<unsigned char *>(detail::bufferpool::allocate(neededSize));
     if (newBigdata == NULL)
       return false;
-    if (!_bigdata && used > 0)
-      ::memcpy(newBigdata, _data, used);
-    available = neededSize;
-    _bigdata = newBigdata; // Don't worry, realloc free previous buffer if needed
+    if (used > 0)
+      ::memcpy(newBigdata, data(), used);
+    releaseBigData();
+    available = newAvailable;
+    _bigdata = newBigdata;
     return true;
   }
 
+  namespace
+  {
+    /// Buffers private data are drawn from the buffer pool.
+    template<typename... Args>
+    boost::shared_ptr<BufferPrivate> makeBufferPrivate(Args&&... args)
+    {
+      return boost::allocate_shared<BufferPrivate>(
+        detail::BufferPoolAllocator<BufferPrivate>{}, std::forward<Args>(args)...);
+    }
+  }
+
   Buffer::Buffer()
-    : _p(boost::make_shared<BufferPrivate>())
+    : _p(makeBufferPrivate())
   {
   }
 
   Buffer::Buffer(const Buffer& b)
-    : _p(boost::make_shared<BufferPrivate>(*b._p))
+    : _p(makeBufferPrivate(*b._p))
   {
   }
 
   Buffer& Buffer::operator=(const Buffer& b)
   {
-    _p = boost::make_shared<BufferPrivate>(*b._p);
+    _p = makeBufferPrivate(*b._p);
     return *this;
   }
 
@@ -157,18 +176,27 @@ namespace qi
     : _p(std::move(b._p))
   {
     // The default state of a qi::Buffer contains a valid BufferPrivate pointer.
-    b._p = boost::make_shared<BufferPrivate>();
+    b._p = makeBufferPrivate();
   }
 
   Buffer& Buffer::operator=(Buffer&& b)
   {
     _p = std::move(b._p);
-    b._p = boost::make_shared<BufferPrivate>();
+    b._p = makeBufferPrivate();
     return *this;
   }
 
+  void Buffer::detach()
+  {
+    // Views on the buffer share its private data: give them the current data
+    // and work on a copy from now on.
+    if (_p.use_count() > 1)
+      _p = makeBufferPrivate(*_p);
+  }
+
   bool Buffer::write(const void *data, size_t size)
   {
+    detach();
     if (_p->used + size > _p->available)
     {
       bool ret = _p->resize(_p->used + size);
@@ -186,6 +214,7 @@ namespace qi
 
   size_t Buffer::addSubBuffer(const Buffer& buffer)
   {
+    detach();
     size_t subBufferSize = buffer.size();
     size_t actualUsed = _p->used;
 
@@ -238,6 +267,7 @@ namespace qi
   */
   void *Buffer::reserve(size_t size)
   {
+    detach();
     if (_p->used + size > _p->available)
     {
       bool success = _p->resize(_p->used + size);
@@ -255,6 +285,11 @@ namespace qi
 
   void Buffer::clear()
   {
+    if (_p.use_count() > 1)
+    {
+      _p = makeBufferPrivate();
+      return;
+    }
     _p->used = 0;
     _p->_subBuffers.clear();
     _p->_cachedSubBufferTotalSize = 0;
@@ -262,6 +297,8 @@ namespace qi
 
   void* Buffer::data()
   {
+    if (_p)
+      detach();
     return _p ? _p->data() : 0;
   }
 
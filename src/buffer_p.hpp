@@ -29,13 +29,16 @@ namespace qi
     const unsigned char* data() const;
     bool            resize(size_t size = 0x100000);
     boost::optional<size_t> indexOfSubBuffer(size_t offset) const;
+    /// Precondition: There is no big data.
+    void            copyData(const BufferPrivate& b);
+    void            releaseBigData();
 
     bool operator==(const BufferPrivate& o) const;
 
     friend KA_GENERATE_REGULAR_OP_DIFFERENT(BufferPrivate)
 
   public:
-    unsigned char*  _bigdata = nullptr;
+    unsigned char*  _bigdata = nullptr; // drawn from the buffer pool
     unsigned char   _data[STATIC_BLOCK] = {};
     size_t          _cachedSubBufferTotalSize = 0u;
     size_t          used = 0u; // size used
@@ -0,0 +1,320 @@
+/*
+**  Copyright (C) 2012 Aldebaran Robotics
+**  See COPYING for the license
+*/
+
+#include <atomic>
+#include <array>
+#include <cstddef>
+#include <cstdlib>
+#include <algorithm>
+
+#include "bufferpool_p.hpp"
+
+namespace qi
+{
+  namespace detail
+  {
+    namespace bufferpool
+    {
+      namespace
+      {
+        // Size classes go from 64 bytes to 1 MiB.
+        const std::size_t minClassLog2 = 6;
+        const std::size_t maxClassLog2 = 20;
+        const std::size_t classCount = maxClassLog2 - minClassLog2 + 1;
+
+        // Bytes a thread may keep cached, for a given size class and in total.
+        const std::size_t maxCachedBytesPerClass = 4 * 1024 * 1024;
+        const std::size_t maxCachedBlocksPerClass = 256;
+        const std::size_t maxCachedBytesPerThread = 8 * 1024 * 1024;
+
+        std::atomic<qi::uint64_t> hitCount{0};
+        std::atomic<qi::uint64_t> missCount{0};
+
+        /// Index of the smallest size class that can hold `size` bytes, or
+        /// `classCount` if the size exceeds the largest size class.
+        std::size_t classIndex(std::size_t size)
+        {
+          std::size_t index = 0u;
+          std::size_t classSize = std::size_t(1) << minClassLog2;
+          while (classSize < size && index != classCount)
+          {
+            classSize <<= 1;
+            ++index;
+          }
+          return index;
+        }
+
+        constexpr std::size_t classSize(std::size_t index)
+        {
+          return std::size_t(1) << (minClassLog2 + index);
+        }
+
+        /// A released block stores a pointer to the next free block, and its
+        /// size class for when it is released from another thread.
+        struct FreeBlock
+        {
+          FreeBlock* next;
+          std::size_t index;
+        };
+
+        /// The thread that allocated a block, to which the block returns when
+        /// it is released by another thread.
+        ///
+        /// Owners are never destroyed: the owner of a thread that exits is
+        /// taken by the next thread that starts using the pool, so blocks
+        /// that are still in use can always be returned to it.
+        struct Owner
+        {
+          std::atomic<bool> taken{true};
+          /// Blocks released by other threads, drained by the owning thread.
+          std::atomic<FreeBlock*> remoteFrees{nullptr};
+          Owner* nextOwner = nullptr;
+
+          void pushRemoteFree(FreeBlock* block)
+          {
+            block->next = remoteFrees.load(std::memory_order_relaxed);
+            while (!remoteFrees.compare_exchange_weak(block->next, block,
+                                                      std::memory_order_release,
+                                                      std::memory_order_relaxed))
+            {
+            }
+          }
+
+          FreeBlock* takeRemoteFrees()
+          {
+            return remoteFrees.exchange(nullptr, std::memory_order_acquire);
+          }
+        };
+
+        std::atomic<Owner*> owners{nullptr};
+
+        Owner* takeOwner()
+        {
+          for (auto owner = owners.load(std::memory_order_acquire); owner; owner = owner->nextOwner)
+          {
+            bool taken = false;
+            if (owner->taken.compare_exchange_strong(taken, true))
+              return owner;
+          }
+          auto owner = new Owner;
+          owner->nextOwner = owners.load(std::memory_order_relaxed);
+          while (!owners.compare_exchange_weak(owner->nextOwner, owner,
+                                               std::memory_order_release,
+                                               std::memory_order_relaxed))
+          {
+          }
+          return owner;
+        }
+
+        /// Pooled blocks are preceded by a header, so that they start at the
+        /// alignment of `malloc`.
+        struct BlockHeader
+        {
+          Owner* owner;
+        };
+        const std::size_t headerSize = alignof(std::max_align_t);
+        static_assert(sizeof(BlockHeader) <= headerSize, "the block header does not fit");
+        static_assert(sizeof(FreeBlock) <= headerSize + classSize(0), "free blocks do not fit");
+
+        BlockHeader* headerOf(void* block)
+        {
+          return reinterpret_cast<BlockHeader*>(static_cast<unsigned char*>(block) - headerSize);
+        }
+
+        void* blockOf(void* raw)
+        {
+          return static_cast<unsigned char*>(raw) + headerSize;
+        }
+
+        void freeAll(FreeBlock* block)
+        {
+          while (block)
+          {
+            auto next = block->next;
+            std::free(block);
+            block = next;
+          }
+        }
+
+        struct ThreadCache;
+
+        // Set when the cache of the current thread has been destroyed, which
+        // happens at thread exit. Buffers can still be released afterwards
+        // (by the destructors of other thread local objects for instance). The
+        // flag is trivially destructible so it remains usable in that case.
+        thread_local bool threadCacheDestroyed = false;
+
+        struct ThreadCache
+        {
+          Owner* const owner;
+          std::array<FreeBlock*, classCount> heads;
+          std::array<std::size_t, classCount> counts;
+          std::size_t cachedBytes = 0u;
+
+          ThreadCache()
+            : owner(takeOwner())
+          {
+            heads.fill(nullptr);
+            counts.fill(0u);
+          }
+
+          ~ThreadCache()
+          {
+            for (auto head : heads)
+              freeAll(head);
+            // Blocks released to this owner from now on are freed by their
+            // releaser, or drained by the next thread that takes the owner.
+            owner->taken.store(false);
+            freeAll(owner->takeRemoteFrees());
+            threadCacheDestroyed = true;
+          }
+
+          static std::size_t maxCount(std::size_t index)
+          {
+            return std::max<std::size_t>(1u,
+              std::min(maxCachedBlocksPerClass, maxCachedBytesPerClass / classSize(index)));
+          }
+
+          FreeBlock* pop(std::size_t index)
+          {
+            auto block = heads[index];
+            if (!block)
+            {
+              drainRemoteFrees();
+              block = heads[index];
+              if (!block)
+                return nullptr;
+            }
+            heads[index] = block->next;
+            --counts[index];
+            cachedBytes -= classSize(index);
+            return block;
+          }
+
+          /// Keeps the block if the limits of the cache allow it, frees it
+          /// otherwise.
+          void push(FreeBlock* block, std::size_t index)
+          {
+            if (counts[index] >= maxCount(index)
+                || cachedBytes + classSize(index) > maxCachedBytesPerThread)
+            {
+              std::free(block);
+              return;
+            }
+            block->next = heads[index];
+            heads[index] = block;
+            ++counts[index];
+            cachedBytes += classSize(index);
+          }
+
+          void drainRemoteFrees()
+          {
+            if (!owner->remoteFrees.load(std::memory_order_relaxed))
+              return;
+            auto block = owner->takeRemoteFrees();
+            while (block)
+            {
+              auto next = block->next;
+              push(block, block->index);
+              block = next;
+            }
+          }
+        };
+
+        ThreadCache* threadCache()
+        {
+          if (threadCacheDestroyed)
+            return nullptr;
+          static thread_local ThreadCache cache;
+          return &cache;
+        }
+
+        /// Returns a released block to the thread that allocated it.
+        void releaseRemote(Owner* owner, FreeBlock* block)
+        {
+          if (!owner->taken.load())
+          {
+            std::free(block);
+            return;
+          }
+          owner->pushRemoteFree(block);
+          // The owning thread may have exited while the block was pushed, and
+          // nobody would drain it until the owner is taken again.
+          if (!owner->taken.load())
+            freeAll(owner->takeRemoteFrees());
+        }
+      } // anonymous namespace
+
+      std::size_t capacityFor(std::size_t size)
+      {
+        const auto index = classIndex(size);
+        return index == classCount ? size : classSize(index);
+      }
+
+      void* allocate(std::size_t size)
+      {
+        const auto index = classIndex(size);
+        if (index == classCount)
+        {
+          missCount.fetch_add(1, std::memory_order_relaxed);
+          return std::malloc(size);
+        }
+
+        auto cache = threadCache();
+        void* raw = cache ? cache->pop(index) : nullptr;
+        if (raw)
+        {
+          hitCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+          missCount.fetch_add(1, std::memory_order_relaxed);
+          raw = std::malloc(headerSize + classSize(index));
+          if (!raw)
+            return nullptr;
+        }
+        static_cast<BlockHeader*>(raw)->owner = cache ? cache->owner : nullptr;
+        return blockOf(raw);
+      }
+
+      void release(void* block, std::size_t capacity)
+      {
+        if (!block)
+          return;
+        const auto index = classIndex(capacity);
+        if (index == classCount)
+        {
+          std::free(block);
+          return;
+        }
+
+        const auto header = headerOf(block);
+        const auto owner = header->owner;
+        auto freeBlock = reinterpret_cast<FreeBlock*>(header);
+        freeBlock->index = index;
+        auto cache = threadCache();
+        if (cache && cache->owner == owner)
+          cache->push(freeBlock, index);
+        else if (owner)
+          releaseRemote(owner, freeBlock);
+        else
+          std::free(freeBlock);
+      }
+
+      BufferPoolStatistics statistics()
+      {
+        BufferPoolStatistics stats;
+        stats.hits = hitCount.load(std::memory_order_relaxed);
+        stats.misses = missCount.load(std::memory_order_relaxed);
+        return stats;
+      }
+    } // namespace bufferpool
+  } // namespace detail
+
+  BufferPoolStatistics bufferPoolStatistics()
+  {
+    return detail::bufferpool::statistics();
+  }
+} // namespace qi
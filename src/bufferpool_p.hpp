@@ -0,0 +1,82 @@
+#pragma once
+/*
+**  Copyright (C) 2012 Aldebaran Robotics
+**  See COPYING for the license
+*/
+
+#ifndef _SRC_BUFFERPOOL_P_HPP_
+#define _SRC_BUFFERPOOL_P_HPP_
+
+#include <cstddef>
+#include <new>
+#include <qi/buffer.hpp>
+
+namespace qi
+{
+  namespace detail
+  {
+    /// Memory pool from which buffers allocate their storage.
+    ///
+    /// Blocks are grouped by size classes (powers of two). Released blocks
+    /// return to a bounded cache local to the thread that allocated them, so
+    /// that they can be reused without synchronization by the next allocations
+    /// of this thread. Blocks released by another thread are handed back
+    /// through a lock-free list that the allocating thread drains when its
+    /// cache runs out. A thread frees its cache when it exits. Blocks bigger
+    /// than the largest size class are not pooled.
+    ///
+    /// All blocks are obtained from `malloc`.
+    namespace bufferpool
+    {
+      /// The actual size of the block allocated for a request of `size` bytes.
+      std::size_t capacityFor(std::size_t size);
+
+      /// Allocates a block of `capacityFor(size)` bytes.
+      /// Returns nullptr on failure.
+      void* allocate(std::size_t size);
+
+      /// Releases a block returned by `allocate`.
+      /// Precondition: `capacity` is the capacity of the block.
+      void release(void* block, std::size_t capacity);
+
+      BufferPoolStatistics statistics();
+    } // namespace bufferpool
+
+    /// Allocator drawing objects from the buffer pool.
+    /// It is typically used with `boost::allocate_shared`.
+    template<typename T>
+    struct BufferPoolAllocator
+    {
+      using value_type = T;
+
+      BufferPoolAllocator() = default;
+      template<typename U>
+      BufferPoolAllocator(const BufferPoolAllocator<U>&) {}
+
+      template<typename U>
+      struct rebind
+      {
+        using other = BufferPoolAllocator<U>;
+      };
+
+      T* allocate(std::size_t n)
+      {
+        if (void* p = bufferpool::allocate(n * sizeof(T)))
+          return static_cast<T*>(p);
+        throw std::bad_alloc();
+      }
+
+      void deallocate(T* p, std::size_t n)
+      {
+        bufferpool::release(p, bufferpool::capacityFor(n * sizeof(T)));
+      }
+
+      template<typename U>
+      friend bool operator==(const BufferPoolAllocator&, const BufferPoolAllocator<U>&) { return true; }
+      template<typename U>
+      friend bool operator!=(const BufferPoolAllocator&, const BufferPoolAllocator<U>&) { return false; }
+    };
+  } // namespace detail
+} // namespace qi
+
+#endif  // _SRC_BUFFERPOOL_P_HPP_
@@ -0,0 +1,119 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#include <qi/bufferview.hpp>
+
+#include <algorithm>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/make_shared.hpp>
+
+namespace qi
+{
+  namespace
+  {
+    void checkRange(std::size_t offset, std::size_t size, std::size_t available)
+    {
+      if (offset > available || size > available - offset)
+      {
+        std::ostringstream ss;
+        ss << "Range of " << size << " bytes at offset " << offset
+           << " is out of a view of " << available << " bytes";
+        throw std::out_of_range(ss.str());
+      }
+    }
+  }
+
+  BufferView::BufferView()
+    : _data(nullptr)
+    , _size(0)
+  {
+  }
+
+  BufferView::BufferView(const Buffer& buffer)
+    : _owner(buffer._p)
+    , _data(static_cast<const char*>(buffer.data()))
+    , _size(buffer.size())
+  {
+  }
+
+  BufferView::BufferView(const Buffer& buffer, std::size_t offset, std::size_t size)
+    : BufferView(buffer)
+  {
+    checkRange(offset, size, _size);
+    _data += offset;
+    _size = size;
+  }
+
+  BufferView::BufferView(boost::shared_ptr<const void> owner, const char* data, std::size_t size)
+    : _owner(std::move(owner))
+    , _data(data)
+    , _size(size)
+  {
+  }
+
+  BufferView BufferView::slice(std::size_t offset, std::size_t size) const
+  {
+    checkRange(offset, size, _size);
+    return BufferView(_owner, _data + offset, size);
+  }
+
+  Buffer BufferView::toBuffer() const
+  {
+    Buffer buffer;
+    if (_size)
+      buffer.write(_data, _size);
+    return buffer;
+  }
+
+  bool BufferView::operator==(const BufferView& b) const
+  {
+    return _size == b._size && (_data == b._data || std::equal(_data, _data + _size, b._data));
+  }
+
+  StringView::StringView()
+    : _data("")
+    , _size(0)
+  {
+  }
+
+  StringView::StringView(const std::string& str)
+    : _data(nullptr)
+    , _size(str.size())
+  {
+    const auto copy = boost::make_shared<const std::string>(str);
+    _data = copy->data();
+    _owner = copy;
+  }
+
+  StringView::StringView(const char* str)
+    : StringView(std::string(str))
+  {
+  }
+
+  StringView::StringView(const BufferView& view)
+    : _owner(view._owner)
+    , _data(view.data())
+    , _size(view.size())
+  {
+  }
+
+  bool operator==(const StringView& a, const StringView& b)
+  {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+  }
+
+  bool operator<(const StringView& a, const StringView& b)
+  {
+    return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+  }
+
+  std::ostream& operator<<(std::ostream& o, const StringView& s)
+  {
+    return o.write(s.data(), s.size());
+  }
+}
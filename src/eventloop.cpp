@@ -2,9 +2,14 @@
 **  Copyright (C) 2012, 2013 Aldebaran Robotics
 **  See COPYING for the license
 */
+#include <algorithm>
+#include <deque>
 #include <thread>
 #include <system_error>
 #include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
 
 #include <boost/asio/io_service.hpp>
 #include <boost/program_options.hpp>
@@ -260,8 +265,321 @@ namespace qi {
 
   using SteadyTimer = boost::asio::basic_waitable_timer<SteadyClock>;
 
+  /// Component responsible for the delayed tasks of the event loop.
+  ///
+  /// Instead of one asio timer per task, pending tasks are kept in a min-heap
+  /// ordered by deadline, and a single asio timer waits for the earliest one.
+  /// When the timer expires, the handlers of all due tasks are posted to the
+  /// io service.
+  ///
+  /// Scheduling a task costs O(log n). Canceling a task is O(1): its handler is
+  /// immediately posted with the `operation_aborted` error and its entry is only
+  /// marked as such. Canceled entries are dropped when they reach the top of
+  /// the heap, or all at once when they become the majority of the heap.
+  class EventLoopAsio::TimerQueue
+  {
+  public:
+    using Handler = boost::function<void(const boost::system::error_code&)>;
+
+    struct Entry
+    {
+      SteadyClockTimePoint deadline;
+      qi::uint64_t sequence; // Tasks with equal deadlines run in scheduling order.
+      Handler handler;       // Empty once posted.
+    };
+    using EntryPtr = std::shared_ptr<Entry>;
+
+    explicit TimerQueue(boost::asio::io_service& io)
+      : _io(io)
+      , _timer(io)
+    {
+    }
+
+    /// Posts `handler` to the io service once `deadline` is reached.
+    EntryPtr schedule(SteadyClockTimePoint deadline, Handler handler)
+    {
+      auto entry = std::make_shared<Entry>();
+      entry->deadline = deadline;
+      entry->handler = std::move(handler);
+
+      std::lock_guard<std::mutex> lock(_mutex);
+      entry->sequence = _nextSequence++;
+      _heap.push_back(entry);
+      std::push_heap(_heap.begin(), _heap.end(), Later{});
+      if (deadline < _armedDeadline)
+        arm(deadline);
+      return entry;
+    }
+
+    /// Posts the handler of the entry with the `operation_aborted` error if it
+    /// has not been posted yet.
+    void cancel(const EntryPtr& entry)
+    {
+      Handler handler;
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!entry->handler)
+          return;
+        std::swap(handler, entry->handler);
+        ++_canceledCount;
+        if (2 * _canceledCount > _heap.size())
+          dropCanceledEntries();
+      }
+      _io.post([handler] { handler(boost::asio::error::operation_aborted); });
+    }
+
+  private:
+    // Ordering for a min-heap on deadlines.
+    struct Later
+    {
+      bool operator()(const EntryPtr& a, const EntryPtr& b) const
+      {
+        return std::tie(a->deadline, a->sequence) > std::tie(b->deadline, b->sequence);
+      }
+    };
+
+    // Precondition: the mutex is locked.
+    void arm(SteadyClockTimePoint deadline)
+    {
+      _armedDeadline = deadline;
+      const auto generation = ++_generation;
+      _timer.expires_at(deadline);
+      _timer.async_wait([=](const boost::system::error_code& erc) {
+        onTimer(erc, generation);
+      });
+    }
+
+    void onTimer(const boost::system::error_code& erc, qi::uint64_t generation)
+    {
+      std::vector<Handler> dueHandlers;
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        // The wait has been superseded by an earlier deadline, or aborted.
+        if (erc || generation != _generation)
+          return;
+
+        _armedDeadline = SteadyClockTimePoint::max();
+        const auto now = SteadyClock::now();
+        while (!_heap.empty() && _heap.front()->deadline <= now)
+        {
+          std::pop_heap(_heap.begin(), _heap.end(), Later{});
+          auto& handler = _heap.back()->handler;
+          if (handler)
+            dueHandlers.push_back(std::move(handler));
+          else
+            --_canceledCount;
+          _heap.back()->handler = {};
+          _heap.pop_back();
+        }
+        if (!_heap.empty())
+          arm(_heap.front()->deadline);
+      }
+      for (auto& handler : dueHandlers)
+        _io.post([handler] { handler(boost::system::error_code{}); });
+    }
+
+    // Precondition: the mutex is locked.
+    void dropCanceledEntries()
+    {
+      _heap.erase(std::remove_if(_heap.begin(), _heap.end(),
+                                 [](const EntryPtr& e) { return !e->handler; }),
+                  _heap.end());
+      std::make_heap(_heap.begin(), _heap.end(), Later{});
+      _canceledCount = 0;
+    }
+
+    boost::asio::io_service& _io;
+    std::mutex _mutex;
+    std::vector<EntryPtr> _heap;
+    std::size_t _canceledCount = 0;
+    qi::uint64_t _nextSequence = 0;
+    SteadyTimer _timer;
+    SteadyClockTimePoint _armedDeadline = SteadyClockTimePoint::max();
+    qi::uint64_t _generation = 0;
+  };
+
+  /// Component responsible for the ready tasks of the event loop in work
+  /// stealing mode.
+  ///
+  /// Each worker thread owns a local queue. Tasks posted from a worker go to
+  /// its local queue, other tasks go to a shared queue. A worker runs the tasks
+  /// of its own queue first, then those of the shared queue, and then steals
+  /// tasks from the queues of the other workers.
+  ///
+  /// Timers and I/O handlers are still dispatched by the io service: workers
+  /// poll it regularly, and block on it when there is no task left. Posting a
+  /// task while some workers are blocked posts a no-op handler in the io
+  /// service to wake one of them up.
+  class EventLoopAsio::WorkStealingScheduler
+  {
+  public:
+    using Task = boost::function<void()>;
+
+    explicit WorkStealingScheduler(boost::asio::io_service& io)
+      : _io(io)
+    {
+    }
+
+    ~WorkStealingScheduler()
+    {
+      auto queue = _queues.load();
+      while (queue)
+      {
+        auto next = queue->next;
+        delete queue;
+        queue = next;
+      }
+    }
+
+    void post(Task task)
+    {
+      TaskQueue& queue = currentWorker.scheduler == this ? *currentWorker.queue : _sharedQueue;
+      {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+      }
+      ++_taskCount;
+      wakeUpSleepingWorker();
+    }
+
+    /// Runs tasks and io service handlers until the io service is stopped or
+    /// runs out of work.
+    void run()
+    {
+      TaskQueue& ownQueue = acquireQueue();
+      const auto previousWorker = currentWorker;
+      currentWorker = Worker{ this, &ownQueue };
+      auto _ = ka::scoped([&] {
+        currentWorker = previousWorker;
+        ownQueue.owned = false;
+        // Remaining tasks of the queue will be stolen by other workers.
+        if (_taskCount.load() != 0)
+          wakeUpSleepingWorker();
+      });
+
+      static const unsigned int ioPollPeriod = 32; // in tasks
+      unsigned int tasksSinceIoPoll = 0;
+      while (!_io.stopped())
+      {
+        Task task;
+        if (pop(ownQueue, task))
+        {
+          if (++tasksSinceIoPoll == ioPollPeriod)
+          {
+            tasksSinceIoPoll = 0;
+            _io.poll();
+          }
+          task();
+          continue;
+        }
+
+        tasksSinceIoPoll = 0;
+        if (_io.poll() != 0)
+          continue;
+
+        auto sleeping = ka::scoped_incr_and_decr(_sleepingWorkerCount);
+        // A task may have been posted before we were counted as sleeping.
+        if (_taskCount.load() != 0)
+          continue;
+        if (_io.run_one() == 0 && (_io.stopped() || _taskCount.load() == 0))
+          return;
+      }
+    }
+
+  private:
+    struct TaskQueue
+    {
+      std::mutex mutex;
+      std::deque<Task> tasks;
+      std::atomic<bool> owned{false};
+      TaskQueue* next = nullptr; // Immutable once the queue is published.
+    };
+
+    struct Worker
+    {
+      WorkStealingScheduler* scheduler;
+      TaskQueue* queue;
+    };
+    static thread_local Worker currentWorker;
+
+    // Queues of exited workers are reused by new workers.
+    TaskQueue& acquireQueue()
+    {
+      for (auto queue = _queues.load(); queue; queue = queue->next)
+      {
+        bool owned = false;
+        if (queue->owned.compare_exchange_strong(owned, true))
+          return *queue;
+      }
+      auto queue = new TaskQueue();
+      queue->owned = true;
+      queue->next = _queues.load();
+      while (!_queues.compare_exchange_weak(queue->next, queue)) {}
+      return *queue;
+    }
+
+    bool pop(TaskQueue& ownQueue, Task& task)
+    {
+      if (_taskCount.load() == 0)
+        return false;
+      if (!popFront(ownQueue, task) && !popFront(_sharedQueue, task))
+      {
+        // Steal from the back of the other queues, leaving the oldest tasks
+        // to their owner.
+        auto queue = _queues.load();
+        while (queue && (queue == &ownQueue || !popBack(*queue, task)))
+          queue = queue->next;
+        if (!queue)
+          return false;
+      }
+      // Let another worker take care of the remaining tasks.
+      if (--_taskCount != 0)
+        wakeUpSleepingWorker();
+      return true;
+    }
+
+    static bool popFront(TaskQueue& queue, Task& task)
+    {
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (queue.tasks.empty())
+        return false;
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+      return true;
+    }
+
+    static bool popBack(TaskQueue& queue, Task& task)
+    {
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (queue.tasks.empty())
+        return false;
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+      return true;
+    }
+
+    void wakeUpSleepingWorker()
+    {
+      // One pending wake up is enough: the woken worker wakes up another one if
+      // there are still tasks left when it takes one.
+      if (_sleepingWorkerCount.load() != 0 && !_wakeUpPending.exchange(true))
+        _io.post([this] { _wakeUpPending = false; });
+    }
+
+    boost::asio::io_service& _io;
+    TaskQueue _sharedQueue;
+    std::atomic<TaskQueue*> _queues{nullptr};
+    std::atomic<unsigned int> _taskCount{0};
+    std::atomic<unsigned int> _sleepingWorkerCount{0};
+    std::atomic<bool> _wakeUpPending{false};
+  };
+
+  thread_local EventLoopAsio::WorkStealingScheduler::Worker
+    EventLoopAsio::WorkStealingScheduler::currentWorker{ nullptr, nullptr };
+
   static std::atomic<uint64_t> gTaskId{0};
   static const auto gThreadCountEnvVar = "QI_EVENTLOOP_THREAD_COUNT";
+  static const auto gWorkStealingEnvVar = "QI_EVENTLOOP_WORK_STEALING";
   static const auto gMinThreadsEnvVar = "QI_EVENTLOOP_MIN_THREADS";
   static const auto gMaxThreadsEnvVar = "QI_EVENTLOOP_MAX_THREADS";
   static const auto gPingTimeoutEnvVar = "QI_EVENTLOOP_PING_TIMEOUT";
@@ -270,10 +588,18 @@ namespace qi {
   static const auto gThreadMaxIdleDurationMsEnvVar = "QI_EVENTLOOP_THREAD_MAX_IDLE_DURATION";
   const char* const EventLoopAsio::defaultName = "MainEventLoop";
 
+  EventLoopAsio::Scheduling EventLoopAsio::defaultScheduling()
+  {
+    return qi::os::getEnvDefault(gWorkStealingEnvVar, false) ? Scheduling::WorkStealing
+                                                             : Scheduling::SharedQueue;
+  }
+
   EventLoopAsio::EventLoopAsio(int threadCount, int minThreadCount, int maxThreadCount,
-                               std::string name, bool spawnOnOverload)
+                               std::string name, bool spawnOnOverload, Scheduling scheduling)
     : EventLoopPrivate(std::move(name))
     , _io(threadCount)
+    , _timers(new TimerQueue(_io))
+    , _scheduler(scheduling == Scheduling::WorkStealing ? new WorkStealingScheduler(_io) : nullptr)
     , _work(nullptr)
     , _minThreads(minThreadCount)
     , _maxThreads(maxThreadCount)
@@ -283,8 +609,9 @@ namespace qi {
     start(threadCount);
   }
 
-  EventLoopAsio::EventLoopAsio(int threadCount, std::string name, bool spawnOnOverload)
-    : EventLoopAsio(threadCount, -1, 0, std::move(name), spawnOnOverload)
+  EventLoopAsio::EventLoopAsio(int threadCount, std::string name, bool spawnOnOverload,
+                               Scheduling scheduling)
+    : EventLoopAsio(threadCount, -1, 0, std::move(name), spawnOnOverload, scheduling)
   {
   }
 
@@ -569,7 +896,10 @@ namespace qi {
     while (true) {
       try
       {
-        _io.run();
+        if (_scheduler)
+          _scheduler->run();
+        else
+          _io.run();
         //the handler finished by himself. just quit.
         break;
       } catch(const detail::TerminateThread& /* e */) {
@@ -663,7 +993,7 @@ namespace qi {
       const auto id = ++gTaskId;
 
       auto countTotalTask = ka::shared_ptr(ka::scoped_incr_and_decr(_totalTask));
-      _io.post([=] { invoke_maybe(cb, id, Promise<void>{}, erc, countTotalTask,
+      postTask([=] { invoke_maybe(cb, id, Promise<void>{}, erc, countTotalTask,
                                   UpdateLastWorkDate{true}); });
     }
     else
@@ -711,19 +1041,25 @@ namespace qi {
 
     if (delay > Duration::zero())
     {
-      boost::shared_ptr<boost::asio::steady_timer> timer = boost::make_shared<boost::asio::steady_timer>(_io);
-      timer->expires_from_now(boost::chrono::duration_cast<boost::asio::steady_timer::duration>(delay));
-      auto prom = detail::makeCancelingPromise(options, boost::bind(&boost::asio::steady_timer::cancel, timer));
-      timer->async_wait([=](const boost::system::error_code& erc) {
-        invoke_maybe(cb, id, prom, erc, countTotalTask, update);
-      });
-      return prom.future();
+      const auto now = SteadyClock::now();
+      const auto deadline = delay < SteadyClockTimePoint::max() - now
+                              ? now + delay
+                              : SteadyClockTimePoint::max();
+      return scheduleTimer(deadline, std::move(cb), options, id, countTotalTask, update);
     }
     Promise<void> prom;
-    _io.post([=] { invoke_maybe(cb, id, prom, erc, countTotalTask, update); });
+    postTask([=] { invoke_maybe(cb, id, prom, erc, countTotalTask, update); });
     return prom.future();
   }
 
+  void EventLoopAsio::postTask(boost::function<void()> task)
+  {
+    if (_scheduler)
+      _scheduler->post(std::move(task));
+    else
+      _io.post(std::move(task));
+  }
+
   void EventLoopAsio::post(qi::SteadyClockTimePoint timepoint,
       const boost::function<void ()>& cb, ExecutionOptions options)
   {
@@ -753,11 +1089,31 @@ namespace qi {
 
     auto countTotalTask = ka::shared_ptr(ka::scoped_incr_and_decr(_totalTask));
 
-    boost::shared_ptr<SteadyTimer> timer = boost::make_shared<SteadyTimer>(_io);
-    timer->expires_at(timepoint);
-    auto prom = detail::makeCancelingPromise(options, boost::bind(&SteadyTimer::cancel, timer));
-    timer->async_wait([=](const boost::system::error_code& erc) {
-      invoke_maybe(cb, id, prom, erc, countTotalTask, update);
+    return scheduleTimer(timepoint, std::move(cb), options, id, countTotalTask, update);
+  }
+
+  template <typename D>
+  qi::Future<void> EventLoopAsio::scheduleTimer(
+    qi::SteadyClockTimePoint deadline, boost::function<void ()> cb,
+    ExecutionOptions options, qi::uint64_t id, D countTask, UpdateLastWorkDate update)
+  {
+    // The entry is only known once scheduled, but the promise is needed by
+    // the handler: the cancel callback reads the entry through a shared slot.
+    // The slot does not own the entry, otherwise the entry, its handler and
+    // the promise would keep each other alive.
+    // The promise may also be canceled after the event loop is destroyed, so
+    // the queue is not owned either.
+    auto entrySlot = std::make_shared<std::weak_ptr<TimerQueue::Entry>>();
+    const std::weak_ptr<TimerQueue> weakTimers = _timers;
+    auto prom = detail::makeCancelingPromise(options, [=](Promise<void>&) {
+      const auto timers = weakTimers.lock();
+      if (!timers)
+        return;
+      if (auto entry = entrySlot->lock())
+        timers->cancel(entry);
+    });
+    *entrySlot = _timers->schedule(deadline, [=](const boost::system::error_code& erc) {
+      invoke_maybe(cb, id, prom, erc, countTask, update);
     });
     return prom.future();
   }
@@ -64,11 +64,25 @@ namespace qi {
   public:
     static const char* const defaultName;
 
+    /// How ready tasks are dispatched to the worker threads.
+    enum class Scheduling
+    {
+      /// All workers run the tasks of the single queue of the io service.
+      SharedQueue,
+      /// Each worker has its own queue, idle workers steal tasks from the others.
+      WorkStealing,
+    };
+
+    /// Work stealing if the environment variable QI_EVENTLOOP_WORK_STEALING is
+    /// set to a true value, shared queue otherwise.
+    static Scheduling defaultScheduling();
+
     explicit EventLoopAsio(int threadCount = 0, std::string name = defaultName,
-      bool spawnOnOverload = true);
+      bool spawnOnOverload = true, Scheduling scheduling = defaultScheduling());
 
     EventLoopAsio(int threadCount, int minThreadCount, int maxThreadCount,
-                  std::string name, bool spawnOnOverload);
+                  std::string name, bool spawnOnOverload,
+                  Scheduling scheduling = defaultScheduling());
 
     ~EventLoopAsio() override;
 
@@ -108,7 +122,21 @@ namespace qi {
       qi::SteadyClockTimePoint timepoint, boost::function<void ()> callback,
       ExecutionOptions options, UpdateLastWorkDate);
 
+    void postTask(boost::function<void ()> task);
+
+    /// Destructible D
+    template<typename D>
+    qi::Future<void> scheduleTimer(
+      qi::SteadyClockTimePoint deadline, boost::function<void ()> callback,
+      ExecutionOptions options, qi::uint64_t id, D countTask, UpdateLastWorkDate);
+
     boost::asio::io_service _io;
+    class TimerQueue;
+    // Must be destroyed before _io. Shared so that canceling a task may check
+    // whether it is still alive.
+    std::shared_ptr<TimerQueue> _timers;
+    class WorkStealingScheduler;
+    std::unique_ptr<WorkStealingScheduler> _scheduler; // null in shared queue mode
     std::atomic<boost::asio::io_service::work*> _work; // keep io.run() alive
     std::atomic<int> _minThreads;
     std::atomic<int> _maxThreads;
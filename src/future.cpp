@@ -6,7 +6,10 @@
 #include <qi/log.hpp>
 #include <qi/os.hpp>
 
+#include <functional>
+#include <memory>
 #include <boost/thread.hpp>
+#include <ka/scoped.hpp>
 
 qiLogCategory("qi.future");
 
@@ -15,153 +18,168 @@ namespace qi {
   namespace detail {
     class FutureBasePrivate {
     public:
-      FutureBasePrivate();
+      FutureBasePrivate() = default;
 
       // Disable copy
       FutureBasePrivate(const FutureBasePrivate&) = delete;
       FutureBasePrivate& operator=(const FutureBasePrivate&) = delete;
 
       boost::condition_variable_any _cond;
-      boost::recursive_mutex _mutex;
-      std::string  _error;
-      std::atomic<FutureState> _state;
-      std::atomic<bool> _cancelRequested;
+      boost::mutex _mutex;
     };
 
-    FutureBasePrivate::FutureBasePrivate()
-      : _cond(),
-        _mutex(),
-        _error(),
-        _state(FutureState_None),
-        _cancelRequested(false)
-
-
-    {
-    }
-
     FutureBase::FutureBase()
-      : _p(new FutureBasePrivate())
+      : _state(FutureState_None)
+      , _cancelRequested(false)
+      , _waiterCount(0)
+      , _error()
+      , _p(nullptr)
     {
     }
 
     FutureBase::~FutureBase()
     {
-      delete _p;
+      delete _p.load();
     };
 
+    FutureBasePrivate& FutureBase::waitData() const
+    {
+      if (auto data = _p.load(std::memory_order_acquire))
+        return *data;
+
+      std::unique_ptr<FutureBasePrivate> data(new FutureBasePrivate());
+      FutureBasePrivate* expected = nullptr;
+      if (_p.compare_exchange_strong(expected, data.get(), std::memory_order_acq_rel))
+        return *data.release();
+      return *expected;
+    }
+
     FutureState FutureBase::state() const
     {
-      return FutureState(_p->_state.load());
+      return FutureState(_state.load());
     }
 
-    static bool waitFinished(FutureBasePrivate* p)
+    // The waiters register themselves before checking the state, and the
+    // setter checks for waiters after setting the state, so that it only takes
+    // the mutex if somebody may be waiting.
+    template <typename F>
+    FutureState FutureBase::blockingWait(F waitOnCondition) const
     {
-      return p->_state.load() != FutureState_Running;
+      auto& data = waitData();
+      boost::unique_lock<boost::mutex> lock(data._mutex);
+      auto _ = ka::scoped_incr_and_decr(_waiterCount);
+      waitOnCondition(data._cond, lock, [this] {
+        return _state.load() != FutureState_Running;
+      });
+      return FutureState(_state.load());
     }
 
     FutureState FutureBase::wait(int msecs) const {
-      boost::recursive_mutex::scoped_lock lock(_p->_mutex);
-      if (_p->_state.load() != FutureState_Running)
-        return FutureState(_p->_state.load());
-      if (msecs == FutureTimeout_Infinite)
-        _p->_cond.wait(lock, boost::bind(&waitFinished, _p));
-      else if (msecs > 0)
-        _p->_cond.wait_for(lock, qi::MilliSeconds(msecs),
-            boost::bind(&waitFinished, _p));
+      const auto state = FutureState(_state.load());
       // msecs <= 0 : do nothing just return the state
-      return FutureState(_p->_state.load());
+      if (state != FutureState_Running || msecs <= 0)
+        return state;
+      return blockingWait([&](boost::condition_variable_any& cond,
+                              boost::unique_lock<boost::mutex>& lock,
+                              std::function<bool()> finished) {
+        if (msecs == FutureTimeout_Infinite)
+          cond.wait(lock, finished);
+        else
+          cond.wait_for(lock, qi::MilliSeconds(msecs), finished);
+      });
     }
 
     FutureState FutureBase::wait(qi::Duration duration) const {
-      boost::recursive_mutex::scoped_lock lock(_p->_mutex);
-      if (_p->_state.load() != FutureState_Running)
-        return FutureState(_p->_state.load());
-      _p->_cond.wait_for(lock, duration, boost::bind(&waitFinished, _p));
-      return FutureState(_p->_state.load());
+      const auto state = FutureState(_state.load());
+      if (state != FutureState_Running)
+        return state;
+      return blockingWait([&](boost::condition_variable_any& cond,
+                              boost::unique_lock<boost::mutex>& lock,
+                              std::function<bool()> finished) {
+        cond.wait_for(lock, duration, finished);
+      });
     }
 
     FutureState FutureBase::wait(qi::SteadyClock::time_point timepoint) const {
-      boost::recursive_mutex::scoped_lock lock(_p->_mutex);
-      if (_p->_state.load() != FutureState_Running)
-        return FutureState(_p->_state.load());
-      _p->_cond.wait_until(lock, timepoint, boost::bind(&waitFinished, _p));
-      return FutureState(_p->_state.load());
+      const auto state = FutureState(_state.load());
+      if (state != FutureState_Running)
+        return state;
+      return blockingWait([&](boost::condition_variable_any& cond,
+                              boost::unique_lock<boost::mutex>& lock,
+                              std::function<bool()> finished) {
+        cond.wait_until(lock, timepoint, finished);
+      });
     }
 
     void FutureBase::reportValue() {
-      //always set by setValue
-      //boost::recursive_mutex::scoped_lock lock(_p->_mutex);
-      _p->_state = FutureState_FinishedWithValue;
+      //always set by setValue, once
+      _state = FutureState_FinishedWithValue;
     }
 
     void FutureBase::requestCancel() {
-      _p->_cancelRequested = true;
+      _cancelRequested = true;
     }
 
     void FutureBase::reportCanceled() {
-      //always set by setCanceled
-      //boost::recursive_mutex::scoped_lock lock(_p->_mutex);
-      _p->_state = FutureState_Canceled;
+      //always set by setCanceled, once
+      _state = FutureState_Canceled;
     }
 
     void FutureBase::reportError(const std::string &message) {
-      //always set by setError
-      //boost::recursive_mutex::scoped_lock lock(_p->_mutex);
-      _p->_state = FutureState_FinishedWithError;
-      _p->_error = message;
+      //always set by setError, once. The error is written before the state is
+      //published, and never modified afterwards.
+      _error = message;
+      _state = FutureState_FinishedWithError;
     }
 
     void FutureBase::reportStart() {
       auto expected = FutureState_None;
-      _p->_state.compare_exchange_strong(expected, FutureState_Running);
+      _state.compare_exchange_strong(expected, FutureState_Running);
     }
 
     void FutureBase::notifyFinish() {
-      boost::unique_lock<boost::recursive_mutex> l{_p->_mutex};
-      _p->_cond.notify_all();
+      if (_waiterCount.load() == 0)
+        return;
+      auto& data = waitData();
+      boost::unique_lock<boost::mutex> l{data._mutex};
+      data._cond.notify_all();
     }
 
     bool FutureBase::isFinished() const {
-      FutureState v = FutureState(_p->_state.load());
+      FutureState v = FutureState(_state.load());
       return v == FutureState_FinishedWithValue || v == FutureState_FinishedWithError || v == FutureState_Canceled;
     }
 
     bool FutureBase::isRunning() const {
-      return _p->_state.load() == FutureState_Running;
+      return _state.load() == FutureState_Running;
     }
 
     bool FutureBase::isCanceled() const {
-      return _p->_state.load() == FutureState_Canceled;
+      return _state.load() == FutureState_Canceled;
     }
 
     bool FutureBase::isCancelRequested() const {
-      return _p->_cancelRequested.load();
+      return _cancelRequested.load();
     }
 
     bool FutureBase::hasError(int msecs) const {
       if (wait(msecs) == FutureState_Running)
         throw FutureException(FutureException::ExceptionState_FutureTimeout);
-      return _p->_state.load() == FutureState_FinishedWithError;
+      return _state.load() == FutureState_FinishedWithError;
     }
 
     bool FutureBase::hasValue(int msecs) const {
       if (wait(msecs) == FutureState_Running)
         throw FutureException(FutureException::ExceptionState_FutureTimeout);
-      return _p->_state.load() == FutureState_FinishedWithValue;
+      return _state.load() == FutureState_FinishedWithValue;
     }
 
     const std::string &FutureBase::error(int msecs) const {
       if (wait(msecs) == FutureState_Running)
         throw FutureException(FutureException::ExceptionState_FutureTimeout);
-      if (_p->_state.load() != FutureState_FinishedWithError)
+      if (_state.load() != FutureState_FinishedWithError)
         throw FutureException(FutureException::ExceptionState_FutureHasNoError);
-      boost::recursive_mutex::scoped_lock lock(_p->_mutex);
-      return _p->_error;
-    }
-
-    boost::recursive_mutex& FutureBase::mutex()
-    {
-      return _p->_mutex;
+      return _error;
     }
   }
 
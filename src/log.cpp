@@ -16,8 +16,12 @@
 #include <qi/log.hpp>
 #include "log_p.hpp"
 #include <qi/os.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <list>
 #include <map>
+#include <memory>
 #include <cstring>
 #include <iomanip>
 #include <iostream>
@@ -34,7 +38,6 @@
 #include <boost/unordered_map.hpp>
 #include <boost/algorithm/string.hpp>
 
-#include <boost/lockfree/queue.hpp>
 #include <boost/function.hpp>
 #include <boost/predef.h>
 #include <boost/utility/string_ref.hpp>
@@ -61,11 +64,6 @@
 #endif
 
 
-#define RTLOG_BUFFERS (128)
-
-#define CAT_SIZE 64
-#define FILE_SIZE 128
-#define FUNC_SIZE 64
 #define LOG_SIZE 2048
 
 qiLogCategory("qi.log");
@@ -227,16 +225,160 @@ namespace qi {
 
   namespace log {
 
-    using privateLog = struct sPrivateLog
+    /// Single-producer single-consumer ring of the records logged
+    /// asynchronously by one thread.
+    ///
+    /// Records are stored contiguously, as a header followed by the bytes of
+    /// the message. The category, file and function are stored as pointers:
+    /// categories are never destroyed, file and function are expected to be
+    /// string literals (`__FILE__`, `__FUNCTION__`). A record that does not fit
+    /// in the ring is dropped and counted, records are never overwritten.
+    class LogRing
     {
-      qi::LogLevel               _logLevel;
-      char                       _category[CAT_SIZE];
-      char                       _file[FILE_SIZE];
-      char                       _function[FUNC_SIZE];
-      int                        _line;
-      char                       _log[LOG_SIZE];
-      qi::Clock::time_point       _date;
-      qi::SystemClock::time_point _systemDate;
+    public:
+      struct Record
+      {
+        std::uint32_t               size; // of the whole record, in bytes
+        std::uint32_t               messageSize; // including the terminating null
+        qi::LogLevel                level;
+        int                         line;
+        detail::Category*           category;
+        const char*                 file;
+        const char*                 function;
+        qi::Clock::time_point       date;
+        qi::SystemClock::time_point systemDate;
+
+        const char* message() const
+        {
+          return reinterpret_cast<const char*>(this + 1);
+        }
+      };
+
+      static const std::size_t capacity = 1 << 17;
+
+      LogRing()
+        : _buffer(new std::uint64_t[capacity / sizeof(std::uint64_t)])
+      {
+      }
+
+      // Producer side.
+      bool push(qi::LogLevel level,
+                detail::Category* category,
+                const char* msg,
+                const char* file,
+                const char* function,
+                int line,
+                qi::Clock::time_point date,
+                qi::SystemClock::time_point systemDate)
+      {
+        if (!msg)
+          msg = "(null)";
+        const auto messageSize = std::min<std::size_t>(std::strlen(msg), LOG_SIZE - 1) + 1;
+        const auto size = alignedSize(sizeof(Record) + messageSize);
+
+        const auto head = _head.load(std::memory_order_relaxed);
+        const auto tail = _tail.load(std::memory_order_acquire);
+        const auto offset = head & mask;
+        // A record is never split: if it does not fit before the end of the
+        // buffer, the remaining bytes are skipped.
+        const auto padding = capacity - offset < size ? capacity - offset : 0;
+        if (head + padding + size - tail > capacity)
+        {
+          _dropCount.fetch_add(1, std::memory_order_relaxed);
+          return false;
+        }
+
+        if (padding)
+          *reinterpret_cast<std::uint32_t*>(bytes() + offset) =
+            static_cast<std::uint32_t>(padding) | paddingFlag;
+
+        auto* record = new (bytes() + ((head + padding) & mask)) Record{
+          static_cast<std::uint32_t>(size), static_cast<std::uint32_t>(messageSize),
+          level, line, category, file, function, date, systemDate };
+        auto* message = reinterpret_cast<char*>(record + 1);
+        std::memcpy(message, msg, messageSize - 1);
+        message[messageSize - 1] = '\0';
+
+        _head.store(head + padding + size, std::memory_order_release);
+        return true;
+      }
+
+      void close()
+      {
+        _closed.store(true, std::memory_order_release);
+      }
+
+      // Consumer side.
+      std::size_t published() const
+      {
+        return _head.load(std::memory_order_acquire);
+      }
+
+      std::size_t consumed() const
+      {
+        return _tail.load(std::memory_order_relaxed);
+      }
+
+      bool closed() const
+      {
+        return _closed.load(std::memory_order_acquire);
+      }
+
+      /// Calls `f` with each record published before `end`. The records stay
+      /// valid until `release(end)` is called.
+      template <typename F>
+      void forEachRecord(std::size_t end, F&& f) const
+      {
+        auto pos = _tail.load(std::memory_order_relaxed);
+        while (pos != end)
+        {
+          const auto* data = bytes() + (pos & mask);
+          const auto size = *reinterpret_cast<const std::uint32_t*>(data);
+          if (size & paddingFlag)
+          {
+            pos += size & ~paddingFlag;
+            continue;
+          }
+          f(*reinterpret_cast<const Record*>(data));
+          pos += size;
+        }
+      }
+
+      void release(std::size_t end)
+      {
+        _tail.store(end, std::memory_order_release);
+      }
+
+      std::uint64_t dropCount() const
+      {
+        return _dropCount.load(std::memory_order_relaxed);
+      }
+
+      std::uint64_t takeDropCount()
+      {
+        return _dropCount.exchange(0, std::memory_order_relaxed);
+      }
+
+    private:
+      static const std::size_t mask = capacity - 1;
+      static const std::uint32_t paddingFlag = 1u << 31;
+
+      static std::size_t alignedSize(std::size_t size)
+      {
+        return (size + alignof(Record) - 1) & ~(alignof(Record) - 1);
+      }
+
+      unsigned char* bytes() const
+      {
+        return reinterpret_cast<unsigned char*>(_buffer.get());
+      }
+
+      std::unique_ptr<std::uint64_t[]> _buffer;
+      // Offsets only grow, their position in the buffer is obtained by masking.
+      std::atomic<std::size_t> _head{ 0 };
+      std::atomic<std::size_t> _tail{ 0 };
+      std::atomic<std::uint64_t> _dropCount{ 0 };
+      std::atomic<bool> _closed{ false };
     };
 
     class Log
@@ -281,8 +423,12 @@ namespace qi {
       boost::condition_variable  LogReadyCond;
       bool                       SyncLog;
       bool                       AsyncLogInit;
+      // Set while the log thread waits for records. Producers only wake it up
+      // in this state, so that it is woken once per batch of records.
+      std::atomic<bool>          LogThreadIdle;
 
-      boost::lockfree::queue<privateLog*>     logs;
+      // Records gathered by printLog, kept to reuse their storage.
+      std::vector<const LogRing::Record*> PendingRecords;
 
       using LogHandlerMap = std::map<std::string, Handler>;
       LogHandlerMap logHandlers;
@@ -334,8 +480,65 @@ namespace qi {
     static LogColor               _glColorWhen = LogColor_Auto;
 
     static Log                   *LogInstance = nullptr;
-    static privateLog             LogBuffer[RTLOG_BUFFERS];
-    static volatile unsigned long LogPush = 0;
+
+    // The rings of the threads that log asynchronously. A ring is destroyed
+    // once its thread has exited and its records have been dispatched.
+    struct LogRings
+    {
+      boost::mutex mutex;
+      std::vector<std::unique_ptr<LogRing>> rings;
+    };
+
+    inline LogRings& _logRings()
+    {
+      static LogRings* _glLogRings;
+      QI_ONCE(_glLogRings = new LogRings);
+      return *_glLogRings;
+    }
+
+    // Set once the ring of the current thread has been released, at thread
+    // exit. Records logged afterwards by this thread are dispatched
+    // synchronously.
+    static thread_local bool _threadLogRingReleased = false;
+
+    struct ThreadLogRing
+    {
+      LogRing* ring = nullptr;
+
+      ~ThreadLogRing()
+      {
+        if (ring)
+          ring->close();
+        _threadLogRingReleased = true;
+      }
+    };
+
+    static LogRing* threadLogRing()
+    {
+      if (_threadLogRingReleased)
+        return nullptr;
+
+      static thread_local ThreadLogRing threadRing;
+      if (!threadRing.ring)
+      {
+        auto& logRings = _logRings();
+        std::unique_ptr<LogRing> ring(new LogRing);
+        threadRing.ring = ring.get();
+        boost::mutex::scoped_lock lock(logRings.mutex);
+        logRings.rings.push_back(std::move(ring));
+      }
+      return threadRing.ring;
+    }
+
+    static bool hasPendingRecords()
+    {
+      auto& logRings = _logRings();
+      boost::mutex::scoped_lock lock(logRings.mutex);
+      return std::any_of(logRings.rings.begin(), logRings.rings.end(),
+                         [](const std::unique_ptr<LogRing>& ring) {
+                           return ring->published() != ring->consumed() || ring->closed();
+                         });
+    }
 
     namespace detail {
 
@@ -649,15 +852,56 @@ namespace qi {
 
     void Log::printLog()
     {
-      privateLog* pl = nullptr;
-
       boost::recursive_mutex::scoped_lock lock(_mutex(), boost::defer_lock);
       boost::mutex::scoped_lock lockHandlers(LogInstance->LogHandlerLock, boost::defer_lock);
       boost::lock(lock, lockHandlers);
-      while (logs.pop(pl))
+
+      // Holding the handlers lock makes this thread the only consumer of the
+      // rings.
+      std::vector<std::pair<LogRing*, std::size_t>> rings;
       {
-        dispatch_unsynchronized(pl->_logLevel, pl->_date, pl->_systemDate, pl->_category, pl->_log,
-                                pl->_file, pl->_function, pl->_line);
+        auto& logRings = _logRings();
+        boost::mutex::scoped_lock lockRings(logRings.mutex);
+        const auto isDone = [](const std::unique_ptr<LogRing>& ring) {
+          return ring->closed() && ring->published() == ring->consumed()
+              && ring->dropCount() == 0;
+        };
+        logRings.rings.erase(
+          std::remove_if(logRings.rings.begin(), logRings.rings.end(), isDone),
+          logRings.rings.end());
+        for (const auto& ring : logRings.rings)
+          rings.emplace_back(ring.get(), ring->published());
+      }
+
+      // Records of each thread are in order, they are merged by date.
+      PendingRecords.clear();
+      for (const auto& ring : rings)
+        ring.first->forEachRecord(ring.second, [&](const LogRing::Record& record) {
+          PendingRecords.push_back(&record);
+        });
+      std::stable_sort(PendingRecords.begin(), PendingRecords.end(),
+                       [](const LogRing::Record* lhs, const LogRing::Record* rhs) {
+                         return lhs->date < rhs->date;
+                       });
+
+      for (const auto* record : PendingRecords)
+        dispatch_unsynchronized(record->level, record->date, record->systemDate,
+                                *record->category, record->message(), record->file,
+                                record->function, record->line);
+      PendingRecords.clear();
+
+      for (const auto& ring : rings)
+      {
+        ring.first->release(ring.second);
+        const auto dropCount = ring.first->takeDropCount();
+        if (dropCount != 0)
+        {
+          const auto msg = std::to_string(dropCount)
+            + " log records were dropped, the log buffer of a thread was full.";
+          dispatch_unsynchronized(qi::LogLevel_Warning, qi::Clock::now(), qi::SystemClock::now(),
+                                  *addCategory("qi.log"), msg.c_str(), __FILE__,
+                                  __FUNCTION__, __LINE__);
+        }
       }
     }
 
@@ -702,7 +946,13 @@ namespace qi {
       {
         {
           boost::mutex::scoped_lock lock(LogWriteLock);
-          LogReadyCond.wait(lock, []{ return !LogInstance->logs.empty(); });
+          LogThreadIdle.store(true, std::memory_order_relaxed);
+          // Pairs with the fence of `detail::log`: either the producer sees
+          // this thread idle, or this thread sees the record.
+          std::atomic_thread_fence(std::memory_order_seq_cst);
+          if (!hasPendingRecords())
+            LogReadyCond.wait(lock, [this]{ return !LogThreadIdle.load(); });
+          LogThreadIdle.store(false, std::memory_order_relaxed);
         }
 
         printLog();
@@ -721,8 +971,8 @@ namespace qi {
 
     inline Log::Log() :
       SyncLog(true),
-      AsyncLogInit(false)
-      , logs(50)
+      AsyncLogInit(false),
+      LogThreadIdle(false)
     {
       LogInit = true;
     }
@@ -742,17 +992,6 @@ namespace qi {
       }
     }
 
-    static void my_strcpy(char *dst, const char *src, int len) {
-      if (!src)
-        src = "(null)";
-#ifdef _MSV_VER
-      strncpy_s(dst, len, src, _TRUNCATE);
-#else
-      strncpy(dst, src, len);
-      dst[len - 1] = 0;
-#endif
-    }
-
     static void doInit(qi::LogLevel verb) {
       //if init has already been called, we are set here. (reallocating all globals
       // will lead to racecond)
@@ -833,7 +1072,8 @@ namespace qi {
 
       qi::Clock::time_point date = qi::Clock::now();
       qi::SystemClock::time_point systemDate = qi::SystemClock::now();
-      if (LogInstance->SyncLog)
+      LogRing* ring = LogInstance->SyncLog ? nullptr : threadLogRing();
+      if (!ring)
       {
         boost::recursive_mutex::scoped_lock lock(_mutex(), boost::defer_lock);
         boost::mutex::scoped_lock lockHandlers(LogInstance->LogHandlerLock, boost::defer_lock);
@@ -847,20 +1087,19 @@ namespace qi {
       }
       else
       {
-        int tmpRtLogPush = ++LogPush % RTLOG_BUFFERS;
-        privateLog* pl = &(LogBuffer[tmpRtLogPush]);
-
-        pl->_logLevel = verb;
-        pl->_line = line;
-        pl->_date = date;
-        pl->_systemDate = systemDate;
-
-        my_strcpy(pl->_category, categoryStr, CAT_SIZE);
-        my_strcpy(pl->_file, file, FILE_SIZE);
-        my_strcpy(pl->_function, fct, FUNC_SIZE);
-        my_strcpy(pl->_log, msg, LOG_SIZE);
-        LogInstance->logs.push(pl);
-        LogInstance->LogReadyCond.notify_one();
+        if (!category)
+          category = addCategory(categoryStr);
+        if (!ring->push(verb, category, msg, file, fct, line, date, systemDate))
+          return;
+
+        // Pairs with the fence of `Log::run`.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (LogInstance->LogThreadIdle.load(std::memory_order_relaxed)
+            && LogInstance->LogThreadIdle.exchange(false))
+        {
+          boost::mutex::scoped_lock lock(LogInstance->LogWriteLock);
+          LogInstance->LogReadyCond.notify_one();
+        }
       }
     }
 
@@ -3,12 +3,17 @@
 **  See COPYING for the license
 */
 
+#include <algorithm>
 #include <boost/make_shared.hpp>
 
 #include <qi/anyobject.hpp>
+#include <qi/getenv.hpp>
 #include <qi/type/objecttypebuilder.hpp>
+#include <qi/type/dynamicobject.hpp>
+#include <qi/type/detail/staticobjecttype.hpp>
 #include <src/type/signal_p.hpp>
 #include "boundobject.hpp"
+#include "metaobjectcache_p.hpp"
 
 const auto logCategory = "qimessaging.boundobject";
 qiLogCategory(logCategory);
@@ -88,6 +93,144 @@ namespace qi
     return AnyReference();
   }
 
+  namespace
+  {
+    /// A call dispatched by a bound object, in the thread that executes it.
+    struct CallContext
+    {
+      const BoundObject* object;
+      MessageSocketPtr socket;
+      const CallContext* previous;
+    };
+
+    /// Innermost call dispatched by a bound object on this thread. Calls may
+    /// nest, if a synchronous call ends up calling another bound object.
+    thread_local const CallContext* currentCallContext = nullptr;
+
+    /// If set, the messages of objects whose methods are called queued are
+    /// dispatched as soon as they are received, instead of being posted to the
+    /// strand of the socket.
+    const auto gInlineDispatchEnvVar = "QI_MESSAGE_DISPATCH_INLINE";
+
+    MessageDispatcher::HandlerKind handlerKind(MetaCallType callType)
+    {
+      static const bool inlineDispatch = os::getEnvDefault(gInlineDispatchEnvVar, false);
+      return inlineDispatch && callType == MetaCallType_Queued
+        ? MessageDispatcher::HandlerKind::NonBlocking
+        : MessageDispatcher::HandlerKind::MayBlock;
+    }
+
+    /// If set to false, the string and raw arguments of calls are always copied
+    /// out of the messages they come in, even for methods taking views.
+    const auto gArgumentViewsEnvVar = "QI_MESSAGE_ARGUMENT_VIEWS";
+
+    /// @return the ids of the methods of the object that take StringView or
+    /// BufferView parameters. Only such methods get their arguments decoded as
+    /// views: other ones, dynamic functions in particular, receive the
+    /// arguments as the types of their signature (std::string, qi::Buffer...).
+    boost::container::flat_set<unsigned int> viewMethodIds(const AnyObject& object)
+    {
+      boost::container::flat_set<unsigned int> ids;
+      static const bool argumentViews = os::getEnvDefault(gArgumentViewsEnvVar, true);
+      if (!argumentViews)
+        return ids;
+
+      GenericObject& go = *object.asGenericObject();
+      const bool isDynamic = go.type == getDynamicTypeInterface();
+      const auto staticType =
+        isDynamic ? nullptr : dynamic_cast<detail::StaticObjectTypeBase*>(go.type);
+      if (!isDynamic && !staticType)
+        return ids;
+
+      static const TypeInfo stringViewInfo = typeOf<StringView>()->info();
+      static const TypeInfo bufferViewInfo = typeOf<BufferView>()->info();
+      for (const auto& metaMethod : go.metaObject().methodMap())
+      {
+        const auto methodId = metaMethod.first;
+        const AnyFunction* method = isDynamic
+          ? &static_cast<DynamicObject*>(go.value)->method(methodId)
+          : staticType->method(methodId);
+        if (!method || !*method)
+          continue;
+        const auto types = method->argumentsType();
+        if (std::any_of(types.begin(), types.end(), [](TypeInterface* type) {
+              return type->info() == stringViewInfo || type->info() == bufferViewInfo;
+            }))
+          ids.insert(methodId);
+      }
+      return ids;
+    }
+
+    /// Returns the type in which the arguments of a call of the given
+    /// parameters signature are decoded for a method taking views. String and
+    /// raw arguments are decoded as views on the message, so that the method
+    /// gets them without copy. Arguments are converted to the parameter types
+    /// of the method afterwards anyway.
+    TypeInterface* callArgumentsType(const Signature& sigparam)
+    {
+      if (sigparam.type() != Signature::Type_Tuple)
+        return TypeInterface::fromSignature(sigparam);
+
+      const SignatureVector& children = sigparam.children();
+      std::vector<TypeInterface*> types;
+      types.reserve(children.size());
+      bool hasViews = false;
+      for (const auto& child : children)
+      {
+        switch (child.type())
+        {
+        case Signature::Type_String:
+          types.push_back(typeOf<StringView>());
+          hasViews = true;
+          break;
+        case Signature::Type_Raw:
+          types.push_back(typeOf<BufferView>());
+          hasViews = true;
+          break;
+        default:
+          types.push_back(TypeInterface::fromSignature(child));
+          if (!types.back())
+            return nullptr;
+          break;
+        }
+      }
+      return hasViews ? makeTupleType(types) : TypeInterface::fromSignature(sigparam);
+    }
+  }
+
+  /// Makes a socket the calling socket of a bound object in the current thread,
+  /// for the duration of the synchronous part of the call.
+  class BoundObject::ScopedCallContext
+  {
+  public:
+    ScopedCallContext(const BoundObject& object, MessageSocketPtr socket)
+      : _context{ &object, std::move(socket), currentCallContext }
+    {
+      currentCallContext = &_context;
+    }
+
+    ~ScopedCallContext()
+    {
+      currentCallContext = _context.previous;
+    }
+
+    ScopedCallContext(const ScopedCallContext&) = delete;
+    ScopedCallContext& operator=(const ScopedCallContext&) = delete;
+
+  private:
+    CallContext _context;
+  };
+
+  MessageSocketPtr BoundObject::callingSocket() const
+  {
+    for (auto context = currentCallContext; context; context = context->previous)
+    {
+      if (context->object == this)
+        return context->socket;
+    }
+    return {};
+  }
+
   struct BoundObject::CancelableKit
   {
     BoundObject::CancelableMap map;
@@ -113,6 +256,14 @@ namespace qi
     QI_LOG_DEBUG_BOUNDOBJECT() << "Constructing a BoundObject";
   }
 
+  bool BoundObject::takesViews(unsigned int methodId)
+  {
+    // The methods of the object do not change once it is bound: they are
+    // looked up on the first call only.
+    std::call_once(_viewMethodIdsComputed, [&] { _viewMethodIds = viewMethodIds(_object); });
+    return _viewMethodIds.count(methodId) != 0;
+  }
+
   BoundObject::~BoundObject()
   {
     _cancelables.reset();
@@ -129,7 +280,7 @@ namespace qi
     {
       ob = new qi::ObjectTypeBuilder<BoundObject>();
       // these are called synchronously by onMessage (and this is needed for
-      // _currentSocket), no need for threadsafety here
+      // callingSocket()), they protect the state they share themselves
       ob->setThreadingModel(ObjectThreadingModel_MultiThread);
       /* Network-related stuff.
       */
@@ -142,6 +293,7 @@ namespace qi
       * There is no use-case that requires the methods below without a BoundObject present.
       */
       ob->advertiseMethod("metaObject"     , &BoundObject::metaObject, MetaCallType_Direct, qi::Message::BoundObjectFunction_MetaObject);
+      ob->advertiseMethod("metaObjectIfChanged", &BoundObject::metaObjectIfChanged, MetaCallType_Direct, qi::Message::BoundObjectFunction_MetaObjectIfChanged);
       ob->advertiseMethod("property", &BoundObject::property, MetaCallType_Queued, qi::Message::BoundObjectFunction_GetProperty);
       ob->advertiseMethod("setProperty", &BoundObject::setProperty, MetaCallType_Queued, qi::Message::BoundObjectFunction_SetProperty);
       ob->advertiseMethod("properties",       &BoundObject::properties, MetaCallType_Direct, qi::Message::BoundObjectFunction_Properties);
@@ -157,11 +309,14 @@ namespace qi
     const MetaSignal* ms = _object.metaObject().signal(eventId);
     if (!ms)
       throw std::runtime_error("No such signal");
-    QI_ASSERT(_currentSocket);
-    AnyFunction mc = AnyFunction::fromDynamicFunction(boost::bind(&forwardEvent, _1, _serviceId, _objectId, eventId, ms->parametersSignature(), _currentSocket, asHostWeakPtr(), ""));
+    const auto socket = callingSocket();
+    QI_ASSERT(socket);
+    AnyFunction mc = AnyFunction::fromDynamicFunction(boost::bind(&forwardEvent, _1, _serviceId, _objectId, eventId, ms->parametersSignature(), socket, asHostWeakPtr(), ""));
     qi::Future<SignalLink> linking = _object.connect(eventId, mc);
-    auto& linkEntry = _links[_currentSocket][remoteSignalLinkId];
-    linkEntry = RemoteSignalLink(linking, eventId);
+    {
+      boost::mutex::scoped_lock lock(_linksMutex);
+      _links[socket][remoteSignalLinkId] = RemoteSignalLink(linking, eventId);
+    }
     return linking.andThen([=](SignalLink linkId) mutable {
       QI_LOG_DEBUG_BOUNDOBJECT() << "Registered event remote_signal_link=" << remoteSignalLinkId
                                  << " local_link=" << linkId;
@@ -174,11 +329,14 @@ namespace qi
     const MetaSignal* ms = _object.metaObject().signal(eventId);
     if (!ms)
       throw std::runtime_error("No such signal");
-    QI_ASSERT(_currentSocket);
-    AnyFunction mc = AnyFunction::fromDynamicFunction(boost::bind(&forwardEvent, _1, _serviceId, _objectId, eventId, ms->parametersSignature(), _currentSocket, asHostWeakPtr(), signature));
+    const auto socket = callingSocket();
+    QI_ASSERT(socket);
+    AnyFunction mc = AnyFunction::fromDynamicFunction(boost::bind(&forwardEvent, _1, _serviceId, _objectId, eventId, ms->parametersSignature(), socket, asHostWeakPtr(), signature));
     qi::Future<SignalLink> linking = _object.connect(eventId, mc);
-    auto& linkEntry = _links[_currentSocket][remoteSignalLinkId];
-    linkEntry = RemoteSignalLink(linking, eventId);
+    {
+      boost::mutex::scoped_lock lock(_linksMutex);
+      _links[socket][remoteSignalLinkId] = RemoteSignalLink(linking, eventId);
+    }
     return linking.andThen([=](SignalLink linkId) mutable {
       QI_LOG_DEBUG_BOUNDOBJECT() << "Registered event remote_signal_link=" << remoteSignalLinkId
                                  << " local_link=" << linkId;
@@ -194,21 +352,28 @@ namespace qi
     if (!isValidSignalLink(remoteSignalLinkId))
       return futurize();
 
-    ServiceSignalLinks&          sl = _links[_currentSocket];
-    ServiceSignalLinks::iterator it = sl.find(remoteSignalLinkId);
-
-    if (it == sl.end())
+    const auto socket = callingSocket();
+    Future<SignalLink> localSignalLinkId;
     {
-      std::stringstream ss;
-      ss << "Unregister request failed for " << remoteSignalLinkId << " " << objectId;
-      qiLogError() << ss.str();
-      throw std::runtime_error(ss.str());
-    }
+      boost::mutex::scoped_lock lock(_linksMutex);
+      ServiceSignalLinks&          sl = _links[socket];
+      ServiceSignalLinks::iterator it = sl.find(remoteSignalLinkId);
+
+      if (it == sl.end())
+      {
+        if (sl.empty())
+          _links.erase(socket);
+        std::stringstream ss;
+        ss << "Unregister request failed for " << remoteSignalLinkId << " " << objectId;
+        qiLogError() << ss.str();
+        throw std::runtime_error(ss.str());
+      }
 
-    auto localSignalLinkId = it->second.localSignalLinkId;
-    sl.erase(it);
-    if (sl.empty())
-      _links.erase(_currentSocket);
+      localSignalLinkId = it->second.localSignalLinkId;
+      sl.erase(it);
+      if (sl.empty())
+        _links.erase(socket);
+    }
     return localSignalLinkId.andThen([=](SignalLink link) {
       return _object.disconnect(link).async();
     }).unwrap();
@@ -220,6 +385,19 @@ namespace qi
     return qi::MetaObject::merge(_self.metaObject(), _object.metaObject());
   }
 
+  qi::MetaObject BoundObject::metaObjectIfChanged(unsigned int objectId,
+                                                  const std::vector<unsigned char>& knownDigest)
+  {
+    auto mo = metaObject(objectId);
+    const auto digest = contentDigest(mo);
+    // A metaobject always has the special methods: an empty one cannot be
+    // mistaken for an actual metaobject.
+    if (knownDigest.size() == digest.size()
+        && std::equal(knownDigest.begin(), knownDigest.end(), digest.begin()))
+      return qi::MetaObject();
+    return mo;
+  }
+
 
   void BoundObject::terminate(unsigned int)
   {
@@ -242,7 +420,8 @@ namespace qi
 
   DispatchStatus BoundObject::onMessage(const qi::Message& msg, MessageSocketPtr socket)
   {
-    boost::recursive_mutex::scoped_lock lock(_callMutex);
+    // No lock is held here: calls from any number of sockets and threads are
+    // deserialized and dispatched concurrently.
     bool exceptionWasThrown = false;
     try {
       if (msg.version() > Message::Header::currentVersion())
@@ -330,7 +509,19 @@ namespace qi
       // AnyReference and achieve exception-safety through a scoped, than using
       // an AnyValue.
       bool mustDestroyRef = true;
-      ref = msg.value(sigparam, socket).release();
+      const bool viewArguments = msg.type() == Message::Type_Call && !isSpecialFunction
+        && !(msg.flags() & Message::TypeFlag_DynamicPayload) && takesViews(funcId);
+      if (viewArguments)
+      {
+        TypeInterface* type = callArgumentsType(hasReturnType ? originalSignature : sigparam);
+        if (type && hasReturnType)
+          type = makeTupleType({ type, typeOf<std::string>() });
+        ref = msg.value(type, socket).release();
+      }
+      else
+      {
+        ref = msg.value(sigparam, socket).release();
+      }
       auto guard = ka::scoped([&]() {
         if (mustDestroyRef)
         {
@@ -359,24 +550,21 @@ namespace qi
         mustDestroyRef = true; // Reactivate destroy on scope exit.
       }
       mfp = ref.asTupleValuePtr();
-      /* Because of 'global' _currentSocket, we cannot support parallel
-      * executions at this point.
-      * Both on self, and on obj which can use currentSocket() too.
+      /* The calling socket is made available to the methods of self, and of
+      * obj through currentSocket(), for the duration of the synchronous part
+      * of the call on this thread only.
       *
-      * So put a lock, and rely on metaCall we invoke being asynchronous for// execution
-      * This is decided by _callType, set from BoundObject ctor argument, passed by Server, which
-      * uses its internal _defaultCallType, passed to its constructor, default
-      * to queued. When Server is instanciated by ObjectHost, it uses the default
-      * value.
+      * Whether the call is executed synchronously is decided by _callType, set
+      * from BoundObject ctor argument, passed by Server, which uses its internal
+      * _defaultCallType, passed to its constructor, default to queued. When
+      * Server is instanciated by ObjectHost, it uses the default value.
       *
       * As a consequence, users of currentSocket() must set _callType to Direct.
-      * Calling currentSocket multiple times in a row should be avoided.
       */
+      ScopedCallContext callContext(*this, socket);
       switch (msg.type())
       {
       case Message::Type_Call: {
-        boost::recursive_mutex::scoped_lock lock(_mutex);
-        _currentSocket = socket;
 
         // Property accessors are insecure to call synchronously
         // because users can customize them.
@@ -397,7 +585,6 @@ namespace qi
         const MetaMethod* mm = obj.metaObject().method(funcId);
         if (mm)
           retSig = mm->returnSignature();
-        _currentSocket.reset();
 
         fut.connect(boost::bind<void>
                     (&BoundObject::serverResultAdapter, _1, retSig, _gethost(), socket, msg.address(), sig,
@@ -576,7 +763,8 @@ namespace qi
       track([this, socket](const Message& msg) { return onMessage(msg, socket); }, weak_from_this());
     syncConnectionList->emplace_back(socket,
                                      MessageDispatcher::RecipientId{ _serviceId, _objectId },
-                                     std::move(handler));
+                                     std::move(handler),
+                                     handlerKind(_callType));
     return true;
   }
 
@@ -850,27 +1038,27 @@ namespace qi
   {
     QI_LOG_DEBUG_BOUNDOBJECT() << "Disconnecting links from socket " << socket;
 
-    boost::recursive_mutex::scoped_lock lock(_callMutex);
-    auto it = _links.find(socket);
-
-    std::size_t count = 0;
-
-    if (it != _links.end())
+    ServiceSignalLinks links;
     {
-      count = it->second.size();
-      for (const auto& linkSlot : it->second)
-      {
-        // FIXME: Do this in the destructor of `RemoteSignalLink` instead, and make it move only.
-        const auto remoteLink = linkSlot.second;
-        _object.disconnect(remoteLink.localSignalLinkId.value()).async().then([](Future<void> f) {
-          if (f.hasError())
-            qiLogError() << f.error();
-        });
-      }
+      boost::mutex::scoped_lock lock(_linksMutex);
+      auto it = _links.find(socket);
+      if (it == _links.end())
+        return 0;
+      links = std::move(it->second);
       _links.erase(it);
     }
 
-    return count;
+    for (const auto& linkSlot : links)
+    {
+      // FIXME: Do this in the destructor of `RemoteSignalLink` instead, and make it move only.
+      const auto remoteLink = linkSlot.second;
+      _object.disconnect(remoteLink.localSignalLinkId.value()).async().then([](Future<void> f) {
+        if (f.hasError())
+          qiLogError() << f.error();
+      });
+    }
+
+    return links.size();
   }
 
   namespace detail
@@ -7,11 +7,13 @@
 #ifndef _SRC_BOUNDOBJECT_HPP_
 #define _SRC_BOUNDOBJECT_HPP_
 
+#include <mutex>
 #include <string>
 #include <boost/thread/mutex.hpp>
 #include <boost/signals2.hpp>
 #include <boost/optional.hpp>
 #include <boost/container/flat_map.hpp>
+#include <boost/container/flat_set.hpp>
 #include <qi/api.hpp>
 #include <qi/session.hpp>
 #include "transportserver.hpp"
@@ -119,26 +121,25 @@ namespace qi
     qi::Future<SignalLink> registerEventWithSignature(unsigned int serviceId, unsigned int eventId, SignalLink linkId, const std::string& signature);
     qi::Future<void> unregisterEvent(unsigned int serviceId, unsigned int eventId, SignalLink linkId);
     qi::MetaObject metaObject(unsigned int serviceId);
+    /// @return the metaobject, or an empty one if its digest is `knownDigest`.
+    qi::MetaObject metaObjectIfChanged(unsigned int serviceId, const std::vector<unsigned char>& knownDigest);
     void           terminate(unsigned int serviceId); //bound only in special cases
     qi::Future<AnyValue> property(const AnyValue& name);
     Future<void>   setProperty(const AnyValue& name, AnyValue value);
     std::vector<std::string> properties();
   public:
     /*
-    * Returns the last socket that sent a message to this object.
-    * Considering the volatility of this operation, Users of currentSocket()
-    * must set _callType to Direct, otherwise behavior is undefined. Calling
-    * currentSocket multiple times in a row in the same context should be
-    * avoided: call it once and use the return value, unless you know what
-    * you're doing.
+    * Returns the socket that sent the call being executed by this object on
+    * the current thread, or null if there is none.
+    * The socket is only known for the duration of the synchronous part of the
+    * call, therefore users of currentSocket() must set _callType to Direct.
     */
     inline qi::MessageSocketPtr currentSocket() const {
 #ifndef NDEBUG
       if (_callType != MetaCallType_Direct)
         qiLogWarning("qimessaging.boundobject") << " currentSocket() used but callType is not direct";
 #endif
-      boost::recursive_mutex::scoped_lock lock(_mutex);
-      return _currentSocket;
+      return callingSocket();
     }
 
     inline AnyObject object() { return _object;}
@@ -176,6 +177,14 @@ namespace qi
 
     DispatchStatus onMessage(const qi::Message& msg, MessageSocketPtr socket);
 
+    /// Socket of the call dispatched by this object on the current thread.
+    MessageSocketPtr callingSocket() const;
+
+    /// Whether the method of the object takes StringView or BufferView
+    /// parameters, which are then decoded as views on the call message.
+    bool takesViews(unsigned int methodId);
+    class ScopedCallContext;
+
     qi::AnyObject createBoundObjectType(BoundObject *self, bool bindTerminate = false);
 
     inline boost::weak_ptr<ObjectHost> _gethost()
@@ -220,11 +229,9 @@ namespace qi
     // Event handling.
     BySocketServiceSignalLinks _links;
 
-    // Locked when a `Call` message is received. It protects `_links`, `_object` and `_self`.
+    // Protects `_links`. Never held while calling into the object.
     // TODO: Use a synchronized_value instead.
-    boost::recursive_mutex _callMutex;
-
-    qi::MessageSocketPtr _currentSocket;
+    boost::mutex _linksMutex;
 
     using MessageDispatchConnectionList = std::vector<MessageDispatchConnection>;
     boost::synchronized_value<MessageDispatchConnectionList> _messageDispatchConnectionList;
@@ -234,10 +241,9 @@ namespace qi
     qi::AnyObject          _self;
     const qi::MetaCallType _callType;
     boost::optional<boost::weak_ptr<qi::ObjectHost>> _owner;
-    // prevents parallel onMessage on self execution and protects the current socket
-    // TODO: Use a synchronized_value instead.
-    mutable boost::recursive_mutex           _mutex;
     boost::synchronized_value<boost::function<void (MessageSocketPtr)>> _onSocketUnboundCallback;
+    std::once_flag _viewMethodIdsComputed;
+    boost::container::flat_set<unsigned int> _viewMethodIds;
 
     static std::atomic<unsigned int> _nextId;
   };
@@ -0,0 +1,186 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#include "localserviceproxy_p.hpp"
+
+#include <utility>
+#include <qi/log.hpp>
+#include <qi/type/detail/manageable.hpp>
+
+qiLogCategory("qimessaging.localserviceproxy");
+
+namespace qi {
+
+  LocalServiceProxy::LocalServiceProxy(AnyObject object)
+    : _object(std::move(object))
+    , _type(_object.asGenericObject()->type)
+    , _info(_type->info())
+    , _metaObject(_object.metaObject())
+    , _uid(_object.uid())
+    , _parentTypes(_type->parentTypes())
+  {
+  }
+
+  void LocalServiceProxy::close(const std::string& reason)
+  {
+    AnyObject object;
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      _closed = true;
+      _closeReason = reason;
+      std::swap(object, _object);
+    }
+    qiLogDebug() << "Local service proxy closed: " << reason;
+  }
+
+  AnyObject LocalServiceProxy::object() const
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    return _closed ? AnyObject() : _object;
+  }
+
+  template<typename T>
+  qi::Future<T> LocalServiceProxy::closedError() const
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    return makeFutureError<T>("Local service proxy closed: " + _closeReason);
+  }
+
+  const TypeInfo& LocalServiceProxy::info()
+  {
+    return _info;
+  }
+
+  void* LocalServiceProxy::initializeStorage(void* ptr)
+  {
+    return _type->initializeStorage(ptr);
+  }
+
+  void* LocalServiceProxy::ptrFromStorage(void** storage)
+  {
+    return _type->ptrFromStorage(storage);
+  }
+
+  void* LocalServiceProxy::clone(void* value)
+  {
+    return _type->clone(value);
+  }
+
+  void LocalServiceProxy::destroy(void* value)
+  {
+    _type->destroy(value);
+  }
+
+  bool LocalServiceProxy::less(void* a, void* b)
+  {
+    return _type->less(a, b);
+  }
+
+  const MetaObject& LocalServiceProxy::metaObject(void* /*instance*/)
+  {
+    return _metaObject;
+  }
+
+  ObjectUid LocalServiceProxy::uid(void* /*instance*/) const
+  {
+    return _uid;
+  }
+
+  const std::vector<std::pair<TypeInterface*, std::ptrdiff_t> >& LocalServiceProxy::parentTypes()
+  {
+    return _parentTypes;
+  }
+
+  qi::Future<AnyReference> LocalServiceProxy::metaCall(void* /*instance*/,
+                                                      AnyObject /*context*/,
+                                                      unsigned int method,
+                                                      const GenericFunctionParameters& args,
+                                                      MetaCallType callType,
+                                                      Signature returnSignature)
+  {
+    const auto obj = object();
+    if (!obj)
+      return closedError<AnyReference>();
+    // The caller's call type is kept: forcing a queued call would deadlock a
+    // synchronous call made from the strand of the service itself.
+    const bool isManageableFunction = method >= Manageable::startId && method < Manageable::endId;
+    return obj.metaCall(method, args, isManageableFunction ? MetaCallType_Direct : callType,
+                        returnSignature);
+  }
+
+  void LocalServiceProxy::metaPost(void* /*instance*/,
+                                   AnyObject /*context*/,
+                                   unsigned int event,
+                                   const GenericFunctionParameters& args)
+  {
+    const auto obj = object();
+    if (!obj)
+    {
+      qiLogVerbose() << "metaPost on a closed local service proxy";
+      return;
+    }
+    obj.metaPost(event, args);
+  }
+
+  qi::Future<SignalLink> LocalServiceProxy::connect(void* /*instance*/,
+                                                    AnyObject /*context*/,
+                                                    unsigned int event,
+                                                    const SignalSubscriber& sub)
+  {
+    const auto obj = object();
+    if (!obj)
+      return closedError<SignalLink>();
+    return obj.connect(event, sub).async();
+  }
+
+  qi::Future<void> LocalServiceProxy::disconnect(void* /*instance*/,
+                                                 AnyObject /*context*/,
+                                                 SignalLink linkId)
+  {
+    const auto obj = object();
+    if (!obj)
+      return closedError<void>();
+    return obj.disconnect(linkId).async();
+  }
+
+  qi::Future<AnyValue> LocalServiceProxy::property(void* /*instance*/,
+                                                   AnyObject /*context*/,
+                                                   unsigned int id)
+  {
+    const auto obj = object();
+    if (!obj)
+      return closedError<AnyValue>();
+    return obj.asGenericObject()->property(id).async();
+  }
+
+  qi::Future<void> LocalServiceProxy::setProperty(void* /*instance*/,
+                                                  AnyObject /*context*/,
+                                                  unsigned int id,
+                                                  AnyValue val)
+  {
+    const auto obj = object();
+    if (!obj)
+      return closedError<void>();
+    return obj.asGenericObject()->setProperty(id, val).async();
+  }
+
+  AnyObject makeLocalServiceProxy(AnyObject object)
+  {
+    GenericObject& go = *object.asGenericObject();
+    auto proxy = new LocalServiceProxy(object);
+    // The generic object shares the value of the service object, which must
+    // therefore live as long as it, even once the proxy is closed.
+    return AnyObject(new GenericObject(proxy, go.value, go.uid), [proxy, object](GenericObject* obj) {
+      delete obj;
+      delete proxy;
+    });
+  }
+
+  void closeLocalServiceProxy(const AnyObject& proxy, const std::string& reason)
+  {
+    static_cast<LocalServiceProxy*>(proxy.asGenericObject()->type)->close(reason);
+  }
+
+} // namespace qi
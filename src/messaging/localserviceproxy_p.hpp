@@ -0,0 +1,91 @@
+#pragma once
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#ifndef _SRC_LOCALSERVICEPROXY_P_HPP_
+#define _SRC_LOCALSERVICEPROXY_P_HPP_
+
+#include <string>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+#include <qi/anyobject.hpp>
+#include <qi/type/typeobject.hpp>
+
+namespace qi {
+
+  /// Proxy of a service registered in the same session as the one asking for
+  /// it.
+  ///
+  /// Calls are dispatched directly to the service object, without going
+  /// through serialization and sockets. User methods are called with the call
+  /// type of the caller, special methods are called directly. As for any local
+  /// call, `BoundObject::currentSocket()` is null during such calls.
+  ///
+  /// The proxy is the object type of a generic object sharing the value of
+  /// the service object: it has the same C++ type and value, so that it can
+  /// still be used as an `Object<T>` of the type of the service, and forwards
+  /// the operations to the type of the service. The generic object keeps the
+  /// service object alive, so that its value remains valid.
+  ///
+  /// Once closed, for example because the service was unregistered, all
+  /// operations through the proxy fail.
+  class LocalServiceProxy : public ObjectTypeInterface
+  {
+  public:
+    explicit LocalServiceProxy(AnyObject object);
+
+    void close(const std::string& reason);
+
+    const TypeInfo& info() override;
+    void* initializeStorage(void* ptr = nullptr) override;
+    void* ptrFromStorage(void** storage) override;
+    void* clone(void* value) override;
+    void destroy(void* value) override;
+    bool less(void* a, void* b) override;
+
+    const MetaObject& metaObject(void* instance) override;
+    ObjectUid uid(void* instance) const override;
+    qi::Future<AnyReference> metaCall(void* instance, AnyObject context, unsigned int method,
+                                      const GenericFunctionParameters& args,
+                                      MetaCallType callType = MetaCallType_Auto,
+                                      Signature returnSignature = {}) override;
+    void metaPost(void* instance, AnyObject context, unsigned int event,
+                  const GenericFunctionParameters& args) override;
+    qi::Future<SignalLink> connect(void* instance, AnyObject context, unsigned int event,
+                                   const SignalSubscriber& sub) override;
+    qi::Future<void> disconnect(void* instance, AnyObject context, SignalLink linkId) override;
+    const std::vector<std::pair<TypeInterface*, std::ptrdiff_t> >& parentTypes() override;
+    qi::Future<AnyValue> property(void* instance, AnyObject context, unsigned int id) override;
+    qi::Future<void> setProperty(void* instance, AnyObject context, unsigned int id,
+                                 AnyValue val) override;
+
+  private:
+    /// Returns the service object, or null once closed.
+    AnyObject object() const;
+
+    template<typename T>
+    qi::Future<T> closedError() const;
+
+    mutable boost::mutex _mutex;
+    AnyObject _object;
+    ObjectTypeInterface* const _type;
+    // Copied from the service object, which may not exist anymore once closed.
+    const TypeInfo _info;
+    const MetaObject _metaObject;
+    const ObjectUid _uid;
+    const std::vector<std::pair<TypeInterface*, std::ptrdiff_t> > _parentTypes;
+    bool _closed = false;
+    std::string _closeReason;
+  };
+
+  /// @return a proxy to the given service object, with the same uid and value.
+  AnyObject makeLocalServiceProxy(AnyObject object);
+
+  /// Closes a proxy made by makeLocalServiceProxy.
+  void closeLocalServiceProxy(const AnyObject& proxy, const std::string& reason);
+
+} // namespace qi
+
+#endif // _SRC_LOCALSERVICEPROXY_P_HPP_
@@ -289,6 +289,14 @@ namespace qi
       qiLogError() <<"fromBuffer: unknown type " << signature.toString();
       throw std::runtime_error("Could not construct type for " + signature.toString());
     }
+    return value(type, socket);
+  }
+
+  AnyValue Message::value(qi::TypeInterface* type,
+                          const qi::MessageSocketPtr& socket) const
+  {
+    if (!type)
+      throw std::runtime_error("Could not decode message content in an unknown type");
     qi::BufferReader br(_buffer);
     AnyReference res(type);
     return AnyValue(
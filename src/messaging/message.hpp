@@ -80,6 +80,7 @@ namespace qi {
       BoundObjectFunction_SetProperty       = 6,
       BoundObjectFunction_Properties        = 7,
       BoundObjectFunction_RegisterEventWithSignature = 8,
+      BoundObjectFunction_MetaObjectIfChanged = 9,
     };
 
     enum ServerFunction
@@ -98,6 +99,9 @@ namespace qi {
       ServiceDirectoryAction_ServiceAdded        = 106,
       ServiceDirectoryAction_ServiceRemoved      = 107,
       ServiceDirectoryAction_MachineId           = 108,
+      // 109 is _socketOfService, which is only used locally.
+      ServiceDirectoryAction_ServicesByName      = 110,
+      ServiceDirectoryAction_RegisterServices    = 111,
     };
 
     enum Type
@@ -129,6 +133,11 @@ namespace qi {
      * NOT IMPLEMENTED
      */
     static const unsigned int TypeFlag_ReturnType = 2;
+    /* If flag is set, message payload is a descriptor of the actual payload,
+     * which was placed in a shared memory ring of the sending end.
+     * See sharedmemorypayload_p.hpp.
+     */
+    static const unsigned int TypeFlag_SharedMemoryPayload = 4;
 
     struct Header
     {
@@ -305,6 +314,10 @@ namespace qi {
     ///@return signature, set by setParameters() or setSignature()
     QI_API AnyValue value(const Signature &signature, const qi::MessageSocketPtr &socket) const;
 
+    /// Decodes the content of the message in a value of the given type, which
+    /// must be compatible with the signature of the content.
+    QI_API AnyValue value(TypeInterface* type, const qi::MessageSocketPtr &socket) const;
+
     QI_API void setValue(const AutoAnyReference& value,
                   const Signature& signature,
                   boost::weak_ptr<ObjectHost> context = {},
@@ -3,6 +3,8 @@
 **  See COPYING for the license
 */
 #include "messagedispatcher.hpp"
+#include <algorithm>
+#include <boost/make_shared.hpp>
 #include <ka/errorhandling.hpp>
 
 static const auto logCategory = "qimessaging.messagedispatcher";
@@ -19,50 +21,86 @@ namespace qi
 namespace
 {
 
-  /// std::map || boost::flat_map M
-  template<typename M>
-  boost::optional<typename M::mapped_type> find(const M& map, const typename M::key_type& key)
+  bool allNonBlocking(const MessageDispatcher::MessageHandlerList& handlers)
   {
-    const auto it = map.find(key);
-    if (it == map.end())
-      return {};
-    return it->second;
+    using Slot = MessageDispatcher::MessageHandlerList::value_type;
+    return std::all_of(handlers.begin(), handlers.end(), [](const Slot& slot) {
+      return slot.second.kind == MessageDispatcher::HandlerKind::NonBlocking;
+    });
   }
 
 }
 
 MessageDispatcher::MessageDispatcher(ExecutionContext& execContext)
   : _execContext{ execContext }
+  , _recipients{ boost::make_shared<const RecipientMessageHandlerMap>() }
 {
 }
 
+MessageDispatcher::RecipientPtr MessageDispatcher::findRecipient(const RecipientId& id) const
+{
+  const auto recipients = boost::atomic_load(&_recipients);
+  const auto it = recipients->find(id);
+  if (it == recipients->end())
+    return {};
+  return it->second;
+}
+
 Future<bool> MessageDispatcher::dispatch(Message msg)
 {
+  const RecipientId recipientId{ msg.service(), msg.object() };
+  // A recipient without handlers yet is not dispatched inline: a handler may
+  // be connected before the posted message is dispatched.
+  const auto recipient = findRecipient(recipientId);
+  if (recipient && recipient->dispatchInline)
+  {
+    QI_LOG_DEBUG_MSGDISPATCHER() << "Dispatching inline a message " << msg.address() << " to "
+                                 << recipient->handlers.size() << " handlers.";
+    return Future<bool>{ tryDispatch(recipient->handlers, msg) };
+  }
+
   QI_LOG_DEBUG_MSGDISPATCHER() << "Posting a message " << msg.address() << " for dispatch.";
   // Avoid copying the message in the asynchronous callback by using a shared
   // reference.
-  const auto sharedMsg = std::make_shared<Message>(std::move(msg));
+  const auto sharedMsg = boost::make_shared<Message>(std::move(msg));
   return _execContext.async([=] {
     const auto& msg = *sharedMsg;
-    const auto handlers = find(_state->recipients, RecipientId{ msg.service(), msg.object() })
-                            .value_or(MessageHandlerList{});
+    // Handlers might have been connected or disconnected since the message was
+    // posted: the table is consulted again. This only costs an atomic load and
+    // does not copy the handlers.
+    const auto recipient = findRecipient(recipientId);
+    if (!recipient)
+      return false;
     QI_LOG_DEBUG_MSGDISPATCHER() << "Dispatching a message " << msg.address() << " to "
-                                 << handlers.size() << " handlers.";
-    return tryDispatch(handlers, msg);
+                                 << recipient->handlers.size() << " handlers.";
+    return tryDispatch(recipient->handlers, msg);
   });
 }
 
 SignalLink MessageDispatcher::messagePendingConnect(unsigned int serviceId,
                                                     unsigned int objectId,
-                                                    MessageHandler fun) noexcept
+                                                    MessageHandler fun,
+                                                    HandlerKind kind) noexcept
 {
+  const RecipientId recipientId{ serviceId, objectId };
   auto state = _state.synchronize();
-  auto& handlers = state->recipients[RecipientId{ serviceId, objectId }];
   const auto newSignalLinkId = state->nextSignalLink++;
   QI_LOG_DEBUG_MSGDISPATCHER() << "Connecting a handler (linkId=" << newSignalLinkId
                                << ") for message dispatch for service=" << serviceId
                                << ", object=" << objectId;
-  handlers.emplace(newSignalLinkId, std::move(fun));
+
+  // The table is only modified while `_state` is held, it can therefore be
+  // loaded without synchronization.
+  auto recipients = boost::make_shared<RecipientMessageHandlerMap>(*_recipients);
+  auto recipient = boost::make_shared<Recipient>();
+  const auto it = recipients->find(recipientId);
+  if (it != recipients->end())
+    recipient->handlers = it->second->handlers;
+  recipient->handlers.emplace(newSignalLinkId, Handler{ std::move(fun), kind });
+  recipient->dispatchInline = allNonBlocking(recipient->handlers);
+  (*recipients)[recipientId] = std::move(recipient);
+
+  boost::atomic_store(&_recipients, RecipientTable{ std::move(recipients) });
   return newSignalLinkId;
 }
 
@@ -75,19 +113,32 @@ bool MessageDispatcher::messagePendingDisconnect(unsigned int serviceId,
   if (!isValidSignalLink(linkId))
     return true;
 
+  const RecipientId recipientId{ serviceId, objectId };
   auto state = _state.synchronize();
-  const auto it = state->recipients.find(RecipientId{ serviceId, objectId });
-  if (it == state->recipients.end())
+  const auto it = _recipients->find(recipientId);
+  if (it == _recipients->end() || it->second->handlers.count(linkId) == 0)
     return false;
 
   QI_LOG_DEBUG_MSGDISPATCHER()
     << "Disconnecting a handler (linkId=" << linkId
     << ") for message dispatch for service=" << serviceId << ", object=" << objectId;
-  auto& handlers = it->second;
-  const auto disconnectedCount = handlers.erase(linkId);
+  auto recipients = boost::make_shared<RecipientMessageHandlerMap>(*_recipients);
+  auto handlers = it->second->handlers;
+  handlers.erase(linkId);
   if (handlers.empty())
-    state->recipients.erase(it);
-  return disconnectedCount == 1;
+  {
+    recipients->erase(recipientId);
+  }
+  else
+  {
+    auto recipient = boost::make_shared<Recipient>();
+    recipient->dispatchInline = allNonBlocking(handlers);
+    recipient->handlers = std::move(handlers);
+    (*recipients)[recipientId] = std::move(recipient);
+  }
+
+  boost::atomic_store(&_recipients, RecipientTable{ std::move(recipients) });
+  return true;
 }
 
 bool MessageDispatcher::tryDispatch(const MessageHandlerList& handlers, const Message& msg)
@@ -100,7 +151,7 @@ bool MessageDispatcher::tryDispatch(const MessageHandlerList& handlers, const Me
 
   using Slot = MessageHandlerList::value_type;
   return std::any_of(handlers.begin(), handlers.end(), [&](const Slot& slot) {
-    const auto& handler = slot.second;
+    const auto& handler = slot.second.function;
     return isMessageHandled(ka::invoke_catch(onHandlerError, handler, msg));
   });
 }
@@ -9,6 +9,7 @@
 
 #include <qi/anyobject.hpp>
 
+#include <boost/shared_ptr.hpp>
 #include <boost/thread/synchronized_value.hpp>
 #include <boost/container/flat_map.hpp>
 
@@ -33,13 +34,25 @@ namespace qi {
   public:
     using MessageHandler = std::function<DispatchStatus (const Message&)>;
 
+    /// Tells how a handler may be called.
+    enum class HandlerKind
+    {
+      /// The handler is called from a task posted to the execution context.
+      MayBlock,
+      /// The handler never blocks: if all the handlers of a recipient are
+      /// non-blocking, they are called directly by `dispatch`, in the context
+      /// that received the message.
+      NonBlocking,
+    };
+
     MessageDispatcher(ExecutionContext& execContext);
 
     Future<bool> dispatch(Message msg);
 
     qi::SignalLink messagePendingConnect(unsigned int serviceId,
                                          unsigned int objectId,
-                                         MessageHandler fun) noexcept;
+                                         MessageHandler fun,
+                                         HandlerKind kind = HandlerKind::MayBlock) noexcept;
 
     /// @invariant
     ///   `d.messagePendingDisconnect(sid, oid, d.messagePendingConnect(sid, oid, _)) == true`
@@ -57,19 +70,38 @@ namespace qi {
 
     ExecutionContext& _execContext;
 
-    using MessageHandlerList = boost::container::flat_map<SignalLink, MessageHandler>;
-    using RecipientMessageHandlerMap = boost::container::flat_map<RecipientId, MessageHandlerList>;
+    struct Handler
+    {
+      MessageHandler function;
+      HandlerKind kind;
+    };
+    using MessageHandlerList = boost::container::flat_map<SignalLink, Handler>;
 
-    // Mutable state of the object.
+    /// The handlers of a recipient. Never modified once published.
+    struct Recipient
+    {
+      MessageHandlerList handlers;
+      bool dispatchInline;
+    };
+    using RecipientPtr = boost::shared_ptr<const Recipient>;
+    using RecipientMessageHandlerMap = boost::container::flat_map<RecipientId, RecipientPtr>;
+    using RecipientTable = boost::shared_ptr<const RecipientMessageHandlerMap>;
+
+    // Mutable state of the object, only used to update the table.
     struct State
     {
-      RecipientMessageHandlerMap recipients;
       SignalLink nextSignalLink = 0;
     };
     using SyncState =  boost::synchronized_value<State>;
     SyncState _state;
 
+    // Read-copy-update table of the recipients: dispatching a message only
+    // loads it, connecting or disconnecting a handler replaces it, while
+    // holding `_state`.
+    RecipientTable _recipients;
+
   private:
+    RecipientPtr findRecipient(const RecipientId& id) const;
     static bool tryDispatch(const MessageHandlerList& handlers, const Message& msg);
   };
 }
@@ -2,6 +2,7 @@
 #include <src/messaging/sock/option.hpp>
 #include "messagesocket.hpp"
 #include "tcpmessagesocket.hpp"
+#include "sock/networkasiolocal.hpp"
 
 // Disable "'this': used in base member initializer list"
 #include <ka/macro.hpp>
@@ -25,6 +26,11 @@ namespace qi
 
   MessageSocketPtr makeMessageSocket(const std::string &protocol, qi::EventLoop *eventLoop)
   {
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    if (protocol == sock::localScheme())
+      return boost::make_shared<TcpMessageSocket<sock::NetworkAsioLocal>>(
+        *asIoServicePtr(eventLoop), sock::SslEnabled{false});
+#endif
     return makeTcpMessageSocket(protocol, eventLoop);
   }
 
@@ -32,12 +38,14 @@ namespace qi
 
   MessageDispatchConnection::MessageDispatchConnection(MessageSocketPtr socket,
                                                        MessageDispatcher::RecipientId recipientId,
-                                                       MessageDispatcher::MessageHandler handler)
+                                                       MessageDispatcher::MessageHandler handler,
+                                                       MessageDispatcher::HandlerKind kind)
     : _socket(socket)
     , _recipientId(recipientId)
     , _messageDispatcherLink(
         socket ?
-          socket->messagePendingConnect(_recipientId.serviceId, _recipientId.objectId, handler) :
+          socket->messagePendingConnect(_recipientId.serviceId, _recipientId.objectId,
+                                        std::move(handler), kind) :
           throw std::invalid_argument(
             "Cannot connect handler to socket message dispatch: the socket pointer is null."))
   {
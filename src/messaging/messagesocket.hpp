@@ -88,9 +88,11 @@ namespace qi
 
     qi::SignalLink messagePendingConnect(unsigned int serviceId,
                                          unsigned int objectId,
-                                         MessageDispatcher::MessageHandler fun) noexcept
+                                         MessageDispatcher::MessageHandler fun,
+                                         MessageDispatcher::HandlerKind kind =
+                                           MessageDispatcher::HandlerKind::MayBlock) noexcept
     {
-      return _dispatcher.messagePendingConnect(serviceId, objectId, std::move(fun));
+      return _dispatcher.messagePendingConnect(serviceId, objectId, std::move(fun), kind);
     }
 
     void messagePendingDisconnect(unsigned int serviceId,
@@ -138,7 +140,9 @@ namespace qi
     /// @throws A `std::invalid_argument` exception if the socket pointer is null.
     MessageDispatchConnection(MessageSocketPtr socket,
                               MessageDispatcher::RecipientId recipientId,
-                              MessageDispatcher::MessageHandler handler);
+                              MessageDispatcher::MessageHandler handler,
+                              MessageDispatcher::HandlerKind kind =
+                                MessageDispatcher::HandlerKind::MayBlock);
     ~MessageDispatchConnection();
 
     MessageSocketPtr socket() const noexcept { return _socket.lock(); }
@@ -0,0 +1,89 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#include "metaobjectcache_p.hpp"
+
+#include <iterator>
+#include <qi/assert.hpp>
+#include <qi/getenv.hpp>
+#include <qi/log.hpp>
+#include <src/type/metaobject_p.hpp>
+
+qiLogCategory("qimessaging.metaobjectcache");
+
+namespace qi {
+
+  MetaObjectCache& MetaObjectCache::instance()
+  {
+    static MetaObjectCache cache(
+        os::getEnvDefault<std::size_t>("QI_METAOBJECT_CACHE_SIZE", 1024));
+    return cache;
+  }
+
+  MetaObjectCache::MetaObjectCache(std::size_t maxSize)
+    : _maxSize(maxSize)
+  {
+  }
+
+  void MetaObjectCache::insert(const ObjectUid& uid, const MetaObject& metaObject)
+  {
+    if (_maxSize == 0u)
+      return;
+
+    const auto digest = contentDigest(metaObject);
+    boost::mutex::scoped_lock lock(_mutex);
+    // Refer to the new metaobject first, so that it is not evicted below.
+    auto metaObjectIt = _metaObjects.find(digest);
+    if (metaObjectIt == _metaObjects.end())
+    {
+      qiLogDebug() << "Caching a new metaobject (" << _metaObjects.size() + 1 << " cached)";
+      metaObjectIt = _metaObjects.emplace(digest, CachedMetaObject{metaObject, 0u}).first;
+    }
+    ++metaObjectIt->second.objectCount;
+
+    const auto objectIt = _objects.find(uid);
+    if (objectIt != _objects.end())
+      forget(objectIt);
+    while (_objects.size() >= _maxSize)
+      forget(_objects.find(_insertionOrder.front()));
+
+    _insertionOrder.push_back(uid);
+    _objects.emplace(uid, RememberedObject{digest, std::prev(_insertionOrder.end())});
+  }
+
+  void MetaObjectCache::forget(RememberedObjects::iterator object)
+  {
+    const auto metaObjectIt = _metaObjects.find(object->second.digest);
+    QI_ASSERT(metaObjectIt != _metaObjects.end());
+    if (--metaObjectIt->second.objectCount == 0u)
+      _metaObjects.erase(metaObjectIt);
+    _insertionOrder.erase(object->second.insertion);
+    _objects.erase(object);
+  }
+
+  boost::optional<MetaObject> MetaObjectCache::find(const ObjectUid& uid) const
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    const auto objectIt = _objects.find(uid);
+    if (objectIt == _objects.end())
+      return {};
+    const auto it = _metaObjects.find(objectIt->second.digest);
+    if (it == _metaObjects.end())
+      return {};
+    return it->second.metaObject;
+  }
+
+  std::size_t MetaObjectCache::size() const
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    return _metaObjects.size();
+  }
+
+  ka::sha1_digest_t contentDigest(const MetaObject& metaObject)
+  {
+    return metaObject._p->contentSHA1();
+  }
+
+} // namespace qi
@@ -0,0 +1,82 @@
+#pragma once
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#ifndef _SRC_METAOBJECTCACHE_P_HPP_
+#define _SRC_METAOBJECTCACHE_P_HPP_
+
+#include <list>
+#include <map>
+#include <boost/optional.hpp>
+#include <boost/thread/mutex.hpp>
+#include <ka/sha1.hpp>
+#include <qi/objectuid.hpp>
+#include <qi/type/metaobject.hpp>
+
+namespace qi {
+
+  /// Process-wide cache of the metaobjects received from remote ends.
+  ///
+  /// Metaobjects are indexed by the digest of their content, so that the
+  /// metaobject of many objects of the same type is stored once, whatever the
+  /// connection it was received from. The cache remembers the metaobject
+  /// last received for each object uid: when fetching the metaobject of that
+  /// object again, for example from another session or after a reconnection,
+  /// the client sends its digest and the remote end only replies with the
+  /// metaobject if it changed (see `BoundObject::metaObjectIfChanged`).
+  ///
+  /// The number of objects remembered is bounded by QI_METAOBJECT_CACHE_SIZE
+  /// (1024 by default), the ones inserted least recently are forgotten first.
+  /// A metaobject is kept as long as a remembered object refers to it.
+  class MetaObjectCache
+  {
+  public:
+    static MetaObjectCache& instance();
+
+    explicit MetaObjectCache(std::size_t maxSize);
+
+    /// Remembers the metaobject as the one of the object of the given uid.
+    void insert(const ObjectUid& uid, const MetaObject& metaObject);
+
+    /// @return the metaobject last received for the object of the given uid,
+    /// if it is still cached.
+    boost::optional<MetaObject> find(const ObjectUid& uid) const;
+
+    /// @return the number of metaobjects cached.
+    std::size_t size() const;
+
+  private:
+    struct CachedMetaObject
+    {
+      MetaObject metaObject;
+      // Number of remembered objects referring to this metaobject.
+      std::size_t objectCount;
+    };
+
+    struct RememberedObject
+    {
+      ka::sha1_digest_t digest;
+      std::list<ObjectUid>::iterator insertion;
+    };
+
+    using RememberedObjects = std::map<ObjectUid, RememberedObject>;
+
+    /// Forgets the object, and its metaobject if no other object refers to it.
+    void forget(RememberedObjects::iterator object);
+
+    mutable boost::mutex _mutex;
+    const std::size_t _maxSize;
+    std::map<ka::sha1_digest_t, CachedMetaObject> _metaObjects;
+    // Uids of the remembered objects, from the least recently inserted.
+    std::list<ObjectUid> _insertionOrder;
+    RememberedObjects _objects;
+  };
+
+  /// @return the digest of the whole content of the metaobject.
+  ka::sha1_digest_t contentDigest(const MetaObject& metaObject);
+
+} // namespace qi
+
+#endif // _SRC_METAOBJECTCACHE_P_HPP_
@@ -11,6 +11,8 @@ KA_WARNING_DISABLE(4355, )
 #include "remoteobject_p.hpp"
 #include "message.hpp"
 #include "messagesocket.hpp"
+#include "metaobjectcache_p.hpp"
+#include "streamcontext.hpp"
 #include <src/type/signal_p.hpp>
 #include <qi/log.hpp>
 #include <boost/thread/mutex.hpp>
@@ -32,11 +34,13 @@ namespace qi {
     mob.addMethod("v", "unregisterEvent", "(IIL)", qi::Message::BoundObjectFunction_UnregisterEvent);
     mob.addMethod(typeOf<MetaObject>()->signature(), "metaObject", "(I)", qi::Message::BoundObjectFunction_MetaObject);
     mob.addMethod("L", "registerEventWithSignature", "(IILs)", qi::Message::BoundObjectFunction_RegisterEventWithSignature);
+    mob.addMethod(typeOf<MetaObject>()->signature(), "metaObjectIfChanged", "(I[C])", qi::Message::BoundObjectFunction_MetaObjectIfChanged);
     const auto mo = mob.metaObject();
     QI_ASSERT(mo.methodId("registerEvent::(IIL)") == qi::Message::BoundObjectFunction_RegisterEvent);
     QI_ASSERT(mo.methodId("unregisterEvent::(IIL)") == qi::Message::BoundObjectFunction_UnregisterEvent);
     QI_ASSERT(mo.methodId("metaObject::(I)") == qi::Message::BoundObjectFunction_MetaObject);
     QI_ASSERT(mo.methodId("registerEventWithSignature::(IILs)") == qi::Message::BoundObjectFunction_RegisterEventWithSignature);
+    QI_ASSERT(mo.methodId("metaObjectIfChanged::(I[C])") == qi::Message::BoundObjectFunction_MetaObjectIfChanged);
     return mo;
   }
 
@@ -125,8 +129,36 @@ namespace qi {
   qi::Future<void> RemoteObject::fetchMetaObject() {
     qiLogVerbose() << "Requesting metaobject";
     qi::Promise<void> prom(qi::FutureCallbackType_Sync);
-    qi::Future<qi::MetaObject> fut =
-      _self.async<qi::MetaObject>("metaObject", 0U);
+    qi::Future<qi::MetaObject> fut;
+    const MessageSocketPtr sock = *_socket;
+    if (sock && sock->sharedCapability<bool>(capabilityname::metaObjectDigest, false))
+    {
+      // Send the digest of the metaobject we already know for this object, if
+      // any: the remote end replies with an empty metaobject if it did not
+      // change.
+      const auto uid = _self.uid();
+      const auto known = MetaObjectCache::instance().find(uid);
+      std::vector<unsigned char> knownDigest;
+      if (known)
+      {
+        const auto digest = contentDigest(*known);
+        knownDigest.assign(digest.begin(), digest.end());
+      }
+      fut = _self.async<qi::MetaObject>("metaObjectIfChanged", 0U, knownDigest)
+        .andThen(FutureCallbackType_Sync, [=](const qi::MetaObject& mo) {
+          if (known && mo.methodMap().empty())
+          {
+            qiLogVerbose() << "Metaobject unchanged, using the cached one";
+            return *known;
+          }
+          MetaObjectCache::instance().insert(uid, mo);
+          return mo;
+        });
+    }
+    else
+    {
+      fut = _self.async<qi::MetaObject>("metaObject", 0U);
+    }
     fut.connect(trackWithFallback(&throwRemoteObjectDestroyedException,
                                   boost::bind<void>(&RemoteObject::onMetaObject, this, _1, prom),
                                   weak_from_this()));
@@ -10,6 +10,7 @@ KA_WARNING_DISABLE(4355, )
 
 #include <vector>
 #include <map>
+#include <set>
 
 #include <boost/make_shared.hpp>
 
@@ -69,6 +70,10 @@ namespace qi
       QI_ASSERT(id == qi::Message::ServiceDirectoryAction_MachineId);
       ob->advertiseMethod("_socketOfService", &ServiceDirectory::_socketOfService);
       // used locally only, we do not export its id
+      id = ob->advertiseMethod("servicesByName", &ServiceDirectory::servicesByName);
+      QI_ASSERT(id == qi::Message::ServiceDirectoryAction_ServicesByName);
+      id = ob->advertiseMethod("registerServices", &ServiceDirectory::registerServices);
+      QI_ASSERT(id == qi::Message::ServiceDirectoryAction_RegisterServices);
       // Silence compile warning unused id
       (void)id;
     }
@@ -258,6 +263,29 @@ namespace qi
     return finalize(servicesIt->second, relativeEndpointsUri);
   }
 
+  std::vector<ServiceInfo> ServiceDirectory::servicesByName(const std::vector<std::string>& names)
+  {
+    const auto optFeature = relativeEndpointsUriEnabled();
+    RelativeEndpointsUriEnabled feature = RelativeEndpointsUriEnabled::No; // Disabled by default.
+    if (!optFeature.empty())
+      feature = *optFeature;
+
+    boost::recursive_mutex::scoped_lock lock(mutex);
+    std::vector<ServiceInfo> result;
+    result.reserve(names.size());
+    for (const auto& name : names)
+    {
+      const auto indexIt = nameToIdx.find(name);
+      if (indexIt == nameToIdx.end())
+        continue;
+      const auto servicesIt = connectedServices.find(indexIt->second);
+      if (servicesIt == connectedServices.end())
+        continue;
+      result.push_back(finalize(servicesIt->second, feature));
+    }
+    return result;
+  }
+
   unsigned int ServiceDirectory::registerService(const ServiceInfo &svcinfo)
   {
     boost::shared_ptr<BoundObject> bo = serviceBoundObject.lock();
@@ -307,6 +335,29 @@ namespace qi
     return idx;
   }
 
+  std::vector<unsigned int> ServiceDirectory::registerServices(const std::vector<ServiceInfo>& svcinfos)
+  {
+    boost::recursive_mutex::scoped_lock lock(mutex);
+    std::set<std::string> names;
+    for (const auto& svcinfo : svcinfos)
+    {
+      if (nameToIdx.find(svcinfo.name()) != nameToIdx.end() || !names.insert(svcinfo.name()).second)
+      {
+        std::stringstream ss;
+        ss << "Service \"" << svcinfo.name() << "\" is already registered. "
+           << "Rejecting conflicting registration attempt of " << svcinfos.size() << " services.";
+        qiLogWarning() << ss.str();
+        throw std::runtime_error(ss.str());
+      }
+    }
+
+    std::vector<unsigned int> result;
+    result.reserve(svcinfos.size());
+    for (const auto& svcinfo : svcinfos)
+      result.push_back(registerService(svcinfo));
+    return result;
+  }
+
   void ServiceDirectory::unregisterService(const unsigned int &idx)
   {
     boost::recursive_mutex::scoped_lock lock(mutex);
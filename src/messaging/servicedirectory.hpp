@@ -29,7 +29,13 @@ namespace qi
     ServiceInfo              service(const std::string &name);
     ServiceInfo              service(const std::string &name,
                                      RelativeEndpointsUriEnabled relativeEndpointsUri);
+    /// Information about the connected services of the given names, in the
+    /// same order. Unknown services are skipped.
+    std::vector<ServiceInfo> servicesByName(const std::vector<std::string> &names);
     unsigned int             registerService(const ServiceInfo &svcinfo);
+    /// Registers all the services or, if one of the names is already taken,
+    /// none of them.
+    std::vector<unsigned int> registerServices(const std::vector<ServiceInfo> &svcinfos);
     void                     unregisterService(const unsigned int &idx);
     void                     serviceReady(const unsigned int &idx);
     void                     updateServiceInfo(const ServiceInfo &svcinfo);
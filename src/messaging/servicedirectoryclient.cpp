@@ -3,6 +3,7 @@
 **  See COPYING for the license
 */
 #include "servicedirectoryclient.hpp"
+#include <algorithm>
 #include <qi/type/objecttypebuilder.hpp>
 #include "servicedirectory_p.hpp"
 #include "messagesocket.hpp"
@@ -460,13 +461,84 @@ namespace qi {
   }
 
   qi::Future<ServiceInfo>              ServiceDirectoryClient::service(const std::string &name) {
-    return _object.async< ServiceInfo >("service", name);
+    if (!supportsBatchedLookup())
+      return _object.async< ServiceInfo >("service", name);
+
+    Promise<ServiceInfo> promise;
+    bool mustSend = false;
+    {
+      boost::mutex::scoped_lock lock(_lookupMutex);
+      _pendingLookups.emplace_back(name, promise);
+      mustSend = !ka::exchange(_lookupInFlight, true);
+    }
+    if (mustSend)
+      sendLookupBatch();
+    return promise.future();
+  }
+
+  qi::Future< std::vector<ServiceInfo> > ServiceDirectoryClient::servicesByName(const std::vector<std::string> &names) {
+    return _object.async< std::vector<ServiceInfo> >("servicesByName", names);
+  }
+
+  bool ServiceDirectoryClient::supportsBatchedLookup()
+  {
+    if (isLocal())
+      return false;
+    return _object.metaObject().methodId("servicesByName::([s])") >= 0;
+  }
+
+  void ServiceDirectoryClient::sendLookupBatch()
+  {
+    PendingLookups batch;
+    {
+      boost::mutex::scoped_lock lock(_lookupMutex);
+      std::swap(batch, _pendingLookups);
+      if (batch.empty())
+      {
+        _lookupInFlight = false;
+        return;
+      }
+    }
+
+    std::vector<std::string> names;
+    names.reserve(batch.size());
+    for (const auto& lookup : batch)
+    {
+      if (std::find(names.begin(), names.end(), lookup.first) == names.end())
+        names.push_back(lookup.first);
+    }
+    qiLogDebug() << "Looking up " << names.size() << " services in one call";
+
+    servicesByName(names).then(track([=](Future<std::vector<ServiceInfo>> fut) mutable {
+      for (auto& lookup : batch)
+      {
+        if (fut.hasError())
+        {
+          lookup.second.setError(fut.error());
+          continue;
+        }
+        const auto& infos = fut.value();
+        const auto it = std::find_if(infos.begin(), infos.end(), [&](const ServiceInfo& info) {
+          return info.name() == lookup.first;
+        });
+        if (it == infos.end())
+          lookup.second.setError("Cannot find service '" + lookup.first + "' in index");
+        else
+          lookup.second.setValue(*it);
+      }
+      // Lookups issued meanwhile are sent together.
+      sendLookupBatch();
+    }, this));
   }
 
   qi::Future<unsigned int>             ServiceDirectoryClient::registerService(const ServiceInfo &svcinfo) {
     return _object.async< unsigned int >("registerService", svcinfo);
   }
 
+  qi::Future< std::vector<unsigned int> > ServiceDirectoryClient::registerServices(const std::vector<ServiceInfo> &svcinfos) {
+    return _object.async< std::vector<unsigned int> >("registerServices", svcinfos);
+  }
+
   qi::Future<void>                     ServiceDirectoryClient::unregisterService(const unsigned int &idx) {
     return _object.async<void>("unregisterService", idx);
   }
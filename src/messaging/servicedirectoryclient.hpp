@@ -39,8 +39,13 @@ namespace qi {
   public:
     //Bound Interface
     qi::Future< std::vector<ServiceInfo> > services();
+    /// Lookups issued while another one is in flight are sent together in a
+    /// single `servicesByName` call when it returns, if the service directory
+    /// supports it.
     qi::Future< ServiceInfo >              service(const std::string &name);
+    qi::Future< std::vector<ServiceInfo> > servicesByName(const std::vector<std::string> &names);
     qi::Future< unsigned int >             registerService(const ServiceInfo &svcinfo);
+    qi::Future< std::vector<unsigned int> > registerServices(const std::vector<ServiceInfo> &svcinfos);
     qi::Future< void >                     unregisterService(const unsigned int &idx);
     qi::Future< void >                     serviceReady(const unsigned int &idx);
     qi::Future< void >                     updateServiceInfo(const ServiceInfo &svcinfo);
@@ -88,6 +93,12 @@ namespace qi {
 
     Future<void> closeImpl(const std::string& reason, bool sendSignalDisconnected);
 
+    // True if the service directory has the `servicesByName` method.
+    bool supportsBatchedLookup();
+    // Sends the lookups queued so far in one call, or marks that no lookup is
+    // in flight anymore if there is none.
+    void sendLookupBatch();
+
   private:
     struct StateData
     {
@@ -110,6 +121,11 @@ namespace qi {
     ClientAuthenticatorFactoryPtr _authFactory;
     bool _enforceAuth;
     mutable boost::mutex _mutex;
+
+    using PendingLookups = std::vector<std::pair<std::string, Promise<ServiceInfo>>>;
+    PendingLookups _pendingLookups; // protected by _lookupMutex
+    bool _lookupInFlight = false; // protected by _lookupMutex
+    boost::mutex _lookupMutex;
   };
 }
 
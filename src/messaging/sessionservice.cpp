@@ -13,6 +13,7 @@ KA_WARNING_DISABLE(4355, )
 #include "servicedirectoryclient.hpp"
 #include "objectregistrar.hpp"
 #include "remoteobject_p.hpp"
+#include "localserviceproxy_p.hpp"
 
 qiLogCategory("qimessaging.sessionservice");
 
@@ -48,6 +49,12 @@ namespace qi {
         static_cast<RemoteObject*>(it->second.asGenericObject()->value)->close("Service removed");
         _remoteObjects.erase(it);
       }
+      it = _localObjects.find(service);
+      if (it != _localObjects.end()) {
+        qiLogVerbose() << "Session: Removing cached local service proxy " << service;
+        closeLocalServiceProxy(it->second, "Service removed");
+        _localObjects.erase(it);
+      }
     }
   }
 
@@ -66,10 +73,30 @@ namespace qi {
     // again. We must not allow remoteobjects to be cleaned twice.
     RemoteObjectMap objects;
     std::swap(objects, _remoteObjects);
+    RemoteObjectMap localObjects;
+    std::swap(localObjects, _localObjects);
 
     for (RemoteObjectMap::iterator it = objects.begin();
         it != objects.end(); ++it)
       static_cast<RemoteObject*>(it->second.asGenericObject()->value)->close("Session closed");
+    for (const auto& localObject : localObjects)
+      closeLocalServiceProxy(localObject.second, "Session closed");
+  }
+
+  qi::AnyObject Session_Service::localServiceProxy(const std::string& service,
+                                                   const qi::AnyObject& object)
+  {
+    boost::recursive_mutex::scoped_lock sl(_remoteObjectsMutex);
+    auto it = _localObjects.find(service);
+    // The service may have been registered again with another object.
+    if (it != _localObjects.end() && it->second.uid() == object.uid())
+      return it->second;
+    if (it != _localObjects.end())
+      closeLocalServiceProxy(it->second, "Service replaced");
+    qiLogVerbose() << "Session: Creating a local service proxy for " << service;
+    auto proxy = makeLocalServiceProxy(object);
+    _localObjects[service] = proxy;
+    return proxy;
   }
 
   ServiceRequest* Session_Service::serviceRequest(long requestId)
@@ -423,11 +450,11 @@ namespace qi {
                                                      const std::string &protocol)
   {
     if (protocol == "" || protocol == "local") {
-      //qiLogError() << "service is not implemented for local service, it always return a remote service";
-      //look for local object registered in the server
+      //look for local object registered in the server, and short-circuit
+      //the serialization and the sockets with a direct-dispatch proxy
       qi::AnyObject go = _server->registeredServiceObject(service);
       if (go)
-        return qi::Future<qi::AnyObject>(go);
+        return qi::Future<qi::AnyObject>(localServiceProxy(service, go));
       if (protocol == "local") {
         qi::Promise<qi::AnyObject> prom;
         prom.setError(std::string("No local object found for ") + service);
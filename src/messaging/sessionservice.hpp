@@ -68,6 +68,8 @@ namespace qi {
     //ServiceDirectoryClient
     void onAuthentication(const MessageSocket::SocketEventData& data, long requestId, MessageSocketPtr socket, ClientAuthenticatorPtr auth, SignalSubscriberPtr old);
 
+    qi::AnyObject localServiceProxy(const std::string& service, const qi::AnyObject& object);
+
     ServiceRequest *serviceRequest(long requestId);
     void            removeRequest(long requestId);
 
@@ -79,6 +81,8 @@ namespace qi {
     //maintain a cache of remote object
     using RemoteObjectMap = std::map<std::string, AnyObject>;
     RemoteObjectMap                 _remoteObjects;
+    // proxies of the services registered in this session (see LocalServiceProxy)
+    RemoteObjectMap                 _localObjects;
     boost::recursive_mutex          _remoteObjectsMutex;
 
   private:
@@ -0,0 +1,397 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#include "sharedmemorypayload_p.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <new>
+#include <set>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/predef.h>
+#include <boost/thread/synchronized_value.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include <qi/getenv.hpp>
+#include <qi/log.hpp>
+#include <qi/macro.hpp>
+#include <qi/os.hpp>
+
+#if !BOOST_OS_WINDOWS
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+qiLogCategory("qimessaging.sharedmemorypayload");
+
+namespace bip = boost::interprocess;
+
+namespace qi
+{
+  namespace
+  {
+    /// Header of a ring, followed by its data. It is aligned on a cache line
+    /// so that the data does not share one with the read position.
+    struct RingHeader
+    {
+      std::uint64_t capacity;
+      std::atomic<std::uint64_t> readPosition;
+    };
+    const std::size_t ringHeaderSize = 64;
+    static_assert(sizeof(RingHeader) <= ringHeaderSize, "RingHeader does not fit in its space.");
+
+    /// Descriptor: position (64 bits), size (32 bits), then ring name.
+    const std::size_t descriptorFixedSize = sizeof(std::uint64_t) + sizeof(std::uint32_t);
+
+    std::size_t payloadThreshold()
+    {
+      static const auto threshold =
+          os::getEnvDefault<std::size_t>("QI_SHM_PAYLOAD_THRESHOLD", 256 * 1024);
+      return threshold;
+    }
+
+    std::uint64_t ringCapacity()
+    {
+      static const auto capacity =
+          os::getEnvDefault<std::uint64_t>("QI_SHM_RING_SIZE", 64 * 1024 * 1024);
+      return capacity;
+    }
+
+    /// Both ends must advertise the capability with the machine id of this end.
+    bool sharesMemoryWith(const StreamContext& context)
+    {
+      try
+      {
+        const auto local = context.localCapability(capabilityname::sharedMemoryPayload);
+        const auto remote = context.remoteCapability(capabilityname::sharedMemoryPayload);
+        if (!local || !remote)
+          return false;
+        const auto localId = local->to<std::string>();
+        return localId == os::getMachineId() && remote->to<std::string>() == localId;
+      }
+      catch (const std::exception& e)
+      {
+        qiLogDebug() << "Invalid shared memory capability: " << e.what();
+        return false;
+      }
+    }
+
+    const std::string ringNamePrefix = "qi-";
+
+    std::string processRingNamePrefix()
+    {
+      return ringNamePrefix + boost::uuids::to_string(os::getProcessUuid()) + "-";
+    }
+
+    /// Whether the name has the format of the rings created by
+    /// `SharedMemoryRingWriter`: "qi-<process uuid>-<number>".
+    bool isRingName(const std::string& name)
+    {
+      static const std::size_t uuidSize = 36u;
+      static const std::size_t maxNumberSize = 10u;
+      const auto numberBegin = ringNamePrefix.size() + uuidSize + 1u;
+      if (name.size() <= numberBegin || name.size() > numberBegin + maxNumberSize
+          || name.compare(0, ringNamePrefix.size(), ringNamePrefix) != 0
+          || name[numberBegin - 1u] != '-')
+        return false;
+      const auto uuid = name.substr(ringNamePrefix.size(), uuidSize);
+      const auto isUuidChar = [](char c) { return std::isxdigit(static_cast<unsigned char>(c)) || c == '-'; };
+      const auto isDigit = [](char c) { return std::isdigit(static_cast<unsigned char>(c)) != 0; };
+      return std::all_of(uuid.begin(), uuid.end(), isUuidChar)
+          && std::all_of(name.begin() + numberBegin, name.end(), isDigit);
+    }
+
+    /// Names of the rings mapped by the readers of this process. A ring is
+    /// only meant to be read by the end its writer advertised it to: a remote
+    /// end that names a ring already mapped here must not get it mapped twice.
+    boost::synchronized_value<std::set<std::string>>& mappedRingNames()
+    {
+      static boost::synchronized_value<std::set<std::string>> names;
+      return names;
+    }
+
+    /// Whether the shared memory object belongs to the user of this process,
+    /// and only to it, as the rings created by `SharedMemoryRingWriter` do.
+    bool isPrivateToUser(const bip::shared_memory_object& shm)
+    {
+#if BOOST_OS_WINDOWS
+      QI_IGNORE_UNUSED(shm);
+      return true;
+#else
+      struct stat status;
+      if (::fstat(shm.get_mapping_handle().handle, &status) != 0)
+        return false;
+      return status.st_uid == ::geteuid() && (status.st_mode & (S_IRWXG | S_IRWXO)) == 0;
+#endif
+    }
+
+    /// Capability message sent to the remote end to publish a single capability.
+    Message capabilityMessage(const std::string& name, const std::string& value)
+    {
+      CapabilityMap capabilities;
+      capabilities[name] = AnyValue::from(value);
+      Message msg;
+      msg.setType(Message::Type_Capability);
+      msg.setService(Message::Service_Server);
+      msg.setValue(capabilities, typeOf<CapabilityMap>()->signature());
+      return msg;
+    }
+
+    /// Copies the buffer as it is laid out on the wire: each sub-buffer
+    /// follows its size in the main buffer (see `sock::appendBuffers`).
+    void flatten(const Buffer& buffer, unsigned char* dest)
+    {
+      const auto data = static_cast<const unsigned char*>(buffer.data());
+      std::size_t begin = 0;
+      for (const auto& sub : buffer.subBuffers())
+      {
+        const auto end = sub.first + sizeof(Buffer::size_type);
+        std::memcpy(dest, data + begin, end - begin);
+        dest += end - begin;
+        begin = end;
+        std::memcpy(dest, sub.second.data(), sub.second.size());
+        dest += sub.second.size();
+      }
+      std::memcpy(dest, data + begin, buffer.size() - begin);
+    }
+  } // anonymous
+
+  SharedMemoryRingWriter::SharedMemoryRingWriter() = default;
+
+  SharedMemoryRingWriter::~SharedMemoryRingWriter()
+  {
+    // The name is removed as soon as the reader confirms it mapped the ring,
+    // but it may never have.
+    if (!_name.empty() && !_mappedByRemote)
+      bip::shared_memory_object::remove(_name.c_str());
+  }
+
+  bool SharedMemoryRingWriter::create()
+  {
+    static std::atomic<unsigned int> ringCount{0};
+    _name = processRingNamePrefix() + std::to_string(++ringCount);
+    const auto capacity = ringCapacity();
+    try
+    {
+      // Only processes of the same user may map the ring.
+      bip::shared_memory_object shm(bip::create_only, _name.c_str(), bip::read_write,
+                                    bip::permissions(0600));
+      shm.truncate(static_cast<bip::offset_t>(ringHeaderSize + capacity));
+      _region = bip::mapped_region(shm, bip::read_write);
+    }
+    catch (const bip::interprocess_exception& e)
+    {
+      qiLogWarning() << "Cannot create the shared memory ring " << _name << ": " << e.what()
+                     << ". Large payloads will go through the socket.";
+      bip::shared_memory_object::remove(_name.c_str());
+      _name.clear();
+      _failed = true;
+      return false;
+    }
+    auto header = new (_region.get_address()) RingHeader;
+    header->capacity = capacity;
+    header->readPosition.store(0, std::memory_order_relaxed);
+    _capacity = capacity;
+    qiLogVerbose() << "Created the shared memory ring " << _name << " of " << capacity << " bytes";
+    return true;
+  }
+
+  boost::optional<Message> SharedMemoryRingWriter::advertise(const Message& msg,
+                                                             const StreamContext& context)
+  {
+    if (_advertised || _failed || msg.buffer().totalSize() < payloadThreshold()
+        || !sharesMemoryWith(context))
+      return {};
+    if (!create())
+      return {};
+    _advertised = true;
+    return capabilityMessage(capabilityname::sharedMemoryPayloadRing, _name);
+  }
+
+  bool SharedMemoryRingWriter::isMappedByRemote(const StreamContext& context)
+  {
+    if (_mappedByRemote)
+      return true;
+    if (!_advertised)
+      return false;
+    try
+    {
+      const auto mapped = context.remoteCapability(capabilityname::sharedMemoryPayloadRingMapped);
+      _mappedByRemote = mapped && mapped->to<std::string>() == _name;
+    }
+    catch (const std::exception& e)
+    {
+      qiLogDebug() << "Invalid shared memory ring confirmation: " << e.what();
+    }
+    // Both ends have the ring mapped: its name is not needed anymore, and
+    // removing it now ensures it does not outlive them.
+    if (_mappedByRemote)
+      bip::shared_memory_object::remove(_name.c_str());
+    return _mappedByRemote;
+  }
+
+  bool SharedMemoryRingWriter::pack(Message& msg, const StreamContext& context)
+  {
+    const std::uint64_t size = msg.buffer().totalSize();
+    if (size < payloadThreshold() || size > _capacity || !isMappedByRemote(context))
+      return false;
+
+    // A payload never wraps around the end of the ring.
+    auto position = _writePosition;
+    const auto offset = position % _capacity;
+    if (offset + size > _capacity)
+      position += _capacity - offset;
+
+    const auto base = static_cast<unsigned char*>(_region.get_address());
+    const auto& header = *reinterpret_cast<const RingHeader*>(base);
+    if (position + size - header.readPosition.load(std::memory_order_acquire) > _capacity)
+    {
+      qiLogDebug() << "Shared memory ring " << _name << " is full, sending " << size
+                   << " bytes through the socket";
+      return false;
+    }
+    flatten(msg.buffer(), base + ringHeaderSize + position % _capacity);
+    std::atomic_thread_fence(std::memory_order_release);
+    _writePosition = position + size;
+
+    const auto size32 = static_cast<std::uint32_t>(size);
+    Buffer descriptor;
+    descriptor.write(&position, sizeof(position));
+    descriptor.write(&size32, sizeof(size32));
+    descriptor.write(_name.data(), _name.size());
+    msg.setBuffer(std::move(descriptor));
+    msg.addFlags(Message::TypeFlag_SharedMemoryPayload);
+    return true;
+  }
+
+  SharedMemoryRingReader::SharedMemoryRingReader() = default;
+
+  SharedMemoryRingReader::~SharedMemoryRingReader()
+  {
+    auto names = mappedRingNames().synchronize();
+    for (const auto& region : _regions)
+      names->erase(region.first);
+  }
+
+  boost::optional<Message> SharedMemoryRingReader::map(const CapabilityMap& capabilities,
+                                                       const StreamContext& context)
+  {
+    const auto it = capabilities.find(capabilityname::sharedMemoryPayloadRing);
+    if (it == capabilities.end() || !sharesMemoryWith(context))
+      return {};
+    std::string name;
+    try
+    {
+      name = it->second.to<std::string>();
+    }
+    catch (const std::exception& e)
+    {
+      qiLogDebug() << "Invalid shared memory ring capability: " << e.what();
+      return {};
+    }
+    if (!isRingName(name))
+    {
+      qiLogVerbose() << "Refusing to map the shared memory object '" << name
+                     << "': it is not a shared memory ring";
+      return {};
+    }
+    if (_regions.count(name))
+      return {};
+
+    bip::mapped_region region;
+    try
+    {
+      bip::shared_memory_object shm(bip::open_only, name.c_str(), bip::read_write);
+      if (!isPrivateToUser(shm))
+      {
+        qiLogVerbose() << "Refusing to map the shared memory ring " << name
+                       << ": it is not private to the user of this process";
+        return {};
+      }
+      region = bip::mapped_region(shm, bip::read_write);
+    }
+    catch (const bip::interprocess_exception& e)
+    {
+      qiLogVerbose() << "Cannot map the shared memory ring " << name << ": " << e.what()
+                     << ". Large payloads will go through the socket.";
+      return {};
+    }
+    if (region.get_size() < ringHeaderSize)
+    {
+      qiLogVerbose() << "Shared memory ring " << name << " is too small";
+      return {};
+    }
+    if (!mappedRingNames()->insert(name).second)
+    {
+      qiLogVerbose() << "Refusing to map the shared memory ring " << name
+                     << ": it is already mapped";
+      return {};
+    }
+    _regions.emplace(name, std::move(region));
+    qiLogVerbose() << "Mapped the shared memory ring " << name;
+    return capabilityMessage(capabilityname::sharedMemoryPayloadRingMapped, name);
+  }
+
+  bool SharedMemoryRingReader::unpack(Message& msg, std::uint32_t maxPayload)
+  {
+    if (!(msg.flags() & Message::TypeFlag_SharedMemoryPayload))
+      return true;
+
+    const auto& descriptor = msg.buffer();
+    if (descriptor.size() <= descriptorFixedSize || !descriptor.subBuffers().empty())
+    {
+      qiLogError() << "Ill-formed shared memory payload descriptor";
+      return false;
+    }
+    const auto data = static_cast<const char*>(descriptor.data());
+    std::uint64_t position;
+    std::uint32_t size;
+    std::memcpy(&position, data, sizeof(position));
+    std::memcpy(&size, data + sizeof(position), sizeof(size));
+    const std::string name(data + descriptorFixedSize, descriptor.size() - descriptorFixedSize);
+    if (size > maxPayload)
+    {
+      qiLogError() << "Shared memory payload of " << size << " bytes exceeds the maximum of "
+                   << maxPayload << " bytes";
+      return false;
+    }
+
+    const auto it = _regions.find(name);
+    if (it == _regions.end())
+    {
+      qiLogError() << "Shared memory payload in the unknown ring " << name;
+      return false;
+    }
+
+    const auto& region = it->second;
+    const auto base = static_cast<unsigned char*>(region.get_address());
+    auto& header = *reinterpret_cast<RingHeader*>(base);
+    const auto capacity = header.capacity;
+    if (capacity == 0 || capacity > region.get_size() - ringHeaderSize
+        || position % capacity + size > capacity)
+    {
+      qiLogError() << "Shared memory payload descriptor out of the bounds of ring " << name;
+      return false;
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    Buffer payload;
+    void* dest = payload.reserve(size);
+    if (size != 0u && !dest)
+    {
+      qiLogWarning() << "Cannot reserve a buffer for the shared memory payload of "
+                     << size << " bytes";
+      return false;
+    }
+    std::memcpy(dest, base + ringHeaderSize + position % capacity, size);
+    header.readPosition.store(position + size, std::memory_order_release);
+
+    msg.setBuffer(std::move(payload));
+    msg.setFlags(msg.flags() & ~Message::TypeFlag_SharedMemoryPayload);
+    return true;
+  }
+
+} // namespace qi
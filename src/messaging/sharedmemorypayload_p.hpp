@@ -0,0 +1,129 @@
+#pragma once
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#ifndef _SRC_MESSAGING_SHAREDMEMORYPAYLOAD_P_HPP_
+#define _SRC_MESSAGING_SHAREDMEMORYPAYLOAD_P_HPP_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/optional.hpp>
+#include "message.hpp"
+#include "streamcontext.hpp"
+
+/// @file
+/// Moves the payload of large messages exchanged between two ends of the same
+/// machine through shared memory, so that only a small descriptor goes through
+/// the socket.
+///
+/// Each end of a socket lazily creates a ring of shared memory for the messages
+/// it sends. The payload of a message is copied into the ring, and the message
+/// is sent with the `Message::TypeFlag_SharedMemoryPayload` flag and a
+/// descriptor of the payload (its position and size in the ring, and the name of
+/// the ring) as its buffer. The receiving end maps the ring on the first
+/// descriptor, copies the payload back into the message and releases its space
+/// in the ring by storing the position of the end of the payload in the ring
+/// header, where the sending end reads it.
+///
+/// As messages are received in the order they are sent, space is released in
+/// order and the ring needs no other synchronization. When the ring has no room
+/// for a payload, the message is simply sent through the socket.
+///
+/// The feature is enabled only with ends advertising the
+/// `capabilityname::sharedMemoryPayload` capability with the same machine id,
+/// which they do if QI_SHM_PAYLOAD is set. Sockets must not use it over SSL,
+/// and only use it with ends connected through a local socket, as the same
+/// user, or through a loopback address.
+///
+/// The receiving end only maps rings whose names have the format of the ones
+/// it creates, that are private to its own user and that no other end of the
+/// process mapped. It never removes them: the sending end removes the name of its ring once the
+/// receiving end confirmed it mapped it, or when it is destroyed.
+///
+/// The ring is only used once the receiving end has confirmed it could map it:
+/// when the first large payload is sent, the sending end creates the ring and
+/// advertises its name in a capability message, and the payload goes through
+/// the socket. The receiving end maps the ring and answers with another
+/// capability message. If it cannot map the ring (it runs under another user,
+/// or in a container that does not share the shared memory of this one...), it
+/// does not answer and payloads keep going through the socket.
+
+namespace qi
+{
+  /// Ring of shared memory in which a socket end writes the payloads it sends.
+  ///
+  /// Not thread-safe: calls must be serialized, in the order the messages are
+  /// sent.
+  class SharedMemoryRingWriter
+  {
+  public:
+    SharedMemoryRingWriter();
+    ~SharedMemoryRingWriter();
+
+    SharedMemoryRingWriter(const SharedMemoryRingWriter&) = delete;
+    SharedMemoryRingWriter& operator=(const SharedMemoryRingWriter&) = delete;
+
+    /// Creates the ring and returns the capability message advertising it, the
+    /// first time a message large enough is sent to a remote end that shares
+    /// memory with this one. The message must be sent before this one.
+    boost::optional<Message> advertise(const Message& msg, const StreamContext& context);
+
+    /// Moves the payload of the message into the ring and replaces it by its
+    /// descriptor, if the message is large enough and the remote end confirmed
+    /// it mapped the ring.
+    ///
+    /// @return true if the payload was moved.
+    bool pack(Message& msg, const StreamContext& context);
+
+  private:
+    bool create();
+    bool isMappedByRemote(const StreamContext& context);
+
+    std::string _name;
+    boost::interprocess::mapped_region _region;
+    std::uint64_t _capacity = 0;
+    std::uint64_t _writePosition = 0;
+    bool _failed = false;
+    bool _advertised = false;
+    bool _mappedByRemote = false;
+  };
+
+  /// Reader of the rings in which remote ends write the payloads they send.
+  ///
+  /// Not thread-safe: calls must be serialized, in the order the messages are
+  /// received.
+  class SharedMemoryRingReader
+  {
+  public:
+    SharedMemoryRingReader();
+    ~SharedMemoryRingReader();
+
+    SharedMemoryRingReader(const SharedMemoryRingReader&) = delete;
+    SharedMemoryRingReader& operator=(const SharedMemoryRingReader&) = delete;
+
+    /// Maps the ring advertised in the capabilities received from the remote
+    /// end, if any, and returns the capability message confirming it.
+    /// Nothing is returned if this end does not share memory with the remote
+    /// one, or if the ring cannot be mapped or is not a ring that may be
+    /// mapped (see the file documentation).
+    boost::optional<Message> map(const CapabilityMap& capabilities, const StreamContext& context);
+
+    /// Replaces the descriptor of a message received with the
+    /// `Message::TypeFlag_SharedMemoryPayload` flag by its payload. Messages
+    /// without the flag are left untouched.
+    ///
+    /// @return false if the descriptor is ill-formed or refers to a ring that
+    /// was not mapped.
+    bool unpack(Message& msg, std::uint32_t maxPayload);
+
+  private:
+    std::map<std::string, boost::interprocess::mapped_region> _regions;
+  };
+
+} // namespace qi
+
+#endif // _SRC_MESSAGING_SHAREDMEMORYPAYLOAD_P_HPP_
@@ -91,6 +91,13 @@ namespace qi
 
     boost::optional<qi::int64_t> getSocketTimeWarnThresholdFromEnv();
 
+    /// Size of the buffer used to receive messages in bulk, or 0 if messages
+    /// are to be received one by one (see `receiveMessageBuffered`).
+    std::size_t getReceiveBufferSizeFromEnv();
+
+    /// Limits of the batches of messages sent with a single write operation.
+    SendBatchLimits getSendBatchLimitsFromEnv();
+
     /// Connected state of the socket.
     /// Allow to send and receive messages.
     ///
@@ -253,7 +260,8 @@ namespace qi
       : _result{ boost::make_shared<SyncConnectedResult<N, S>>(ConnectedResult<N, S>{ s }) }
       , _stopRequested(false)
       , _shuttingdown(false)
-      , _sendMsg{s}
+      , _receiveMsg{getReceiveBufferSizeFromEnv()}
+      , _sendMsg{s, getSendBatchLimitsFromEnv()}
     {
     }
 
@@ -49,12 +49,33 @@ namespace qi { namespace sock {
     /// Warning: On some platform (e.g. MacOs), timeout might be ignored.
     static void setSocketNativeOptions(boost::asio::ip::tcp::socket::native_handle_type h, int timeoutInSeconds);
 
+    /// Whether the peer of the connected socket runs on this machine, that is
+    /// whether it is connected through a loopback address. TCP gives no way to
+    /// know the user the peer runs as.
+    template<typename L>
+    static bool isLocalPeer(L& socket)
+    {
+      boost::system::error_code erc;
+      auto address = socket.remote_endpoint(erc).address();
+      if (erc)
+        return false;
+      if (address.is_v6() && address.to_v6().is_v4_mapped())
+        address = address.to_v6().to_v4();
+      return address.is_loopback();
+    }
+
     /// NetSslSocket S, MutableBufferSequence B, ReadHandler H
     template<typename S, typename B, typename H>
     static void async_read(S& s, const B& b, H h)
     {
       boost::asio::async_read(s, b, h);
     }
+    /// NetSslSocket S, MutableBufferSequence B, ReadHandler H
+    template<typename S, typename B, typename H>
+    static void async_read_some(S& s, const B& b, H h)
+    {
+      s.async_read_some(b, h);
+    }
     /// NetSslSocket S, ConstBufferSequence B, WriteHandler H
     template<typename S, typename B, typename H>
     static void async_write(S& s, const B& b, H h)
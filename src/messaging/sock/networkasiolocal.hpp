@@ -0,0 +1,351 @@
+#pragma once
+#ifndef _QI_SOCK_NETWORKASIOLOCAL_HPP
+#define _QI_SOCK_NETWORKASIOLOCAL_HPP
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/optional.hpp>
+#include <boost/predef.h>
+#include <qi/url.hpp>
+#include "networkasio.hpp"
+#include "error.hpp"
+#include "option.hpp"
+#include "resolve.hpp"
+
+/// @file
+/// Contains the implementation of the Network concept for boost::asio local
+/// (unix domain) stream sockets.
+///
+/// Local sockets are addressed by URLs of the form `unix://<path>`, where the
+/// path is the file the server is bound to. As qi::Url splits the port at the
+/// first colon, the path must not contain any. A port, if any, is ignored.
+///
+/// The types of this model wrap the boost::asio local socket types so that
+/// they model the same concepts as the TCP ones (see concept.hpp), letting
+/// TcpMessageSocket run unchanged over local sockets.
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace qi { namespace sock {
+
+  /// The URL scheme of local sockets.
+  inline char const* localScheme()
+  {
+    return "unix";
+  }
+
+  /// @return the URL of a local socket bound to `path`.
+  inline Url localUrl(const std::string& path)
+  {
+    return Url(std::string(localScheme()) + "://" + path);
+  }
+
+  /// Models NetAddress: the path of a local endpoint.
+  class LocalAddress
+  {
+    std::string _path;
+  public:
+    explicit LocalAddress(std::string path = {})
+      : _path(std::move(path))
+    {
+    }
+    std::string to_string() const
+    {
+      return _path;
+    }
+    bool is_v6() const
+    {
+      return false;
+    }
+  };
+
+  /// Models NetEndpoint and NetEntry.
+  class LocalEndpoint
+  {
+    boost::asio::local::stream_protocol::endpoint _endpoint;
+  public:
+    LocalEndpoint() = default;
+    explicit LocalEndpoint(const std::string& path)
+      : _endpoint(path)
+    {
+    }
+    explicit LocalEndpoint(boost::asio::local::stream_protocol::endpoint ep)
+      : _endpoint(std::move(ep))
+    {
+    }
+  // NetEndpoint:
+    LocalAddress address() const
+    {
+      return LocalAddress{ _endpoint.path() };
+    }
+    unsigned short port() const
+    {
+      return 0;
+    }
+    boost::asio::local::stream_protocol protocol() const
+    {
+      return _endpoint.protocol();
+    }
+  // NetEntry:
+    const LocalEndpoint& endpoint() const
+    {
+      return *this;
+    }
+  // Custom:
+    const boost::asio::local::stream_protocol::endpoint& native() const
+    {
+      return _endpoint;
+    }
+  };
+
+  /// The URL of a local endpoint.
+  inline Url url(const LocalEndpoint& ep, SslEnabled)
+  {
+    return localUrl(ep.address().to_string());
+  }
+
+  /// Local sockets have no Nagle algorithm: setting this option does nothing.
+  struct LocalNoDelay
+  {
+    explicit LocalNoDelay(bool)
+    {
+    }
+  };
+
+  /// Models NetLowestSocket on top of a local stream socket.
+  class LocalSocket
+  {
+    boost::asio::local::stream_protocol::socket _socket;
+  public:
+    using lowest_layer_type = LocalSocket;
+    using endpoint_type = LocalEndpoint;
+    using shutdown_type = boost::asio::socket_base::shutdown_type;
+    using executor_type = boost::asio::local::stream_protocol::socket::executor_type;
+    using native_handle_type = boost::asio::local::stream_protocol::socket::native_handle_type;
+
+    explicit LocalSocket(boost::asio::io_service& io)
+      : _socket(io)
+    {
+    }
+
+    executor_type get_executor()
+    {
+      return _socket.get_executor();
+    }
+
+    lowest_layer_type& lowest_layer()
+    {
+      return *this;
+    }
+
+    const lowest_layer_type& lowest_layer() const
+    {
+      return *this;
+    }
+
+    /// The underlying socket, to be accepted by an acceptor.
+    boost::asio::local::stream_protocol::socket& socket()
+    {
+      return _socket;
+    }
+
+    template<typename H>
+    void async_connect(const LocalEndpoint& ep, H h)
+    {
+      _socket.async_connect(ep.native(), std::move(h));
+    }
+
+    template<typename B, typename H>
+    void async_read_some(const B& buffers, H&& h)
+    {
+      _socket.async_read_some(buffers, std::forward<H>(h));
+    }
+
+    template<typename B, typename H>
+    void async_write_some(const B& buffers, H&& h)
+    {
+      _socket.async_write_some(buffers, std::forward<H>(h));
+    }
+
+    LocalEndpoint remote_endpoint() const
+    {
+      return LocalEndpoint{ _socket.remote_endpoint() };
+    }
+
+    void set_option(const LocalNoDelay&)
+    {
+    }
+
+    native_handle_type native_handle()
+    {
+      return _socket.native_handle();
+    }
+
+    void shutdown(shutdown_type what)
+    {
+      _socket.shutdown(what);
+    }
+
+    void shutdown(shutdown_type what, boost::system::error_code& erc)
+    {
+      _socket.shutdown(what, erc);
+    }
+
+    void cancel()
+    {
+      _socket.cancel();
+    }
+
+    void close(boost::system::error_code& erc)
+    {
+      _socket.close(erc);
+    }
+  };
+
+  /// Models NetSslSocket without encryption: local connections never go
+  /// through the network, and the handshake is rejected.
+  class LocalStream
+  {
+    LocalSocket _socket;
+  public:
+    using next_layer_type = LocalSocket;
+    using lowest_layer_type = LocalSocket;
+    using executor_type = LocalSocket::executor_type;
+    using handshake_type = boost::asio::ssl::stream_base::handshake_type;
+
+    LocalStream(boost::asio::io_service& io, boost::asio::ssl::context&)
+      : _socket(io)
+    {
+    }
+
+    executor_type get_executor()
+    {
+      return _socket.get_executor();
+    }
+
+    void set_verify_mode(boost::asio::ssl::verify_mode)
+    {
+    }
+
+    template<typename H>
+    void async_handshake(handshake_type, H h)
+    {
+      boost::asio::post(_socket.get_executor(), [=]() mutable {
+        h(boost::asio::error::make_error_code(boost::asio::error::operation_not_supported));
+      });
+    }
+
+    lowest_layer_type& lowest_layer()
+    {
+      return _socket;
+    }
+
+    next_layer_type& next_layer()
+    {
+      return _socket;
+    }
+
+    template<typename B, typename H>
+    void async_read_some(const B& buffers, H&& h)
+    {
+      _socket.async_read_some(buffers, std::forward<H>(h));
+    }
+
+    template<typename B, typename H>
+    void async_write_some(const B& buffers, H&& h)
+    {
+      _socket.async_write_some(buffers, std::forward<H>(h));
+    }
+  };
+
+  /// Models NetResolver for local URLs. URLs are resolved by
+  /// `ResolveUrl<NetworkAsioLocal>` without going through it.
+  class LocalResolver
+  {
+  public:
+    using iterator = std::vector<LocalEndpoint>::const_iterator;
+    explicit LocalResolver(boost::asio::io_service&)
+    {
+    }
+    void cancel()
+    {
+    }
+  };
+
+  /// Model the `Network` concept for boost::asio local stream sockets.
+  ///
+  /// Buffers, reads and writes are the same as for `NetworkAsio`.
+  struct NetworkAsioLocal : NetworkAsio
+  {
+    using acceptor_type = boost::asio::local::stream_protocol::acceptor;
+    using resolver_type = LocalResolver;
+    using ssl_socket_type = LocalStream;
+    using socket_option_no_delay_type = LocalNoDelay;
+
+    /// There is no keepalive for local sockets: the peer closing the
+    /// connection, even by dying, is immediately known.
+    static void setSocketNativeOptions(LocalSocket::native_handle_type, int)
+    {
+    }
+
+    /// Whether the peer of the connected socket runs as the same user as this
+    /// process, according to the credentials the kernel recorded for it.
+    template<typename L>
+    static bool isLocalPeer(L& socket)
+    {
+#if BOOST_OS_LINUX
+      ucred credentials{};
+      socklen_t size = sizeof(credentials);
+      if (::getsockopt(socket.native_handle(), SOL_SOCKET, SO_PEERCRED, &credentials, &size) != 0)
+        return false;
+      return credentials.uid == ::geteuid();
+#else
+      uid_t uid;
+      gid_t gid;
+      if (::getpeereid(socket.native_handle(), &uid, &gid) != 0)
+        return false;
+      return uid == ::geteuid();
+#endif
+    }
+  };
+
+  /// The path of a local URL is directly the endpoint: there is nothing to
+  /// resolve, and the completion handler is called synchronously.
+  template<>
+  class ResolveUrl<NetworkAsioLocal>
+  {
+    using OptionalEntry = boost::optional<LocalEndpoint>;
+  public:
+    explicit ResolveUrl(boost::asio::io_service&)
+    {
+    }
+    friend bool operator==(const ResolveUrl&, const ResolveUrl&)
+    {
+      return true;
+    }
+    friend bool operator!=(const ResolveUrl&, const ResolveUrl&)
+    {
+      return false;
+    }
+  // Procedure:
+    template<typename Proc, typename Proc1 = ka::constant_function_t<void>>
+    void operator()(const Url& url, IpV6Enabled, Proc onComplete, Proc1 = Proc1{})
+    {
+      if (url.protocol() != localScheme() || url.host().empty())
+      {
+        onComplete(badAddress<ErrorCode<NetworkAsioLocal>>(), OptionalEntry{});
+        return;
+      }
+      onComplete(success<ErrorCode<NetworkAsioLocal>>(), OptionalEntry{ LocalEndpoint{ url.host() } });
+    }
+  };
+}} // namespace qi::sock
+
+#endif // BOOST_ASIO_HAS_LOCAL_SOCKETS
+
+#endif // _QI_SOCK_NETWORKASIOLOCAL_HPP
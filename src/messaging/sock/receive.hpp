@@ -1,11 +1,16 @@
 #pragma once
 #ifndef _QI_SOCK_RECEIVE_HPP
 #define _QI_SOCK_RECEIVE_HPP
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
 #include <boost/shared_ptr.hpp>
 #include <boost/optional.hpp>
 #include <ka/src.hpp>
 #include <ka/macroregular.hpp>
 #include <qi/trackable.hpp>
+#include <qi/assert.hpp>
 #include <qi/log.hpp>
 #include "src/messaging/message.hpp"
 #include "concept.hpp"
@@ -51,6 +56,37 @@
 /// where the next message is to be received, or nothing if reception must stop
 /// (this is done by using an optional pointer).
 ///
+/// ## The buffered message receive loop
+///
+/// `receiveMessage` performs at least two reads per message (one for the
+/// header and one for the payload). When many small messages are exchanged,
+/// the cost of these operations (system calls, handlers dispatch) dominates.
+///
+/// `receiveMessageBuffered` is an alternative receive loop that reads as many
+/// bytes as available into a `ReceiveBuffer` and then extracts from it all the
+/// complete messages it contains before reading again:
+///
+/// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+///           start
+///             |
+///             v
+///    complete msg in buffer? <--------------------------------
+///        | no         | yes                                   |
+///        |            v                                       |
+///        |   pass msg/error to upper layer -- must continue? -
+///        |                                        | no   yes
+///        v                                        v
+///   payload fits in buffer? --- no ---> async read   stop
+///        | yes                      rest of payload
+///        v                          in msg memory ----------> ...
+///   async read some bytes
+///   in buffer ----------------------> ...
+/// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+///
+/// Payloads that fit in the receive buffer are copied once from it to the
+/// message memory. Payloads that do not fit are read directly into the message
+/// memory, once the bytes already buffered have been moved there.
+///
 ///
 /// ## Lifetime and synchronization mechanisms
 ///
@@ -342,6 +378,253 @@ namespace qi { namespace sock {
     }
   }
 
+  /// Memory into which bytes are read from a socket in bulk, so that several
+  /// messages can be extracted from a single read operation.
+  ///
+  /// Received bytes that have not been consumed yet lie in [data(), data() + size()).
+  /// Before a new read, these bytes are moved at the beginning of the storage,
+  /// so that the free space is always contiguous.
+  ///
+  /// A capacity of zero means that the buffer is not used.
+  class ReceiveBuffer
+  {
+    std::vector<unsigned char> _storage;
+    std::size_t _begin = 0u;
+    std::size_t _end = 0u;
+  public:
+  // Regular:
+    explicit ReceiveBuffer(std::size_t capacity = 0u)
+      : _storage(capacity)
+    {
+      QI_ASSERT(capacity == 0u || capacity >= sizeof(Message::Header));
+    }
+    KA_GENERATE_FRIEND_REGULAR_OPS_3(ReceiveBuffer, _storage, _begin, _end)
+  // Custom:
+    std::size_t capacity() const
+    {
+      return _storage.size();
+    }
+
+    /// Number of received bytes not consumed yet.
+    std::size_t size() const
+    {
+      return _end - _begin;
+    }
+
+    const unsigned char* data() const
+    {
+      return _storage.data() + _begin;
+    }
+
+    /// Precondition: n <= size()
+    void consume(std::size_t n)
+    {
+      QI_ASSERT(n <= size());
+      _begin += n;
+      if (_begin == _end)
+        clear();
+    }
+
+    void clear()
+    {
+      _begin = _end = 0u;
+    }
+
+    /// Moves the pending bytes at the beginning of the storage and returns the
+    /// free memory following them.
+    std::pair<unsigned char*, std::size_t> prepare()
+    {
+      if (_begin != 0u)
+      {
+        std::memmove(_storage.data(), _storage.data() + _begin, size());
+        _end -= _begin;
+        _begin = 0u;
+      }
+      return {_storage.data() + _end, capacity() - _end};
+    }
+
+    /// Marks `n` bytes of the memory returned by `prepare` as received.
+    /// Precondition: n is lesser or equal to the size returned by `prepare`.
+    void commit(std::size_t n)
+    {
+      QI_ASSERT(_end + n <= capacity());
+      _end += n;
+    }
+  };
+
+  /// Receive messages through the socket by reading bytes in bulk in the
+  /// given buffer, and call the handler for each message or error.
+  ///
+  /// The handler has the same semantics as the one of `receiveMessage`: it
+  /// returns the memory where the next message must be received, or nothing
+  /// to stop. If several messages are available in the buffer, the handler is
+  /// called successively for each one of them, without waiting for the network.
+  ///
+  /// Bytes remaining in the buffer when the reception is stopped are kept, so
+  /// that the reception can be resumed by calling this function again with
+  /// the same buffer.
+  ///
+  /// Precondition: The buffer must have a non-null capacity.
+  ///
+  /// Precondition: The buffer and the message referred to by `ptrMsg` must be
+  ///   valid until the reception has been stopped.
+  ///
+  /// Network N,
+  /// Mutable<SslSocket<N>> S,
+  /// Mutable<Message> M,
+  /// Procedure<Optional<M> (ErrorCode<N>, M)> Proc,
+  /// Transformation<Procedure> F0,
+  /// Transformation<Procedure<void (Args...)>> F1
+  template<typename N, typename S, typename M, typename Proc, typename F0 = ka::id_transfo_t, typename F1 = ka::id_transfo_t>
+  void receiveMessageBuffered(const S& socket, ReceiveBuffer* ptrBuf, M ptrMsg, SslEnabled ssl,
+    size_t maxPayload, Proc onReceive, F0 lifetimeTransfo = F0{}, F1 syncTransfo = F1{});
+
+  namespace detail
+  {
+    /// Network N,
+    /// Mutable<SslSocket<N>> S,
+    /// Mutable<Message> M,
+    /// Procedure<Optional<M> (ErrorCode<N>, M)> Proc,
+    /// Transformation<Procedure> F0,
+    /// Transformation<Procedure<void (Args...)>> F1
+    template<typename N, typename S, typename M, typename Proc, typename F0, typename F1>
+    void onReadSome(const ErrorCode<N>& erc, std::size_t len, const S& socket,
+      ReceiveBuffer* ptrBuf, M ptrMsg, SslEnabled ssl, size_t maxPayload, Proc onReceive,
+      const F0& lifetimeTransfo, const F1& syncTransfo)
+    {
+      if (erc)
+      {
+        if (auto optionalPtrMsg = onReceive(erc, M{}))
+        {
+          receiveMessageBuffered<N>(socket, ptrBuf, *optionalPtrMsg, ssl, maxPayload,
+            onReceive, lifetimeTransfo, syncTransfo);
+        }
+        return;
+      }
+      ptrBuf->commit(len);
+      receiveMessageBuffered<N>(socket, ptrBuf, ptrMsg, ssl, maxPayload, onReceive,
+        lifetimeTransfo, syncTransfo);
+    }
+  } // namespace detail
+
+  /// Network N,
+  /// Mutable<SslSocket<N>> S,
+  /// Mutable<Message> M,
+  /// Procedure<Optional<M> (ErrorCode<N>, M)> Proc,
+  /// Transformation<Procedure> F0,
+  /// Transformation<Procedure<void (Args...)>> F1
+  template<typename N, typename S, typename M, typename Proc, typename F0, typename F1>
+  void receiveMessageBuffered(const S& socket, ReceiveBuffer* ptrBuf, M ptrMsg, SslEnabled ssl,
+    size_t maxPayload, Proc onReceive, F0 lifetimeTransfo, F1 syncTransfo)
+  {
+    QI_ASSERT(ptrBuf->capacity() != 0u);
+    auto& buf = *ptrBuf;
+    static const auto headerSize = sizeof(Message::Header);
+
+    // The stream cannot be resynchronized after an invalid header, so the
+    // buffered bytes are discarded.
+    // Returns true if the reception must continue.
+    auto receiveErrorAndMaybeContinue = [&](ErrorCode<N> erc) {
+      buf.clear();
+      if (auto optionalPtrMsg = onReceive(erc, M{}))
+      {
+        ptrMsg = *optionalPtrMsg;
+        return true;
+      }
+      return false;
+    };
+
+    // First, we pass the upper layer all the complete messages already received.
+    while (buf.size() >= headerSize)
+    {
+      auto& msg = *ptrMsg;
+      std::memcpy(&msg.header(), buf.data(), headerSize);
+      const auto& header = msg.header();
+      if (header.magic != Message::Header::magicCookie)
+      {
+        qiLogWarning(logCategory()) << &(*socket) << ": Incorrect magic from "
+          << (*socket).lowest_layer().remote_endpoint().address().to_string()
+          << " (expected " << Message::Header::magicCookie
+          << ", got " << header.magic << ").";
+        if (!receiveErrorAndMaybeContinue(fault<ErrorCode<N>>())) return;
+        continue;
+      }
+      const size_t payload = header.size;
+      if (payload > maxPayload)
+      {
+        qiLogWarning(logCategory()) << "Receiving message of size " << payload
+          << " above maximum configured payload size " << maxPayload <<
+             " (configure with environment variable QI_MAX_MESSAGE_PAYLOAD).";
+        if (!receiveErrorAndMaybeContinue(messageSize<ErrorCode<N>>())) return;
+        continue;
+      }
+      const bool complete = buf.size() - headerSize >= payload;
+      if (!complete && headerSize + payload <= buf.capacity())
+        break; // The message will fit in the buffer: wait for more bytes.
+
+      auto messageBuffer = msg.extractBuffer();
+      void* ptr = nullptr;
+      if (payload != 0u && (ptr = messageBuffer.reserve(payload)) == nullptr)
+      {
+        qiLogWarning(logCategory()) << "Cannot reserve a buffer for the "
+          "received payload of size " << payload << " byte(s).";
+        if (!receiveErrorAndMaybeContinue(noMemory<ErrorCode<N>>())) return;
+        continue;
+      }
+      const auto buffered = std::min(buf.size() - headerSize, payload);
+      if (buffered != 0u)
+        std::memcpy(ptr, buf.data() + headerSize, buffered);
+      buf.consume(headerSize + buffered);
+      msg.setBuffer(std::move(messageBuffer));
+
+      if (!complete)
+      {
+        // The payload does not fit in the buffer: the remaining bytes are read
+        // directly into the message memory.
+        auto readData = lifetimeTransfo([=](ErrorCode<N> erc, std::size_t /*len*/) mutable {
+          if (auto optionalPtrNextMsg = onReceive(erc, ptrMsg))
+          {
+            receiveMessageBuffered<N>(socket, ptrBuf, *optionalPtrNextMsg, ssl, maxPayload,
+              onReceive, lifetimeTransfo, syncTransfo);
+          }
+        });
+        auto buffer = N::buffer(static_cast<unsigned char*>(ptr) + buffered, payload - buffered);
+        if (*ssl)
+        {
+          N::async_read(*socket, buffer, syncTransfo(readData));
+        }
+        else
+        {
+          N::async_read((*socket).next_layer(), buffer, syncTransfo(readData));
+        }
+        return;
+      }
+
+      if (auto optionalPtrNextMsg = onReceive(success<ErrorCode<N>>(), ptrMsg))
+      {
+        ptrMsg = *optionalPtrNextMsg;
+        continue;
+      }
+      return;
+    }
+
+    // Then, we wait for more bytes.
+    const auto freeMemory = buf.prepare();
+    auto readSome = syncTransfo(lifetimeTransfo([=](ErrorCode<N> erc, std::size_t len) {
+      detail::onReadSome<N>(erc, len, socket, ptrBuf, ptrMsg, ssl, maxPayload, onReceive,
+        lifetimeTransfo, syncTransfo);
+    }));
+    auto buffer = N::buffer(freeMemory.first, freeMemory.second);
+    if (*ssl)
+    {
+      N::async_read_some(*socket, buffer, readSome);
+    }
+    else
+    {
+      N::async_read_some((*socket).next_layer(), buffer, readSome);
+    }
+  }
+
   /// Receive continuously messages until told to stop.
   ///
   /// A handler is called when a message is received.
@@ -378,11 +661,20 @@ namespace qi { namespace sock {
   class ReceiveMessageContinuous
   {
     Message _msg;
+    ReceiveBuffer _buffer;
   public:
   // QuasiRegular:
     ReceiveMessageContinuous() = default;
     // TODO: uncomment when messages are comparable, or when latest GCC is fixed.
 //    KA_GENERATE_FRIEND_REGULAR_OPS_1(ReceiveMessageContinuous, _msg)
+  // Custom:
+    /// If `receiveBufferSize` is not null, messages are received through a
+    /// buffer of this size (see `receiveMessageBuffered`). Otherwise, each
+    /// message is read separately (see `receiveMessage`).
+    explicit ReceiveMessageContinuous(std::size_t receiveBufferSize)
+      : _buffer(receiveBufferSize)
+    {
+    }
   // Procedure:
     /// Mutable<SslSocket<N>> S,
     /// Procedure<bool (ErrorCode<N>, Message*)> Proc,
@@ -392,29 +684,34 @@ namespace qi { namespace sock {
     void operator()(const S& socket, SslEnabled ssl, size_t maxPayload,
         Proc onReceive, const F0& lifetimeTransfo = {}, const F1& syncTransfo = {})
     {
-      receiveMessage<N>(socket, &_msg, ssl, maxPayload,
-
-        // This callback will be called when a message has been received.
-        // The pointer is the one we passed, or `nullptr` if an error occurred.
-        // It informs the upper layer that a message has been received and let
-        // it decide if we must continue receiving messages.
-        // If we must continue receiving messages, this callback itself returns
-        // a non-empty optional with a pointer to the memory where a new message
-        // can be received.
-        [=](ErrorCode<N> erc, Message* m) mutable -> boost::optional<Message*> {
-          if (onReceive(erc, m))
-          {
-            // Must continue.
-            auto dataBuffer = _msg.extractBuffer();
-            dataBuffer.clear();
-            _msg.setBuffer(std::move(dataBuffer));
-            return {&_msg}; // We reuse the message memory to receive the next message.
-          }
-          return {};
-        },
-        lifetimeTransfo,
-        syncTransfo
-      );
+      // This callback will be called when a message has been received.
+      // The pointer is the one we passed, or `nullptr` if an error occurred.
+      // It informs the upper layer that a message has been received and let
+      // it decide if we must continue receiving messages.
+      // If we must continue receiving messages, this callback itself returns
+      // a non-empty optional with a pointer to the memory where a new message
+      // can be received.
+      auto onReceiveMsg = [=](ErrorCode<N> erc, Message* m) mutable -> boost::optional<Message*> {
+        if (onReceive(erc, m))
+        {
+          // Must continue.
+          auto dataBuffer = _msg.extractBuffer();
+          dataBuffer.clear();
+          _msg.setBuffer(std::move(dataBuffer));
+          return {&_msg}; // We reuse the message memory to receive the next message.
+        }
+        return {};
+      };
+      if (_buffer.capacity() != 0u)
+      {
+        receiveMessageBuffered<N>(socket, &_buffer, &_msg, ssl, maxPayload, onReceiveMsg,
+          lifetimeTransfo, syncTransfo);
+      }
+      else
+      {
+        receiveMessage<N>(socket, &_msg, ssl, maxPayload, onReceiveMsg,
+          lifetimeTransfo, syncTransfo);
+      }
     }
   };
 
@@ -2,12 +2,15 @@
 #ifndef _QI_SOCK_SEND_HPP
 #define _QI_SOCK_SEND_HPP
 #include <atomic>
+#include <iterator>
+#include <utility>
 #include <vector>
 #include <list>
 #include <stdexcept>
 #include <sstream>
 #include <boost/thread/synchronized_value.hpp>
 #include <boost/core/ignore_unused.hpp>
+#include <ka/macroregular.hpp>
 #include <ka/src.hpp>
 #include <ka/scoped.hpp>
 #include <qi/trackable.hpp>
@@ -70,6 +73,13 @@
 /// case, `SendMessageEnqueue` effectively constitutes the upper layer of
 /// `sendMessage`.
 ///
+/// To reduce the number of write operations when messages accumulate in the
+/// queue, `SendMessageEnqueue` actually relies on `sendMessages`, a variant of
+/// `sendMessage` that writes a batch of consecutive messages with a single
+/// scatter-gather write. The size of a batch is bounded by `SendBatchLimits`.
+/// Once the batch is written, the upper layer is informed of the result for
+/// each message of the batch.
+///
 /// `SendMessageEnqueue` has itself an upper layer: it passes it the
 /// sent message though a callback. This callback returns a boolean to
 /// signal if message sending must continue.
@@ -81,15 +91,15 @@
 ///  SendMessageEnqueue start
 ///             |
 ///             v
-///   sendMessage(_msgQueue.begin()) <--
-///             | message sent          |
-///             v                       |
-/// pass msg/error to upper layer*      |
-///             |                       |
-///             v                       |
-///   remove msg from queue             |
+///  sendMessages(_msgQueue.begin(), n) <--
+///             | messages sent           |
+///             v                         |
+/// pass msgs/error to upper layer*       |
+///             |                         |
+///             v                         |
+///   remove msgs from queue              |
 ///             |                       |
-///       must continue? ---------------
+///       must continue? -----------------
 ///             | no         yes
 ///             v
 ///            stop
@@ -113,18 +123,23 @@
 
 namespace qi { namespace sock {
 
-  /// Make network buffers for the given message.
+  /// Number of network buffers needed to send the given message.
+  inline std::size_t bufferCount(const Message& msg)
+  {
+    return 2 + 2 * msg.buffer().subBuffers().size();
+  }
+
+  /// Append network buffers for the given message.
   ///
-  /// One buffer is for the header and the other one is for data.
+  /// One buffer is for the header and the others are for data.
   ///
   /// Network N
   template<typename N>
-  std::vector<ConstBuffer<N>> makeBuffers(const Message& msg)
+  void appendBuffers(std::vector<ConstBuffer<N>>& buffers, const Message& msg)
   {
     // header buffer
     ConstBuffer<N> headerBuffer = N::buffer(static_cast<const void*>(&msg.header()),
       sizeof(Message::Header));
-    std::vector<ConstBuffer<N>> buffers;
     const auto& msgBuffer = msg.buffer();
 
     // A buffer has a header and data.
@@ -140,7 +155,6 @@ namespace qi { namespace sock {
     // Memory layout for a buffer with 2 subbuffers:
     // (low address)                                                         (high address)
     // |header|buffer_part_0|size_subbuffer_0|buffer_part_1|size_subbuffer_1|buffer_part_2|
-    buffers.reserve(1 + 2 * msgBuffer.subBuffers().size() + 1);
     buffers.push_back(headerBuffer);
 
     decltype(msgBuffer.size()) beginOffset = 0;
@@ -161,9 +175,58 @@ namespace qi { namespace sock {
     // end of main buffer
     buffers.push_back(N::buffer(
       static_cast<const char*>(msgBuffer.data()) + beginOffset, msgBuffer.size() - beginOffset));
+  }
+
+  /// Make network buffers for the given message.
+  ///
+  /// Network N
+  template<typename N>
+  std::vector<ConstBuffer<N>> makeBuffers(const Message& msg)
+  {
+    std::vector<ConstBuffer<N>> buffers;
+    buffers.reserve(bufferCount(msg));
+    appendBuffers<N>(buffers, msg);
     return buffers;
   }
 
+  /// Bounds of a batch of messages sent with a single write operation.
+  ///
+  /// A batch always contains at least one message, even if this message alone
+  /// exceeds the limits.
+  struct SendBatchLimits
+  {
+    /// Maximum cumulated size of the messages, headers included.
+    std::size_t maxBytes = 256 * 1024;
+    /// Maximum number of network buffers (that is, of I/O vectors).
+    std::size_t maxBuffers = 128;
+    KA_GENERATE_FRIEND_REGULAR_OPS_2(SendBatchLimits, maxBytes, maxBuffers)
+  };
+
+  /// Number of consecutive messages, starting at `itFirst`, that fit in a
+  /// batch with the given limits.
+  ///
+  /// Precondition: itFirst != itEnd
+  ///
+  /// InputIterator<Message> I
+  template<typename I>
+  std::size_t batchCount(I itFirst, I itEnd, const SendBatchLimits& limits)
+  {
+    QI_ASSERT(itFirst != itEnd);
+    std::size_t count = 0u, bytes = 0u, buffers = 0u;
+    for (; itFirst != itEnd; ++itFirst, ++count)
+    {
+      const auto& msg = *itFirst;
+      const auto msgBytes = sizeof(Message::Header) + msg.buffer().totalSize();
+      const auto msgBuffers = bufferCount(msg);
+      if (count != 0u
+          && (bytes + msgBytes > limits.maxBytes || buffers + msgBuffers > limits.maxBuffers))
+        break;
+      bytes += msgBytes;
+      buffers += msgBuffers;
+    }
+    return count;
+  }
+
   /// Send a message through the socket and call the handler when the operation
   /// is complete, successfully or not.
   ///
@@ -218,6 +281,65 @@ namespace qi { namespace sock {
     }
   }
 
+  /// Send a batch of consecutive messages through the socket with a single
+  /// write operation and call the handler when the operation is complete,
+  /// successfully or not.
+  ///
+  /// The handler is passed the error code, an iterator to the first message of
+  /// the batch and the number of messages in the batch. If it returns a new
+  /// batch (an iterator to its first message and a count), it is immediately
+  /// sent.
+  ///
+  /// The count is used instead of an end iterator so that messages can be
+  /// appended to the underlying container while the batch is being sent.
+  ///
+  /// Precondition: The messages of the batch must be valid until the handler
+  ///   has been called.
+  ///
+  /// Precondition: This function must not be called while a message is already
+  ///   being sent. It is possible to call it again only once the handler as
+  ///   been called.
+  ///
+  /// Network N,
+  /// Mutable<SslSocket<N>> S,
+  /// InputIterator<Message> I,
+  /// Procedure<Optional<std::pair<I, std::size_t>> (ErrorCode<N>, I, std::size_t)> Proc,
+  /// Transformation<Procedure> F0,
+  /// Transformation<Procedure<void (Args...)>> F1
+  template<typename N, typename S, typename I, typename Proc, typename F0 = ka::id_transfo_t, typename F1 = ka::id_transfo_t>
+  void sendMessages(const S& socket, I itFirst, std::size_t count, Proc onSent, SslEnabled ssl,
+      F0 lifetimeTransfo = {}, F1 syncTransfo = {})
+  {
+    std::vector<ConstBuffer<N>> buffers;
+    {
+      std::size_t bufCount = 0u;
+      auto it = itFirst;
+      for (std::size_t i = 0u; i != count; ++i, ++it)
+        bufCount += bufferCount(*it);
+      buffers.reserve(bufCount);
+    }
+    {
+      auto it = itFirst;
+      for (std::size_t i = 0u; i != count; ++i, ++it)
+        appendBuffers<N>(buffers, *it);
+    }
+    auto writeCont = syncTransfo(lifetimeTransfo([=](ErrorCode<N> erc, size_t /*len*/) mutable {
+      if (auto optionalNextBatch = onSent(erc, itFirst, count))
+      {
+        sendMessages<N>(socket, optionalNextBatch->first, optionalNextBatch->second, onSent, ssl,
+          lifetimeTransfo, syncTransfo);
+      }
+    }));
+    if (*ssl)
+    {
+      N::async_write(*socket, std::move(buffers), writeCont);
+    }
+    else
+    {
+      N::async_write((*socket).next_layer(), std::move(buffers), writeCont);
+    }
+  }
+
   /// Functor that sends messages through a socket.
   ///
   /// The role of this type is to provide a queue for messages.
@@ -226,7 +348,9 @@ namespace qi { namespace sock {
   /// The messages will be sent in a FIFO manner.
   /// Sending messages is thread-safe.
   ///
-  /// The actual sending is done by `sendMessage`.
+  /// The actual sending is done by `sendMessages`: all the messages enqueued
+  /// when the previous write completes are sent with a single write, within
+  /// the limits given at construction.
   ///
   /// When a message has been sent, a callback is called. This callback return
   /// a boolean to decide if the queue, if not empty, must continue to be processed.
@@ -234,6 +358,11 @@ namespace qi { namespace sock {
   /// If you decide to stop the queue processing and it contain some messages,
   /// the queue is not cleared. Next time you send a message, it will
   /// be enqueued and the queue processing will continue from where it had stopped.
+  /// If the write of a batch succeeded, the messages of the batch that follow
+  /// the message for which the processing was stopped have nonetheless been
+  /// written: they are removed from the queue without calling the callback.
+  /// If the write failed, none of the messages of the batch have been sent:
+  /// the callback is called with the error for each of them.
   ///
   /// Warning: The instance must remain alive until messages are sent.
   /// You can provide a procedure transformation (`lifetimeTransfo`) that will
@@ -252,8 +381,9 @@ namespace qi { namespace sock {
       : _sending{false}
     {
     }
-    explicit SendMessageEnqueue(const S& socket)
+    explicit SendMessageEnqueue(const S& socket, SendBatchLimits limits = {})
       : _socket(socket)
+      , _batchLimits(limits)
       , _sending{false}
     {
     }
@@ -269,6 +399,7 @@ namespace qi { namespace sock {
       const F0& lifetimeTransfo = F0{}, const F1& syncTransfo = F1{});
   private:
     S _socket;
+    SendBatchLimits _batchLimits;
     /// A list is used because we need the iterators not to be invalidated by
     /// insertions at begin or end, which is not the case with deque.
     /// See [23.3.3.4 deque modifiers].
@@ -278,10 +409,10 @@ namespace qi { namespace sock {
   };
 
   // Lemma SendMessageEnqueue.0:
-  //  If a message is already being sent, the message is queued without
-  //  invalidating the one being sent.
+  //  If messages are already being sent, the message is queued without
+  //  invalidating the ones being sent.
   // Proof:
-  //  All messages are put in the send queue, including the one being sent.
+  //  All messages are put in the send queue, including the ones being sent.
   //  The send queue is a list so adding an element doesn't invalidate the other ones.
   template<typename N, typename S>
   template<typename Msg, typename Proc, typename F0, typename F1>
@@ -290,57 +421,62 @@ namespace qi { namespace sock {
   {
     qiLogDebug(logCategory()) << _socket.get() << " SendMessageEnqueue()(" << msg.type() << ": " << msg.address() << ", ssl=" << *ssl << ")";
     using I = decltype(_sendQueue.begin());
-    I itMsg;
+    using Batch = std::pair<I, std::size_t>;
+    Batch batch;
     bool mustStartSendLoop = false;
     {
       std::lock_guard<std::mutex> lock{_sendMutex};
       _sendQueue.emplace_back(std::forward<Msg>(msg));
-      itMsg = _sendQueue.begin();
       // We've just added a message to the queue, so if we are not currently sending,
       // we must (re)start the send loop.
       if (!_sending)
       {
         _sending = true;
         mustStartSendLoop = true;
+        batch = Batch{_sendQueue.begin(),
+                      batchCount(_sendQueue.begin(), _sendQueue.end(), _batchLimits)};
       }
     }
     if (mustStartSendLoop)
     {
       // Lemma SendMessageEnqueue.1:
-      //  When calling sendMessage, itMsg is still valid.
+      //  When calling sendMessages, the messages of the batch are still valid.
       // Proof:
       //  The send queue is a std::list, so inserting or erasing other elements
-      //  doesn't invalidate the iterator.
+      //  doesn't invalidate the iterators.
       //  Each thread adds a message to the send queue. But only one at a time
       //  can enter this branch (by tryRaiseAtomicFlag.0).
       //  Also, the sending flag is only modified while the queue is locked, so
       //  the scenario where a thread B adds a message to the queue, is suspended
       //  just before evaluating the condition of this branch, then the send loop
       //  thread A clears the queue, and then the thread B resumes, is correctly handled.
-      //  Moreover, this branch results in exactly one message being removed from
-      //  the send queue (by SendMessageEnqueue.2).
-      //  Therefore, at this point the number of messages in the send queue is
-      //  always at least 1.
+      //  Moreover, this branch results in exactly the messages of the batch
+      //  being removed from the send queue (by SendMessageEnqueue.2).
+      //  Therefore, at this point the send queue always contains at least the
+      //  messages of the batch.
 
       // Lemma SendMessageEnqueue.2:
-      //  eraseAndReturnNextMessage erases from the send queue the element pointed
-      //  by the given iterator, even if an exception is thrown.
+      //  eraseAndReturnNextBatch erases from the send queue the elements of the
+      //  given batch, even if an exception is thrown.
 
-      // This callback will be called when a message has been sent, or an error
-      // occurred. It passes an iterator on the sent message to the upper layer,
-      // which in return decides whether sending of the enqueued messaged must
-      // continue. Then, the callback erase the message.
-      auto eraseAndReturnNextMessage =
-        [&, onSent](ErrorCode<N> erc, I itSent) mutable -> boost::optional<I> {
+      // This callback will be called when a batch of messages has been sent,
+      // or an error occurred. It passes an iterator on each message of the
+      // batch to the upper layer, which in return decides whether sending of
+      // the enqueued messaged must continue. Then, the callback erases the
+      // messages.
+      auto eraseAndReturnNextBatch =
+        [&, onSent](ErrorCode<N> erc, I itFirst, std::size_t count) mutable -> boost::optional<Batch> {
           // It's ok to allow new sendings once the current one is complete.
           bool mustContinue = false;
-          boost::optional<I> itNext;
+          boost::optional<Batch> nextBatch;
           try
           {
             // A scoped is used to cope with potential exception thrown by onSent.
             auto scopedErase = ka::scoped([&] {
               std::lock_guard<std::mutex> lock{_sendMutex};
-              _sendQueue.erase(itSent);
+              auto itEnd = itFirst;
+              std::advance(itEnd, count);
+              _sendQueue.erase(itFirst, itEnd);
               if (!mustContinue || _sendQueue.empty())
               {
                 QI_ASSERT(_sending);
@@ -349,19 +485,26 @@ namespace qi { namespace sock {
                 _sending = false;
                 return;
               }
-              itNext = _sendQueue.begin();
+              nextBatch = Batch{_sendQueue.begin(),
+                                batchCount(_sendQueue.begin(), _sendQueue.end(), _batchLimits)};
             });
-            mustContinue = onSent(erc, itSent);
+            // On error, every message of the batch is unsent and must be
+            // reported as such, whatever the upper layer returns.
+            bool continueNotifying = true;
+            auto itSent = itFirst;
+            for (std::size_t i = 0u; (erc || continueNotifying) && i != count; ++i, ++itSent)
+              continueNotifying = onSent(erc, itSent) && continueNotifying;
+            mustContinue = continueNotifying;
           }
           catch (const std::exception& e)
           {
             qiLogError(logCategory()) << "Error in post-send phase: " << e.what();
             throw;
           }
-          return itNext;
+          return nextBatch;
         };
 
-      sendMessage<N>(_socket, itMsg, std::move(eraseAndReturnNextMessage), ssl,
+      sendMessages<N>(_socket, batch.first, batch.second, std::move(eraseAndReturnNextBatch), ssl,
         lifetimeTransfo, syncTransfo);
     }
   }
@@ -4,6 +4,7 @@
 */
 
 #include <boost/algorithm/string.hpp>
+#include <qi/getenv.hpp>
 
 #include "streamcontext.hpp"
 
@@ -17,6 +18,10 @@ namespace qi
     char const * const remoteCancelableCalls = "RemoteCancelableCalls";
     char const * const objectPtrUid          = "ObjectPtrUID";
     char const * const relativeEndpointUri   = "RelativeEndpointURI";
+    char const * const sharedMemoryPayload   = "SharedMemoryPayload";
+    char const * const sharedMemoryPayloadRing = "SharedMemoryPayloadRing";
+    char const * const sharedMemoryPayloadRingMapped = "SharedMemoryPayloadRingMapped";
+    char const * const metaObjectDigest      = "MetaObjectDigest";
   }
 
 
@@ -116,10 +121,15 @@ static void initCapabilities()
   , { capabilityname::remoteCancelableCalls, AnyValue::from(true)  }
   , { capabilityname::objectPtrUid         , AnyValue::from(true)  }
   , { capabilityname::relativeEndpointUri  , AnyValue::from(true)  }
+  , { capabilityname::metaObjectDigest     , AnyValue::from(true)  }
   };
 
   _defaultCapabilities = new CapabilityMap(defaultCaps);
 
+  // Passing payloads through shared memory bypasses the socket: it is opt-in.
+  if (qi::os::getEnvDefault("QI_SHM_PAYLOAD", false))
+    (*_defaultCapabilities)[capabilityname::sharedMemoryPayload] = AnyValue::from(os::getMachineId());
+
   // Process override from environment
   std::string capstring = qi::os::getenv("QI_TRANSPORT_CAPABILITIES");
   std::vector<std::string> caps;
@@ -41,6 +41,23 @@ using CapabilityMap = std::map<std::string, AnyValue>;
     // Capability: ServiceDirectory may add relative endpoints to services to the list of endpoints
     // in service information.
     QI_API extern char const * const relativeEndpointUri;
+
+    // Capability: large message payloads may be passed through shared memory.
+    // The value is the machine id of the end, payloads are only shared between
+    // ends of the same machine. It is only advertised if QI_SHM_PAYLOAD is set.
+    QI_API extern char const * const sharedMemoryPayload;
+
+    // Capability sent once connected: name of the shared memory ring in which
+    // the end writes the payloads it sends.
+    QI_API extern char const * const sharedMemoryPayloadRing;
+
+    // Capability sent once connected: name of the ring of the remote end that
+    // this end mapped. Payloads are only written to a ring once confirmed.
+    QI_API extern char const * const sharedMemoryPayloadRingMapped;
+
+    // Capability: the remote end only sends a metaobject when its digest
+    // differs from the one the client already knows.
+    QI_API extern char const * const metaObjectDigest;
   }
 
   /// State of the `RelativeEndpointsUri` capability.
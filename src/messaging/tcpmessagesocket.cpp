@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <string>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/lexical_cast.hpp>
@@ -6,6 +7,7 @@
 #include <qi/log.hpp>
 #include "sock/networkasio.hpp"
 #include "sock/option.hpp"
+#include "sock/connectedstate.hpp"
 
 #if BOOST_OS_WINDOWS
 # include <Winsock2.h> // needed by mstcpip.h
@@ -133,6 +135,29 @@ namespace qi {
 
 namespace qi { namespace sock {
 
+  namespace
+  {
+    /// Returns the value of the environment variable, or the default value if
+    /// it is not set or if it is invalid, in which case a warning is logged.
+    template<typename T>
+    T getEnvOrWarn(const char* name, T defaultValue)
+    {
+      const auto value = os::getenv(name);
+      if (value.empty())
+        return defaultValue;
+      try
+      {
+        return boost::lexical_cast<T>(value);
+      }
+      catch (const boost::bad_lexical_cast&)
+      {
+        qiLogWarning() << "Invalid value '" << value << "' for " << name
+                       << ", using the default value " << defaultValue << ".";
+        return defaultValue;
+      }
+    }
+  }
+
   boost::optional<qi::int64_t> getSocketTimeWarnThresholdFromEnv()
   {
     static const auto thresholdEnvVariable = os::getenv("QIMESSAGING_SOCKET_DISPATCH_TIME_WARN_THRESHOLD");
@@ -143,6 +168,27 @@ namespace qi { namespace sock {
     return warnThreshold;
   }
 
+  std::size_t getReceiveBufferSizeFromEnv()
+  {
+    static const auto bufferSize = [] {
+      const auto size = getEnvOrWarn("QI_MESSAGE_RECEIVE_BUFFER_SIZE", std::size_t(0));
+      // A non-null size must at least allow to receive a message header.
+      return size == 0u ? size : std::max(size, sizeof(Message::Header));
+    }();
+    return bufferSize;
+  }
+
+  SendBatchLimits getSendBatchLimitsFromEnv()
+  {
+    static const auto limits = [] {
+      SendBatchLimits l;
+      l.maxBytes = getEnvOrWarn("QI_MESSAGE_SEND_BATCH_MAX_BYTES", l.maxBytes);
+      l.maxBuffers = getEnvOrWarn("QI_MESSAGE_SEND_BATCH_MAX_BUFFERS", l.maxBuffers);
+      return l;
+    }();
+    return limits;
+  }
+
   void NetworkAsio::setSocketNativeOptions(
     boost::asio::ip::tcp::socket::native_handle_type socketNativeHandle, int timeoutInSeconds)
   {
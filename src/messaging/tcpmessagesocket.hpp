@@ -3,6 +3,7 @@
 #ifndef _SRC_TCPMESSAGESOCKET_HPP_
 #define _SRC_TCPMESSAGESOCKET_HPP_
 
+#include <atomic>
 #include <string>
 #include <functional>
 #include <memory>
@@ -18,6 +19,7 @@
 #include "message.hpp"
 #include "messagedispatcher.hpp"
 #include "messagesocket.hpp"
+#include "sharedmemorypayload_p.hpp"
 #include "sock/disconnectedstate.hpp"
 #include "sock/disconnectingstate.hpp"
 #include "sock/connectingstate.hpp"
@@ -295,6 +297,13 @@ namespace qi {
     using State = boost::variant<DisconnectedState, ConnectingState, ConnectedState, DisconnectingState>;
     State _state;
     boost::synchronized_value<Url> _url;
+    // Whether the remote end runs on this machine, as the same user when the
+    // transport tells it. Shared memory is used only with such ends.
+    std::atomic<bool> _localPeer{false};
+    // Written in `send` under the state lock, in the order messages are sent.
+    SharedMemoryRingWriter _sharedMemoryWriter;
+    // Read in `handleMessage`, in the order messages are received.
+    SharedMemoryRingReader _sharedMemoryReader;
 
     bool mustTreatAsServerAuthentication(const Message& msg) const;
     bool handleCapabilityMessage(const Message& msg);
@@ -394,6 +403,7 @@ namespace qi {
         return false;
       }
       auto self = shared_from_this();
+      _localPeer = N::isLocalPeer((*res.socket).lowest_layer());
       _state = ConnectedState(res.socket, _ssl, maxPayload, sock::HandleMessage<N, S>{self});
       auto& connected = asConnected(_state);
       connected.complete().then(connected.ioServiceStranded(
@@ -472,6 +482,7 @@ namespace qi {
         // Connecting was successful, so we enter the connected state (to be able
         // send and receive messages).
         static const auto maxPayload = getMaxPayloadFromEnv();
+        _localPeer = N::isLocalPeer((*res.socket).lowest_layer());
         _state = ConnectedState(res.socket, _ssl, maxPayload, sock::HandleMessage<N, S>{self});
         auto& connected = asConnected(_state);
         connected.complete().then(connected.ioServiceStranded(
@@ -574,8 +585,17 @@ namespace qi {
         AnyValue v{msg.value(typeOf<CapabilityMap>()->signature(), shared_from_this())};
         cm = v.to<CapabilityMap>();
       }
-      boost::mutex::scoped_lock lock(_contextMutex);
-      _remoteCapabilityMap.insert(cm.begin(), cm.end());
+      {
+        boost::mutex::scoped_lock lock(_contextMutex);
+        _remoteCapabilityMap.insert(cm.begin(), cm.end());
+      }
+      // Shared memory is never used over SSL, where payloads would bypass
+      // encryption, nor with ends that are not known to be local.
+      if (!*_ssl && _localPeer)
+      {
+        if (auto confirmation = _sharedMemoryReader.map(cm, *this))
+          send(std::move(*confirmation));
+      }
     }
     catch (const std::runtime_error& e)
     {
@@ -597,6 +617,11 @@ namespace qi {
   template<typename N, typename S>
   bool TcpMessageSocket<N, S>::handleMessage(Message msg)
   {
+    static const auto maxPayload = getMaxPayloadFromEnv();
+    if (!_sharedMemoryReader.unpack(msg, maxPayload))
+    {
+      return false;
+    }
     bool success = false;
     if (mustTreatAsServerAuthentication(msg) || msg.type() == Message::Type_Capability)
     {
@@ -653,6 +678,14 @@ namespace qi {
       QI_LOG_DEBUG_SOCKET(this) << "Socket must be connected to send().";
       return false;
     }
+    if (!*_ssl && _localPeer)
+    {
+      // The ring is advertised before the first large payload, which still goes
+      // through the socket, and used once the remote end confirmed it mapped it.
+      if (auto advertisement = _sharedMemoryWriter.advertise(msg, *this))
+        asConnected(_state).send(std::move(*advertisement), _ssl);
+      _sharedMemoryWriter.pack(msg, *this);
+    }
     // NOTE: Should we specify an `onSent` callback and stop sending if an error
     // occurred?
     asConnected(_state).send(std::move(msg), _ssl);
@@ -26,6 +26,7 @@ KA_WARNING_DISABLE(4355, )
 #include "transportserver.hpp"
 #include "messagesocket.hpp"
 #include "transportserverasio_p.hpp"
+#include "transportserverlocal_p.hpp"
 
 qiLogCategory("qimessaging.transportserver");
 
@@ -47,6 +48,12 @@ namespace qi
     {
       impl = TransportServerAsioPrivate::make(this, ctx);
     }
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    else if (url.protocol() == sock::localScheme())
+    {
+      impl = TransportServerLocalPrivate::make(this, ctx);
+    }
+#endif
     else
     {
       const char* s = "Unrecognized protocol to create the TransportServer.";
@@ -0,0 +1,160 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#include "transportserverlocal_p.hpp"
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <boost/make_shared.hpp>
+#include <qi/log.hpp>
+#include <qi/eventloop.hpp>
+#include "tcpmessagesocket.hpp"
+
+qiLogCategory("qimessaging.transportserver");
+
+namespace qi
+{
+  namespace
+  {
+    bool isSocketFile(const std::string& path)
+    {
+      struct ::stat status;
+      return ::stat(path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode);
+    }
+
+    /// A socket file that no process listens to is left by a process that
+    /// did not close its server, and may be replaced.
+    bool isStaleSocketFile(boost::asio::io_service& io, const std::string& path)
+    {
+      if (!isSocketFile(path))
+        return false;
+      boost::asio::local::stream_protocol::socket probe(io);
+      boost::system::error_code erc;
+      probe.connect(boost::asio::local::stream_protocol::endpoint(path), erc);
+      return erc == boost::asio::error::connection_refused;
+    }
+  }
+
+  TransportServerLocalPrivate::TransportServerLocalPrivate(TransportServer* self, EventLoop* ctx)
+    : TransportServerImpl(self, ctx)
+    , _acceptor(new sock::Acceptor<N>(*asIoServicePtr(ctx)))
+    , _live(true)
+    , _bound(false)
+    , _sslContext(sock::makeSslContextPtr<N>(sock::SslContext<N>::tlsv12))
+  {
+  }
+
+  boost::shared_ptr<TransportServerLocalPrivate> TransportServerLocalPrivate::make(
+      TransportServer* self,
+      EventLoop* ctx)
+  {
+    return boost::shared_ptr<TransportServerLocalPrivate>{
+      new TransportServerLocalPrivate(self, ctx) };
+  }
+
+  TransportServerLocalPrivate::~TransportServerLocalPrivate()
+  {
+  }
+
+  qi::Future<void> TransportServerLocalPrivate::listen(const qi::Url& url)
+  {
+    _path = url.host();
+    if (_path.empty())
+    {
+      const char* s = "Listen error: no path in the local socket URL.";
+      qiLogError() << s;
+      return qi::makeFutureError<void>(s);
+    }
+
+    auto& io = *asIoServicePtr(context);
+    if (isStaleSocketFile(io, _path))
+    {
+      qiLogVerbose() << "Removing stale socket file " << _path;
+      ::unlink(_path.c_str());
+    }
+
+    const boost::asio::local::stream_protocol::endpoint ep(_path);
+    boost::system::error_code ec;
+    _acceptor->open(ep.protocol(), ec);
+    if (!ec)
+    {
+      fcntl(_acceptor->native_handle(), F_SETFD, FD_CLOEXEC);
+      _acceptor->bind(ep, ec);
+    }
+    if (!ec)
+    {
+      _bound = true;
+      _acceptor->listen(boost::asio::socket_base::max_connections, ec);
+    }
+    if (ec)
+    {
+      std::stringstream ss;
+      ss << "failed to listen on " << _path << ": " << ec.message();
+      qiLogError("qimessaging.server.listen") << ss.str();
+      return qi::makeFutureError<void>(ss.str());
+    }
+
+    _listenUrl = sock::localUrl(_path);
+    {
+      boost::mutex::scoped_lock l(_endpointsMutex);
+      _endpoints.push_back(_listenUrl);
+    }
+    qiLogVerbose() << "TransportServer will listen on: " << _listenUrl.str();
+
+    accept();
+    _connectionPromise.setValue(0);
+    return _connectionPromise.future();
+  }
+
+  void TransportServerLocalPrivate::accept()
+  {
+    auto socket = sock::makeSocketWithContextPtr<N>(*asIoServicePtr(context), _sslContext);
+    auto self = shared_from_this();
+    _acceptor->async_accept(socket->next_layer().socket(),
+      [self, socket](const boost::system::error_code& erc) {
+        self->onAccept(erc, socket);
+      });
+  }
+
+  void TransportServerLocalPrivate::onAccept(const boost::system::error_code& erc,
+                                             sock::SocketWithContextPtr<N> socket)
+  {
+    boost::mutex::scoped_lock lock(_acceptCloseMutex);
+    if (!_live)
+      return;
+    if (erc)
+    {
+      qiLogDebug() << "accept error " << erc.message();
+      self->acceptError(erc.value());
+      if (erc == boost::asio::error::operation_aborted || erc == boost::asio::error::bad_descriptor)
+        return;
+    }
+    else
+    {
+      auto messageSocket = boost::make_shared<TcpMessageSocket<N>>(
+        *asIoServicePtr(context), sock::SslEnabled{false}, socket);
+      qiLogDebug() << "New local socket accepted: " << messageSocket.get();
+      self->newConnection(std::pair<MessageSocketPtr, Url>{ messageSocket, _listenUrl });
+    }
+    accept();
+  }
+
+  void TransportServerLocalPrivate::close()
+  {
+    qiLogDebug() << this << " close";
+    boost::mutex::scoped_lock l(_acceptCloseMutex);
+    if (!_live.exchange(false))
+      return;
+    boost::system::error_code ec;
+    _acceptor->close(ec);
+    if (_bound)
+      ::unlink(_path.c_str());
+  }
+}
+
+#endif // BOOST_ASIO_HAS_LOCAL_SOCKETS
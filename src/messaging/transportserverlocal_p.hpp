@@ -0,0 +1,68 @@
+#pragma once
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#ifndef _SRC_TRANSPORTSERVERLOCAL_P_HPP_
+#define _SRC_TRANSPORTSERVERLOCAL_P_HPP_
+
+#include <atomic>
+#include <memory>
+#include <boost/asio.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <qi/url.hpp>
+#include "sock/networkasiolocal.hpp"
+#include "sock/socketptr.hpp"
+#include "sock/sslcontextptr.hpp"
+#include "transportserver.hpp"
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+
+namespace qi
+{
+  /// Accepts connections on a local (unix domain) socket, listening on URLs
+  /// of the form `unix://<path>`.
+  ///
+  /// The socket file is created when listening, replacing any socket file
+  /// left by a previous process, and removed when closing.
+  class TransportServerLocalPrivate:
+      public TransportServerImpl,
+      public boost::enable_shared_from_this<TransportServerLocalPrivate>
+  {
+    TransportServerLocalPrivate(TransportServer* self, EventLoop* ctx);
+
+  public:
+    using N = sock::NetworkAsioLocal;
+
+    static boost::shared_ptr<TransportServerLocalPrivate> make(
+        TransportServer* self,
+        EventLoop* ctx);
+
+    virtual ~TransportServerLocalPrivate();
+
+    qi::Future<void> listen(const qi::Url& listenUrl) override;
+    void close() override;
+
+  private:
+    void accept();
+    void onAccept(const boost::system::error_code& erc,
+                  sock::SocketWithContextPtr<N> socket);
+
+    std::unique_ptr<sock::Acceptor<N>> _acceptor;
+    std::atomic<bool> _live;
+    bool _bound;
+    // Local connections are never encrypted: the context is only required by
+    // the socket interface.
+    sock::SslContextPtr<N> _sslContext;
+    std::string _path;
+    Url _listenUrl;
+
+    // The server must avoid being closed while accepting a connection.
+    boost::mutex _acceptCloseMutex;
+  };
+}
+
+#endif // BOOST_ASIO_HAS_LOCAL_SOCKETS
+
+#endif  // _SRC_TRANSPORTSERVERLOCAL_P_HPP_
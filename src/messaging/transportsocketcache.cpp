@@ -20,6 +20,8 @@
 static constexpr auto noReachableEndpointErrorMessage
   = "No reachable endpoint was found for this service.";
 
+static constexpr auto localSocketScheme = "unix";
+
 qiLogCategory(LOG_CATEGORY);
 
 namespace qi
@@ -114,6 +116,17 @@ bool isLocalHost(const std::string& host)
   return boost::algorithm::starts_with(host, "127.") || host == "localhost";
 }
 
+static std::vector<Uri> local_socket_only(const std::vector<Uri>& input)
+{
+  std::vector<Uri> result;
+  for (const auto& uri: input)
+  {
+    if (uri.scheme() == localSocketScheme)
+      result.push_back(uri);
+  }
+  return result;
+}
+
 static std::vector<Uri> localhost_only(const std::vector<Uri>& input)
 {
   std::vector<Uri> result;
@@ -135,9 +148,19 @@ Future<MessageSocketPtr> TransportSocketCache::socket(const ServiceInfo& servInf
   bool local = machineId == os::getMachineId();
   std::vector<Uri> connectionCandidates;
 
-  // If the connection is local, we're mainly interested in localhost endpoint
+  // If the connection is local, we're mainly interested in local socket
+  // endpoints, that bypass the TCP stack, then in localhost endpoints. These
+  // are also tried if connecting to the local socket ones fails (for instance
+  // because of a stale socket file).
   if (local)
-    connectionCandidates = localhost_only(servInfo.uriEndpoints());
+  {
+    connectionCandidates = local_socket_only(servInfo.uriEndpoints());
+    auto localhostCandidates = localhost_only(servInfo.uriEndpoints());
+    if (connectionCandidates.size() == 0)
+      connectionCandidates = std::move(localhostCandidates);
+    else
+      couple->fallbackCandidates = std::move(localhostCandidates);
+  }
 
   // If the connection isn't local or if the service doesn't expose local endpoints,
   // try and connect to whatever is available.
@@ -171,28 +194,41 @@ Future<MessageSocketPtr> TransportSocketCache::socket(const ServiceInfo& servInf
     }
     // Otherwise, we keep track of all those URIs and assign them the same promise in our map.
     // They will all track the same connection.
-    couple->attemptCount = qi::numericConvert<int>(connectionCandidates.size());
-    auto& uriMap = _connections[machineId];
-    for (const auto& uri: connectionCandidates)
+    connectCandidates(couple, connectionCandidates, servInfo);
+  }
+  return couple->promise.future();
+}
+
+void TransportSocketCache::connectCandidates(ConnectionAttemptPtr attempt,
+                                             const std::vector<Uri>& candidates,
+                                             const ServiceInfo& info)
+{
+  const std::string& machineId = info.machineId();
+  const bool local = machineId == os::getMachineId();
+  attempt->attemptCount = qi::numericConvert<int>(candidates.size());
+  auto& uriMap = _connections[machineId];
+  for (const auto& uri: candidates)
+  {
+    const auto scheme = uri.scheme();
+    // Only these protocols are supported for message sockets.
+    if (scheme == localSocketScheme)
     {
-      const auto scheme = uri.scheme();
-      // Only these protocols are supported for message sockets.
-      if (scheme != "tcp" && scheme != "tcps")
-        continue;
-
-      if (!local && isLoopbackAddress((*uri.authority()).host()))
-        continue; // Do not try to connect on localhost when it is a remote!
-
-      uriMap[uri] = couple;
-      MessageSocketPtr socket = makeMessageSocket(scheme);
-      _allPendingConnections.push_back(socket);
-      Future<void> sockFuture = socket->connect(toUrl(uri));
-      qiLogDebug() << "Inserted [" << machineId << "][" << uri << "]";
-      sockFuture.then(std::bind(&TransportSocketCache::onSocketParallelConnectionAttempt, this,
-                                std::placeholders::_1, socket, uri, servInfo));
+      if (!local)
+        continue; // Local sockets of a remote machine are unreachable.
     }
+    else if (scheme != "tcp" && scheme != "tcps")
+      continue;
+    else if (!local && isLoopbackAddress((*uri.authority()).host()))
+      continue; // Do not try to connect on localhost when it is a remote!
+
+    uriMap[uri] = attempt;
+    MessageSocketPtr socket = makeMessageSocket(scheme);
+    _allPendingConnections.push_back(socket);
+    Future<void> sockFuture = socket->connect(toUrl(uri));
+    qiLogDebug() << "Inserted [" << machineId << "][" << uri << "]";
+    sockFuture.then(std::bind(&TransportSocketCache::onSocketParallelConnectionAttempt, this,
+                              std::placeholders::_1, socket, uri, info));
   }
-  return couple->promise.future();
 }
 
 FutureSync<void> TransportSocketCache::disconnect(MessageSocketPtr socket)
@@ -332,6 +368,15 @@ void TransportSocketCache::onSocketParallelConnectionAttempt(Future<void> fut,
       // It's a critical error if we've exhausted all available endpoints.
       if (attempt->attemptCount == 0)
       {
+        if (!attempt->fallbackCandidates.empty())
+        {
+          qiLogVerbose() << "Could not connect to service #" << info.serviceId()
+                         << " through its local socket endpoints, trying its localhost endpoints.";
+          const auto candidates = std::move(attempt->fallbackCandidates);
+          attempt->fallbackCandidates.clear();
+          connectCandidates(attempt, candidates, info);
+          return;
+        }
         std::stringstream err;
         err << "Could not connect to service #" << info.serviceId() << ": no endpoint replied.";
         qiLogError() << err.str();
@@ -84,6 +84,8 @@ namespace qi
       Promise<MessageSocketPtr> promise;
       MessageSocketPtr endpoint;
       std::vector<Uri> relatedUris;
+      /// Endpoints to try once all the attempts on the current ones failed.
+      std::vector<Uri> fallbackCandidates;
       int attemptCount = 0;
       State state = State_Pending;
       SignalLink disconnectionTracking = SignalBase::invalidSignalLink;
@@ -92,6 +94,12 @@ namespace qi
 
     void checkClear(ConnectionAttemptPtr, const std::string& machineId);
 
+    /// Tries to connect to each of the candidates, on behalf of the attempt.
+    /// `_socketMutex` must be locked.
+    void connectCandidates(ConnectionAttemptPtr attempt,
+                           const std::vector<Uri>& candidates,
+                           const ServiceInfo& info);
+
     /// The promise is set when the `disconnected` signal of `socket` has been received.
     struct DisconnectInfo
     {
@@ -3,7 +3,10 @@
 **  See COPYING for the license
 */
 #include <atomic>
+#include <thread>
 #include <boost/atomic.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/optional.hpp>
 #include <boost/thread/synchronized_value.hpp>
 #include <boost/container/flat_map.hpp>
 
@@ -13,6 +16,7 @@
 #include <qi/future.hpp>
 #include <qi/getenv.hpp>
 
+
 qiLogCategory("qi.strand");
 
 namespace qi {
@@ -134,24 +138,137 @@ enum class StrandPrivate::State
   // we don't care about finished state
 };
 
-struct StrandPrivate::Callback
+namespace detail
+{
+  // Link of the intrusive queue of callbacks of a strand.
+  struct StrandQueueNode
+  {
+    std::atomic<StrandQueueNode*> next{nullptr};
+  };
+}
+
+struct StrandPrivate::Callback : detail::StrandQueueNode
 {
   uint32_t id;
-  State state;
+  std::atomic<State> state{State::None};
   boost::function<void()> callback;
-  qi::Promise<void> promise;
-  qi::Future<void> asyncFuture;
+  // Only set if a future of the callback is returned to the caller.
+  boost::optional<qi::Promise<void>> promise;
+  // Set if the callback is deferred with a delay. Protected by the strand mutex.
+  boost::optional<qi::Future<void>> asyncFuture;
+  bool deferred = false;
   ExecutionOptions executionOptions;
+  // Reference held by the queue while the callback is in it.
+  boost::shared_ptr<Callback> self;
+
+  void setValue()
+  {
+    if (promise)
+      promise->setValue(nullptr);
+  }
+
+  void setError(const std::string& error)
+  {
+    if (promise)
+      promise->setError(error);
+  }
+
+  void trySetError(const std::string& error)
+  {
+    if (promise)
+      qi::trySetError(*promise, error);
+  }
+
+  void setCanceled()
+  {
+    if (promise)
+      promise->setCanceled();
+  }
 };
 
+/// Intrusive lock-free multi-producer single-consumer queue of callbacks,
+/// after Dmitry Vyukov's algorithm.
+///
+/// Pushing is wait-free. Popping is done with the strand mutex locked, by the
+/// processing of the strand or by its joining. A callback is kept alive by the
+/// queue through its `self` member.
+class StrandPrivate::Queue
+{
+  using Node = detail::StrandQueueNode;
+
+public:
+  Queue()
+    : _head(&_stub)
+    , _tail(&_stub)
+  {
+  }
+
+  Queue(const Queue&) = delete;
+  Queue& operator=(const Queue&) = delete;
+
+  ~Queue()
+  {
+    while (pop()) {}
+  }
+
+  void push(boost::shared_ptr<Callback> cbStruct)
+  {
+    Callback* const node = cbStruct.get();
+    node->self = std::move(cbStruct);
+    pushNode(node);
+  }
+
+  /// Returns null if the queue is empty, or if the callback following the
+  /// last popped one is being pushed.
+  boost::shared_ptr<Callback> pop()
+  {
+    Node* head = _head;
+    Node* next = head->next.load(std::memory_order_acquire);
+    if (head == &_stub)
+    {
+      if (!next)
+        return {};
+      _head = next;
+      head = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+    if (!next)
+    {
+      if (head != _tail.load(std::memory_order_acquire))
+        return {};
+      // The head is the last node: push the stub behind it so that it can be
+      // unlinked.
+      pushNode(&_stub);
+      next = head->next.load(std::memory_order_acquire);
+      if (!next)
+        return {};
+    }
+    _head = next;
+    return std::move(static_cast<Callback*>(head)->self);
+  }
+
+private:
+  void pushNode(Node* node)
+  {
+    node->next.store(nullptr, std::memory_order_relaxed);
+    Node* const prev = _tail.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+  }
+
+  Node _stub;
+  Node* _head; // Only accessed by the consumer.
+  std::atomic<Node*> _tail;
+};
 
 StrandPrivate::StrandPrivate(qi::ExecutionContext& executor)
   : _executor(executor)
   , _curId(0)
   , _aliveCount(0)
+  , _pendingCount(0)
   , _processing(false)
   , _processingThread(0)
   , _dying(false)
+  , _queue(new Queue())
   , _deferredTasksFutures{ std::make_shared<ScopedPromiseGroup>() }
 {
 }
@@ -193,22 +310,10 @@ void StrandPrivate::join() QI_NOEXCEPT(true)
   qiLogDebug() << "Strand joining (" << this << ") -> Joining starts : processing=" << _processing
     << ", size=" << _aliveCount << ")";
 
+  // The processing checks that the strand is not dying before popping a task
+  // with the mutex locked, it will not pop any task anymore.
   qiLogDebug() << "Strand joining (" << this << ") -> clearing scheduled tasks...";
-  for (auto&& task : _queue)
-  {
-    if (task->state == StrandPrivate::State::Canceled)
-      continue;
-    QI_ASSERT(task->state == StrandPrivate::State::Scheduled);
-
-    const auto errorMsg = safeInvoke([&]{
-      task->promise.setError(dyingStrandMessage);
-    });
-    if (errorMsg)
-    {
-      qiLogWarning() << "Error when setting promise in error: " << *errorMsg;
-    }
-  }
-  _queue.clear();
+  clearQueue();
 
   qiLogDebug() << "Strand joining (" << this << ") -> clearing deferred tasks...";
   _deferredTasksFutures.reset();
@@ -220,14 +325,33 @@ void StrandPrivate::join() QI_NOEXCEPT(true)
   joined = true;
 }
 
+// Precondition: the mutex is locked and the strand is dying.
+void StrandPrivate::clearQueue()
+{
+  while (auto task = _queue->pop())
+  {
+    auto state = State::Scheduled;
+    if (!task->state.compare_exchange_strong(state, State::Canceled))
+    {
+      QI_ASSERT(state == State::Canceled);
+      continue;
+    }
 
+    const auto errorMsg = safeInvoke([&]{
+      task->trySetError(dyingStrandMessage);
+    });
+    if (errorMsg)
+    {
+      qiLogWarning() << "Error when setting promise in error: " << *errorMsg;
+    }
+  }
+}
 
 boost::shared_ptr<StrandPrivate::Callback> StrandPrivate::createCallback(boost::function<void()> cb, ExecutionOptions options)
 {
   ++_aliveCount;
   boost::shared_ptr<Callback> cbStruct = boost::make_shared<Callback>();
   cbStruct->id = ++_curId;
-  cbStruct->state = State::None;
   cbStruct->callback = std::move(cb);
   cbStruct->executionOptions = options;
   return cbStruct;
@@ -250,7 +374,6 @@ Future<void> StrandPrivate::asyncDelayImpl(boost::function<void()> cb, qi::Durat
 
 Future<void> StrandPrivate::deferImpl(boost::function<void()> cb, qi::Duration delay, ExecutionOptions options)
 {
-  boost::recursive_mutex::scoped_lock lock(_mutex);
   if (_dying)
   {
     qiLogDebug() << this << " strand is dying, stopping defer call";
@@ -262,96 +385,94 @@ Future<void> StrandPrivate::deferImpl(boost::function<void()> cb, qi::Duration d
   cbStruct->promise = qi::Promise<void>(
     ka::scope_lock_proc(boost::bind(&StrandPrivate::cancel, this, cbStruct),
                         ka::mutable_store(weak_from_this())));
+  auto future = cbStruct->promise->future();
 
   qiLogDebug() << "Deferring job id " << cbStruct->id << " in " << qi::to_string(delay);
   if (delay.count())
   {
+    boost::recursive_mutex::scoped_lock lock(_mutex);
+    if (_dying)
+    {
+      qiLogDebug() << this << " strand is dying, stopping defer call";
+      --_aliveCount;
+      return makeFutureError<void>(dyingStrandMessage);
+    }
+    cbStruct->deferred = true;
     cbStruct->asyncFuture = _executor.asyncDelay(track([=]{
       enqueue(cbStruct, options);
     }), delay, options).then(ka::constant_function());
-    _deferredTasksFutures->add(cbStruct->promise);
+    _deferredTasksFutures->add(*cbStruct->promise);
   }
   else
     enqueue(cbStruct, options);
-  return cbStruct->promise.future();
+  return future;
 }
 
 void StrandPrivate::enqueue(boost::shared_ptr<Callback> cbStruct, ExecutionOptions options)
 {
-  const bool shouldschedule = [&]()
+  qiLogDebug() << "Enqueueing job id " << cbStruct->id;
+
+  if (cbStruct->deferred)
   {
     boost::recursive_mutex::scoped_lock lock(_mutex);
-    qiLogDebug() << "Enqueueing job id " << cbStruct->id;
-
-    if (_dying)
-    {
-      trySetError(cbStruct->promise, dyingStrandMessage);
-      qiLogDebug() << "Strand is dying on job id " << cbStruct->id;
-      return false;
-    }
+    if (_deferredTasksFutures)
+      _deferredTasksFutures->remove(cbStruct->promise->future().uniqueId());
+  }
 
-    auto scheduleCallback = [&] {
-      _queue.push_back(cbStruct);
-      cbStruct->state = State::Scheduled;
-    };
+  if (_dying)
+  {
+    cbStruct->trySetError(dyingStrandMessage);
+    qiLogDebug() << "Strand is dying on job id " << cbStruct->id;
+    return;
+  }
 
-    // the callback may have been canceled
-    if (cbStruct->state == State::None)
-    {
-      qiLogDebug() << "Strand callback state is None on job id " << cbStruct->id;
-      scheduleCallback();
-    }
-    else
-    {
-      QI_ASSERT(cbStruct->state == State::Canceled);
-      if (options.onCancelRequested == CancelOption::NeverSkipExecution)
-      {
-        qiLogDebug() << "Job was canceled but is specified as never skipped - will execute";
-        scheduleCallback();
-      }
-      else
-      {
-        qiLogDebug() << "Job was canceled, dropping";
-        return false;
-      }
-    }
-    // if process was not scheduled yet, do it, there is work to do
-    if (!_processing)
+  // the callback may have been canceled
+  auto state = State::None;
+  if (!cbStruct->state.compare_exchange_strong(state, State::Scheduled))
+  {
+    QI_ASSERT(state == State::Canceled);
+    if (options.onCancelRequested != CancelOption::NeverSkipExecution)
     {
-      qiLogDebug() << "Schedule process on job id " << cbStruct->id;
-      _processing = true;
-      if (cbStruct->asyncFuture.isValid())
-      {
-        _deferredTasksFutures->remove(cbStruct->promise.future().uniqueId());
-      }
-      return true;
+      qiLogDebug() << "Job was canceled, dropping";
+      return;
     }
+    qiLogDebug() << "Job was canceled but is specified as never skipped - will execute";
+  }
 
-    return false;
-  }();
+  _queue->push(std::move(cbStruct));
+
+  // The strand may have been joined between the check above and the push, in
+  // which case the queue has already been cleared and will not be processed
+  // anymore: clear it again. `join` sets the flag before clearing the queue,
+  // so either it pops this callback or we see the flag here.
+  if (_dying)
+  {
+    boost::recursive_mutex::scoped_lock lock(_mutex);
+    qiLogDebug() << "Strand died while enqueueing job, clearing the queue";
+    clearQueue();
+    return;
+  }
 
-  if (shouldschedule)
+  // if process was not scheduled yet, do it, there is work to do
+  if (_pendingCount.fetch_add(1) == 0)
   {
     qiLogDebug() << "StrandPrivate::process was not scheduled, doing it";
     _executor.async(track([=]{ process(); }), options);
   }
 }
 
-void StrandPrivate::stopProcess(boost::recursive_mutex::scoped_lock& lock,
-                                bool finished)
+void StrandPrivate::startProcess()
 {
-  // if we still have work
-  if (!finished && !_dying)
-  {
-    qiLogDebug() << "Strand quantum expired, rescheduling";
-    lock.unlock();
-    _executor.async(track([=] { process(); }));
-  }
-  else
-  {
-    _processing = false;
-    _processFinished.notify_all();
-  }
+  _processingThread = qi::os::gettid();
+  _processing = true;
+}
+
+void StrandPrivate::stopProcess()
+{
+  _processingThread = 0;
+  boost::recursive_mutex::scoped_lock lock(_mutex);
+  _processing = false;
+  _processFinished.notify_all();
 }
 
 void StrandPrivate::process()
@@ -361,120 +482,132 @@ void StrandPrivate::process()
 
   qiLogDebug() << "StrandPrivate::process started";
 
-  _processingThread = qi::os::gettid();
+  startProcess();
 
   qi::SteadyClockTimePoint start = qi::SteadyClock::now();
 
   do
   {
     boost::shared_ptr<Callback> cbStruct;
+    while (true)
     {
-      boost::recursive_mutex::scoped_lock lock(_mutex);
-      if (_dying)
       {
-        qiLogDebug() << this << " strand is dying, stopping process";
-        break;
+        boost::recursive_mutex::scoped_lock lock(_mutex);
+        if (_dying)
+        {
+          qiLogDebug() << this << " strand is dying, stopping process";
+          lock.unlock();
+          stopProcess();
+          return;
+        }
+
+        QI_ASSERT(_pendingCount.load() != 0);
+        if ((cbStruct = _queue->pop()))
+          break;
       }
+      // The count is incremented after the push, so the callback is in the
+      // queue, but it may not be linked to the previous one yet. Wait for it
+      // without the lock, that `join` and the enqueueing of jobs may need.
+      std::this_thread::yield();
+    }
 
-      QI_ASSERT(_processing);
-      if (_queue.empty())
-      {
-        qiLogDebug() << "Queue empty, stopping";
-        stopProcess(lock, true);
-        _processingThread = 0;
-        return;
+    auto state = State::Scheduled;
+    if (cbStruct->state.compare_exchange_strong(state, State::Running)
+    || (state == State::Canceled && cbStruct->executionOptions.onCancelRequested == CancelOption::NeverSkipExecution))
+    {
+      --_aliveCount;
+      cbStruct->state = State::Running;
+
+      qiLogDebug() << "Executing job id " << cbStruct->id;
+      try {
+        cbStruct->callback();
+        cbStruct->setValue();
       }
-      cbStruct = _queue.front();
-      _queue.pop_front();
-      if (cbStruct->state == State::Scheduled
-      || (cbStruct->state == State::Canceled && cbStruct->executionOptions.onCancelRequested == CancelOption::NeverSkipExecution))
-      {
-        --_aliveCount;
-        cbStruct->state = State::Running;
+      catch (std::exception& e) {
+        cbStruct->setError(e.what());
       }
-      else
-      {
-        // Job was canceled, cancel() already has done --_aliveCount
-        qiLogDebug() << "Abandoning job id " << cbStruct->id
-          << ", state: " << static_cast<int>(cbStruct->state);
-        continue;
+      catch (...) {
+        cbStruct->setError("callback has thrown in strand");
       }
+      qiLogDebug() << "Finished job id " << cbStruct->id;
     }
-    qiLogDebug() << "Executing job id " << cbStruct->id;
-    try {
-      cbStruct->callback();
-      cbStruct->promise.setValue(0);
+    else
+    {
+      // Job was canceled, cancel() already has done --_aliveCount
+      qiLogDebug() << "Abandoning job id " << cbStruct->id
+        << ", state: " << static_cast<int>(state);
     }
-    catch (std::exception& e) {
-      cbStruct->promise.setError(e.what());
+
+    // Only the processing decrements the count, it cannot reach 0 behind our back.
+    if (_pendingCount.load() == 1)
+    {
+      stopProcess();
+      if (_pendingCount.fetch_sub(1) == 1)
+      {
+        qiLogDebug() << "Queue empty, stopping";
+        return;
+      }
+      // Some callback has been pushed meanwhile, we are still in charge.
+      startProcess();
     }
-    catch (...) {
-      cbStruct->promise.setError("callback has thrown in strand");
+    else
+    {
+      --_pendingCount;
     }
-    qiLogDebug() << "Finished job id " << cbStruct->id;
   } while (qi::SteadyClock::now() - start < qi::MicroSeconds(QI_STRAND_QUANTUM_US));
 
-  _processingThread = 0;
-
+  stopProcess();
+  if (!_dying)
   {
-    boost::recursive_mutex::scoped_lock lock(_mutex);
-    stopProcess(lock, false);
+    qiLogDebug() << "Strand quantum expired, rescheduling";
+    _executor.async(track([=] { process(); }));
   }
 }
 
 void StrandPrivate::cancel(boost::shared_ptr<Callback> cbStruct)
 {
-  boost::recursive_mutex::scoped_lock lock(_mutex);
-
   if (_dying)
   {
     qiLogDebug() << this << " strand is dying, stopping task cancellation";
-    trySetError(cbStruct->promise, dyingStrandMessage);
+    cbStruct->trySetError(dyingStrandMessage);
     return;
   }
 
-  switch (cbStruct->state)
+  const bool skipExecution =
+    cbStruct->executionOptions.onCancelRequested != CancelOption::NeverSkipExecution;
+
+  auto state = State::None;
+  if (cbStruct->state.compare_exchange_strong(state, State::Canceled))
   {
-    case State::None:
-      qiLogDebug() << "Not scheduled yet, canceling future";
-      cbStruct->asyncFuture.cancel();
-      cbStruct->state = State::Canceled;
-      if(cbStruct->executionOptions.onCancelRequested != CancelOption::NeverSkipExecution)
-      {
-        --_aliveCount;
-        cbStruct->promise.setCanceled();
-      }
-      break;
-    case State::Scheduled:
-      qiLogDebug() << "Was scheduled, removing it from queue";
-      if (cbStruct->executionOptions.onCancelRequested != CancelOption::NeverSkipExecution)
-      {
-        bool erased = false;
-        for (Queue::iterator iter = _queue.begin(); iter != _queue.end(); ++iter)
-          if ((*iter)->id == cbStruct->id)
-          {
-            _queue.erase(iter);
-            erased = true;
-            break;
-          }
-        // state was scheduled, so the callback must be there
-        QI_ASSERT(erased);
-        // Silence compile warning unused erased
-        (void)erased;
-
-        --_aliveCount;
-        cbStruct->promise.setCanceled();
-      }
-      else
-      {
-        cbStruct->state = State::Canceled;
-      }
-      break;
-    default:
-      qiLogDebug() << "State is " << static_cast<int>(cbStruct->state)
-        << ", too late for canceling";
-      break;
+    qiLogDebug() << "Not scheduled yet, canceling future";
+    {
+      boost::recursive_mutex::scoped_lock lock(_mutex);
+      if (cbStruct->asyncFuture)
+        cbStruct->asyncFuture->cancel();
+    }
+    if (skipExecution)
+    {
+      --_aliveCount;
+      cbStruct->setCanceled();
+    }
+    return;
+  }
+
+  if (state == State::Scheduled
+      && cbStruct->state.compare_exchange_strong(state, State::Canceled))
+  {
+    // The callback stays in the queue, the processing will abandon it.
+    qiLogDebug() << "Was scheduled, it will be dropped from the queue";
+    if (skipExecution)
+    {
+      --_aliveCount;
+      cbStruct->setCanceled();
+    }
+    return;
   }
+
+  qiLogDebug() << "State is " << static_cast<int>(state)
+    << ", too late for canceling";
 }
 
 bool StrandPrivate::isInThisContext() const
@@ -567,7 +700,8 @@ void Strand::postImpl(boost::function<void()> callback, ExecutionOptions options
   auto prv = boost::atomic_load(&_p);
   if (prv)
   {
-    // As no future will be returned, we need to at least log the user if a problem occured.
+    // As no future will be returned, no promise is created for the callback,
+    // but we need to at least log the user if a problem occured.
     prv->enqueue(prv->createCallback([=] {
       auto errorLogger = ka::compose([](const std::string& msg) {
         qiLogWarning() << "Uncaught error in task posted in a strand: " << msg;
@@ -5,6 +5,7 @@
 
 #include <qi/anyobject.hpp>
 #include <memory>
+#include "calltrace_p.hpp"
 
 #include <ka/macro.hpp>
 KA_WARNING_PUSH()
@@ -96,8 +97,27 @@ inline void call(qi::Promise<AnyReference>& out,
 {
   bool stats = context && context.isStatsEnabled();
   bool trace = context && context.isTraceEnabled();
+  bool binaryTrace = context && context.asGenericObject()->isBinaryTraceEnabled();
   qi::AnyReference retref;
   int tid = 0; // trace call id, reused for result sending
+  CallTraceEvent binaryEvent;
+  if (binaryTrace)
+  {
+    const auto object = context.asGenericObject();
+    binaryEvent.objectUid = object->traceUid();
+    binaryEvent.id = detail::nextCallTraceId();
+    binaryEvent.kind = EventTrace::Event_Call;
+    binaryEvent.slotId = methodId;
+    binaryEvent.timestamp = detail::callTraceTimestamp();
+    binaryEvent.postTimestamp = postTimestamp.tv_sec * 1000000LL + postTimestamp.tv_usec;
+    binaryEvent.userUsTime = 0;
+    binaryEvent.systemUsTime = 0;
+    binaryEvent.callerContext = callerContext;
+    binaryEvent.calleeContext = qi::os::gettid();
+    binaryEvent.argumentsDigest =
+      object->_sampleTraceArguments() ? detail::callArgumentsDigest(params) : 0;
+    detail::recordCallTraceEvent(binaryEvent);
+  }
   if (trace)
   {
     tid = context.asGenericObject()->_nextTraceId();
@@ -135,7 +155,7 @@ inline void call(qi::Promise<AnyReference>& out,
 
   qi::int64_t time = stats?qi::os::ustime():0;
   std::pair<int64_t, int64_t> cputime, cpuendtime;
-  if (stats||trace)
+  if (stats||trace||binaryTrace)
      cputime = qi::os::cputime();
 
   bool success = false;
@@ -162,13 +182,23 @@ inline void call(qi::Promise<AnyReference>& out,
     out.setError("Unknown exception caught.");
   }
 
-  if (stats||trace)
+  if (stats||trace||binaryTrace)
   {
     cpuendtime = qi::os::cputime();
     cpuendtime.first -= cputime.first;
     cpuendtime.second -= cputime.second;
   }
 
+  if (binaryTrace)
+  {
+    binaryEvent.kind = success ? EventTrace::Event_Result : EventTrace::Event_Error;
+    binaryEvent.timestamp = detail::callTraceTimestamp();
+    binaryEvent.userUsTime = cpuendtime.first;
+    binaryEvent.systemUsTime = cpuendtime.second;
+    binaryEvent.argumentsDigest = 0;
+    detail::recordCallTraceEvent(binaryEvent);
+  }
+
   if (stats)
     context.asGenericObject()->pushStats(methodId, (float)(qi::os::ustime() - time)/1e6f,
                        (float)cpuendtime.first / 1e6f,
@@ -16,9 +16,17 @@
 #include <qi/type/typedispatcher.hpp>
 #include <qi/types.hpp>
 #include <qi/numeric.hpp>
+#include <qi/getenv.hpp>
 #include <ka/scoped.hpp>
+#include <ka/utility.hpp>
+#include <boost/thread/mutex.hpp>
+#include <map>
+#include <memory>
+#include <set>
+#include <unordered_map>
 #include <vector>
 #include <cstring>
+#include <limits>
 
 qiLogCategory("qitype.binarycoder");
 
@@ -216,6 +224,49 @@ namespace qi {
     }
   }
 
+  void BinaryDecoder::read(StringView& s)
+  {
+    std::uint32_t sz = 0;
+    read(sz);
+
+    s = StringView();
+    if (sz) {
+      BufferReader& reader = bufferReader();
+      const size_t offset = reader.position();
+      if (!readRaw(sz)) {
+        qiLogError() << "Read past end";
+        setStatus(Status::ReadPastEnd);
+        return;
+      }
+      s = StringView(BufferView(reader.buffer(), offset, sz));
+    }
+  }
+
+  void BinaryDecoder::read(BufferView& view)
+  {
+    BufferReader& reader = bufferReader();
+    if (reader.hasSubBuffer())
+    {
+      view = BufferView(reader.subBuffer());
+      return;
+    }
+    uint32_t sz = 0;
+    read(sz);
+
+    // As for StringView, a read past the end is reported by the status of the
+    // decoder, which decodeBinary turns into an exception.
+    view = BufferView();
+    if (sz) {
+      const size_t offset = reader.position();
+      if (!readRaw(sz)) {
+        qiLogError() << "Read past end";
+        setStatus(Status::ReadPastEnd);
+        return;
+      }
+      view = BufferView(reader.buffer(), offset, sz);
+    }
+  }
+
   // Output
   BinaryEncoder::BinaryEncoder(qi::Buffer &buffer)
     : _p(new BinaryEncoderPrivate(buffer))
@@ -417,6 +468,85 @@ namespace qi {
 
   namespace detail {
 
+    // Size in bytes of the elements of a list that can be copied as a whole
+    // block to and from the binary format, or 0 if they must be visited one
+    // by one.
+    // The binary format stores arithmetic values with the representation
+    // they have in memory, so a contiguous array of them is its own
+    // serialization.
+    static std::size_t bulkElementSize(TypeInterface* elementType)
+    {
+      switch (elementType->kind())
+      {
+        case TypeKind_Int:
+          // Booleans have size 0.
+          return static_cast<IntTypeInterface*>(elementType)->size();
+        case TypeKind_Float:
+          return static_cast<FloatTypeInterface*>(elementType)->size();
+        default:
+          return 0;
+      }
+    }
+
+    static void writeInt(BinaryEncoder& out, int64_t value, bool isSigned, int byteSize)
+    {
+      switch((isSigned ? 1 : -1) * byteSize)
+      {
+        case 0:  out.write(static_cast<bool>(!!value));  break;
+        case 1:  out.write(static_cast<int8_t>(value));  break;
+        case -1: out.write(static_cast<uint8_t>(value)); break;
+        case 2:  out.write(static_cast<int16_t>(value)); break;
+        case -2: out.write(static_cast<uint16_t>(value));break;
+        case 4:  out.write(static_cast<int32_t>(value)); break;
+        case -4: out.write(static_cast<uint32_t>(value));break;
+        case 8:  out.write(static_cast<int64_t>(value)); break;
+        case -8: out.write(static_cast<uint64_t>(value));break;
+        default: {
+          std::stringstream ss;
+          ss << "Unknown integer type " << isSigned << " " << byteSize;
+          throw std::runtime_error(ss.str());
+        }
+      }
+    }
+
+    static void writeFloat(BinaryEncoder& out, double value, int byteSize)
+    {
+      if (byteSize == 4)
+        out.write(numericConvert<float>(value));
+      else if (byteSize == 8)
+        out.write(value);
+      else {
+        std::stringstream ss;
+        ss << "serialize on unknown float type " << byteSize;
+        throw std::runtime_error(ss.str());
+      }
+    }
+
+    // Appends `count` elements of `elementSize` bytes to the list with a
+    // single copy if its elements are stored contiguously.
+    // Returns false if the elements must be read one by one instead.
+    static bool readBulk(BinaryDecoder& in, ListTypeInterface* type, void** storage,
+                         std::size_t elementSize, std::uint32_t count)
+    {
+      if (!elementSize || !count)
+        return false;
+      // Check that the data is there before growing the list, so that a bogus
+      // count cannot make us allocate an arbitrary amount of memory.
+      const bool overflows = count > std::numeric_limits<std::size_t>::max() / elementSize;
+      const std::size_t byteCount = overflows ? 0 : count * elementSize;
+      if (overflows || !in.bufferReader().peek(byteCount))
+      {
+        in.setStatus(BinaryDecoder::Status::ReadPastEnd);
+        return true;
+      }
+      const std::size_t previousSize = type->size(*storage);
+      char* data = static_cast<char*>(type->resizeContiguous(storage, previousSize + count));
+      if (!data)
+        return false;
+      std::memcpy(data + previousSize * elementSize, in.readRaw(byteCount), byteCount);
+      return true;
+    }
+
     class SerializeTypeVisitor
     {
     public:
@@ -441,36 +571,12 @@ namespace qi {
 
       void visitInt(int64_t value, bool isSigned, int byteSize)
       {
-        switch((isSigned ? 1 : -1) * byteSize)
-        {
-          case 0:  out.write(static_cast<bool>(!!value));  break;
-          case 1:  out.write(static_cast<int8_t>(value));  break;
-          case -1: out.write(static_cast<uint8_t>(value)); break;
-          case 2:  out.write(static_cast<int16_t>(value)); break;
-          case -2: out.write(static_cast<uint16_t>(value));break;
-          case 4:  out.write(static_cast<int32_t>(value)); break;
-          case -4: out.write(static_cast<uint32_t>(value));break;
-          case 8:  out.write(static_cast<int64_t>(value)); break;
-          case -8: out.write(static_cast<uint64_t>(value));break;
-          default: {
-            std::stringstream ss;
-            ss << "Unknown integer type " << isSigned << " " << byteSize;
-            throw std::runtime_error(ss.str());
-          }
-        }
+        writeInt(out, value, isSigned, byteSize);
       }
 
       void visitFloat(double value, int byteSize)
       {
-        if (byteSize == 4)
-          out.write(numericConvert<float>(value));
-        else if (byteSize == 8)
-          out.write(value);
-        else {
-          std::stringstream ss;
-          ss << "serialize on unknown float type " << byteSize;
-          throw std::runtime_error(ss.str());
-        }
+        writeFloat(out, value, byteSize);
       }
 
       void visitString(char* data, size_t len)
@@ -480,10 +586,21 @@ namespace qi {
 
       void visitList(AnyIterator it, AnyIterator end)
       {
-        out.beginList(numericConvert<std::uint32_t>(value.size()),
-                      static_cast<ListTypeInterface*>(value.type())->elementType()->signature());
-        for (; it != end; ++it)
-          serialize(*it, out, serializeObjectCb, socket);
+        ListTypeInterface* type = static_cast<ListTypeInterface*>(value.type());
+        TypeInterface* elementType = type->elementType();
+        const std::size_t size = value.size();
+        out.beginList(numericConvert<std::uint32_t>(size), elementType->signature());
+        const std::size_t elementSize = bulkElementSize(elementType);
+        const void* data = elementSize ? type->contiguousData(value.rawValue()) : nullptr;
+        if (data)
+        {
+          out.write(static_cast<const char*>(data), size * elementSize);
+        }
+        else
+        {
+          for (; it != end; ++it)
+            serialize(*it, out, serializeObjectCb, socket);
+        }
         out.endList();
       }
 
@@ -678,6 +795,12 @@ namespace qi {
 
       void visitString(char*, size_t)
       {
+        // views reference the data of the buffer being read, without copy
+        if (result.type()->info() == typeOf<StringView>()->info()) {
+          in.read(result.as<StringView>());
+          return;
+        }
+
         std::string s;
         in.read(s);
 
@@ -694,11 +817,15 @@ namespace qi {
 
       void visitList(AnyIterator, AnyIterator)
       {
-        TypeInterface* elementType = static_cast<ListTypeInterface*>(result.type())->elementType();
+        ListTypeInterface* type = static_cast<ListTypeInterface*>(result.type());
+        TypeInterface* elementType = type->elementType();
         std::uint32_t sz = 0;
         in.read(sz);
         if (in.status() != BinaryDecoder::Status::Ok)
           return;
+        void* storage = result.rawValue();
+        if (readBulk(in, type, &storage, bulkElementSize(elementType), sz))
+          return;
         for (unsigned i = 0; i < sz; ++i)
         {
           AnyReference v = deserialize(elementType, in, context, socket);
@@ -829,6 +956,15 @@ namespace qi {
 
       void visitRaw(AnyReference)
       {
+        const TypeInfo& info = result.type()->info();
+        if (info == typeOf<BufferView>()->info()) {
+          in.read(result.as<BufferView>());
+          return;
+        }
+        if (info == typeOf<Buffer>()->info()) {
+          in.read(result.as<Buffer>());
+          return;
+        }
         Buffer b;
         in.read(b);
         result.setRaw(static_cast<const char*>(b.data()), b.size());
@@ -856,10 +992,476 @@ namespace qi {
       MessageSocketPtr socket;
     }; //class
 
-    void serialize(AnyReference val, BinaryEncoder& out, SerializeObjectCallback context, MessageSocketPtr socket)
+    /// What the binary format of the values of a type is made of, resolved
+    /// once per type instead of being rediscovered at each value.
+    ///
+    /// A plan is compiled the first time a type is encoded or decoded, then
+    /// replayed on the storage of the values, without dispatching on the kind
+    /// of the type, computing signatures nor creating intermediate references.
+    /// Kinds which depend on the value, such as dynamic values and objects,
+    /// and recursive types, are left to the visitors above.
+    struct SerializationPlan
+    {
+      enum class Op
+      {
+        Int,
+        Float,
+        String,
+        List,
+        Map,
+        Tuple,
+        Optional,
+        Visit,
+      };
+
+      Op op = Op::Visit;
+      TypeInterface* type = nullptr;
+      Signature signature;
+      // Int and Float: size of the value in bytes. List: size of the elements
+      // if they can be copied as a whole block, 0 otherwise.
+      std::size_t size = 0;
+      bool isSigned = false;
+      // String: the storage is a std::string, which can be read into directly.
+      bool isStdString = false;
+      bool isStringView = false;
+      // List: element. Map: key and element. Tuple: members. Optional: value.
+      std::vector<const SerializationPlan*> children;
+    };
+
+    /// Plans of all the types encoded or decoded so far. As types, they are
+    /// never destroyed.
+    class SerializationPlanRegistry
     {
-      detail::SerializeTypeVisitor stv(out, context, val, socket);
+    public:
+      const SerializationPlan* plan(TypeInterface* type)
+      {
+        boost::mutex::scoped_lock lock(_mutex);
+        return compile(type);
+      }
+
+    private:
+      const SerializationPlan* compile(TypeInterface* type)
+      {
+        const auto it = _plans.find(type);
+        if (it != _plans.end())
+          return it->second.get();
+
+        std::unique_ptr<SerializationPlan> plan(new SerializationPlan);
+        plan->type = type;
+        plan->signature = type->signature();
+        if (!_compiling.insert(type).second)
+        {
+          // Recursive type: the nested occurrence is visited.
+          _recursivePlans.push_back(std::move(plan));
+          return _recursivePlans.back().get();
+        }
+        auto scopeEndCompiling = ka::scoped([&]{ _compiling.erase(type); });
+
+        switch (type->kind())
+        {
+          case TypeKind_Int:
+          {
+            const auto intType = static_cast<IntTypeInterface*>(type);
+            const auto size = intType->size();
+            if (size == 0 || size == 1 || size == 2 || size == 4 || size == 8)
+            {
+              plan->op = SerializationPlan::Op::Int;
+              plan->size = size;
+              plan->isSigned = intType->isSigned();
+            }
+            break;
+          }
+          case TypeKind_Float:
+          {
+            const auto size = static_cast<FloatTypeInterface*>(type)->size();
+            if (size == 4 || size == 8)
+            {
+              plan->op = SerializationPlan::Op::Float;
+              plan->size = size;
+            }
+            break;
+          }
+          case TypeKind_String:
+            plan->op = SerializationPlan::Op::String;
+            plan->isStdString = type->info() == typeOf<std::string>()->info();
+            plan->isStringView = type->info() == typeOf<StringView>()->info();
+            break;
+          case TypeKind_List:
+          case TypeKind_VarArgs:
+          {
+            const auto elementType = static_cast<ListTypeInterface*>(type)->elementType();
+            plan->op = SerializationPlan::Op::List;
+            plan->size = bulkElementSize(elementType);
+            plan->children.push_back(compile(elementType));
+            break;
+          }
+          case TypeKind_Map:
+          {
+            const auto mapType = static_cast<MapTypeInterface*>(type);
+            plan->op = SerializationPlan::Op::Map;
+            plan->children.push_back(compile(mapType->keyType()));
+            plan->children.push_back(compile(mapType->elementType()));
+            break;
+          }
+          case TypeKind_Tuple:
+            plan->op = SerializationPlan::Op::Tuple;
+            for (const auto memberType : static_cast<StructTypeInterface*>(type)->memberTypes())
+              plan->children.push_back(compile(memberType));
+            break;
+          case TypeKind_Optional:
+            plan->op = SerializationPlan::Op::Optional;
+            plan->children.push_back(
+                compile(static_cast<OptionalTypeInterface*>(type)->valueType()));
+            break;
+          default:
+            break;
+        }
+        const auto result = plan.get();
+        _plans.emplace(type, std::move(plan));
+        return result;
+      }
+
+      boost::mutex _mutex;
+      std::map<TypeInterface*, std::unique_ptr<SerializationPlan>> _plans;
+      std::vector<std::unique_ptr<SerializationPlan>> _recursivePlans;
+      std::set<TypeInterface*> _compiling;
+    };
+
+    /// @return the plan of the type, or null if plans are disabled by setting
+    /// QI_SERIALIZATION_PLANS to 0.
+    /// Once compiled, plans are looked up without locking.
+    static const SerializationPlan* serializationPlan(TypeInterface* type)
+    {
+      static const bool enabled = os::getEnvDefault("QI_SERIALIZATION_PLANS", true);
+      if (!enabled || !type)
+        return nullptr;
+
+      static thread_local std::unordered_map<TypeInterface*, const SerializationPlan*> threadPlans;
+      auto& plan = threadPlans[type];
+      if (!plan)
+      {
+        static SerializationPlanRegistry* registry = nullptr;
+        QI_THREADSAFE_NEW(registry);
+        plan = registry->plan(type);
+      }
+      return plan;
+    }
+
+    class PlanEncoder
+    {
+    public:
+      PlanEncoder(BinaryEncoder& out, SerializeObjectCallback& serializeObjectCb,
+                  MessageSocketPtr& socket)
+        : out(out)
+        , serializeObjectCb(serializeObjectCb)
+        , socket(socket)
+      {}
+
+      void encode(const SerializationPlan& plan, void* storage)
+      {
+        using Op = SerializationPlan::Op;
+        switch (plan.op)
+        {
+          case Op::Int:
+            writeInt(out, static_cast<IntTypeInterface*>(plan.type)->get(storage), plan.isSigned,
+                     static_cast<int>(plan.size));
+            break;
+          case Op::Float:
+            writeFloat(out, static_cast<FloatTypeInterface*>(plan.type)->get(storage),
+                       static_cast<int>(plan.size));
+            break;
+          case Op::String:
+          {
+            auto content = static_cast<StringTypeInterface*>(plan.type)->get(storage);
+            out.writeString(content.first.first, content.first.second);
+            if (content.second)
+              content.second(content.first);
+            break;
+          }
+          case Op::List:
+          {
+            const auto type = static_cast<ListTypeInterface*>(plan.type);
+            const std::size_t size = type->size(storage);
+            out.write(numericConvert<std::uint32_t>(size));
+            const void* data = plan.size ? type->contiguousData(storage) : nullptr;
+            if (data)
+            {
+              out.write(static_cast<const char*>(data), size * plan.size);
+              break;
+            }
+            const auto& elementPlan = *plan.children[0];
+            for (auto it = type->begin(storage), end = type->end(storage); it != end; ++it)
+              encode(elementPlan, *it);
+            break;
+          }
+          case Op::Map:
+          {
+            const auto type = static_cast<MapTypeInterface*>(plan.type);
+            out.write(numericConvert<std::uint32_t>(type->size(storage)));
+            for (auto it = type->begin(storage), end = type->end(storage); it != end; ++it)
+            {
+              AnyReference keyValue = *it;
+              encode(*plan.children[0], keyValue[0]);
+              encode(*plan.children[1], keyValue[1]);
+            }
+            break;
+          }
+          case Op::Tuple:
+          {
+            const auto type = static_cast<StructTypeInterface*>(plan.type);
+            for (unsigned int i = 0; i < plan.children.size(); ++i)
+              encode(*plan.children[i], type->get(storage, i));
+            break;
+          }
+          case Op::Optional:
+          {
+            const auto type = static_cast<OptionalTypeInterface*>(plan.type);
+            const bool hasValue = type->hasValue(storage);
+            out.write(hasValue);
+            if (hasValue)
+              encode(*plan.children[0], type->value(storage));
+            break;
+          }
+          case Op::Visit:
+          {
+            const AnyReference value(plan.type, storage);
+            SerializeTypeVisitor stv(out, serializeObjectCb, value, socket);
+            typeDispatch(stv, value);
+            break;
+          }
+        }
+      }
+
+      /// Encodes a value as a whole, keeping the signature of the encoder up to
+      /// date.
+      void encodeValue(const SerializationPlan& plan, void* storage)
+      {
+        out.beginTuple(plan.signature);
+        auto scopeEndTuple = ka::scoped([&]{ out.endTuple(); });
+        encode(plan, storage);
+      }
+
+      // References obtained from iterators or optionals may not be of the
+      // type the plan expects.
+      void encode(const SerializationPlan& plan, const AnyReference& value)
+      {
+        if (value.type() == plan.type)
+          encode(plan, value.rawValue());
+        else
+          serialize(value, out, serializeObjectCb, socket);
+      }
+
+      BinaryEncoder& out;
+      SerializeObjectCallback& serializeObjectCb;
+      MessageSocketPtr& socket;
+    };
+
+    class PlanDecoder
+    {
+    public:
+      PlanDecoder(BinaryDecoder& in, DeserializeObjectCallback& context, MessageSocketPtr& socket)
+        : in(in)
+        , context(context)
+        , socket(socket)
+      {}
+
+      void decode(const SerializationPlan& plan, void** storage)
+      {
+        using Op = SerializationPlan::Op;
+        switch (plan.op)
+        {
+          case Op::Int:
+            static_cast<IntTypeInterface*>(plan.type)->set(storage, readInt(plan));
+            break;
+          case Op::Float:
+          {
+            double value = 0;
+            if (plan.size == 4)
+            {
+              float f = 0;
+              in.read(f);
+              value = f;
+            }
+            else
+            {
+              in.read(value);
+            }
+            static_cast<FloatTypeInterface*>(plan.type)->set(storage, value);
+            break;
+          }
+          case Op::String:
+          {
+            if (plan.isStdString)
+            {
+              in.read(*static_cast<std::string*>(plan.type->ptrFromStorage(storage)));
+              break;
+            }
+            if (plan.isStringView)
+            {
+              in.read(*static_cast<StringView*>(plan.type->ptrFromStorage(storage)));
+              break;
+            }
+            std::string s;
+            in.read(s);
+            static_cast<StringTypeInterface*>(plan.type)->set(storage, s.data(), s.size());
+            break;
+          }
+          case Op::List:
+          {
+            const auto type = static_cast<ListTypeInterface*>(plan.type);
+            std::uint32_t size = 0;
+            in.read(size);
+            if (in.status() != BinaryDecoder::Status::Ok)
+              break;
+            if (readBulk(in, type, storage, plan.size, size))
+              break;
+            const auto& elementPlan = *plan.children[0];
+            for (std::uint32_t i = 0; i < size && in.status() == BinaryDecoder::Status::Ok; ++i)
+            {
+              auto element = makeStorage(elementPlan);
+              decode(elementPlan, &element.value);
+              type->pushBack(storage, element.value);
+            }
+            break;
+          }
+          case Op::Map:
+          {
+            const auto type = static_cast<MapTypeInterface*>(plan.type);
+            std::uint32_t size = 0;
+            in.read(size);
+            for (std::uint32_t i = 0; i < size && in.status() == BinaryDecoder::Status::Ok; ++i)
+            {
+              auto key = makeStorage(*plan.children[0]);
+              decode(*plan.children[0], &key.value);
+              auto element = makeStorage(*plan.children[1]);
+              decode(*plan.children[1], &element.value);
+              type->insert(storage, key.value, element.value);
+            }
+            break;
+          }
+          case Op::Tuple:
+          {
+            std::vector<Storage> members;
+            members.reserve(plan.children.size());
+            std::vector<void*> values;
+            values.reserve(plan.children.size());
+            for (const auto memberPlan : plan.children)
+            {
+              members.push_back(makeStorage(*memberPlan));
+              decode(*memberPlan, &members.back().value);
+              values.push_back(members.back().value);
+            }
+            static_cast<StructTypeInterface*>(plan.type)->set(storage, values);
+            break;
+          }
+          case Op::Optional:
+          {
+            const auto type = static_cast<OptionalTypeInterface*>(plan.type);
+            bool hasValue = false;
+            in.read(hasValue);
+            if (!hasValue)
+            {
+              type->reset(storage);
+              break;
+            }
+            auto value = makeStorage(*plan.children[0]);
+            decode(*plan.children[0], &value.value);
+            type->set(storage, value.value);
+            break;
+          }
+          case Op::Visit:
+          {
+            DeserializeTypeVisitor dtv(in, context, socket);
+            dtv.result = AnyReference(plan.type, *storage);
+            typeDispatch(dtv, dtv.result);
+            *storage = dtv.result.rawValue();
+            break;
+          }
+        }
+      }
+
+    private:
+      /// Storage of a value being decoded, destroyed with it.
+      struct Storage
+      {
+        Storage(TypeInterface* type) : type(type), value(type->initializeStorage()) {}
+        Storage(Storage&& o) : type(o.type), value(ka::exchange(o.value, nullptr)) {}
+        Storage(const Storage&) = delete;
+        Storage& operator=(const Storage&) = delete;
+        ~Storage() { if (value) type->destroy(value); }
+
+        TypeInterface* type;
+        void* value;
+      };
+
+      static Storage makeStorage(const SerializationPlan& plan)
+      {
+        return Storage(plan.type);
+      }
+
+      int64_t readInt(const SerializationPlan& plan)
+      {
+        switch ((plan.isSigned ? 1 : -1) * static_cast<int>(plan.size))
+        {
+          case 0:  return readValue<bool>();
+          case 1:  return readValue<int8_t>();
+          case -1: return readValue<uint8_t>();
+          case 2:  return readValue<int16_t>();
+          case -2: return readValue<uint16_t>();
+          case 4:  return readValue<int32_t>();
+          case -4: return readValue<uint32_t>();
+          case 8:  return readValue<int64_t>();
+          default: return static_cast<int64_t>(readValue<uint64_t>());
+        }
+      }
+
+      template<typename T>
+      T readValue()
+      {
+        T value = 0;
+        in.read(value);
+        return value;
+      }
+
+      BinaryDecoder& in;
+      DeserializeObjectCallback& context;
+      MessageSocketPtr& socket;
+    };
+
+    static void encodeValue(AnyReference val, BinaryEncoder& out, SerializeObjectCallback& context,
+                            MessageSocketPtr& socket)
+    {
+      const auto plan = serializationPlan(val.type());
+      if (plan && plan->op != SerializationPlan::Op::Visit)
+      {
+        PlanEncoder(out, context, socket).encodeValue(*plan, val.rawValue());
+        return;
+      }
+      SerializeTypeVisitor stv(out, context, val, socket);
       qi::typeDispatch(stv, val);
+    }
+
+    /// Decodes into `what` in place.
+    /// @return the decoded value, which is `what` unless it was a void value.
+    static AnyReference decodeValue(AnyReference what, BinaryDecoder& in,
+                                    DeserializeObjectCallback& context, MessageSocketPtr& socket)
+    {
+      const auto plan = serializationPlan(what.type());
+      if (plan && plan->op != SerializationPlan::Op::Visit)
+      {
+        void* storage = what.rawValue();
+        PlanDecoder(in, context, socket).decode(*plan, &storage);
+        return AnyReference(what.type(), storage);
+      }
+      DeserializeTypeVisitor dtv(in, context, socket);
+      dtv.result = what;
+      qi::typeDispatch(dtv, dtv.result);
+      return dtv.result;
+    }
+
+    void serialize(AnyReference val, BinaryEncoder& out, SerializeObjectCallback context, MessageSocketPtr socket)
+    {
+      encodeValue(val, out, context, socket);
       if (out.status() != BinaryEncoder::Status::Ok) {
         std::stringstream ss;
         ss << "OSerialization error " << BinaryEncoder::statusToStr(out.status());
@@ -869,15 +1471,13 @@ namespace qi {
 
     AnyReference deserialize(AnyReference what, BinaryDecoder& in, DeserializeObjectCallback context, MessageSocketPtr socket)
     {
-      detail::DeserializeTypeVisitor dtv(in, context, socket);
-      dtv.result = what;
-      qi::typeDispatch(dtv, dtv.result);
+      AnyReference result = decodeValue(what, in, context, socket);
       if (in.status() != BinaryDecoder::Status::Ok) {
         std::stringstream ss;
         ss << "ISerialization error " << BinaryDecoder::statusToStr(in.status());
         throw std::runtime_error(ss.str());
       }
-      return dtv.result;
+      return result;
     }
 
     AnyReference deserialize(qi::TypeInterface *type, BinaryDecoder& in, DeserializeObjectCallback context, MessageSocketPtr socket)
@@ -895,8 +1495,7 @@ namespace qi {
 
   void encodeBinary(qi::Buffer *buf, const qi::AutoAnyReference &gvp, SerializeObjectCallback onObject, MessageSocketPtr socket) {
     BinaryEncoder be(*buf);
-    detail::SerializeTypeVisitor stv(be, onObject, gvp, socket);
-    qi::typeDispatch(stv, gvp);
+    detail::encodeValue(gvp, be, onObject, socket);
     if (be.status() != BinaryEncoder::Status::Ok) {
       std::stringstream ss;
       ss << "OSerialization error " << BinaryEncoder::statusToStr(be.status());
@@ -908,16 +1507,14 @@ namespace qi {
   AnyReference decodeBinary(qi::BufferReader *buf, qi::AnyReference gvp,
     DeserializeObjectCallback onObject, MessageSocketPtr socket) {
     BinaryDecoder in(buf);
-    detail::DeserializeTypeVisitor dtv(in, onObject, socket);
-    dtv.result = gvp;
-    qi::typeDispatch(dtv, dtv.result);
+    AnyReference result = detail::decodeValue(gvp, in, onObject, socket);
     if (in.status() != BinaryDecoder::Status::Ok) {
       std::stringstream ss;
       ss << "ISerialization error " << BinaryDecoder::statusToStr(in.status());
       qiLogError() << ss.str();
       throw std::runtime_error(ss.str());
     }
-    return dtv.result;
+    return result;
   }
 
 }
@@ -10,6 +10,7 @@
 #include <boost/noncopyable.hpp>
 
 #include <qi/buffer.hpp>
+#include <qi/bufferview.hpp>
 
 #include <qi/type/typeinterface.hpp>
 #include <qi/anyvalue.hpp>
@@ -66,6 +67,13 @@ namespace qi {
 
     void read(qi::Buffer &buffer);
 
+    /// Reads a string as a view on the data of the buffer being read, without
+    /// copying it.
+    void read(StringView& s);
+    /// Reads a raw buffer as a view on the data of the buffer being read,
+    /// without copying it.
+    void read(BufferView& view);
+
     template<typename T> void read(T& v);
 
     //read raw data
@@ -0,0 +1,232 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <boost/functional/hash.hpp>
+#include <boost/thread/mutex.hpp>
+#include "calltrace_p.hpp"
+
+namespace qi
+{
+namespace
+{
+  /// Single-producer single-consumer ring of the events recorded by a thread.
+  class CallTraceRing
+  {
+  public:
+    static const std::size_t capacity = 1024;
+
+    bool push(const CallTraceEvent& event)
+    {
+      const auto head = _head.load(std::memory_order_relaxed);
+      if (head - _tail.load(std::memory_order_acquire) == capacity)
+      {
+        _dropCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      _events[head % capacity] = event;
+      _head.store(head + 1, std::memory_order_release);
+      return true;
+    }
+
+    std::size_t drain(std::vector<CallTraceEvent>& events, std::size_t maxCount)
+    {
+      const auto tail = _tail.load(std::memory_order_relaxed);
+      const auto count = std::min(_head.load(std::memory_order_acquire) - tail, maxCount);
+      for (std::size_t i = 0; i < count; ++i)
+        events.push_back(_events[(tail + i) % capacity]);
+      _tail.store(tail + count, std::memory_order_release);
+      return count;
+    }
+
+    bool empty() const
+    {
+      return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_relaxed);
+    }
+
+    qi::uint64_t takeDropCount()
+    {
+      return _dropCount.exchange(0, std::memory_order_relaxed);
+    }
+
+    void close()
+    {
+      _closed.store(true, std::memory_order_release);
+    }
+
+    bool closed() const
+    {
+      return _closed.load(std::memory_order_acquire);
+    }
+
+  private:
+    std::array<CallTraceEvent, capacity> _events;
+    std::atomic<std::size_t> _head{ 0 };
+    std::atomic<std::size_t> _tail{ 0 };
+    std::atomic<qi::uint64_t> _dropCount{ 0 };
+    std::atomic<bool> _closed{ false };
+  };
+
+  // The rings of the threads that recorded events. A ring is destroyed once
+  // its thread has exited and its events have been drained. Consumers are
+  // serialized by the mutex.
+  struct CallTraceRings
+  {
+    boost::mutex mutex;
+    std::vector<std::unique_ptr<CallTraceRing>> rings;
+    // Drops of the rings that were destroyed.
+    qi::uint64_t dropCount = 0;
+  };
+
+  CallTraceRings& callTraceRings()
+  {
+    static CallTraceRings* rings = new CallTraceRings;
+    return *rings;
+  }
+
+  // Set once the ring of the current thread has been released, at thread exit.
+  thread_local bool threadCallTraceRingReleased = false;
+
+  struct ThreadCallTraceRing
+  {
+    CallTraceRing* ring = nullptr;
+
+    ~ThreadCallTraceRing()
+    {
+      if (ring)
+        ring->close();
+      threadCallTraceRingReleased = true;
+    }
+  };
+
+  CallTraceRing* threadCallTraceRing()
+  {
+    if (threadCallTraceRingReleased)
+      return nullptr;
+
+    static thread_local ThreadCallTraceRing threadRing;
+    if (!threadRing.ring)
+    {
+      auto& rings = callTraceRings();
+      std::unique_ptr<CallTraceRing> ring(new CallTraceRing);
+      threadRing.ring = ring.get();
+      boost::mutex::scoped_lock lock(rings.mutex);
+      rings.rings.push_back(std::move(ring));
+    }
+    return threadRing.ring;
+  }
+
+  qi::os::timeval toTimeval(qi::int64_t us)
+  {
+    return qi::os::timeval(us);
+  }
+}
+
+namespace detail
+{
+  qi::int64_t callTraceTimestamp()
+  {
+    return boost::chrono::duration_cast<qi::MicroSeconds>(
+      qi::SystemClock::now().time_since_epoch()).count();
+  }
+
+  unsigned int nextCallTraceId()
+  {
+    static std::atomic<unsigned int> id{ 0 };
+    return ++id;
+  }
+
+  void recordCallTraceEvent(const CallTraceEvent& event)
+  {
+    if (auto ring = threadCallTraceRing())
+      ring->push(event);
+  }
+
+  qi::uint64_t callArgumentsDigest(const GenericFunctionParameters& params)
+  {
+    // Only the values of the simplest types are hashed, other arguments only
+    // contribute their kind: the digest must stay cheap to compute.
+    std::size_t digest = params.size();
+    for (std::size_t i = 1; i < params.size(); ++i)
+    {
+      const auto& param = params[i];
+      if (!param.type())
+      {
+        boost::hash_combine(digest, -1);
+        continue;
+      }
+      const auto kind = param.kind();
+      boost::hash_combine(digest, static_cast<int>(kind));
+      switch (kind)
+      {
+      case TypeKind_Int:
+        boost::hash_combine(digest, param.toInt());
+        break;
+      case TypeKind_Float:
+        boost::hash_combine(digest, param.toDouble());
+        break;
+      case TypeKind_String:
+      {
+        auto* type = static_cast<StringTypeInterface*>(param.type());
+        const auto str = type->get(param.rawValue());
+        boost::hash_combine(digest,
+                            boost::hash_range(str.first.first, str.first.first + str.first.second));
+        if (str.second)
+          str.second(str.first);
+        break;
+      }
+      default:
+        break;
+      }
+    }
+    // 0 means that the arguments were not sampled.
+    return digest ? digest : 1;
+  }
+}
+
+EventTrace CallTraceEvent::toEventTrace() const
+{
+  return EventTrace(id, kind, slotId,
+                    argumentsDigest ? AnyValue::from(argumentsDigest) : AnyValue(),
+                    toTimeval(timestamp), userUsTime, systemUsTime, callerContext,
+                    calleeContext, postTimestamp ? toTimeval(postTimestamp) : qi::os::timeval());
+}
+
+std::size_t drainCallTraceEvents(std::vector<CallTraceEvent>& events, std::size_t maxCount)
+{
+  auto& rings = callTraceRings();
+  boost::mutex::scoped_lock lock(rings.mutex);
+  std::size_t count = 0;
+  for (auto it = rings.rings.begin(); it != rings.rings.end() && count < maxCount;)
+  {
+    auto& ring = **it;
+    // Check that the ring is closed before checking that it is empty, so that
+    // no event can be pushed in between.
+    const bool closed = ring.closed();
+    count += ring.drain(events, maxCount - count);
+    if (closed && ring.empty())
+    {
+      rings.dropCount += ring.takeDropCount();
+      it = rings.rings.erase(it);
+    }
+    else
+      ++it;
+  }
+  return count;
+}
+
+qi::uint64_t takeDroppedCallTraceEventCount()
+{
+  auto& rings = callTraceRings();
+  boost::mutex::scoped_lock lock(rings.mutex);
+  auto count = rings.dropCount;
+  rings.dropCount = 0;
+  for (const auto& ring : rings.rings)
+    count += ring->takeDropCount();
+  return count;
+}
+}
@@ -0,0 +1,32 @@
+#pragma once
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#ifndef _SRC_TYPE_CALLTRACE_P_HPP_
+#define _SRC_TYPE_CALLTRACE_P_HPP_
+
+#include <qi/type/detail/manageable.hpp>
+
+namespace qi
+{
+namespace detail
+{
+  /// @return the current qi::SystemClock time, in microseconds since the epoch.
+  qi::int64_t callTraceTimestamp();
+
+  /// @return a process-unique call trace id.
+  unsigned int nextCallTraceId();
+
+  /// Records the event in the buffer of the current thread. The event is
+  /// dropped and counted if the buffer is full.
+  void recordCallTraceEvent(const CallTraceEvent& event);
+
+  /// @return a digest of the arguments of a call, the first parameter being
+  /// the object.
+  qi::uint64_t callArgumentsDigest(const GenericFunctionParameters& params);
+}
+}
+
+#endif // _SRC_TYPE_CALLTRACE_P_HPP_
@@ -0,0 +1,157 @@
+#pragma once
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#ifndef _SRC_TYPE_LATENCYHISTOGRAM_P_HPP_
+#define _SRC_TYPE_LATENCYHISTOGRAM_P_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <qi/stats.hpp>
+
+namespace qi
+{
+namespace detail
+{
+  /// Log-linear (HDR-style) histogram of durations in microseconds.
+  ///
+  /// Values below 2 * subBucketCount are counted exactly. Above, each power
+  /// of two is split in subBucketCount buckets, so that a value is known with
+  /// a relative error below 1 / subBucketCount. Values above maxValue are
+  /// counted in the last bucket.
+  ///
+  /// Recording only does relaxed atomic increments: it is wait-free and may
+  /// be done concurrently from any thread. Reading while values are recorded
+  /// gives a slightly inconsistent but valid snapshot.
+  class LatencyHistogram
+  {
+  public:
+    static const unsigned int subBucketBits = 5;
+    static const unsigned int subBucketCount = 1u << subBucketBits;
+    static const unsigned int maxValueBits = 36;
+    static const std::uint64_t maxValue = (std::uint64_t(1) << maxValueBits) - 1;
+    static const unsigned int bucketCount = (maxValueBits - subBucketBits + 1) * subBucketCount;
+
+    LatencyHistogram()
+      : _count(0)
+      , _min(std::numeric_limits<std::uint64_t>::max())
+      , _max(0)
+      , _sum(0)
+    {
+      for (auto& bucket : _buckets)
+        bucket.store(0, std::memory_order_relaxed);
+    }
+
+    void record(std::uint64_t value)
+    {
+      _buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+      _sum.fetch_add(value, std::memory_order_relaxed);
+      auto min = _min.load(std::memory_order_relaxed);
+      while (value < min && !_min.compare_exchange_weak(min, value, std::memory_order_relaxed))
+        ;
+      auto max = _max.load(std::memory_order_relaxed);
+      while (value > max && !_max.compare_exchange_weak(max, value, std::memory_order_relaxed))
+        ;
+      _count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::uint64_t count() const
+    {
+      return _count.load(std::memory_order_relaxed);
+    }
+
+    /// Min, max and sum of the recorded values, in seconds.
+    MinMaxSum minMaxSum() const
+    {
+      if (count() == 0)
+        return MinMaxSum();
+      return MinMaxSum(toSeconds(_min.load(std::memory_order_relaxed)),
+                       toSeconds(_max.load(std::memory_order_relaxed)),
+                       toSeconds(_sum.load(std::memory_order_relaxed)));
+    }
+
+    /// Median, 90th, 99th and 99.9th percentiles of the recorded values, in
+    /// seconds. Each percentile is the middle of the bucket holding it.
+    LatencyPercentiles percentiles() const
+    {
+      std::array<std::uint64_t, bucketCount> counts;
+      std::uint64_t total = 0;
+      for (unsigned int i = 0; i < bucketCount; ++i)
+      {
+        counts[i] = _buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+      }
+      if (total == 0)
+        return LatencyPercentiles();
+
+      const double ranks[] = { 0.5, 0.9, 0.99, 0.999 };
+      float values[4] = {};
+      std::uint64_t cumulated = 0;
+      unsigned int rank = 0;
+      for (unsigned int i = 0; i < bucketCount && rank < 4; ++i)
+      {
+        cumulated += counts[i];
+        while (rank < 4 && cumulated >= static_cast<std::uint64_t>(ranks[rank] * total + 0.5))
+          values[rank++] = toSeconds(bucketMiddle(i));
+      }
+      return LatencyPercentiles(values[0], values[1], values[2], values[3]);
+    }
+
+    static unsigned int bucketIndex(std::uint64_t value)
+    {
+      if (value > maxValue)
+        value = maxValue;
+      if (value < 2 * subBucketCount)
+        return static_cast<unsigned int>(value);
+      const unsigned int shift = highestBit(value) - subBucketBits;
+      return (shift + 1) * subBucketCount
+           + static_cast<unsigned int>(value >> shift) - subBucketCount;
+    }
+
+    /// @return the middle of the range of values counted by bucket \p index.
+    static double bucketMiddle(unsigned int index)
+    {
+      if (index < 2 * subBucketCount)
+        return index;
+      const unsigned int shift = index / subBucketCount - 1;
+      const std::uint64_t lowest =
+          static_cast<std::uint64_t>(index % subBucketCount + subBucketCount) << shift;
+      return lowest + ((std::uint64_t(1) << shift) - 1) / 2.0;
+    }
+
+  private:
+    static unsigned int highestBit(std::uint64_t value)
+    {
+      unsigned int bit = 0;
+      while (value >>= 1)
+        ++bit;
+      return bit;
+    }
+
+    static float toSeconds(double us)
+    {
+      return static_cast<float>(us / 1e6);
+    }
+
+    std::array<std::atomic<std::uint32_t>, bucketCount> _buckets;
+    std::atomic<std::uint64_t> _count;
+    std::atomic<std::uint64_t> _min;
+    std::atomic<std::uint64_t> _max;
+    std::atomic<std::uint64_t> _sum;
+  };
+
+  /// Wall, user and system time histograms of a method.
+  struct MethodLatencyHistograms
+  {
+    LatencyHistogram wall;
+    LatencyHistogram user;
+    LatencyHistogram system;
+  };
+} // detail
+} // qi
+
+#endif // _SRC_TYPE_LATENCYHISTOGRAM_P_HPP_
@@ -1,6 +1,10 @@
+#include <atomic>
+#include <cmath>
+#include <boost/make_shared.hpp>
 #include <qi/type/detail/manageable.hpp>
 #include <qi/type/objecttypebuilder.hpp>
 #include "../type/signal_p.hpp"
+#include "latencyhistogram_p.hpp"
 
 namespace qi
 {
@@ -18,16 +22,41 @@ namespace qi
     boost::shared_ptr<ExecutionContext> executionContext;
     boost::mutex                        initMutex;
 
-    bool statsEnabled;
+    using MethodHistogramsPtr = boost::shared_ptr<detail::MethodLatencyHistograms>;
+    using StatsTable = std::map<unsigned int, MethodHistogramsPtr>;
+
+    std::atomic<bool> statsEnabled;
     bool traceEnabled;
-    ObjectStatistics stats;
+    // Histograms of each method, read with atomic_load so that pushing
+    // statistics does not lock. The table is copied when a method is added.
+    boost::shared_ptr<const StatsTable> stats;
+    boost::mutex statsMutex;
     qi::Atomic<int> traceId;
+
+    std::atomic<bool> binaryTraceEnabled;
+    std::atomic<unsigned int> traceSamplingPeriod;
+    std::atomic<unsigned int> traceSampleCounter;
+    const unsigned int traceUid;
   };
 
+  namespace
+  {
+    unsigned int nextTraceUid()
+    {
+      static std::atomic<unsigned int> uid{ 0 };
+      return ++uid;
+    }
+  }
+
   ManageablePrivate::ManageablePrivate()
     : dying(false)
     , statsEnabled(false)
     , traceEnabled(false)
+    , stats(boost::make_shared<const StatsTable>())
+    , binaryTraceEnabled(false)
+    , traceSamplingPeriod(0)
+    , traceSampleCounter(0)
+    , traceUid(nextTraceUid())
   {
   }
 
@@ -99,23 +128,74 @@ namespace qi
     _p->statsEnabled = state;
   }
 
+  namespace
+  {
+    std::uint64_t toMicroSeconds(float seconds)
+    {
+      return seconds > 0 ? static_cast<std::uint64_t>(std::llround(seconds * 1e6)) : 0;
+    }
+  }
+
   void Manageable::pushStats(int slotId, float wallTime, float userTime, float systemTime)
   {
-    boost::mutex::scoped_lock l(_p->registrationsMutex);
-    MethodStatistics& ms = _p->stats[slotId];
-    ms.push(wallTime, userTime, systemTime);
+    const unsigned int id = static_cast<unsigned int>(slotId);
+    auto table = boost::atomic_load(&_p->stats);
+    auto it = table->find(id);
+    if (it == table->end())
+    {
+      boost::mutex::scoped_lock l(_p->statsMutex);
+      table = boost::atomic_load(&_p->stats);
+      it = table->find(id);
+      if (it == table->end())
+      {
+        auto newTable = boost::make_shared<ManageablePrivate::StatsTable>(*table);
+        newTable->emplace(id, boost::make_shared<detail::MethodLatencyHistograms>());
+        boost::atomic_store(&_p->stats,
+                            boost::shared_ptr<const ManageablePrivate::StatsTable>(newTable));
+        table = newTable;
+        it = table->find(id);
+      }
+    }
+    detail::MethodLatencyHistograms& histograms = *it->second;
+    histograms.wall.record(toMicroSeconds(wallTime));
+    histograms.user.record(toMicroSeconds(userTime));
+    histograms.system.record(toMicroSeconds(systemTime));
   }
 
   ObjectStatistics Manageable::stats() const
   {
-    boost::mutex::scoped_lock l(_p->registrationsMutex);
-    return _p->stats;
+    ObjectStatistics result;
+    const auto table = boost::atomic_load(&_p->stats);
+    for (const auto& method : *table)
+    {
+      const detail::MethodLatencyHistograms& histograms = *method.second;
+      result[method.first] = MethodStatistics(static_cast<unsigned int>(histograms.wall.count()),
+                                              histograms.wall.minMaxSum(),
+                                              histograms.user.minMaxSum(),
+                                              histograms.system.minMaxSum());
+    }
+    return result;
+  }
+
+  ObjectPercentiles Manageable::statsPercentiles() const
+  {
+    ObjectPercentiles result;
+    const auto table = boost::atomic_load(&_p->stats);
+    for (const auto& method : *table)
+    {
+      const detail::MethodLatencyHistograms& histograms = *method.second;
+      result[method.first] = MethodPercentiles(static_cast<unsigned int>(histograms.wall.count()),
+                                               histograms.wall.percentiles(),
+                                               histograms.user.percentiles(),
+                                               histograms.system.percentiles());
+    }
+    return result;
   }
 
   void Manageable::clearStats()
   {
-    boost::mutex::scoped_lock l(_p->registrationsMutex);
-    _p->stats.clear();
+    boost::mutex::scoped_lock l(_p->statsMutex);
+    boost::atomic_store(&_p->stats, boost::make_shared<const ManageablePrivate::StatsTable>());
   }
 
   bool Manageable::isTraceEnabled() const
@@ -133,6 +213,38 @@ namespace qi
     return ++_p->traceId;
   }
 
+  bool Manageable::isBinaryTraceEnabled() const
+  {
+    return _p->binaryTraceEnabled.load(std::memory_order_relaxed);
+  }
+
+  void Manageable::enableBinaryTrace(bool state)
+  {
+    _p->binaryTraceEnabled.store(state, std::memory_order_relaxed);
+  }
+
+  void Manageable::setTraceSamplingPeriod(unsigned int period)
+  {
+    _p->traceSamplingPeriod.store(period, std::memory_order_relaxed);
+  }
+
+  unsigned int Manageable::traceSamplingPeriod() const
+  {
+    return _p->traceSamplingPeriod.load(std::memory_order_relaxed);
+  }
+
+  unsigned int Manageable::traceUid() const
+  {
+    return _p->traceUid;
+  }
+
+  bool Manageable::_sampleTraceArguments()
+  {
+    const auto period = _p->traceSamplingPeriod.load(std::memory_order_relaxed);
+    return period != 0
+      && _p->traceSampleCounter.fetch_add(1, std::memory_order_relaxed) % period == 0;
+  }
+
   namespace manageable
   {
   static Manageable::MethodMap* methodMap = nullptr;
@@ -155,6 +267,8 @@ namespace qi
     builder.advertiseMethod("isTraceEnabled", &Manageable::isTraceEnabled, MetaCallType_Auto, id++);
     builder.advertiseMethod("enableTrace", &Manageable::enableTrace,       MetaCallType_Auto, id++);
     builder.advertiseSignal("traceObject", &Manageable::traceObject, id++);
+    builder.advertiseMethod("statsPercentiles", &Manageable::statsPercentiles,
+                            MetaCallType_Auto, id++);
     QI_ASSERT(id <= endId);
     const detail::ObjectTypeData& typeData = builder.typeData();
     *manageable::methodMap = typeData.methodMap;
@@ -11,6 +11,7 @@
 #include <boost/algorithm/string/predicate.hpp>
 #include <qi/iocolor.hpp>
 #include <qi/detail/print.hpp>
+#include <cstdint>
 #include <iomanip>
 
 qiLogCategory("qitype.metaobject");
@@ -484,6 +485,18 @@ qi::Atomic<int> MetaObjectPrivate::uid{1};
   }
 
 
+  /// Writes a field of the content digest, prefixed by its size so that
+  /// consecutive fields cannot be confused with other ones.
+  static void writeDigestField(std::ostream& out, const std::string& field)
+  {
+    out << field.size() << ':' << field;
+  }
+
+  static void writeDigestField(std::ostream& out, std::uint64_t value)
+  {
+    out << value << ';';
+  }
+
   void MetaObjectPrivate::refreshCache()
   {
     // Both change on property(=event) and method will invalidate the cache.
@@ -494,13 +507,25 @@ qi::Atomic<int> MetaObjectPrivate::uid{1};
     {
       _objectNameToIdx.clear();
       _methodNameToOverload.clear();
+      writeDigestField(buff, _methods.size());
       for (auto& metaMethodsSlot : _methods)
       {
         auto& metaMethod = metaMethodsSlot.second;
         const std::string methodNameSignature = metaMethod.toString();
         _objectNameToIdx[methodNameSignature] = MetaObjectIdType(metaMethod.uid(), MetaObjectType_Method);
         idx = std::max(idx, metaMethod.uid());
-        buff << methodNameSignature << metaMethod.uid();
+        writeDigestField(buff, methodNameSignature);
+        writeDigestField(buff, metaMethod.uid());
+        writeDigestField(buff, metaMethod.returnSignature().toString());
+        writeDigestField(buff, metaMethod.description());
+        writeDigestField(buff, metaMethod.returnDescription());
+        const auto& parameters = metaMethod.parameters();
+        writeDigestField(buff, parameters.size());
+        for (const auto& parameter : parameters)
+        {
+          writeDigestField(buff, parameter.name());
+          writeDigestField(buff, parameter.description());
+        }
 
         OverloadMap::iterator overloadIt = _methodNameToOverload.find(metaMethod.name());
         if (overloadIt == _methodNameToOverload.end())
@@ -516,16 +541,27 @@ qi::Atomic<int> MetaObjectPrivate::uid{1};
       }
     }
     {
+      writeDigestField(buff, _events.size());
       for (auto& metaSignalSlot : _events)
       {
         auto& metaSignal = metaSignalSlot.second;
         const auto metaSignalNameSignature = metaSignal.toString();
         _objectNameToIdx[metaSignalNameSignature] = MetaObjectIdType(metaSignal.uid(), MetaObjectType_Signal);
         idx = std::max(idx, metaSignal.uid());
-        buff << metaSignalNameSignature << metaSignal.uid();
+        writeDigestField(buff, metaSignalNameSignature);
+        writeDigestField(buff, metaSignal.uid());
       }
     }
-    buff << _description;
+    {
+      boost::recursive_mutex::scoped_lock pl(_propertiesMutex);
+      writeDigestField(buff, _properties.size());
+      for (const auto& metaPropertySlot : _properties)
+      {
+        writeDigestField(buff, metaPropertySlot.second.toString());
+        writeDigestField(buff, metaPropertySlot.second.uid());
+      }
+    }
+    writeDigestField(buff, _description);
 
     // never lower index
     _index = std::max(idx, _index.load());
@@ -535,6 +571,14 @@ qi::Atomic<int> MetaObjectPrivate::uid{1};
     _dirtyCache = false;
   }
 
+  ka::sha1_digest_t MetaObjectPrivate::contentSHA1() const
+  {
+    boost::recursive_mutex::scoped_lock ml(_methodsMutex);
+    if (_dirtyCache || !_contentSHA1)
+      const_cast<MetaObjectPrivate*>(this)->refreshCache();
+    return *_contentSHA1;
+  }
+
   void MetaObjectPrivate::setDescription(const std::string &desc) {
     _description = desc;
   }
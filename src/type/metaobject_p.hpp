@@ -154,6 +154,10 @@ namespace qi {
     // Recompute data cached in *ToIdx
     void refreshCache();
 
+    /// Digest of the whole content of the metaobject: two metaobjects of the
+    /// same digest are interchangeable.
+    ka::sha1_digest_t contentSHA1() const;
+
     void setDescription(const std::string& desc);
 
     int findMethod(const std::string& nameWithOptionalSignature, const GenericFunctionParameters& args, bool* canCache) const;
@@ -8,6 +8,7 @@
 
 #include <boost/thread/recursive_mutex.hpp>
 #include <boost/make_shared.hpp>
+#include <boost/smart_ptr/shared_ptr.hpp>
 
 #include <qi/signal.hpp>
 #include <qi/anyvalue.hpp>
@@ -32,6 +33,23 @@ namespace qi {
     disconnectAll();
   }
 
+  boost::shared_ptr<const SignalTriggerState> SignalBasePrivate::triggerState() const
+  {
+    return boost::atomic_load(&publishedTriggerState);
+  }
+
+  void SignalBasePrivate::updateTriggerState()
+  {
+    auto state = boost::make_shared<SignalTriggerState>();
+    state->subscribers.reserve(subscriberMap.size());
+    for (const auto& subscriber : subscriberMap)
+      state->subscribers.push_back(subscriber.second);
+    state->defaultCallType = defaultCallType;
+    state->triggerOverride = triggerOverride;
+    boost::atomic_store(&publishedTriggerState,
+                        boost::shared_ptr<const SignalTriggerState>(std::move(state)));
+  }
+
   Future<bool> SignalBasePrivate::disconnect(const SignalLink& l)
   {
     // The invalid signal link is never connected, therefore the disconnection
@@ -54,6 +72,7 @@ namespace qi {
       subscriber = it->second;
       // Remove from map (but SignalSubscriber object still good)
       subscriberMap.erase(it);
+      updateTriggerState();
       if (subscriberMap.empty() && onSubscribers)
         onSubscribersToCall = onSubscribers;
       // Ensure no call on subscriber occurs once this function returns
@@ -79,6 +98,7 @@ namespace qi {
 
     subscriberMap.erase(it->second);
     trackMap.erase(it);
+    updateTriggerState();
   }
 
   Future<bool> SignalBasePrivate::disconnectAllStep(bool overallSuccess)
@@ -152,6 +172,7 @@ QI_WARNING_POP()
     QI_ASSERT(_p);
     boost::recursive_mutex::scoped_lock lock(_p->mutex);
     _p->defaultCallType = callType;
+    _p->updateTriggerState();
   }
 
   void SignalBase::operator()(
@@ -189,15 +210,11 @@ QI_WARNING_POP()
   void SignalBase::trigger(const GenericFunctionParameters& params, MetaCallType callType)
   {
     QI_ASSERT(_p);
-    SignalBase::Trigger trigger;
-    {
-      boost::recursive_mutex::scoped_lock lock(_p->mutex);
-      trigger = _p->triggerOverride;
-    }
-    if (trigger)
-      trigger(params, callType);
+    const auto state = _p->triggerState();
+    if (state->triggerOverride)
+      state->triggerOverride(params, callType);
     else
-      callSubscribers(params, callType);
+      callSubscribersImpl(*state, params, callType);
   }
 
   void SignalBase::setTriggerOverride(Trigger t)
@@ -205,6 +222,7 @@ QI_WARNING_POP()
     QI_ASSERT(_p);
     boost::recursive_mutex::scoped_lock lock(_p->mutex);
     _p->triggerOverride = t;
+    _p->updateTriggerState();
   }
 
   void SignalBase::setOnSubscribers(OnSubscribers onSubscribers)
@@ -216,13 +234,13 @@ QI_WARNING_POP()
 
   namespace {
     template<typename Params>
-    void callSubscribersImpl(const SignalBase& x, SignalSubscriberMap& subscribers,
-                             const Params& params, MetaCallType callType)
+    void callEachSubscriber(const SignalBase& x, const std::vector<SignalSubscriber>& subscribers,
+                            const Params& params, MetaCallType callType)
     {
-      for (auto& i: subscribers)
+      for (const auto& subscriber: subscribers)
       {
         qiLogDebug() << &x << " Invoking signal subscriber";
-        SignalSubscriber s = i.second; // holds the subscription alive
+        SignalSubscriber s = subscriber;
         s.call(params, callType);
       }
     }
@@ -230,18 +248,19 @@ QI_WARNING_POP()
 
   void SignalBase::callSubscribers(const GenericFunctionParameters& params, MetaCallType callType)
   {
-    MetaCallType mct = callType;
     QI_ASSERT(_p);
+    callSubscribersImpl(*_p->triggerState(), params, callType);
+  }
 
-    SignalSubscriberMap copy;
-    {
-      boost::recursive_mutex::scoped_lock lock(_p->mutex);
-      if (mct == qi::MetaCallType_Auto)
-        mct = _p->defaultCallType;
-
-      copy = _p->subscriberMap;
-    }
-    qiLogDebug() << this << " Invoking signal subscribers: " << copy.size();
+  void SignalBase::callSubscribersImpl(const SignalTriggerState& state,
+                                       const GenericFunctionParameters& params,
+                                       MetaCallType callType)
+  {
+    // The state holds the subscriptions alive for the duration of the call.
+    const auto& subscribers = state.subscribers;
+    const MetaCallType mct =
+        callType == qi::MetaCallType_Auto ? state.defaultCallType : callType;
+    qiLogDebug() << this << " Invoking signal subscribers: " << subscribers.size();
 
     // If any subscriber is going to use an execution context, it's going to
     // need a copy of the arguments, so that it can post a task to the execution
@@ -249,9 +268,8 @@ QI_WARNING_POP()
     // because it would be inefficient. We therefore detect here if a copy is
     // needed, and if so make this copy once for all.
 
-    using V = SignalSubscriberMap::value_type;
-    const bool mustCopyParams = std::any_of(copy.begin(), copy.end(), [mct](const V& v) {
-      const SignalSubscriber& s = v.second;
+    const bool mustCopyParams = std::any_of(subscribers.begin(), subscribers.end(),
+                                            [mct](const SignalSubscriber& s) {
       return static_cast<bool>(s.executionContextFor(mct)); // Has a context.
     });
 
@@ -264,11 +282,11 @@ QI_WARNING_POP()
           delete object;
         }
       };
-      callSubscribersImpl(*this, copy, std::move(paramsCopy), mct);
+      callEachSubscriber(*this, subscribers, std::move(paramsCopy), mct);
     }
     else
     {
-      callSubscribersImpl(*this, copy, params, mct);
+      callEachSubscriber(*this, subscribers, params, mct);
     }
     qiLogDebug() << this << " done invoking signal subscribers";
   }
@@ -479,6 +497,7 @@ QI_WARNING_POP()
     subscriberInMap = src;
     subscriberInMap._p->linkId = res;
     subscriberInMap._p->source = this->_p;
+    _p->updateTriggerState();
     Future<void> callingOnSubscribers{nullptr};
     if (first && _p->onSubscribers)
     {
@@ -599,19 +618,14 @@ QI_WARNING_POP()
 
   std::vector<SignalSubscriber> SignalBase::subscribers()
   {
-    std::vector<SignalSubscriber> res;
     QI_ASSERT(_p);
-    boost::recursive_mutex::scoped_lock sl(_p->mutex);
-    for (const auto& i: _p->subscriberMap)
-      res.push_back(i.second);
-    return res;
+    return _p->triggerState()->subscribers;
   }
 
   bool SignalBase::hasSubscribers()
   {
     QI_ASSERT(_p);
-    boost::recursive_mutex::scoped_lock sl(_p->mutex);
-    return !_p->subscriberMap.empty();
+    return !_p->triggerState()->subscribers.empty();
   }
 
   SignalSubscriber SignalBase::connect(AnyObject obj, const std::string& slot)
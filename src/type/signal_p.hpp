@@ -7,7 +7,9 @@
 #ifndef _SRC_SIGNAL_P_HPP_
 #define _SRC_SIGNAL_P_HPP_
 
+#include <vector>
 #include <qi/signal.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/thread/thread.hpp>
 #include <boost/thread/recursive_mutex.hpp>
 
@@ -16,20 +18,40 @@ namespace qi {
   using SignalSubscriberMap = std::map<SignalLink, SignalSubscriber>;
   using TrackMap = std::map<int, SignalLink>;
 
+  /// What a trigger of the signal needs to know. It is never modified once
+  /// published: every change of one of its members publishes a new one, so
+  /// that triggering a signal only loads a pointer instead of locking the
+  /// signal and copying its subscribers.
+  struct SignalTriggerState
+  {
+    std::vector<SignalSubscriber> subscribers;
+    MetaCallType defaultCallType;
+    SignalBase::Trigger triggerOverride;
+  };
+
   class SignalBasePrivate
   {
   public:
     SignalBasePrivate()
       : execContext(nullptr)
       , defaultCallType(MetaCallType_Auto)
-    {}
+    {
+      updateTriggerState();
+    }
 
     ~SignalBasePrivate();
     Future<bool> disconnect(const SignalLink& l);
     Future<bool> disconnectAll();
     void disconnectTrackLink(int id);
 
+    boost::shared_ptr<const SignalTriggerState> triggerState() const;
+
   private:
+    /// Publishes a new trigger state from the members. Must be called with
+    /// `mutex` locked, after each change of `subscriberMap`,
+    /// `defaultCallType` or `triggerOverride`.
+    void updateTriggerState();
+
     friend class SignalBase;
     Future<bool> disconnectAllStep(bool overallSuccess);
 
@@ -42,6 +64,7 @@ namespace qi {
     boost::recursive_mutex         mutex;
     MetaCallType                   defaultCallType;
     SignalBase::Trigger            triggerOverride;
+    boost::shared_ptr<const SignalTriggerState> publishedTriggerState;
   };
 
 }
@@ -2,13 +2,21 @@
 **  Copyright (C) 2012 Aldebaran Robotics
 **  See COPYING for the license
 */
+#include <array>
 #include <cstring>
+#include <functional>
 
 #include <qi/assert.hpp>
+#include <qi/atomic.hpp>
 #include <qi/signature.hpp>
 #include <qi/type/typeinterface.hpp>
 #include <qi/jsoncodec.hpp>
+#include <qi/getenv.hpp>
 #include <boost/make_shared.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <unordered_map>
 #include "signatureconvertor.hpp"
 
 qiLogCategory("qitype.signature");
@@ -102,7 +110,7 @@ namespace qi {
   }
 
 
-  float Signature::isConvertibleTo(const qi::Signature& b) const
+  static float computeConvertibility(const Signature& a, const Signature& b)
   {
     /* The returned float is just a basic heuristic, it does not handle:
      * - comparison between integral types
@@ -118,28 +126,28 @@ namespace qi {
     static const char floating[] = "fd";
     static const char container[] = "[{(";
 
-    Signature::Type s = type();
+    Signature::Type s = a.type();
     Signature::Type d = b.type();
 
     //varargs are just vector, handle them that way
-    if (s == Type_VarArgs)
-      s = Type_List;
-    if (d == Type_VarArgs)
-      d = Type_List;
-    if (d == Type_Void)
+    if (s == Signature::Type_VarArgs)
+      s = Signature::Type_List;
+    if (d == Signature::Type_VarArgs)
+      d = Signature::Type_List;
+    if (d == Signature::Type_Void)
       return calculateFactor();
-    if (d == Type_Unknown)
+    if (d == Signature::Type_Unknown)
     {
       // We cannot anwser the question for unknown types. So let it pass
       // and the conversion code will decide.
       // Type_Unknown is not serializable anyway.
-      if (s != Type_Unknown)
+      if (s != Signature::Type_Unknown)
         error += 10.f; // Weird but can happen with object pointers
       return calculateFactor();
     }
 
-    if (d == Type_Dynamic || // Dynamic can convert to whatever
-        s == Type_None) // None means parent is empty container
+    if (d == Signature::Type_Dynamic || // Dynamic can convert to whatever
+        s == Signature::Type_None) // None means parent is empty container
     {
       error += 5.f; // big malus for dynamic
       return calculateFactor();
@@ -148,22 +156,22 @@ namespace qi {
     // Source is convertible to an optional if source's type is convertible to the destination
     // optional value type or if source's type is void. For instance, int is convertible to
     // optional<int>, but also int is convertible to optional<dynamic>
-    if (d == Type_Optional)
+    if (d == Signature::Type_Optional)
     {
       // If source is also an optional then we are performing a optional to optional conversion.
       // By design this is allowed if source value type is convertible to dest value type.
-      if (s == Type_Optional)
-        return children()[0].isConvertibleTo(b.children()[0]);
+      if (s == Signature::Type_Optional)
+        return a.children()[0].isConvertibleTo(b.children()[0]);
 
       // Converting void to optional means constructing an empty optional. This design choice was
       // made to simplify conversion from language bindings where types are not explicit (like
       // python).
-      else if (s == Type_Void)
+      else if (s == Signature::Type_Void)
         return calculateFactor();
 
-      return isConvertibleTo(b.children()[0]);
+      return a.isConvertibleTo(b.children()[0]);
     }
-    else if (s == Type_Optional)
+    else if (s == Signature::Type_Optional)
     {
       // The case where dest is dynamic is already handled above, and is the same for optionals:
       // converting optionals to dynamic is allowed, but converting optionals to anything else is
@@ -188,12 +196,12 @@ namespace qi {
     { // Container, list or map
       if (d != s)
         return 0.f; // Must be same container
-      if (children().size() != b.children().size())
+      if (a.children().size() != b.children().size())
       {
-        if (s != Type_Tuple)
+        if (s != Signature::Type_Tuple)
           return 0.f;
         // Special case for same-named tuples that might be compatible
-        std::string aSrc = annotation();
+        std::string aSrc = a.annotation();
         std::string aDst = b.annotation();
         // This mode is recommended only for tests where it is more
         // conveniant to have differently named structs
@@ -211,7 +219,7 @@ namespace qi {
       SignatureVector::const_iterator its;
       SignatureVector::const_iterator itd;
       itd = b.children().begin();
-      for (its = children().begin(); its != children().end(); ++its, ++itd) {
+      for (its = a.children().begin(); its != a.children().end(); ++its, ++itd) {
         float childRes = its->isConvertibleTo(*itd);
         if (childRes == 0.f)
           return 0.f; // Just check subtype compatibility
@@ -219,7 +227,7 @@ namespace qi {
         // [s] -> m should have a greater convertibility than [s] -> [m]
         childErr *= 1.0f - (1.0f - childRes) * 0.95f;
       }
-      QI_ASSERT(its==children().end() && itd==b.children().end()); // we already exited on size mismatch
+      QI_ASSERT(its==a.children().end() && itd==b.children().end()); // we already exited on size mismatch
     }
     else if (d != s)
       return 0.f;
@@ -293,6 +301,9 @@ namespace qi {
 
     std::string            _signature;
     std::vector<Signature> _children;
+    // Whether this is the node shared by all the signatures of this string,
+    // which lives as long as the process.
+    bool                   _interned = false;
   };
 
   static size_t findNext(const std::string &signature, size_t index) {
@@ -470,29 +481,203 @@ namespace qi {
     _signature.assign(signature, begin, end - begin);
   }
 
+  /// Parsed signatures, shared by all the signatures of the same string, and
+  /// the convertibility scores between them.
+  ///
+  /// Signatures are immutable, so equal signatures can share a node and be
+  /// compared by pointer. Each thread looks the signatures it builds up in a
+  /// small cache of its own first, without any lock, and only then in the
+  /// table shared by all threads.
+  ///
+  /// The shared table holds up to QI_SIGNATURE_CACHE_SIZE signatures (4096 by
+  /// default). Once it is full, the signatures that are not used anymore are
+  /// evicted from time to time, along with all the memoized scores; if none
+  /// is, new signatures are parsed as before. Setting it to 0 disables
+  /// interning.
+  class SignatureInterner
+  {
+  public:
+    static SignatureInterner& instance()
+    {
+      static SignatureInterner* interner = nullptr;
+      QI_THREADSAFE_NEW(interner);
+      return *interner;
+    }
+
+    SignatureInterner()
+      : _maxSize(os::getEnvDefault("QI_SIGNATURE_CACHE_SIZE", std::size_t(4096)))
+      , _empty(boost::make_shared<SignaturePrivate>())
+    {
+      _empty->_interned = true;
+    }
+
+    boost::shared_ptr<SignaturePrivate> empty() const
+    {
+      return _empty;
+    }
+
+    boost::shared_ptr<SignaturePrivate> intern(const std::string& signature)
+    {
+      const auto cache = threadCache();
+      if (!cache)
+        return internShared(signature);
+      auto& slot = (*cache)[std::hash<std::string>{}(signature) % threadCacheSize];
+      if (slot && slot->_signature == signature)
+        return slot;
+      auto p = internShared(signature);
+      if (p->_interned)
+        slot = p;
+      return p;
+    }
+
+    float convertibility(const Signature& a, const Signature& b, const SignaturePrivate* pa,
+                         const SignaturePrivate* pb)
+    {
+      // Scores are only memoized between interned nodes, whose addresses
+      // cannot be reused by other signatures while they are in the table.
+      if (!pa->_interned || !pb->_interned)
+        return computeConvertibility(a, b);
+
+      const auto key = std::make_pair(pa, pb);
+      {
+        boost::shared_lock<boost::shared_mutex> lock(_convertibilitiesMutex);
+        const auto it = _convertibilities.find(key);
+        if (it != _convertibilities.end())
+          return it->second;
+      }
+
+      const float score = computeConvertibility(a, b);
+      boost::unique_lock<boost::shared_mutex> lock(_convertibilitiesMutex);
+      if (_convertibilities.size() >= 4 * _maxSize)
+        _convertibilities.clear();
+      _convertibilities.emplace(key, score);
+      return score;
+    }
+
+  private:
+    using SignaturePair = std::pair<const SignaturePrivate*, const SignaturePrivate*>;
+
+    static const std::size_t threadCacheSize = 64;
+    using ThreadCache = std::array<boost::shared_ptr<SignaturePrivate>, threadCacheSize>;
+
+    // Set when the cache of the current thread has been destroyed, at thread
+    // exit. Signatures can still be built afterwards, by the destructors of
+    // other thread local objects for instance.
+    static thread_local bool _threadCacheDestroyed;
+
+    struct ThreadCacheStorage
+    {
+      ThreadCache cache;
+      ~ThreadCacheStorage()
+      {
+        _threadCacheDestroyed = true;
+      }
+    };
+
+    static ThreadCache* threadCache()
+    {
+      if (_threadCacheDestroyed)
+        return nullptr;
+      static thread_local ThreadCacheStorage storage;
+      return &storage.cache;
+    }
+
+    boost::shared_ptr<SignaturePrivate> internShared(const std::string& signature)
+    {
+      {
+        boost::shared_lock<boost::shared_mutex> lock(_signaturesMutex);
+        const auto it = _signatures.find(signature);
+        if (it != _signatures.end())
+          return it->second;
+      }
+
+      // Parse without holding the lock: children are interned as well.
+      auto p = boost::make_shared<SignaturePrivate>();
+      p->init(signature, 0, signature.size());
+
+      boost::unique_lock<boost::shared_mutex> lock(_signaturesMutex);
+      const auto it = _signatures.find(signature);
+      if (it != _signatures.end())
+        return it->second;
+      if (_maxSize != 0 && _signatures.size() >= _maxSize)
+        evictUnused();
+      if (_signatures.size() < _maxSize)
+      {
+        p->_interned = true;
+        _signatures.emplace(signature, p);
+      }
+      return p;
+    }
+
+    /// Removes the signatures that only the table still refers to, at most
+    /// once every eighth of the table size: sweeping costs a pass over it.
+    /// `_signaturesMutex` must be locked.
+    void evictUnused()
+    {
+      if (_missesUntilEviction != 0)
+      {
+        --_missesUntilEviction;
+        return;
+      }
+      _missesUntilEviction = _maxSize / 8;
+
+      bool evicted = false;
+      for (auto it = _signatures.begin(); it != _signatures.end();)
+      {
+        // Nodes are only shared through the table while its lock is held, so
+        // no other reference to an unused one may appear meanwhile.
+        if (it->second.use_count() == 1)
+        {
+          it = _signatures.erase(it);
+          evicted = true;
+        }
+        else
+          ++it;
+      }
+      // The scores of the evicted nodes must not be found by new nodes at
+      // their addresses.
+      if (evicted)
+      {
+        boost::unique_lock<boost::shared_mutex> lock(_convertibilitiesMutex);
+        _convertibilities.clear();
+      }
+    }
+
+    const std::size_t _maxSize;
+    const boost::shared_ptr<SignaturePrivate> _empty;
+    boost::shared_mutex _signaturesMutex;
+    std::unordered_map<std::string, boost::shared_ptr<SignaturePrivate>> _signatures;
+    std::size_t _missesUntilEviction = 0;
+    boost::shared_mutex _convertibilitiesMutex;
+    std::unordered_map<SignaturePair, float, boost::hash<SignaturePair>> _convertibilities;
+  };
+
+  thread_local bool SignatureInterner::_threadCacheDestroyed = false;
+
+  float Signature::isConvertibleTo(const qi::Signature& b) const
+  {
+    return SignatureInterner::instance().convertibility(*this, b, _p.get(), b._p.get());
+  }
+
   Signature::Signature()
-    : _p(boost::make_shared<SignaturePrivate>())
+    : _p(SignatureInterner::instance().empty())
   {
   }
 
   Signature::Signature(const char *signature)
-    : _p(boost::make_shared<SignaturePrivate>())
+    : _p(SignatureInterner::instance().intern(signature))
   {
-    _p->_signature.assign(signature);
-    _p->init(_p->_signature, 0, _p->_signature.size());
   }
 
 
   Signature::Signature(const std::string &signature)
-    : _p(boost::make_shared<SignaturePrivate>())
+    : _p(SignatureInterner::instance().intern(signature))
   {
-    _p->init(signature, 0, signature.size());
   }
 
   Signature::Signature(const std::string &signature, size_t begin, size_t end)
-    : _p(boost::make_shared<SignaturePrivate>())
+    : _p(SignatureInterner::instance().intern(signature.substr(begin, end - begin)))
   {
-    _p->init(signature, begin, end);
   }
 
   bool Signature::isValid() const {
@@ -597,6 +782,8 @@ namespace qi {
   //compare signature without taking annotation into account
   bool operator==(const Signature& lhs, const Signature& rhs)
   {
+    if (lhs._p == rhs._p)
+      return true;
     if (lhs.type() != rhs.type())
       return false;
     if (lhs.children().size() != rhs.children().size())
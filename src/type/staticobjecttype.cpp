@@ -36,6 +36,13 @@ StaticObjectTypeBase::metaObject(void* )
   return _metaObject;
 }
 
+const AnyFunction*
+StaticObjectTypeBase::method(unsigned int id) const
+{
+  const auto it = _data.methodMap.find(id);
+  return it == _data.methodMap.end() ? nullptr : &it->second.first;
+}
+
 namespace {
   template <typename T>
   void noopDeleter(T* obj)
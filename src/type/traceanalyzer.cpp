@@ -304,6 +304,30 @@ namespace qi
     }
   }
 
+  void TraceAnalyzer::addTrace(const qi::CallTraceEvent& event)
+  {
+    addTrace(event.toEventTrace(), event.objectUid);
+  }
+
+  std::size_t TraceAnalyzer::addRecordedTraces()
+  {
+    static const std::size_t batchSize = 4096;
+    std::vector<CallTraceEvent> events;
+    events.reserve(batchSize);
+    std::size_t count = 0;
+    std::size_t drained = 0;
+    // Stop at the first incomplete batch, not to chase producers forever.
+    do
+    {
+      events.clear();
+      drained = drainCallTraceEvents(events, batchSize);
+      for (const auto& event : events)
+        addTrace(event);
+      count += drained;
+    } while (drained == batchSize);
+    return count;
+  }
+
   void TraceAnalyzer::clear()
   {
     _p->perContext.clear();
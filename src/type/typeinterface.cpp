@@ -3,6 +3,7 @@
 **  See COPYING for the license
 */
 
+#include <atomic>
 #include <mutex>
 
 #include <boost/algorithm/string.hpp>
@@ -103,10 +104,26 @@ namespace qi {
     return res;
   }
 
-  QI_API TypeInterface* getType(const TypeIndex& typeId)
+  static std::mutex& typeFactoryMutex()
   {
     static std::mutex mutex;
-    std::lock_guard<std::mutex> sl(mutex);
+    return mutex;
+  }
+
+  static std::atomic<unsigned int>& typeFactoryVersion()
+  {
+    static std::atomic<unsigned int> version{ 1 };
+    return version;
+  }
+
+  QI_API unsigned int typeRegistryVersion()
+  {
+    return typeFactoryVersion().load(std::memory_order_acquire);
+  }
+
+  QI_API TypeInterface* getType(const TypeIndex& typeId)
+  {
+    std::lock_guard<std::mutex> sl(typeFactoryMutex());
     static bool fallback = !qi::os::getenv("QI_TYPE_RTTI_FALLBACK").empty();
 
     // We create-if-not-exist on purpose: to detect access that occur before
@@ -126,6 +143,7 @@ namespace qi {
     qiLogCategory("qitype.type"); // method can be called at static init
     qiLogDebug() << "registerType "  << typeId.name() << " "
      << type->kind() <<" " << (void*)type << " " << type->signature().toString();
+    std::lock_guard<std::mutex> sl(typeFactoryMutex());
     TypeFactory::iterator i = typeFactory().find(TypeInfo(typeId));
     if (i != typeFactory().end())
     {
@@ -138,6 +156,7 @@ namespace qi {
     }
     typeFactory()[TypeInfo(typeId)] = type;
     fallbackTypeFactory()[typeId.name()] = type;
+    typeFactoryVersion().fetch_add(1, std::memory_order_release);
     return true;
   }
 
@@ -1507,6 +1526,16 @@ namespace qi {
     return (*it).rawValue();
   }
 
+  void* ListTypeInterface::contiguousData(void* /*storage*/)
+  {
+    return nullptr;
+  }
+
+  void* ListTypeInterface::resizeContiguous(void** /*storage*/, size_t /*size*/)
+  {
+    return nullptr;
+  }
+
   namespace detail
   {
     void typeFail(const char* typeName, const char* operation)
@@ -271,6 +271,8 @@ KA_WARNING_POP()
 
     using H = ssl_socket_type::lowest_layer_type::_native_handle;
     static void setSocketNativeOptions(H, int) {}
+    template<typename L>
+    static bool isLocalPeer(L&) {return false;}
 
     struct _mutable_buffer_sequence
     {
@@ -336,6 +338,14 @@ KA_WARNING_POP()
       _async_read_next_layer(s, b, h);
     }
 
+    /// The mock does not distinguish partial reads from complete reads:
+    /// handlers report themselves the number of transferred bytes.
+    template<typename NetSslSocket, typename NetTransferHandler>
+    static void async_read_some(NetSslSocket& s, _mutable_buffer_sequence b, NetTransferHandler h)
+    {
+      async_read(s, b, h);
+    }
+
     using _anyAsyncWriterNextLayer = std::function<void (ssl_socket_type::next_layer_type&, const std::vector<_const_buffer_sequence>&, _anyTransferHandler)>;
     static _anyAsyncWriterNextLayer _async_write_next_layer;
 
@@ -558,3 +558,128 @@ TEST(NetReceiveMessage, Asio)
 
   close<N>(clientSideSocket);
 }
+
+////////////////////////////////////////////////////////////////////////////////
+/// NetReceiveMessageBuffered tests:
+////////////////////////////////////////////////////////////////////////////////
+
+namespace mock
+{
+  /// Appends a complete message (header and payload) to `bytes`.
+  inline void appendMessage(std::vector<unsigned char>& bytes, qi::uint32_t id,
+                            const std::string& payload)
+  {
+    qi::Message::Header header;
+    header.id = id;
+    header.size = static_cast<qi::uint32_t>(payload.size());
+    auto* p = reinterpret_cast<const unsigned char*>(&header);
+    bytes.insert(bytes.end(), p, p + sizeof(header));
+    bytes.insert(bytes.end(), payload.begin(), payload.end());
+  }
+} // namespace mock
+
+TEST(NetReceiveMessageBuffered, ReceivesSeveralMessagesInOneRead)
+{
+  using namespace qi;
+  using namespace qi::sock;
+  using N = mock::Network;
+  using S = SslSocket<N>;
+
+  std::vector<unsigned char> bytes;
+  mock::appendMessage(bytes, 1u, "abc");
+  mock::appendMessage(bytes, 2u, "");
+  mock::appendMessage(bytes, 3u, "defgh");
+
+  int readCount = 0;
+  auto _ = ka::scoped_set_and_restore(
+    N::_async_read_next_layer,
+    [&](S::next_layer_type&, N::_mutable_buffer_sequence buf, N::_anyTransferHandler h) {
+      ++readCount;
+      if (readCount > 1)
+      {
+        h(ErrorCode<N>{ErrorCode<N>::shutdown}, 0u);
+        return;
+      }
+      ASSERT_GE(std::distance(buf.begin, buf.end), static_cast<std::ptrdiff_t>(bytes.size()));
+      std::copy(bytes.begin(), bytes.end(), buf.begin);
+      h(ErrorCode<N>{}, bytes.size());
+    }
+  );
+  SslContext<N> context;
+  auto socket = makeSslSocketPtr<N>(N::defaultIoService(), context);
+  const size_t maxPayload = 10000;
+  ReceiveBuffer receiveBuffer{1024};
+  Message msg;
+  std::vector<std::pair<unsigned int, std::string>> received;
+  ErrorCode<N> lastError;
+  receiveMessageBuffered<N>(socket, &receiveBuffer, &msg, SslEnabled{false}, maxPayload,
+    [&](ErrorCode<N> e, Message* m) -> boost::optional<Message*> {
+      if (e)
+      {
+        lastError = e;
+        return {};
+      }
+      const auto& buffer = m->buffer();
+      received.emplace_back(m->id(),
+        std::string(static_cast<const char*>(buffer.data()), buffer.size()));
+      m->setBuffer(Buffer{});
+      return {m};
+    });
+  const std::vector<std::pair<unsigned int, std::string>> expected{
+    {1u, "abc"}, {2u, ""}, {3u, "defgh"}
+  };
+  ASSERT_EQ(expected, received);
+  ASSERT_EQ(2, readCount);
+  ASSERT_EQ(ErrorCode<N>{ErrorCode<N>::shutdown}, lastError);
+}
+
+TEST(NetReceiveMessageBuffered, ReadsPayloadBiggerThanBufferDirectlyInMessage)
+{
+  using namespace qi;
+  using namespace qi::sock;
+  using N = mock::Network;
+  using S = SslSocket<N>;
+
+  const std::string payload(200, 'x');
+  std::vector<unsigned char> bytes;
+  mock::appendMessage(bytes, 1u, payload);
+  const std::size_t bufferCapacity = 64u;
+
+  std::vector<std::size_t> readSizes;
+  std::size_t offset = 0u;
+  auto _ = ka::scoped_set_and_restore(
+    N::_async_read_next_layer,
+    [&](S::next_layer_type&, N::_mutable_buffer_sequence buf, N::_anyTransferHandler h) {
+      const auto size = std::min<std::size_t>(std::distance(buf.begin, buf.end),
+                                              bytes.size() - offset);
+      readSizes.push_back(size);
+      if (size == 0u)
+      {
+        h(ErrorCode<N>{ErrorCode<N>::shutdown}, 0u);
+        return;
+      }
+      std::copy(bytes.begin() + offset, bytes.begin() + offset + size, buf.begin);
+      offset += size;
+      h(ErrorCode<N>{}, size);
+    }
+  );
+  SslContext<N> context;
+  auto socket = makeSslSocketPtr<N>(N::defaultIoService(), context);
+  const size_t maxPayload = 10000;
+  ReceiveBuffer receiveBuffer{bufferCapacity};
+  Message msg;
+  std::string received;
+  receiveMessageBuffered<N>(socket, &receiveBuffer, &msg, SslEnabled{false}, maxPayload,
+    [&](ErrorCode<N> e, Message* m) -> boost::optional<Message*> {
+      if (e) return {};
+      const auto& buffer = m->buffer();
+      received.assign(static_cast<const char*>(buffer.data()), buffer.size());
+      return {};
+    });
+  ASSERT_EQ(payload, received);
+  // One read fills the buffer, then the rest of the payload is read at once.
+  const std::vector<std::size_t> expectedReadSizes{
+    bufferCapacity, sizeof(Message::Header) + payload.size() - bufferCapacity
+  };
+  ASSERT_EQ(expectedReadSizes, readSizes);
+}
@@ -329,3 +329,129 @@ TEST(NetSendMessageEnqueue, MultipleSendsFromMultipleThreadsAsio)
   // Allow detached thread to finish.
   for (auto& t: sendThreads) t.join();
 }
+
+TEST(NetSendMessageEnqueue, EnqueuedMessagesAreSentInOneWrite)
+{
+  using namespace qi;
+  using namespace qi::sock;
+  using N = mock::Network;
+
+  std::vector<std::size_t> writeBufferCounts;
+  std::vector<N::_anyTransferHandler> pendingWrites;
+  auto scopedWrite = ka::scoped_set_and_restore(
+    N::_async_write_next_layer,
+    [&](SslSocket<N>::next_layer_type&, const std::vector<N::_const_buffer_sequence>& bufs,
+          N::_anyTransferHandler writeCont) {
+      writeBufferCounts.push_back(bufs.size());
+      pendingWrites.push_back(writeCont);
+    }
+  );
+  SslContext<N> context;
+  auto socket = makeSslSocketPtr<N>(N::defaultIoService(), context);
+  using I = std::list<Message>::const_iterator;
+  std::vector<unsigned int> sentIds;
+  SendMessageEnqueue<N, SslSocketPtr<N>> send{socket};
+  auto onSent = [&](ErrorCode<N> erc, I itMsg) {
+    if (!erc) sentIds.push_back(itMsg->id());
+    return true;
+  };
+  const unsigned int messageCount = 6u;
+  for (unsigned int i = 0u; i != messageCount; ++i)
+  {
+    Message msg;
+    msg.setId(i);
+    send(std::move(msg), SslEnabled{false}, onSent);
+  }
+  // Only the first message has been written, the other ones are waiting.
+  ASSERT_EQ(1u, pendingWrites.size());
+  pendingWrites.back()(success<ErrorCode<N>>(), 0u);
+  // All the waiting messages are written at once (2 buffers per message).
+  ASSERT_EQ(2u, pendingWrites.size());
+  pendingWrites.back()(success<ErrorCode<N>>(), 0u);
+  ASSERT_EQ(2u, pendingWrites.size());
+  const std::vector<std::size_t> expectedBufferCounts{2u, 2u * (messageCount - 1u)};
+  ASSERT_EQ(expectedBufferCounts, writeBufferCounts);
+  const std::vector<unsigned int> expectedIds{0u, 1u, 2u, 3u, 4u, 5u};
+  ASSERT_EQ(expectedIds, sentIds);
+}
+
+TEST(NetSendMessageEnqueue, BatchesAreBoundedByLimits)
+{
+  using namespace qi;
+  using namespace qi::sock;
+  using N = mock::Network;
+
+  std::vector<std::size_t> writeBufferCounts;
+  std::vector<N::_anyTransferHandler> pendingWrites;
+  auto scopedWrite = ka::scoped_set_and_restore(
+    N::_async_write_next_layer,
+    [&](SslSocket<N>::next_layer_type&, const std::vector<N::_const_buffer_sequence>& bufs,
+          N::_anyTransferHandler writeCont) {
+      writeBufferCounts.push_back(bufs.size());
+      pendingWrites.push_back(writeCont);
+    }
+  );
+  SslContext<N> context;
+  auto socket = makeSslSocketPtr<N>(N::defaultIoService(), context);
+  using I = std::list<Message>::const_iterator;
+  SendBatchLimits limits;
+  limits.maxBuffers = 4u; // 2 messages without payload
+  SendMessageEnqueue<N, SslSocketPtr<N>> send{socket, limits};
+  unsigned int sentCount = 0u;
+  auto onSent = [&](ErrorCode<N>, I) {
+    ++sentCount;
+    return true;
+  };
+  for (int i = 0; i != 6; ++i)
+    send(Message{}, SslEnabled{false}, onSent);
+  // Completing a write starts the next one, if any.
+  for (std::size_t i = 0u; i != pendingWrites.size(); ++i)
+  {
+    auto writeCont = pendingWrites[i];
+    writeCont(success<ErrorCode<N>>(), 0u);
+  }
+  ASSERT_EQ(6u, sentCount);
+  const std::vector<std::size_t> expectedBufferCounts{2u, 4u, 4u, 2u};
+  ASSERT_EQ(expectedBufferCounts, writeBufferCounts);
+}
+
+TEST(NetSendMessageEnqueue, WriteErrorIsReportedForEveryMessageOfTheBatch)
+{
+  using namespace qi;
+  using namespace qi::sock;
+  using N = mock::Network;
+
+  std::vector<N::_anyTransferHandler> pendingWrites;
+  auto scopedWrite = ka::scoped_set_and_restore(
+    N::_async_write_next_layer,
+    [&](SslSocket<N>::next_layer_type&, const std::vector<N::_const_buffer_sequence>&,
+          N::_anyTransferHandler writeCont) {
+      pendingWrites.push_back(writeCont);
+    }
+  );
+  SslContext<N> context;
+  auto socket = makeSslSocketPtr<N>(N::defaultIoService(), context);
+  using I = std::list<Message>::const_iterator;
+  std::vector<unsigned int> failedIds;
+  SendMessageEnqueue<N, SslSocketPtr<N>> send{socket};
+  auto onSent = [&](ErrorCode<N> erc, I itMsg) {
+    if (erc) failedIds.push_back(itMsg->id());
+    // Stop at the first error.
+    return !erc;
+  };
+  const unsigned int messageCount = 4u;
+  for (unsigned int i = 0u; i != messageCount; ++i)
+  {
+    Message msg;
+    msg.setId(i);
+    send(std::move(msg), SslEnabled{false}, onSent);
+  }
+  ASSERT_EQ(1u, pendingWrites.size());
+  pendingWrites.back()(success<ErrorCode<N>>(), 0u);
+  // The three other messages are written at once, and the write fails.
+  ASSERT_EQ(2u, pendingWrites.size());
+  pendingWrites.back()(ErrorCode<N>{ErrorCode<N>::unknown}, 0u);
+  ASSERT_EQ(2u, pendingWrites.size());
+  const std::vector<unsigned int> expectedIds{1u, 2u, 3u};
+  ASSERT_EQ(expectedIds, failedIds);
+}
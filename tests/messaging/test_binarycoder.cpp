@@ -6,8 +6,14 @@
 */
 
 #include <gtest/gtest.h>
+#include <cstring>
+#include <limits>
+#include <list>
 #include <map>
+#include <vector>
+#include <boost/optional.hpp>
 #include <qi/buffer.hpp>
+#include <qi/bufferview.hpp>
 #include <qi/binarycodec.hpp>
 #include <qi/session.hpp>
 #include <limits.h>
@@ -387,6 +393,80 @@ TEST(TestBind, serializeBuffer)
 
 }
 
+TEST(TestBind, serializeVectorFloats)
+{
+  qi::Buffer buf;
+  qi::BufferReader bufr(buf);
+  std::vector<float> v(100000);
+  for (std::size_t i = 0; i < v.size(); ++i)
+    v[i] = static_cast<float>(i) / 3.f;
+  qi::encodeBinary(&buf, v);
+
+  std::vector<float> v1;
+  qi::decodeBinary(&bufr, &v1);
+  EXPECT_EQ(v, v1);
+}
+
+TEST(TestBind, serializeContiguousListSameAsElementWise)
+{
+  const std::vector<int> v{1, -2, 3, INT_MAX, INT_MIN};
+  const std::list<int> l(v.begin(), v.end());
+
+  qi::Buffer bufVector;
+  qi::encodeBinary(&bufVector, v);
+  qi::Buffer bufList;
+  qi::encodeBinary(&bufList, l);
+
+  ASSERT_EQ(bufList.size(), bufVector.size());
+  EXPECT_EQ(0, memcmp(bufList.data(), bufVector.data(), bufList.size()));
+
+  // Decode from the element-wise encoding into a contiguous list and back.
+  qi::BufferReader bufrList(bufList);
+  std::vector<int> v1;
+  qi::decodeBinary(&bufrList, &v1);
+  EXPECT_EQ(v, v1);
+
+  qi::BufferReader bufrVector(bufVector);
+  std::list<int> l1;
+  qi::decodeBinary(&bufrVector, &l1);
+  EXPECT_EQ(l, l1);
+}
+
+TEST(TestBind, serializeVectorUCharsAndInt64s)
+{
+  qi::Buffer buf;
+  qi::BufferReader bufr(buf);
+  const std::vector<unsigned char> vuc{0, 1, 127, 128, 255};
+  const std::vector<qi::int64_t> vi64{0, -1, std::numeric_limits<qi::int64_t>::max()};
+  const std::vector<double> vd;
+  qi::encodeBinary(&buf, vuc);
+  qi::encodeBinary(&buf, vd);
+  qi::encodeBinary(&buf, vi64);
+
+  std::vector<unsigned char> vuc1;
+  std::vector<double> vd1;
+  std::vector<qi::int64_t> vi641;
+  qi::decodeBinary(&bufr, &vuc1);
+  qi::decodeBinary(&bufr, &vd1);
+  qi::decodeBinary(&bufr, &vi641);
+  EXPECT_EQ(vuc, vuc1);
+  EXPECT_EQ(vd, vd1);
+  EXPECT_EQ(vi64, vi641);
+}
+
+TEST(TestBind, deserializeTruncatedVectorFails)
+{
+  qi::Buffer buf;
+  qi::encodeBinary(&buf, std::vector<qi::uint32_t>(10, 42u));
+
+  qi::Buffer truncated;
+  truncated.write(buf.data(), buf.size() - 1);
+  qi::BufferReader bufr(truncated);
+  std::vector<qi::uint32_t> v;
+  EXPECT_ANY_THROW(qi::decodeBinary(&bufr, &v));
+  EXPECT_TRUE(v.empty());
+}
+
 TEST(TestBind, serializeAllTypes)
 {
   qi::Buffer      buf;
@@ -540,6 +620,76 @@ TEST(TestBind, SerializeCustomComplex)
   ASSERT_EQ(comp, compout);
 }
 
+TEST(TestBind, SerializeCustomSameAsMemberWise)
+{
+  qi::Buffer bufStruct;
+  qi::encodeBinary(&bufStruct, point(12, -13));
+  qi::Buffer bufMembers;
+  qi::encodeBinary(&bufMembers, 12);
+  qi::encodeBinary(&bufMembers, -13);
+
+  ASSERT_EQ(bufMembers.size(), bufStruct.size());
+  EXPECT_EQ(0, memcmp(bufMembers.data(), bufStruct.data(), bufMembers.size()));
+}
+
+TEST(TestBind, SerializeNestedContainersRepeatedly)
+{
+  using Nested = std::map<std::string, boost::optional<Complex>>;
+  Complex comp;
+  comp.foo = 2.5f;
+  comp.points.push_back(point(1, 2));
+  comp.baz = "nested";
+  comp.stuff.push_back(std::vector<int>{4, 5, 6});
+  const Nested nested{ { "empty", boost::none }, { "set", comp } };
+
+  // The same types are encoded and decoded several times, in the same
+  // buffer, as they would be in successive calls.
+  qi::Buffer buf;
+  qi::BufferReader bufr(buf);
+  for (int i = 0; i < 3; ++i)
+    qi::encodeBinary(&buf, nested);
+  for (int i = 0; i < 3; ++i)
+  {
+    Nested nestedout;
+    qi::decodeBinary(&bufr, &nestedout);
+    EXPECT_TRUE(nested == nestedout);
+  }
+}
+
+TEST(TestBind, SerializeStructOfDynamicValues)
+{
+  const std::vector<qi::AnyValue> values{ qi::AnyValue::from(42),
+                                          qi::AnyValue::from(std::string("foo")),
+                                          qi::AnyValue::from(std::vector<Point>{ point(1, 2) }) };
+  qi::Buffer buf;
+  qi::BufferReader bufr(buf);
+  qi::encodeBinary(&buf, values);
+
+  std::vector<qi::AnyValue> valuesout;
+  qi::decodeBinary(&bufr, &valuesout);
+  ASSERT_EQ(3u, valuesout.size());
+  EXPECT_EQ(42, valuesout[0].to<int>());
+  EXPECT_EQ("foo", valuesout[1].to<std::string>());
+  const auto points = valuesout[2].to<std::vector<Point>>();
+  ASSERT_EQ(1u, points.size());
+  EXPECT_EQ(point(1, 2), points[0]);
+}
+
+TEST(TestBind, deserializeTruncatedCustomFails)
+{
+  Complex comp;
+  comp.points.push_back(point(1, 2));
+  comp.baz = "truncated";
+  qi::Buffer buf;
+  qi::encodeBinary(&buf, comp);
+
+  qi::Buffer truncated;
+  truncated.write(buf.data(), buf.size() - 1);
+  qi::BufferReader bufr(truncated);
+  Complex compout;
+  EXPECT_ANY_THROW(qi::decodeBinary(&bufr, &compout));
+}
+
 //compilation of weird case. C++ typesystem Hell.
 TEST(TestBind, TestShPtr) {
   boost::shared_ptr<int> sh1;
@@ -649,3 +799,96 @@ TEST(testSerializable, Value) {
   qi::encodeBinary(&buf, gv);
   qi::decodeBinary(&bufr, &gv2);
 }
+
+namespace
+{
+  bool isWithin(const void* p, const qi::Buffer& buffer)
+  {
+    const char* begin = static_cast<const char*>(buffer.data());
+    const char* c = static_cast<const char*>(p);
+    return c >= begin && c < begin + buffer.size();
+  }
+}
+
+TEST(TestBind, deserializeStringViewWithoutCopy)
+{
+  qi::Buffer buf;
+  qi::encodeBinary(&buf, std::string("canard"));
+  qi::encodeBinary(&buf, std::vector<std::string>{"foo", "bar"});
+
+  qi::BufferReader bufr(buf);
+  qi::StringView view;
+  qi::decodeBinary(&bufr, &view);
+  std::vector<qi::StringView> views;
+  qi::decodeBinary(&bufr, &views);
+
+  const qi::Buffer& cbuf = buf;
+  EXPECT_EQ("canard", view.toString());
+  EXPECT_TRUE(isWithin(view.data(), cbuf));
+  ASSERT_EQ(2u, views.size());
+  EXPECT_EQ("foo", views[0].toString());
+  EXPECT_EQ("bar", views[1].toString());
+  EXPECT_TRUE(isWithin(views[1].data(), cbuf));
+
+  // The views keep their data when the buffer changes or goes away.
+  buf.clear();
+  qi::encodeBinary(&buf, std::string("poulet"));
+  buf = qi::Buffer();
+  EXPECT_EQ("canard", view.toString());
+  EXPECT_EQ("bar", views[1].toString());
+}
+
+TEST(TestBind, deserializeBufferViewWithoutCopy)
+{
+  qi::Buffer raw;
+  raw.write("canard", strlen("canard") + 1);
+  qi::Buffer buf;
+  qi::encodeBinary(&buf, raw);
+
+  qi::BufferReader bufr(buf);
+  qi::BufferView view;
+  qi::decodeBinary(&bufr, &view);
+  EXPECT_EQ(raw, view.toBuffer());
+  EXPECT_STREQ("canard", view.data());
+}
+
+TEST(TestBind, deserializeTruncatedViewsFails)
+{
+  // Strings and raw buffers are both serialized as their size and content.
+  qi::Buffer buf;
+  qi::encodeBinary(&buf, std::string("canard"));
+  qi::Buffer truncated;
+  truncated.write(buf.data(), buf.size() - 1);
+
+  // Both views report a read past the end the same way.
+  {
+    qi::BufferReader bufr(truncated);
+    qi::StringView view;
+    EXPECT_ANY_THROW(qi::decodeBinary(&bufr, &view));
+    EXPECT_TRUE(view.toString().empty());
+  }
+  {
+    qi::BufferReader bufr(truncated);
+    qi::BufferView view;
+    EXPECT_ANY_THROW(qi::decodeBinary(&bufr, &view));
+    EXPECT_EQ(0u, view.size());
+  }
+}
+
+TEST(TestBind, serializeViewsAsStringAndRaw)
+{
+  qi::Buffer raw;
+  raw.write("canard", strlen("canard"));
+  qi::Buffer buf;
+  qi::encodeBinary(&buf, qi::StringView("poulet"));
+  qi::encodeBinary(&buf, qi::BufferView(raw));
+
+  qi::BufferReader bufr(buf);
+  std::string s;
+  qi::decodeBinary(&bufr, &s);
+  qi::Buffer b;
+  qi::decodeBinary(&bufr, &b);
+  EXPECT_EQ("poulet", s);
+  EXPECT_EQ(raw, b);
+}
+
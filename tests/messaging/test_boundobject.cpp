@@ -0,0 +1,189 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include <boost/make_shared.hpp>
+#include <qi/anyobject.hpp>
+#include <qi/type/dynamicobjectbuilder.hpp>
+#include "src/messaging/boundobject.hpp"
+#include "src/messaging/messagesocket.hpp"
+
+namespace
+{
+  const unsigned int serviceId = 42u;
+  const int usualTimeoutMs = 5000;
+  const std::chrono::milliseconds usualTimeout{usualTimeoutMs};
+
+  /// Socket that only dispatches the messages it is given to the bound objects,
+  /// and records the messages sent through it.
+  class FakeSocket : public qi::MessageSocket
+  {
+  public:
+    qi::FutureSync<void> connect(const qi::Url&) override { return qi::Future<void>{nullptr}; }
+    qi::FutureSync<void> disconnect() override { return qi::Future<void>{nullptr}; }
+    bool ensureReading() override { return true; }
+    Status status() const override { return Status::Connected; }
+    boost::optional<qi::Url> remoteEndpoint() const override { return qi::Url{"tcp://127.0.0.1:1"}; }
+    qi::Url url() const override { return qi::Url{"tcp://127.0.0.1:2"}; }
+
+    bool send(qi::Message msg) override
+    {
+      if (onSend)
+        onSend(msg);
+      return true;
+    }
+
+    /// Dispatches the message as if it had been received. Messages are
+    /// dispatched in the strand of the socket, unless they are dispatched
+    /// inline.
+    qi::Future<bool> receive(qi::Message msg)
+    {
+      return _dispatcher.dispatch(std::move(msg));
+    }
+
+    std::function<void (const qi::Message&)> onSend;
+  };
+
+  using FakeSocketPtr = boost::shared_ptr<FakeSocket>;
+
+  qi::Message makeCall(unsigned int function, int arg, unsigned int service = serviceId)
+  {
+    static std::atomic<unsigned int> messageId{0u};
+    qi::Message msg(qi::Message::Type_Call,
+                    qi::MessageAddress(++messageId, service, qi::Message::GenericObject_Main,
+                                       function));
+    msg.setValues({qi::AnyReference::from(arg)});
+    return msg;
+  }
+}
+
+TEST(BoundObjectCallContext, CurrentSocketIsTheCallerOfEachConcurrentCall)
+{
+  qi::BoundObjectPtr bo;
+  std::promise<void> firstEntered, secondEntered;
+  std::mutex mutex;
+  std::vector<qi::MessageSocketPtr> observedSockets(2);
+  bool overlapped = true;
+  int callCount = 0;
+
+  qi::DynamicObjectBuilder builder;
+  const auto funcId = builder.advertiseMethod("call", [&](int index) {
+    // Wait for the other call to be executing, so that both run concurrently.
+    (index == 0 ? firstEntered : secondEntered).set_value();
+    const auto other = (index == 0 ? secondEntered : firstEntered).get_future();
+    const bool otherEntered = other.wait_for(usualTimeout) == std::future_status::ready;
+    std::lock_guard<std::mutex> lock{mutex};
+    overlapped = overlapped && otherEntered;
+    ++callCount;
+    observedSockets[index] = bo->currentSocket();
+    return index;
+  });
+  // Otherwise the calls would be serialized in the strand of the object,
+  // outside of the dispatching threads. Direct calls of the other tests run
+  // in the dispatching thread for the same reason.
+  builder.setThreadingModel(qi::ObjectThreadingModel_MultiThread);
+  bo = qi::makeServiceBoundObjectPtr(serviceId, builder.object(), qi::MetaCallType_Direct);
+
+  const auto socket0 = boost::make_shared<FakeSocket>();
+  const auto socket1 = boost::make_shared<FakeSocket>();
+  bo->bindToSocket(socket0);
+  bo->bindToSocket(socket1);
+
+  auto dispatched0 = socket0->receive(makeCall(funcId, 0));
+  auto dispatched1 = socket1->receive(makeCall(funcId, 1));
+  ASSERT_EQ(qi::FutureState_FinishedWithValue, dispatched0.wait(usualTimeoutMs));
+  ASSERT_EQ(qi::FutureState_FinishedWithValue, dispatched1.wait(usualTimeoutMs));
+
+  EXPECT_EQ(2, callCount);
+  EXPECT_TRUE(overlapped);
+  EXPECT_EQ(qi::MessageSocketPtr(socket0), observedSockets[0]);
+  EXPECT_EQ(qi::MessageSocketPtr(socket1), observedSockets[1]);
+  // The socket is only known during the call.
+  EXPECT_FALSE(bo->currentSocket());
+
+  bo->unbindFromSocket(socket0);
+  bo->unbindFromSocket(socket1);
+}
+
+TEST(BoundObjectCallContext, CurrentSocketIsRestoredAfterANestedCall)
+{
+  qi::BoundObjectPtr outer, inner;
+  FakeSocketPtr socket = boost::make_shared<FakeSocket>();
+  const unsigned int innerServiceId = serviceId + 1u;
+
+  qi::MessageSocketPtr innerObserved, outerObservedInNested, outerObservedAfter, innerObservedAfter;
+  qi::DynamicObjectBuilder innerBuilder;
+  const auto innerFuncId = innerBuilder.advertiseMethod("call", [&](int) {
+    innerObserved = inner->currentSocket();
+    outerObservedInNested = outer->currentSocket();
+  });
+  innerBuilder.setThreadingModel(qi::ObjectThreadingModel_MultiThread);
+  inner = qi::makeServiceBoundObjectPtr(innerServiceId, innerBuilder.object(),
+                                        qi::MetaCallType_Direct);
+
+  qi::DynamicObjectBuilder outerBuilder;
+  const auto outerFuncId = outerBuilder.advertiseMethod("call", [&](int) {
+    // The call is dispatched in the strand of the socket, so the nested call
+    // is dispatched synchronously in this thread.
+    socket->receive(makeCall(innerFuncId, 0, innerServiceId)).value();
+    outerObservedAfter = outer->currentSocket();
+    innerObservedAfter = inner->currentSocket();
+  });
+  outerBuilder.setThreadingModel(qi::ObjectThreadingModel_MultiThread);
+  outer = qi::makeServiceBoundObjectPtr(serviceId, outerBuilder.object(), qi::MetaCallType_Direct);
+
+  outer->bindToSocket(socket);
+  inner->bindToSocket(socket);
+
+  ASSERT_EQ(qi::FutureState_FinishedWithValue,
+            socket->receive(makeCall(outerFuncId, 0)).wait(usualTimeoutMs));
+  EXPECT_EQ(qi::MessageSocketPtr(socket), innerObserved);
+  EXPECT_EQ(qi::MessageSocketPtr(socket), outerObservedInNested);
+  EXPECT_EQ(qi::MessageSocketPtr(socket), outerObservedAfter);
+  EXPECT_FALSE(innerObservedAfter);
+
+  outer->unbindFromSocket(socket);
+  inner->unbindFromSocket(socket);
+}
+
+TEST(BoundObjectCallContext, CurrentSocketIsNotKnownWhenAnAsyncCallFinishes)
+{
+  qi::BoundObjectPtr bo;
+  FakeSocketPtr socket = boost::make_shared<FakeSocket>();
+  qi::Promise<int> result;
+
+  qi::DynamicObjectBuilder builder;
+  const auto funcId = builder.advertiseMethod("call", [&](int) {
+    return result.future();
+  });
+  builder.setThreadingModel(qi::ObjectThreadingModel_MultiThread);
+  bo = qi::makeServiceBoundObjectPtr(serviceId, builder.object(), qi::MetaCallType_Direct);
+  bo->bindToSocket(socket);
+
+  std::promise<qi::MessageSocketPtr> observedOnReply;
+  socket->onSend = [&](const qi::Message& msg) {
+    if (msg.type() == qi::Message::Type_Reply)
+      observedOnReply.set_value(bo->currentSocket());
+  };
+
+  ASSERT_EQ(qi::FutureState_FinishedWithValue,
+            socket->receive(makeCall(funcId, 0)).wait(usualTimeoutMs));
+  EXPECT_FALSE(bo->currentSocket());
+
+  // The result is set from another thread, where the reply is sent.
+  std::thread([&] { result.setValue(12); }).join();
+  auto observed = observedOnReply.get_future();
+  ASSERT_EQ(std::future_status::ready, observed.wait_for(usualTimeout));
+  EXPECT_FALSE(observed.get());
+
+  bo->unbindFromSocket(socket);
+}
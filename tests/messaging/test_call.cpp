@@ -18,6 +18,7 @@
 #include <qi/application.hpp>
 #include <qi/eventloop.hpp>
 #include <qi/anyobject.hpp>
+#include <qi/bufferview.hpp>
 #include <qi/type/dynamicobject.hpp>
 #include <qi/type/dynamicobjectbuilder.hpp>
 #include <qi/type/objecttypebuilder.hpp>
@@ -363,6 +364,54 @@ TEST(TestCall, TestFloatToDoubleConvertion)
   qi::Future<int> fut = proxy.async<int>("fakeRGB", "Haha", 42, duration);
 }
 
+TEST(TestCall, CallMethodsTakingViews)
+{
+  TestSessionPair p;
+  qi::DynamicObjectBuilder ob;
+  ob.advertiseMethod("echo", [](const qi::StringView& s) { return s; });
+  ob.advertiseMethod("concat", [](const qi::StringView& a, const std::string& b) {
+    return a.toString() + b;
+  });
+  ob.advertiseMethod("rawSize", [](const qi::BufferView& b) { return static_cast<int>(b.size()); });
+  qi::AnyObject obj(ob.object());
+  p.server()->registerService("views", obj).value();
+  qi::AnyObject proxy = p.client()->service("views").value();
+
+  EXPECT_EQ("canard", proxy.call<std::string>("echo", std::string("canard")));
+  EXPECT_EQ("", proxy.call<std::string>("echo", std::string()));
+  EXPECT_EQ("foobar", proxy.call<std::string>("concat", std::string("foo"), std::string("bar")));
+  qi::Buffer buf;
+  buf.write("canard", strlen("canard") + 1);
+  EXPECT_EQ(static_cast<int>(strlen("canard") + 1), proxy.call<int>("rawSize", buf));
+}
+
+TEST(TestCall, DynamicFunctionsReceiveStringsAsStdString)
+{
+  // Arguments are only decoded as views for methods taking views, which is
+  // not the case of dynamic functions: they keep getting the types of the
+  // signature.
+  const auto describe = [](const qi::AnyReference& arg) {
+    return arg.type()->info() == qi::typeOf<std::string>()->info()
+      ? arg.to<std::string>()
+      : "unexpected type " + arg.type()->info().asDemangledString();
+  };
+  TestSessionPair p;
+  qi::DynamicObjectBuilder ob;
+  ob.xAdvertiseMethod("s", "dynamic", "(s)", qi::AnyFunction::fromDynamicFunction(
+    [=](const qi::AnyReferenceVector& args) {
+      // The first argument is the object.
+      return qi::AnyReference::from(describe(args.at(1))).clone();
+    }));
+  ob.advertiseMethod("anyArguments", [=](const qi::AnyArguments& args) {
+    return describe(args.args().at(0).asReference());
+  });
+  p.server()->registerService("dynamic", ob.object()).value();
+  qi::AnyObject proxy = p.client()->service("dynamic").value();
+
+  EXPECT_EQ("canard", proxy.call<std::string>("dynamic", std::string("canard")));
+  EXPECT_EQ("canard", proxy.call<std::string>("anyArguments", std::string("canard")));
+}
+
 struct TestCallOptional : testing::Test
 {
   void SetUp() override
@@ -0,0 +1,147 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#include <atomic>
+#include <thread>
+#include <gtest/gtest.h>
+#include <qi/strand.hpp>
+#include "src/messaging/messagedispatcher.hpp"
+
+namespace
+{
+  const qi::MilliSeconds defaultTimeout{ 2000 };
+  const unsigned int serviceId = 42;
+  const unsigned int objectId = 12;
+
+  qi::Message makeMessage(unsigned int service = serviceId, unsigned int object = objectId)
+  {
+    qi::Message msg;
+    msg.setService(service);
+    msg.setObject(object);
+    return msg;
+  }
+}
+
+TEST(MessageDispatcher, MessageWithoutRecipientIsNotHandled)
+{
+  qi::Strand strand;
+  qi::MessageDispatcher dispatcher{ strand };
+  dispatcher.messagePendingConnect(serviceId, objectId,
+    [](const qi::Message&) { return qi::DispatchStatus::MessageHandled; });
+
+  auto fut = dispatcher.dispatch(makeMessage(serviceId + 1, objectId));
+  ASSERT_EQ(qi::FutureState_FinishedWithValue, fut.wait(defaultTimeout));
+  EXPECT_FALSE(fut.value());
+}
+
+TEST(MessageDispatcher, MayBlockHandlerIsCalledFromTheExecutionContext)
+{
+  qi::Strand strand;
+  qi::MessageDispatcher dispatcher{ strand };
+  std::atomic<bool> calledInStrand{ false };
+  dispatcher.messagePendingConnect(serviceId, objectId, [&](const qi::Message&) {
+    calledInStrand = strand.isInThisContext();
+    return qi::DispatchStatus::MessageHandled;
+  });
+
+  auto fut = dispatcher.dispatch(makeMessage());
+  ASSERT_EQ(qi::FutureState_FinishedWithValue, fut.wait(defaultTimeout));
+  EXPECT_TRUE(fut.value());
+  EXPECT_TRUE(calledInStrand.load());
+}
+
+TEST(MessageDispatcher, NonBlockingHandlersAreCalledInline)
+{
+  qi::Strand strand;
+  qi::MessageDispatcher dispatcher{ strand };
+  std::thread::id callingThread;
+  dispatcher.messagePendingConnect(serviceId, objectId, [&](const qi::Message&) {
+    callingThread = std::this_thread::get_id();
+    return qi::DispatchStatus::MessageHandled;
+  }, qi::MessageDispatcher::HandlerKind::NonBlocking);
+
+  auto fut = dispatcher.dispatch(makeMessage());
+  ASSERT_TRUE(fut.isFinished());
+  EXPECT_TRUE(fut.value());
+  EXPECT_EQ(std::this_thread::get_id(), callingThread);
+}
+
+TEST(MessageDispatcher, RecipientWithAMayBlockHandlerIsNotDispatchedInline)
+{
+  qi::Strand strand;
+  qi::MessageDispatcher dispatcher{ strand };
+  std::atomic<int> calledInStrandCount{ 0 };
+  auto handler = [&](const qi::Message&) {
+    if (strand.isInThisContext())
+      ++calledInStrandCount;
+    return qi::DispatchStatus::MessageNotHandled;
+  };
+  dispatcher.messagePendingConnect(serviceId, objectId, handler,
+                                   qi::MessageDispatcher::HandlerKind::NonBlocking);
+  const auto link = dispatcher.messagePendingConnect(serviceId, objectId, handler);
+
+  auto fut = dispatcher.dispatch(makeMessage());
+  ASSERT_EQ(qi::FutureState_FinishedWithValue, fut.wait(defaultTimeout));
+  EXPECT_FALSE(fut.value());
+  EXPECT_EQ(2, calledInStrandCount.load());
+
+  // Once the blocking handler is gone, the recipient is dispatched inline again.
+  EXPECT_TRUE(dispatcher.messagePendingDisconnect(serviceId, objectId, link));
+  fut = dispatcher.dispatch(makeMessage());
+  EXPECT_TRUE(fut.isFinished());
+  EXPECT_EQ(2, calledInStrandCount.load());
+}
+
+TEST(MessageDispatcher, DisconnectedHandlerIsNotCalledForPendingMessages)
+{
+  qi::Strand strand;
+  qi::MessageDispatcher dispatcher{ strand };
+  std::atomic<bool> called{ false };
+  const auto link = dispatcher.messagePendingConnect(serviceId, objectId, [&](const qi::Message&) {
+    called = true;
+    return qi::DispatchStatus::MessageHandled;
+  });
+
+  qi::Future<bool> fut;
+  {
+    // Blocks the strand until the handler is disconnected.
+    qi::Promise<void> unblock;
+    auto blocker = strand.async([=] { unblock.future().wait(); });
+    fut = dispatcher.dispatch(makeMessage());
+    EXPECT_TRUE(dispatcher.messagePendingDisconnect(serviceId, objectId, link));
+    unblock.setValue(nullptr);
+    blocker.wait();
+  }
+
+  ASSERT_EQ(qi::FutureState_FinishedWithValue, fut.wait(defaultTimeout));
+  EXPECT_FALSE(fut.value());
+  EXPECT_FALSE(called.load());
+  EXPECT_FALSE(dispatcher.messagePendingDisconnect(serviceId, objectId, link));
+}
+
+TEST(MessageDispatcher, HandlerConnectedBeforeDispatchIsCalledForPendingMessages)
+{
+  qi::Strand strand;
+  qi::MessageDispatcher dispatcher{ strand };
+  std::atomic<bool> called{ false };
+
+  qi::Future<bool> fut;
+  {
+    // Blocks the strand until the handler is connected.
+    qi::Promise<void> unblock;
+    auto blocker = strand.async([=] { unblock.future().wait(); });
+    fut = dispatcher.dispatch(makeMessage());
+    dispatcher.messagePendingConnect(serviceId, objectId, [&](const qi::Message&) {
+      called = true;
+      return qi::DispatchStatus::MessageHandled;
+    });
+    unblock.setValue(nullptr);
+    blocker.wait();
+  }
+
+  ASSERT_EQ(qi::FutureState_FinishedWithValue, fut.wait(defaultTimeout));
+  EXPECT_TRUE(fut.value());
+  EXPECT_TRUE(called.load());
+}
@@ -0,0 +1,117 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#include <gtest/gtest.h>
+#include <qi/os.hpp>
+#include <qi/type/metaobject.hpp>
+#include "src/messaging/metaobjectcache_p.hpp"
+
+namespace
+{
+  qi::MetaObject makeMetaObject(const std::string& methodName,
+                                const std::string& description = {})
+  {
+    qi::MetaMethodBuilder method("s", methodName, "(s)", description);
+    qi::MetaObjectBuilder builder;
+    builder.addMethod(method, 100);
+    return builder.metaObject();
+  }
+
+  qi::ObjectUid makeUid(int i)
+  {
+    static int objects[8];
+    return qi::ObjectUid{qi::os::getMachineIdAsUuid(), qi::os::getProcessUuid(), &objects[i]};
+  }
+}
+
+TEST(MetaObjectCache, FindsTheMetaObjectOfAnObject)
+{
+  qi::MetaObjectCache cache(16);
+  const auto mo = makeMetaObject("foo");
+  cache.insert(makeUid(0), mo);
+
+  const auto found = cache.find(makeUid(0));
+  ASSERT_TRUE(found);
+  EXPECT_EQ(qi::contentDigest(mo), qi::contentDigest(*found));
+  EXPECT_EQ(100, found->methodId("foo::(s)"));
+  EXPECT_FALSE(cache.find(makeUid(1)));
+}
+
+TEST(MetaObjectCache, StoresSameContentOnce)
+{
+  qi::MetaObjectCache cache(16);
+  cache.insert(makeUid(0), makeMetaObject("foo"));
+  cache.insert(makeUid(1), makeMetaObject("foo"));
+  EXPECT_EQ(1u, cache.size());
+  cache.insert(makeUid(2), makeMetaObject("bar"));
+  EXPECT_EQ(2u, cache.size());
+}
+
+TEST(MetaObjectCache, EvictsOldestMetaObjects)
+{
+  qi::MetaObjectCache cache(2);
+  cache.insert(makeUid(0), makeMetaObject("foo"));
+  cache.insert(makeUid(1), makeMetaObject("bar"));
+  cache.insert(makeUid(2), makeMetaObject("baz"));
+  EXPECT_EQ(2u, cache.size());
+  EXPECT_FALSE(cache.find(makeUid(0)));
+  EXPECT_TRUE(cache.find(makeUid(1)));
+  EXPECT_TRUE(cache.find(makeUid(2)));
+}
+
+TEST(MetaObjectCache, ForgetsOldestObjectsOfTheSameMetaObject)
+{
+  qi::MetaObjectCache cache(2);
+  cache.insert(makeUid(0), makeMetaObject("foo"));
+  cache.insert(makeUid(1), makeMetaObject("foo"));
+  cache.insert(makeUid(2), makeMetaObject("foo"));
+  EXPECT_EQ(1u, cache.size());
+  EXPECT_FALSE(cache.find(makeUid(0)));
+  EXPECT_TRUE(cache.find(makeUid(1)));
+  EXPECT_TRUE(cache.find(makeUid(2)));
+
+  // A metaobject is evicted with the last object referring to it.
+  cache.insert(makeUid(3), makeMetaObject("bar"));
+  cache.insert(makeUid(4), makeMetaObject("bar"));
+  EXPECT_EQ(1u, cache.size());
+  EXPECT_FALSE(cache.find(makeUid(2)));
+  EXPECT_EQ(100, cache.find(makeUid(4))->methodId("bar::(s)"));
+}
+
+TEST(MetaObjectCache, InsertingAnObjectAgainRefreshesIt)
+{
+  qi::MetaObjectCache cache(2);
+  cache.insert(makeUid(0), makeMetaObject("foo"));
+  cache.insert(makeUid(1), makeMetaObject("bar"));
+  cache.insert(makeUid(0), makeMetaObject("baz"));
+  EXPECT_EQ(2u, cache.size());
+  cache.insert(makeUid(2), makeMetaObject("baz"));
+  EXPECT_EQ(1u, cache.size());
+  EXPECT_FALSE(cache.find(makeUid(1)));
+  EXPECT_EQ(100, cache.find(makeUid(0))->methodId("baz::(s)"));
+}
+
+TEST(MetaObjectCache, DigestCoversDescriptions)
+{
+  EXPECT_EQ(qi::contentDigest(makeMetaObject("foo", "a")),
+            qi::contentDigest(makeMetaObject("foo", "a")));
+  EXPECT_NE(qi::contentDigest(makeMetaObject("foo", "a")),
+            qi::contentDigest(makeMetaObject("foo", "b")));
+}
+
+TEST(MetaObjectCache, DigestDelimitsFields)
+{
+  // The same characters, split differently between the description of the
+  // method and the one of the object.
+  qi::MetaMethodBuilder method0("s", "foo", "(s)", "ab");
+  qi::MetaObjectBuilder builder0;
+  builder0.addMethod(method0, 100);
+  builder0.setDescription("c");
+  qi::MetaMethodBuilder method1("s", "foo", "(s)", "a");
+  qi::MetaObjectBuilder builder1;
+  builder1.addMethod(method1, 100);
+  builder1.setDescription("bc");
+  EXPECT_NE(qi::contentDigest(builder0.metaObject()), qi::contentDigest(builder1.metaObject()));
+}
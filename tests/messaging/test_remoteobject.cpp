@@ -1,9 +1,14 @@
 #include <chrono>
 #include <future>
 #include <mutex>
+#include <thread>
+#include <vector>
 #include <gtest/gtest.h>
 #include <qi/jsoncodec.hpp>
 #include <qi/log.hpp>
+#include <qi/os.hpp>
+#include <qi/testutils/testutils.hpp>
+#include "../../src/messaging/metaobjectcache_p.hpp"
 #include "../../src/messaging/remoteobject_p.hpp"
 #include "../../src/messaging/server.hpp"
 
@@ -131,3 +136,61 @@ TEST_F(RemoteObject, CallingAVoidMethodSendsACallMessage)
   EXPECT_EQ(methodId, message.address().functionId);
 }
 
+
+TEST_F(RemoteObject, FetchingTheMetaObjectOfAKnownObjectSendsItsDigest)
+{
+  const unsigned int serviceId = 24u;
+  const qi::ObjectUid uid{qi::os::getMachineIdAsUuid(), qi::os::getProcessUuid(), this};
+
+  qi::MetaObjectBuilder mob;
+  auto mmb = makeMetaMethodBuilder();
+  mob.addMethod(mmb, 100);
+  const auto known = mob.metaObject();
+  qi::MetaObjectCache::instance().insert(uid, known);
+
+  // The remote end tells it supports digests.
+  qi::Message capabilities;
+  capabilities.setType(qi::Message::Type_Capability);
+  capabilities.setService(qi::Message::Service_Server);
+  capabilities.setValue(qi::CapabilityMap{{qi::capabilityname::metaObjectDigest, qi::AnyValue::from(true)}},
+                        qi::typeOf<qi::CapabilityMap>()->signature());
+  serverSocket->send(std::move(capabilities));
+  for (int i = 0; i < 100; ++i)
+  {
+    if (clientSocket->remoteCapability<bool>(qi::capabilityname::metaObjectDigest, false))
+      break;
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  }
+
+  // The test answers the request itself, keep the server from replying that
+  // nobody handled it.
+  serverSocket->messagePendingConnect(serviceId, qi::Message::GenericObject_Main,
+                                      [](const qi::Message&) {
+    return qi::DispatchStatus::MessageHandled;
+  });
+
+  auto remoteObject = qi::RemoteObject::makePtr(serviceId, qi::Message::GenericObject_Main, uid);
+  remoteObject->setTransportSocket(clientSocket);
+
+  auto futureMessage = nextClientToServerMessage(); // get ready to receive messages
+  auto fetched = remoteObject->fetchMetaObject();
+
+  auto status = futureMessage.wait_for(usualTimeout);
+  ASSERT_EQ(std::future_status::ready, status);
+  const auto request = futureMessage.get();
+  EXPECT_EQ(qi::Message::Type_Call, request.type());
+  EXPECT_EQ(qi::Message::BoundObjectFunction_MetaObjectIfChanged, request.address().functionId);
+  auto args = request.value("(I[C])", clientSocket);
+  const auto digest = qi::contentDigest(known);
+  EXPECT_EQ(std::vector<unsigned char>(digest.begin(), digest.end()),
+            args[1].to<std::vector<unsigned char>>());
+
+  // The remote end answers that the metaobject did not change: the known one
+  // is used.
+  qi::Message reply(qi::Message::Type_Reply, request.address());
+  const qi::MetaObject unchanged;
+  reply.setValue(unchanged, qi::typeOf<qi::MetaObject>()->signature());
+  serverSocket->send(reply);
+  ASSERT_TRUE(test::finishesWithValue(fetched));
+  EXPECT_EQ(100, remoteObject->metaObject().methodId(name + "::" + parametersSignature.toString()));
+}
@@ -172,3 +172,59 @@ TEST_P(ServiceDirectoryServiceRelativeEndpoint, EndpointsAreSorted)
   EXPECT_THAT(serv1Ep, WhenSortedBy(&qi::isPreferredEndpoint, serv1Ep));
   EXPECT_THAT(serv2Ep, WhenSortedBy(&qi::isPreferredEndpoint, serv2Ep));
 }
+
+namespace
+{
+
+struct ServiceDirectoryBatch : testing::Test
+{
+  ServiceDirectoryBatch()
+    : sbo(makeServiceBoundObjectPtr(qi::Message::Service_ServiceDirectory,
+                                    qi::AnyObject{},
+                                    qi::MetaCallType_Direct))
+  {
+    sd._setServiceBoundObject(sbo);
+  }
+
+  static qi::ServiceInfo serviceInfo(std::string name)
+  {
+    qi::ServiceInfo info;
+    info.setName(ka::mv(name));
+    info.setMachineId(qi::os::getMachineId());
+    info.setProcessId(static_cast<unsigned int>(qi::os::getpid()));
+    return info;
+  }
+
+  qi::BoundObjectPtr sbo;
+  qi::ServiceDirectory sd;
+};
+
+} // anonymous namespace
+
+TEST_F(ServiceDirectoryBatch, ServicesByNameSkipsUnknownAndPendingServices)
+{
+  sd.serviceReady(sd.registerService(serviceInfo("a")));
+  sd.serviceReady(sd.registerService(serviceInfo("b")));
+  sd.registerService(serviceInfo("pending"));
+
+  const auto infos = sd.servicesByName({"b", "unknown", "pending", "a"});
+  ASSERT_EQ(2u, infos.size());
+  EXPECT_EQ("b", infos[0].name());
+  EXPECT_EQ("a", infos[1].name());
+}
+
+TEST_F(ServiceDirectoryBatch, RegisterServicesRegistersAllOrNothing)
+{
+  const auto ids = sd.registerServices({serviceInfo("a"), serviceInfo("b")});
+  ASSERT_EQ(2u, ids.size());
+  EXPECT_NE(ids[0], ids[1]);
+  for (auto id : ids)
+    sd.serviceReady(id);
+  EXPECT_EQ(2u, sd.servicesByName({"a", "b"}).size());
+
+  // A conflicting name, or a name appearing twice, rejects the whole batch.
+  EXPECT_ANY_THROW(sd.registerServices({serviceInfo("c"), serviceInfo("a")}));
+  EXPECT_ANY_THROW(sd.registerServices({serviceInfo("d"), serviceInfo("d")}));
+  EXPECT_NO_THROW(sd.registerService(serviceInfo("c")));
+  EXPECT_NO_THROW(sd.registerService(serviceInfo("d")));
+}
@@ -9,8 +9,10 @@
 #include <string>
 #include <future>
 #include <chrono>
+#include <thread>
 
 #include <gtest/gtest.h>
+#include <boost/filesystem.hpp>
 #include <boost/optional.hpp>
 
 #include <qi/session.hpp>
@@ -187,6 +189,29 @@ namespace
 
 }
 
+TEST(TestSession, ConnectsToServiceDirectoryThroughLocalSocket)
+{
+  const auto dir = qi::os::mktmpdir("test-session-local");
+  const qi::Url localUrl("unix://" + dir + "/sd.sock");
+
+  auto sd = qi::makeSession();
+  ASSERT_TRUE(finishesWithValue(
+    sd->listenStandalone(std::vector<qi::Url>{ test::defaultListenUrl(), localUrl })));
+  const auto endpoints = sd->endpoints();
+  EXPECT_NE(endpoints.end(), std::find(endpoints.begin(), endpoints.end(), localUrl));
+  ASSERT_TRUE(finishesWithValue(sd->registerService(dummyServiceName, dummyDynamicObject())));
+
+  auto client = qi::makeSession();
+  ASSERT_TRUE(finishesWithValue(client->connect(localUrl)));
+  EXPECT_EQ("unix", client->url().protocol());
+  AnyObject service = client->service(dummyServiceName).value();
+  EXPECT_EQ("ping", service.call<std::string>("reply", "ping"));
+
+  client->close();
+  sd->close();
+  boost::filesystem::remove_all(dir);
+}
+
 TEST(TestSession, MultiClose)
 {
   TestSessionPair sessionPair;
@@ -347,6 +372,87 @@ TEST(TestSession, GetSimpleService)
   ASSERT_TRUE(finishesWithValue(server.service(dummyServiceName)));
 }
 
+TEST(TestSession, GetLocalServiceThroughDirectProxy)
+{
+  TestSessionPair sessionPair;
+  auto& server = *sessionPair.server();
+
+  DynamicObjectBuilder ob;
+  // The object does not serialize its calls, so that they run where the
+  // call type of the caller says.
+  ob.setThreadingModel(ObjectThreadingModel_MultiThread);
+  ob.advertiseMethod("reply", &reply);
+  ob.advertiseMethod("threadId", [] { return qi::os::gettid(); });
+  auto obj = ob.object();
+  unsigned int serviceIndex = 0;
+  ASSERT_TRUE(finishesWithValue(server.registerService(dummyServiceName, obj),
+                                willAssignValue(serviceIndex)));
+
+  AnyObject proxy1;
+  AnyObject proxy2;
+  ASSERT_TRUE(finishesWithValue(server.service(dummyServiceName), willAssignValue(proxy1)));
+  ASSERT_TRUE(finishesWithValue(server.service(dummyServiceName), willAssignValue(proxy2)));
+  EXPECT_TRUE(proxy1.asGenericObject() == proxy2.asGenericObject());
+  EXPECT_FALSE(proxy1.asGenericObject() == obj.asGenericObject());
+  EXPECT_EQ(obj.uid(), proxy1.uid());
+
+  // The call type of the caller is kept: `call` is direct, `async` is queued.
+  EXPECT_EQ("hello", proxy1.call<std::string>("reply", "hello"));
+  EXPECT_EQ(qi::os::gettid(), proxy1.call<int>("threadId"));
+  EXPECT_NE(qi::os::gettid(), proxy1.async<int>("threadId").value());
+
+  // Once the service is unregistered, the proxy does not reach it anymore.
+  ASSERT_TRUE(finishesWithValue(server.unregisterService(serviceIndex)));
+  Future<std::string> reply;
+  for (int i = 0; i < 100; ++i)
+  {
+    reply = proxy1.async<std::string>("reply", "hello");
+    if (finishesWithError(reply))
+      break;
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  }
+  EXPECT_TRUE(finishesWithError(reply));
+}
+
+TEST(TestSession, LocalServiceIsKeptAliveByItsClosedProxy)
+{
+  TestSessionPair sessionPair;
+  auto& server = *sessionPair.server();
+
+  Promise<void> destroyed;
+  unsigned int serviceIndex = 0;
+  {
+    DynamicObjectBuilder ob;
+    ob.advertiseMethod("reply", &reply);
+    ASSERT_TRUE(finishesWithValue(
+        server.registerService(dummyServiceName,
+                               ob.object([=](GenericObject*) mutable { destroyed.setValue(nullptr); })),
+        willAssignValue(serviceIndex)));
+  }
+
+  AnyObject proxy;
+  ASSERT_TRUE(finishesWithValue(server.service(dummyServiceName), willAssignValue(proxy)));
+  EXPECT_EQ("hello", proxy.call<std::string>("reply", "hello"));
+
+  ASSERT_TRUE(finishesWithValue(server.unregisterService(serviceIndex)));
+  // The proxy is closed once the session handles the removal of the service,
+  // but its value, which is the one of the service, remains valid.
+  Future<std::string> reply;
+  for (int i = 0; i < 100; ++i)
+  {
+    reply = proxy.async<std::string>("reply", "hello");
+    if (finishesWithError(reply))
+      break;
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  }
+  EXPECT_TRUE(finishesWithError(reply));
+  EXPECT_FALSE(proxy.metaObject().findMethod("reply").empty());
+  EXPECT_FALSE(destroyed.future().isFinished());
+
+  proxy.reset();
+  ASSERT_TRUE(finishesWithValue(destroyed.future()));
+}
+
 TEST(TestSession, GetSimpleServiceTwice)
 {
   TestSessionPair sessionPair;
@@ -364,6 +470,80 @@ TEST(TestSession, GetSimpleServiceTwice)
   ASSERT_TRUE(obj1.asGenericObject() == obj2.asGenericObject());
 }
 
+TEST(TestSession, GetServiceFromAnotherSessionWithKnownMetaObject)
+{
+  auto server = qi::makeSession();
+  ASSERT_TRUE(finishesWithValue(server->listenStandalone(test::defaultListenUrl())));
+  ASSERT_TRUE(finishesWithValue(server->registerService(dummyServiceName, dummyDynamicObject())));
+
+  // The second client sends the digest of the metaobject received by the
+  // first one and is answered that it did not change.
+  std::vector<SessionPtr> clients;
+  std::vector<AnyObject> proxies;
+  for (int i = 0; i < 2; ++i)
+  {
+    auto client = qi::makeSession();
+    clients.push_back(client);
+    ASSERT_TRUE(finishesWithValue(client->connect(test::url(*server))));
+    AnyObject proxy;
+    ASSERT_TRUE(finishesWithValue(client->service(dummyServiceName), willAssignValue(proxy)));
+    EXPECT_EQ("hello", proxy.call<std::string>("reply", "hello"));
+    proxies.push_back(proxy);
+  }
+  EXPECT_EQ(proxies[0].metaObject().methodMap().size(), proxies[1].metaObject().methodMap().size());
+  EXPECT_EQ(proxies[0].metaObject().methodId("reply::(s)"),
+            proxies[1].metaObject().methodId("reply::(s)"));
+}
+
+TEST(TestSession, GetManyServicesConcurrently)
+{
+  TestSessionPair sessionPair;
+  auto& server = *sessionPair.server();
+  auto& client = *sessionPair.client();
+
+  const int serviceCount = 20;
+  for (int i = 0; i < serviceCount; ++i)
+  {
+    ASSERT_TRUE(finishesWithValue(
+      server.registerService("Service" + std::to_string(i), dummyDynamicObject())));
+  }
+
+  AnyObject directory;
+  ASSERT_TRUE(finishesWithValue(sessionPair.sd()->service("ServiceDirectory"),
+                                willAssignValue(directory)));
+  const auto servicesByNameId = directory.metaObject().methodId("servicesByName::([s])");
+  const auto serviceId = directory.metaObject().methodId("service::(s)");
+  ASSERT_GE(servicesByNameId, 0);
+  ASSERT_GE(serviceId, 0);
+  directory.call<void>("enableStats", true);
+
+  // Concurrent lookups are batched together by the service directory client.
+  std::vector<Future<AnyObject>> futures;
+  for (int i = 0; i < serviceCount; ++i)
+    futures.push_back(client.service("Service" + std::to_string(i)).async());
+  const auto unknown = client.service("UnknownService").async();
+
+  for (auto& future : futures)
+  {
+    AnyObject proxy;
+    ASSERT_TRUE(finishesWithValue(future, willAssignValue(proxy)));
+    EXPECT_EQ("hello", proxy.call<std::string>("reply", "hello"));
+  }
+  EXPECT_TRUE(finishesWithError(unknown));
+
+  auto stats = directory.call<ObjectStatistics>("stats");
+  directory.call<void>("enableStats", false);
+  // Through a gateway, the lookups are answered by the gateway itself.
+  if (sessionPair.mode() == TestMode::Mode_Gateway)
+    return;
+
+  // The first lookup is sent alone, the ones issued while it is in flight
+  // together once it is answered.
+  EXPECT_EQ(0u, stats[serviceId].count());
+  EXPECT_GE(stats[servicesByNameId].count(), 1u);
+  EXPECT_LE(stats[servicesByNameId].count(), static_cast<unsigned int>(serviceCount) / 4);
+}
+
 TEST(TestSession, GetSimpleServiceTwiceUnexisting)
 {
   TestSessionPair sessionPair;
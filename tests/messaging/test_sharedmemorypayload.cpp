@@ -0,0 +1,287 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <vector>
+#ifdef __linux__
+# include <sys/stat.h>
+#endif
+#include <gtest/gtest.h>
+#include <qi/os.hpp>
+#include "src/messaging/sharedmemorypayload_p.hpp"
+
+namespace
+{
+  const std::uint32_t maxPayload = std::numeric_limits<std::uint32_t>::max();
+
+  /// Stream context of which both ends advertised a given machine id.
+  class RemoteContext : public qi::StreamContext
+  {
+  public:
+    explicit RemoteContext(const std::string& remoteMachineId,
+                           const std::string& localMachineId = qi::os::getMachineId())
+    {
+      _localCapabilityMap[qi::capabilityname::sharedMemoryPayload] =
+          qi::AnyValue::from(localMachineId);
+      _remoteCapabilityMap[qi::capabilityname::sharedMemoryPayload] =
+          qi::AnyValue::from(remoteMachineId);
+    }
+
+    /// Merges the capabilities of a capability message sent by the remote end.
+    qi::CapabilityMap receiveCapabilities(const qi::Message& msg)
+    {
+      EXPECT_EQ(qi::Message::Type_Capability, msg.type());
+      const auto capabilities =
+          msg.value(qi::typeOf<qi::CapabilityMap>()->signature(), qi::MessageSocketPtr{})
+              .to<qi::CapabilityMap>();
+      _remoteCapabilityMap.insert(capabilities.begin(), capabilities.end());
+      return capabilities;
+    }
+  };
+
+  /// Performs the exchange that precedes the use of the ring, as a socket
+  /// sending `msg` would.
+  ///
+  /// @return true if the reader confirmed it mapped the ring.
+  bool exchangeRing(qi::SharedMemoryRingWriter& writer, RemoteContext& writerContext,
+                    qi::SharedMemoryRingReader& reader, RemoteContext& readerContext,
+                    const qi::Message& msg)
+  {
+    const auto advertisement = writer.advertise(msg, writerContext);
+    if (!advertisement)
+      return false;
+    const auto confirmation =
+        reader.map(readerContext.receiveCapabilities(*advertisement), readerContext);
+    if (!confirmation)
+      return false;
+    writerContext.receiveCapabilities(*confirmation);
+    return true;
+  }
+
+  qi::Message makeLargeMessage(std::size_t size, int first = 0)
+  {
+    std::vector<int> data(size / sizeof(int));
+    std::iota(data.begin(), data.end(), first);
+    qi::Buffer buffer;
+    buffer.write(data.data(), data.size() * sizeof(int));
+    qi::Message msg{qi::Message::Type_Call, qi::MessageAddress{1, 2, 3, 4}};
+    msg.setBuffer(std::move(buffer));
+    return msg;
+  }
+
+  bool sameContent(const qi::Buffer& b0, const qi::Buffer& b1)
+  {
+    return b0.size() == b1.size() && std::memcmp(b0.data(), b1.data(), b0.size()) == 0;
+  }
+}
+
+TEST(SharedMemoryPayload, PacksLargePayloadsForEndsOfTheSameMachine)
+{
+  RemoteContext context{qi::os::getMachineId()};
+  RemoteContext readerContext{qi::os::getMachineId()};
+  qi::SharedMemoryRingWriter writer;
+  qi::SharedMemoryRingReader reader;
+  ASSERT_TRUE(exchangeRing(writer, context, reader, readerContext,
+                           makeLargeMessage(1024 * 1024)));
+
+  const auto original = makeLargeMessage(1024 * 1024);
+  auto msg = original;
+  ASSERT_TRUE(writer.pack(msg, context));
+  EXPECT_TRUE(msg.flags() & qi::Message::TypeFlag_SharedMemoryPayload);
+  EXPECT_LT(msg.buffer().size(), 1024u);
+
+  ASSERT_TRUE(reader.unpack(msg, maxPayload));
+  EXPECT_FALSE(msg.flags() & qi::Message::TypeFlag_SharedMemoryPayload);
+  EXPECT_EQ(original.header(), msg.header());
+  EXPECT_TRUE(sameContent(original.buffer(), msg.buffer()));
+}
+
+TEST(SharedMemoryPayload, KeepsSmallPayloadsAndOtherMachines)
+{
+  RemoteContext context{qi::os::getMachineId()};
+  RemoteContext readerContext{qi::os::getMachineId()};
+  qi::SharedMemoryRingWriter writer;
+  qi::SharedMemoryRingReader ringReader;
+
+  auto small = makeLargeMessage(1024);
+  EXPECT_FALSE(writer.advertise(small, context));
+  auto large = makeLargeMessage(1024 * 1024);
+  EXPECT_FALSE(writer.advertise(large, RemoteContext{"another-machine"}));
+  EXPECT_FALSE(writer.advertise(large, qi::StreamContext{}));
+  ASSERT_TRUE(exchangeRing(writer, context, ringReader, readerContext, large));
+
+  EXPECT_FALSE(writer.pack(small, context));
+  EXPECT_FALSE(large.flags() & qi::Message::TypeFlag_SharedMemoryPayload);
+
+  // Messages without the flag are not touched by the reader.
+  qi::SharedMemoryRingReader reader;
+  const auto original = large;
+  ASSERT_TRUE(reader.unpack(large, maxPayload));
+  EXPECT_TRUE(sameContent(original.buffer(), large.buffer()));
+}
+
+TEST(SharedMemoryPayload, SendsThroughTheSocketWhenRingIsFull)
+{
+  RemoteContext context{qi::os::getMachineId()};
+  RemoteContext readerContext{qi::os::getMachineId()};
+  qi::SharedMemoryRingWriter writer;
+  qi::SharedMemoryRingReader reader;
+  ASSERT_TRUE(exchangeRing(writer, context, reader, readerContext,
+                           makeLargeMessage(1024 * 1024)));
+
+  // Fill the ring without reading it.
+  const std::size_t size = 4 * 1024 * 1024;
+  std::vector<qi::Message> packed;
+  for (int i = 0; ; ++i)
+  {
+    ASSERT_LT(i, 1000);
+    auto msg = makeLargeMessage(size, i);
+    if (!writer.pack(msg, context))
+      break;
+    packed.push_back(msg);
+  }
+  ASSERT_FALSE(packed.empty());
+
+  // Reading a payload releases its space.
+  ASSERT_TRUE(reader.unpack(packed.front(), maxPayload));
+  EXPECT_TRUE(sameContent(makeLargeMessage(size, 0).buffer(), packed.front().buffer()));
+  auto msg = makeLargeMessage(size, -1);
+  ASSERT_TRUE(writer.pack(msg, context));
+  packed.push_back(msg);
+
+  // Payloads are intact after wrapping around the ring.
+  for (std::size_t i = 1; i < packed.size(); ++i)
+  {
+    ASSERT_TRUE(reader.unpack(packed[i], maxPayload));
+    const int first = i + 1 == packed.size() ? -1 : static_cast<int>(i);
+    EXPECT_TRUE(sameContent(makeLargeMessage(size, first).buffer(), packed[i].buffer()));
+  }
+}
+
+TEST(SharedMemoryPayload, RejectsPayloadsAboveMaximum)
+{
+  RemoteContext context{qi::os::getMachineId()};
+  RemoteContext readerContext{qi::os::getMachineId()};
+  qi::SharedMemoryRingWriter writer;
+  qi::SharedMemoryRingReader reader;
+  ASSERT_TRUE(exchangeRing(writer, context, reader, readerContext,
+                           makeLargeMessage(1024 * 1024)));
+
+  auto msg = makeLargeMessage(1024 * 1024);
+  ASSERT_TRUE(writer.pack(msg, context));
+  EXPECT_FALSE(reader.unpack(msg, 1024));
+}
+
+TEST(SharedMemoryPayload, KeepsPayloadsUntilTheReaderConfirmsItMappedTheRing)
+{
+  RemoteContext context{qi::os::getMachineId()};
+  qi::SharedMemoryRingWriter writer;
+
+  auto msg = makeLargeMessage(1024 * 1024);
+  EXPECT_FALSE(writer.pack(msg, context));
+  const auto advertisement = writer.advertise(msg, context);
+  ASSERT_TRUE(advertisement);
+  // The ring is only advertised once.
+  EXPECT_FALSE(writer.advertise(msg, context));
+  EXPECT_FALSE(writer.pack(msg, context));
+  EXPECT_FALSE(msg.flags() & qi::Message::TypeFlag_SharedMemoryPayload);
+
+  // A reader that did not opt in does not map the ring.
+  RemoteContext readerContext{qi::os::getMachineId(), std::string{}};
+  qi::SharedMemoryRingReader reader;
+  EXPECT_FALSE(reader.map(readerContext.receiveCapabilities(*advertisement), readerContext));
+  EXPECT_FALSE(writer.pack(msg, context));
+}
+
+TEST(SharedMemoryPayload, RejectsPayloadsOfRingsThatWereNotMapped)
+{
+  RemoteContext context{qi::os::getMachineId()};
+  RemoteContext readerContext{qi::os::getMachineId()};
+  qi::SharedMemoryRingWriter writer;
+  qi::SharedMemoryRingReader reader;
+  ASSERT_TRUE(exchangeRing(writer, context, reader, readerContext,
+                           makeLargeMessage(1024 * 1024)));
+
+  auto msg = makeLargeMessage(1024 * 1024);
+  ASSERT_TRUE(writer.pack(msg, context));
+  qi::SharedMemoryRingReader otherReader;
+  EXPECT_FALSE(otherReader.unpack(msg, maxPayload));
+}
+
+TEST(SharedMemoryPayload, MapsOnlyRingsThatNoOtherReaderMapped)
+{
+  RemoteContext context{qi::os::getMachineId()};
+  RemoteContext readerContext{qi::os::getMachineId()};
+  qi::SharedMemoryRingWriter writer;
+  qi::SharedMemoryRingReader reader;
+  const auto advertisement = writer.advertise(makeLargeMessage(1024 * 1024), context);
+  ASSERT_TRUE(advertisement);
+  const auto capabilities = readerContext.receiveCapabilities(*advertisement);
+  ASSERT_TRUE(reader.map(capabilities, readerContext));
+
+  RemoteContext otherReaderContext{qi::os::getMachineId()};
+  qi::SharedMemoryRingReader otherReader;
+  EXPECT_FALSE(otherReader.map(capabilities, otherReaderContext));
+}
+
+TEST(SharedMemoryPayload, MapsOnlyNamesOfRings)
+{
+  RemoteContext readerContext{qi::os::getMachineId()};
+  qi::SharedMemoryRingReader reader;
+  for (const std::string name : { "", "/", "qi", "other-segment", "../qi-ring",
+                                  "qi-00000000-0000-0000-0000-000000000000-",
+                                  "qi-00000000-0000-0000-0000-000000000000-1/../x" })
+  {
+    qi::CapabilityMap capabilities;
+    capabilities[qi::capabilityname::sharedMemoryPayloadRing] = qi::AnyValue::from(name);
+    EXPECT_FALSE(reader.map(capabilities, readerContext)) << name;
+  }
+}
+
+#ifdef __linux__
+TEST(SharedMemoryPayload, OnlyTheWriterRemovesTheRing)
+{
+  RemoteContext context{qi::os::getMachineId()};
+  RemoteContext readerContext{qi::os::getMachineId()};
+  qi::SharedMemoryRingWriter writer;
+  const auto advertisement = writer.advertise(makeLargeMessage(1024 * 1024), context);
+  ASSERT_TRUE(advertisement);
+  const auto path = "/dev/shm/" + context.receiveCapabilities(*advertisement)
+                                      .at(qi::capabilityname::sharedMemoryPayloadRing)
+                                      .to<std::string>();
+
+  struct stat status;
+  {
+    qi::SharedMemoryRingReader reader;
+    const auto confirmation =
+        reader.map(readerContext.receiveCapabilities(*advertisement), readerContext);
+    ASSERT_TRUE(confirmation);
+    EXPECT_EQ(0, ::stat(path.c_str(), &status));
+    context.receiveCapabilities(*confirmation);
+  }
+  EXPECT_EQ(0, ::stat(path.c_str(), &status));
+
+  // The writer removes the name once it knows the reader mapped the ring.
+  auto msg = makeLargeMessage(1024 * 1024);
+  EXPECT_TRUE(writer.pack(msg, context));
+  EXPECT_NE(0, ::stat(path.c_str(), &status));
+}
+
+TEST(SharedMemoryPayload, RingIsOnlyAccessibleToItsUser)
+{
+  RemoteContext context{qi::os::getMachineId()};
+  qi::SharedMemoryRingWriter writer;
+  const auto advertisement = writer.advertise(makeLargeMessage(1024 * 1024), context);
+  ASSERT_TRUE(advertisement);
+  const auto name = context.receiveCapabilities(*advertisement)
+                        .at(qi::capabilityname::sharedMemoryPayloadRing).to<std::string>();
+
+  struct stat status;
+  ASSERT_EQ(0, ::stat(("/dev/shm/" + name).c_str(), &status));
+  EXPECT_EQ(0600u, status.st_mode & 0777u);
+}
+#endif
@@ -1,3 +1,4 @@
+#include <atomic>
 #include <chrono>
 #include <functional>
 #include <numeric>
@@ -741,6 +742,81 @@ TYPED_TEST(NetMessageSocketAsio, SendReceiveManyMessages)
   for (auto& t: sendThreads) t.join();
 }
 
+// Large payloads between ends of the same machine that opted in go through
+// shared memory once the receiving end mapped the ring, except over SSL. This
+// must be transparent.
+TYPED_TEST(NetMessageSocketAsio, SendReceiveLargeMessageThroughSharedMemory)
+{
+  using namespace qi;
+  using namespace qi::sock;
+
+  TransportServer server;
+  const auto listenRes = this->listen(server);
+  auto& promiseServerSideSocket = listenRes.promiseConnectedSocket;
+
+  Message largeMsg{Message::Type_Post, MessageAddress{1234, 5, 9876, 107}};
+  {
+    std::vector<int> data(1024 * 1024);
+    std::iota(data.begin(), data.end(), 42);
+    Buffer buffer;
+    buffer.write(&data[0], data.size() * sizeof(data[0]));
+    largeMsg.setBuffer(std::move(buffer));
+  }
+  std::vector<Promise<Message>> promisesReceived(2);
+  std::atomic<std::size_t> receivedCount{0u};
+  auto clientSideSocket = makeMessageSocket(this->scheme());
+  const auto _ = ka::scoped([=]{ clientSideSocket->disconnect().wait(defaultTimeout); });
+  clientSideSocket->messageReady.connect([&](const Message& msg) {
+    if (msg.type() == Message::Type_Post)
+      promisesReceived.at(receivedCount++).setValue(msg);
+  });
+  ASSERT_EQ(FutureState_FinishedWithValue, clientSideSocket->connect(listenRes.url).wait(defaultTimeout));
+  ASSERT_EQ(FutureState_FinishedWithValue, promiseServerSideSocket.future().wait(defaultTimeout));
+  auto serverSideSocket = promiseServerSideSocket.future().value();
+  serverSideSocket->ensureReading();
+
+  // Both ends opt in and exchange their capabilities, among which their
+  // machine id.
+  const auto exchangeCapabilities = [](MessageSocket& from, MessageSocket& to) {
+    from.advertiseCapability(capabilityname::sharedMemoryPayload,
+                             AnyValue::from(os::getMachineId()));
+    Message capabilities;
+    capabilities.setType(Message::Type_Capability);
+    capabilities.setService(Message::Service_Server);
+    capabilities.setValue(from.localCapabilities(), typeOf<CapabilityMap>()->signature());
+    ASSERT_TRUE(from.send(std::move(capabilities)));
+    for (int i = 0; i < 200 && !to.hasReceivedRemoteCapabilities(); ++i)
+      std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    ASSERT_TRUE(to.hasReceivedRemoteCapabilities());
+  };
+  exchangeCapabilities(*clientSideSocket, *serverSideSocket);
+  exchangeCapabilities(*serverSideSocket, *clientSideSocket);
+
+  // The first large message goes through the socket, after the advertisement
+  // of the ring.
+  ASSERT_TRUE(serverSideSocket->send(largeMsg));
+  auto futReceived = promisesReceived[0].future();
+  ASSERT_EQ(FutureState_FinishedWithValue, futReceived.wait(defaultTimeout));
+  EXPECT_TRUE(messageEqual(largeMsg, futReceived.value()));
+
+  // Over TCP, the client confirms it mapped the ring, which is then used.
+  // Shared memory is never used over SSL.
+  const bool ssl = this->scheme() == "tcps";
+  const auto ringMapped = [&] {
+    return serverSideSocket->remoteCapability(capabilityname::sharedMemoryPayloadRingMapped);
+  };
+  for (int i = 0; i < 200 && !ssl && !ringMapped(); ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+
+  ASSERT_TRUE(serverSideSocket->send(largeMsg));
+  futReceived = promisesReceived[1].future();
+  ASSERT_EQ(FutureState_FinishedWithValue, futReceived.wait(defaultTimeout));
+  const auto received = futReceived.value();
+  EXPECT_TRUE(messageEqual(largeMsg, received));
+  EXPECT_EQ(0, received.flags() & Message::TypeFlag_SharedMemoryPayload);
+  EXPECT_EQ(!ssl, static_cast<bool>(ringMapped()));
+}
+
 TEST(NetMessageSocketAsio, DisconnectToDistantWhileConnected)
 {
   using namespace qi;
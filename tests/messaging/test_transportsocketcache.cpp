@@ -15,6 +15,7 @@
 #include <thread>
 #include <numeric>
 #include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
 #include <boost/optional.hpp>
 
 #include <gtest/gtest.h>
@@ -228,6 +229,63 @@ TEST_F(TestTransportSocketCache, ReusesSocketOfServiceWithRelativeEndpoint)
   EXPECT_EQ(socket1Fut.value(), socket2Fut.value());
 }
 
+TEST_F(TestTransportSocketCache, PrefersLocalSocketOnSameMachine)
+{
+  const auto dir = qi::os::mktmpdir("test-transportsocketcache");
+  ASSERT_TRUE(test::finishesWithValue(server_.listen("tcp://127.0.0.1:0")));
+  ASSERT_TRUE(test::finishesWithValue(server_.listen("unix://" + dir + "/socket")));
+  const auto endpoints = server_.endpoints();
+  ASSERT_EQ(2u, endpoints.size());
+
+  qi::ServiceInfo info;
+  info.setMachineId(qi::os::getMachineId());
+  info.setEndpoints(endpoints);
+  const auto socketFut = cache_.socket(info);
+  ASSERT_TRUE(test::finishesWithValue(socketFut));
+  EXPECT_EQ("unix", socketFut.value()->url().protocol());
+  EXPECT_TRUE(socketFut.value()->isConnected());
+
+  server_.close();
+  boost::filesystem::remove_all(dir);
+}
+
+TEST_F(TestTransportSocketCache, FallsBackToLocalhostWhenLocalSocketIsUnreachable)
+{
+  const auto dir = qi::os::mktmpdir("test-transportsocketcache");
+  ASSERT_TRUE(test::finishesWithValue(server_.listen("tcp://127.0.0.1:0")));
+  auto endpoints = server_.endpoints();
+  ASSERT_EQ(1u, endpoints.size());
+  // Nothing listens on this socket.
+  endpoints.push_back(qi::Url("unix://" + dir + "/socket"));
+
+  qi::ServiceInfo info;
+  info.setMachineId(qi::os::getMachineId());
+  info.setEndpoints(endpoints);
+  const auto socketFut = cache_.socket(info);
+  ASSERT_TRUE(test::finishesWithValue(socketFut));
+  EXPECT_EQ("tcp", socketFut.value()->url().protocol());
+  EXPECT_TRUE(socketFut.value()->isConnected());
+
+  server_.close();
+  boost::filesystem::remove_all(dir);
+}
+
+TEST_F(TestTransportSocketCache, IgnoresLocalSocketOfRemoteMachine)
+{
+  const auto dir = qi::os::mktmpdir("test-transportsocketcache");
+  ASSERT_TRUE(test::finishesWithValue(server_.listen("tcp://127.0.0.1:0")));
+  ASSERT_TRUE(test::finishesWithValue(server_.listen("unix://" + dir + "/socket")));
+
+  qi::ServiceInfo info;
+  info.setMachineId("another machine");
+  info.setEndpoints(server_.endpoints());
+  const auto socketFut = cache_.socket(info);
+  EXPECT_TRUE(test::finishesWithError(socketFut));
+
+  server_.close();
+  boost::filesystem::remove_all(dir);
+}
+
 TEST(TestCall, IPV6Accepted)
 {
   // todo: enable whenever qi::Url properly supports ipv6
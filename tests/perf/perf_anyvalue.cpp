@@ -0,0 +1,90 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+/*
+ * Measures building and cloning vectors of AnyValues holding small values,
+ * such as the argument packs of calls.
+ */
+
+#include <string>
+#include <boost/program_options.hpp>
+#include <qi/anyvalue.hpp>
+#include "perfmain.hpp"
+
+namespace po = boost::program_options;
+
+namespace
+{
+  qi::AnyValueVector makeValues(unsigned int size)
+  {
+    qi::AnyValueVector values;
+    values.reserve(size);
+    for (unsigned int i = 0; i < size; ++i)
+    {
+      switch (i % 3)
+      {
+        case 0: values.push_back(qi::AnyValue::from(static_cast<int>(i))); break;
+        case 1: values.push_back(qi::AnyValue::from(static_cast<double>(i))); break;
+        default: values.push_back(qi::AnyValue::from(i % 2 == 0)); break;
+      }
+    }
+    return values;
+  }
+
+  void benchBuild(qi::DataPerfSuite& out, unsigned int count, unsigned int size)
+  {
+    qi::DataPerf dp;
+    dp.start("AnyValueVector_Build_" + std::to_string(size), count);
+    for (unsigned int i = 0; i < count; ++i)
+      makeValues(size);
+    dp.stop();
+    out << dp;
+  }
+
+  void benchClone(qi::DataPerfSuite& out, unsigned int count, unsigned int size)
+  {
+    const auto values = makeValues(size);
+    qi::DataPerf dp;
+    dp.start("AnyValueVector_Clone_" + std::to_string(size), count);
+    for (unsigned int i = 0; i < count; ++i)
+      qi::AnyValueVector copy(values);
+    dp.stop();
+    out << dp;
+  }
+
+  void benchFromVector(qi::DataPerfSuite& out, unsigned int count, unsigned int size)
+  {
+    const auto values = makeValues(size);
+    qi::DataPerf dp;
+    dp.start("AnyValueVector_FromAnyValue_" + std::to_string(size), count);
+    for (unsigned int i = 0; i < count; ++i)
+      qi::AnyValue::from(values).to<qi::AnyValueVector>();
+    dp.stop();
+    out << dp;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  po::options_description options;
+  options.add_options()
+    ("count", po::value<unsigned int>()->default_value(10000),
+     "Number of vectors per benchmark.")
+    ("size", po::value<unsigned int>()->default_value(1000),
+     "Number of values in each vector.");
+
+  return qi::perf::perfMain(argc, argv, "perf_anyvalue", qi::DataPerfSuite::OutputData_Period,
+                            options, {
+    [](qi::DataPerfSuite& out, const po::variables_map& vm) {
+      benchBuild(out, vm["count"].as<unsigned int>(), vm["size"].as<unsigned int>());
+    },
+    [](qi::DataPerfSuite& out, const po::variables_map& vm) {
+      benchClone(out, vm["count"].as<unsigned int>(), vm["size"].as<unsigned int>());
+    },
+    [](qi::DataPerfSuite& out, const po::variables_map& vm) {
+      benchFromVector(out, vm["count"].as<unsigned int>() / 10, vm["size"].as<unsigned int>());
+    },
+  });
+}
@@ -0,0 +1,112 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+/*
+ * Compares the cost of scheduling and canceling a large number of delayed
+ * tasks on an event loop, with the cost of doing so with one asio timer per
+ * task (which is how the event loop used to implement delayed tasks).
+ */
+
+#include <thread>
+#include <vector>
+#include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/program_options.hpp>
+#include <qi/eventloop.hpp>
+#include <qi/future.hpp>
+#include "perfmain.hpp"
+
+namespace po = boost::program_options;
+
+namespace
+{
+  // Delays spread over [1s, 2s), so that no task is due during the benchmark.
+  qi::Duration delay(unsigned int i, unsigned int count)
+  {
+    return qi::Seconds{1} + qi::MilliSeconds{1000 * i / count};
+  }
+
+  void benchEventLoop(qi::DataPerfSuite& out, unsigned int count)
+  {
+    qi::EventLoop loop("perf_eventlooptimers", 1, false);
+    std::vector<qi::Future<void>> futures;
+    futures.reserve(count);
+
+    qi::DataPerf dp;
+    dp.start("EventLoop_Schedule", count);
+    for (unsigned int i = 0; i < count; ++i)
+      futures.push_back(loop.asyncDelay([]{}, delay(i, count)));
+    dp.stop();
+    out << dp;
+
+    dp.start("EventLoop_Cancel", count);
+    for (auto& f : futures)
+      f.cancel();
+    for (auto& f : futures)
+      f.wait();
+    dp.stop();
+    out << dp;
+  }
+
+  void benchTimerPerTask(qi::DataPerfSuite& out, unsigned int count)
+  {
+    using Timer = boost::asio::steady_timer;
+    boost::asio::io_service io;
+    boost::asio::io_service::work work(io);
+    std::thread worker([&]{ io.run(); });
+
+    std::vector<qi::Future<void>> futures;
+    futures.reserve(count);
+
+    qi::DataPerf dp;
+    dp.start("TimerPerTask_Schedule", count);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+      auto timer = boost::make_shared<Timer>(io);
+      timer->expires_from_now(
+          boost::chrono::duration_cast<Timer::duration>(delay(i, count)));
+      qi::Promise<void> prom([timer](qi::Promise<void>&) { timer->cancel(); });
+      timer->async_wait([prom](const boost::system::error_code& erc) mutable {
+        if (erc)
+          prom.setCanceled();
+        else
+          prom.setValue(nullptr);
+      });
+      futures.push_back(prom.future());
+    }
+    dp.stop();
+    out << dp;
+
+    dp.start("TimerPerTask_Cancel", count);
+    for (auto& f : futures)
+      f.cancel();
+    for (auto& f : futures)
+      f.wait();
+    dp.stop();
+    out << dp;
+
+    io.stop();
+    worker.join();
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  po::options_description options;
+  options.add_options()
+    ("count", po::value<unsigned int>()->default_value(100000),
+     "Number of pending timers.");
+
+  return qi::perf::perfMain(argc, argv, "perf_eventlooptimers",
+                            qi::DataPerfSuite::OutputData_Period, options, {
+    [](qi::DataPerfSuite& out, const po::variables_map& vm) {
+      benchEventLoop(out, vm["count"].as<unsigned int>());
+    },
+    [](qi::DataPerfSuite& out, const po::variables_map& vm) {
+      benchTimerPerTask(out, vm["count"].as<unsigned int>());
+    },
+  });
+}
@@ -0,0 +1,138 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+/*
+ * Measures the throughput of the basic operations on futures and promises:
+ * creating them, setting them, chaining continuations and waiting on them.
+ */
+
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <qi/future.hpp>
+#include "perfmain.hpp"
+
+namespace po = boost::program_options;
+
+namespace
+{
+  void benchCreate(qi::DataPerfSuite& out, unsigned int count)
+  {
+    qi::DataPerf dp;
+    dp.start("Future_Create", count);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+      qi::Promise<void> prom;
+      qi::Future<void> fut = prom.future();
+      prom.setValue(nullptr);
+    }
+    dp.stop();
+    out << dp;
+  }
+
+  void benchSet(qi::DataPerfSuite& out, unsigned int count)
+  {
+    std::vector<qi::Promise<int>> promises(count);
+    std::vector<qi::Future<int>> futures;
+    futures.reserve(count);
+    for (auto& prom : promises)
+      futures.push_back(prom.future());
+
+    qi::DataPerf dp;
+    dp.start("Future_Set", count);
+    for (unsigned int i = 0; i < count; ++i)
+      promises[i].setValue(static_cast<int>(i));
+    dp.stop();
+    out << dp;
+  }
+
+  void benchConnectAndSet(qi::DataPerfSuite& out, unsigned int count)
+  {
+    unsigned int callCount = 0;
+    qi::DataPerf dp;
+    dp.start("Future_ConnectAndSet", count);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+      qi::Promise<int> prom;
+      prom.future().connect([&callCount](const qi::Future<int>&) { ++callCount; },
+                            qi::FutureCallbackType_Sync);
+      prom.setValue(static_cast<int>(i));
+    }
+    dp.stop();
+    out << dp;
+
+    if (callCount != count)
+      std::cerr << "Future_ConnectAndSet: " << callCount << " callbacks called instead of "
+                << count << std::endl;
+  }
+
+  void benchThenChain(qi::DataPerfSuite& out, unsigned int count, unsigned int length)
+  {
+    qi::DataPerf dp;
+    dp.start("Future_ThenChain", count * length);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+      qi::Promise<int> prom;
+      qi::Future<int> fut = prom.future();
+      for (unsigned int j = 0; j < length; ++j)
+        fut = fut.andThen(qi::FutureCallbackType_Sync, [](int v) { return v + 1; });
+      prom.setValue(0);
+      fut.value();
+    }
+    dp.stop();
+    out << dp;
+  }
+
+  void benchWait(qi::DataPerfSuite& out, unsigned int count)
+  {
+    std::vector<qi::Promise<int>> promises(count);
+    std::vector<qi::Future<int>> futures;
+    futures.reserve(count);
+    for (auto& prom : promises)
+      futures.push_back(prom.future());
+
+    // One thread sets the promises while this one waits for them, in order.
+    qi::DataPerf dp;
+    dp.start("Future_WaitCrossThread", count);
+    std::thread setter([&] {
+      for (unsigned int i = 0; i < count; ++i)
+        promises[i].setValue(static_cast<int>(i));
+    });
+    for (auto& fut : futures)
+      fut.wait();
+    dp.stop();
+    setter.join();
+    out << dp;
+
+    dp.start("Future_WaitFinished", count);
+    for (auto& fut : futures)
+      fut.wait();
+    dp.stop();
+    out << dp;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  po::options_description options;
+  options.add_options()
+    ("count", po::value<unsigned int>()->default_value(1000000),
+     "Number of futures per benchmark.")
+    ("chain", po::value<unsigned int>()->default_value(10),
+     "Number of continuations in each chain of the then benchmark.");
+
+  const auto count = [](const po::variables_map& vm) { return vm["count"].as<unsigned int>(); };
+  return qi::perf::perfMain(argc, argv, "perf_future", qi::DataPerfSuite::OutputData_Period,
+                            options, {
+    [=](qi::DataPerfSuite& out, const po::variables_map& vm) { benchCreate(out, count(vm)); },
+    [=](qi::DataPerfSuite& out, const po::variables_map& vm) { benchSet(out, count(vm)); },
+    [=](qi::DataPerfSuite& out, const po::variables_map& vm) { benchConnectAndSet(out, count(vm)); },
+    [=](qi::DataPerfSuite& out, const po::variables_map& vm) {
+      benchThenChain(out, count(vm) / 10, vm["chain"].as<unsigned int>());
+    },
+    [=](qi::DataPerfSuite& out, const po::variables_map& vm) { benchWait(out, count(vm)); },
+  });
+}
@@ -0,0 +1,104 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+/*
+ * Measures the cold start of a session getting many services: a new client
+ * session connects to the service directory and gets every service, either
+ * all at once, in which case lookups are batched, or one after the other.
+ */
+
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <qi/anyobject.hpp>
+#include <qi/session.hpp>
+#include <qi/type/dynamicobjectbuilder.hpp>
+#include "perfmain.hpp"
+
+namespace po = boost::program_options;
+
+namespace
+{
+  std::string serviceName(unsigned int i)
+  {
+    return "ServiceDirectoryBench" + std::to_string(i);
+  }
+
+  int identity(int value)
+  {
+    return value;
+  }
+
+  void benchColdStart(qi::DataPerfSuite& out, const qi::Url& sdUrl, unsigned int serviceCount,
+                      bool concurrent)
+  {
+    auto client = qi::makeSession();
+    qi::DataPerf dp;
+    dp.start(std::string("ServiceDirectory_ColdStart") + (concurrent ? "Concurrent_" : "Sequential_")
+             + std::to_string(serviceCount) + "Services",
+             serviceCount);
+    client->connect(sdUrl).value();
+    std::vector<qi::AnyObject> services;
+    if (concurrent)
+    {
+      std::vector<qi::Future<qi::AnyObject>> futures;
+      for (unsigned int i = 0; i < serviceCount; ++i)
+        futures.push_back(client->service(serviceName(i)).async());
+      for (auto& future : futures)
+        services.push_back(future.value());
+    }
+    else
+    {
+      for (unsigned int i = 0; i < serviceCount; ++i)
+        services.push_back(client->service(serviceName(i)).value());
+    }
+    dp.stop();
+    out << dp;
+    client->close().value();
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  po::options_description options;
+  options.add_options()
+    ("services", po::value<unsigned int>()->default_value(500),
+     "Number of services to get.")
+    ("count", po::value<unsigned int>()->default_value(5),
+     "Number of cold starts per benchmark.")
+    ("listen-url", po::value<std::string>()->default_value("tcp://127.0.0.1:0"),
+     "URL the service directory listens to.");
+
+  return qi::perf::perfMain(argc, argv, "perf_servicedirectory",
+                            qi::DataPerfSuite::OutputData_Period, options, {
+    [](qi::DataPerfSuite& out, const po::variables_map& vm) {
+      const auto serviceCount = vm["services"].as<unsigned int>();
+
+      auto sd = qi::makeSession();
+      sd->listenStandalone(qi::Url(vm["listen-url"].as<std::string>())).value();
+      const auto sdUrl = sd->endpoints().front();
+
+      auto provider = qi::makeSession();
+      provider->connect(sdUrl).value();
+      provider->listen("tcp://127.0.0.1:0").value();
+      for (unsigned int i = 0; i < serviceCount; ++i)
+      {
+        qi::DynamicObjectBuilder ob;
+        ob.advertiseMethod("identity", &identity);
+        provider->registerService(serviceName(i), ob.object()).value();
+      }
+
+      const auto count = vm["count"].as<unsigned int>();
+      for (const bool concurrent : {true, false})
+      {
+        for (unsigned int i = 0; i < count; ++i)
+          benchColdStart(out, sdUrl, serviceCount, concurrent);
+      }
+
+      provider->close().value();
+      sd->close().value();
+    },
+  });
+}
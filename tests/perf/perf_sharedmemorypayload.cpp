@@ -0,0 +1,89 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+/*
+ * Measures the throughput of calls carrying large buffers between two sessions
+ * of the same machine. Run with QI_SHM_PAYLOAD=1 so that payloads above
+ * QI_SHM_PAYLOAD_THRESHOLD go through shared memory, and without it to send
+ * them through the socket and compare.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <qi/anyobject.hpp>
+#include <qi/buffer.hpp>
+#include <qi/session.hpp>
+#include <qi/type/dynamicobjectbuilder.hpp>
+#include "perfmain.hpp"
+
+namespace po = boost::program_options;
+
+namespace
+{
+  unsigned int bufferSize(const qi::Buffer& buffer)
+  {
+    return static_cast<unsigned int>(buffer.totalSize());
+  }
+
+  void benchCall(qi::DataPerfSuite& out, qi::AnyObject service, unsigned int count,
+                 unsigned int size)
+  {
+    qi::Buffer buffer;
+    std::vector<unsigned char> data(size, 0x2a);
+    buffer.write(data.data(), data.size());
+
+    // The first call connects the socket, exchanges capabilities and sets up
+    // the shared memory ring.
+    service.call<unsigned int>("size", buffer);
+
+    qi::DataPerf dp;
+    dp.start("SharedMemoryPayload_Call_" + std::to_string(size / 1000) + "KB", count, size);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+      if (service.call<unsigned int>("size", buffer) != size)
+        std::cerr << "SharedMemoryPayload_Call: wrong size received" << std::endl;
+    }
+    dp.stop();
+    out << dp;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  po::options_description options;
+  options.add_options()
+    ("count", po::value<unsigned int>()->default_value(100),
+     "Number of calls per benchmark.")
+    ("sizes", po::value<std::vector<unsigned int>>()->multitoken()
+                ->default_value(std::vector<unsigned int>{1000000, 2000000, 5000000, 10000000},
+                                "1000000 2000000 5000000 10000000"),
+     "Sizes in bytes of the buffers to benchmark.")
+    ("listen-url", po::value<std::string>()->default_value("tcp://127.0.0.1:0"),
+     "URL the service session listens to.");
+
+  return qi::perf::perfMain(argc, argv, "perf_sharedmemorypayload",
+                            qi::DataPerfSuite::OutputData_MsgMBPerSecond, options, {
+    [](qi::DataPerfSuite& out, const po::variables_map& vm) {
+      auto server = qi::makeSession();
+      server->listenStandalone(qi::Url(vm["listen-url"].as<std::string>())).value();
+      qi::DynamicObjectBuilder ob;
+      ob.advertiseMethod("size", &bufferSize);
+      server->registerService("SharedMemoryPayloadBench", ob.object()).value();
+
+      auto client = qi::makeSession();
+      client->connect(server->endpoints().front()).value();
+      qi::AnyObject service = client->service("SharedMemoryPayloadBench").value();
+
+      const auto count = vm["count"].as<unsigned int>();
+      for (auto size : vm["sizes"].as<std::vector<unsigned int>>())
+        benchCall(out, service, count, size);
+
+      client->close().value();
+      server->close().value();
+    },
+  });
+}
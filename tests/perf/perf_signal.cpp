@@ -0,0 +1,61 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+/*
+ * Measures the throughput of triggering a signal, depending on its number of
+ * subscribers. Subscribers are called synchronously and do nearly nothing, so
+ * that the cost of the emission itself dominates.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <qi/signal.hpp>
+#include "perfmain.hpp"
+
+namespace po = boost::program_options;
+
+namespace
+{
+  void benchTrigger(qi::DataPerfSuite& out, unsigned int count, unsigned int subscriberCount)
+  {
+    qi::Signal<int> signal;
+    unsigned int callCount = 0;
+    for (unsigned int i = 0; i < subscriberCount; ++i)
+      signal.connect([&callCount](int) { ++callCount; }).setCallType(qi::MetaCallType_Direct);
+
+    qi::DataPerf dp;
+    dp.start("Signal_Trigger_" + std::to_string(subscriberCount) + "_Subscribers", count);
+    for (unsigned int i = 0; i < count; ++i)
+      signal(static_cast<int>(i));
+    dp.stop();
+    out << dp;
+
+    if (callCount != count * subscriberCount)
+      std::cerr << "Signal_Trigger: " << callCount << " calls instead of "
+                << count * subscriberCount << std::endl;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  po::options_description options;
+  options.add_options()
+    ("count", po::value<unsigned int>()->default_value(100000),
+     "Number of triggers per benchmark.")
+    ("subscribers", po::value<std::vector<unsigned int>>()->multitoken()
+                      ->default_value(std::vector<unsigned int>{0, 1, 10, 100}, "0 1 10 100"),
+     "Numbers of subscribers to benchmark.");
+
+  return qi::perf::perfMain(argc, argv, "perf_signal", qi::DataPerfSuite::OutputData_Period,
+                            options, {
+    [](qi::DataPerfSuite& out, const po::variables_map& vm) {
+      const auto count = vm["count"].as<unsigned int>();
+      for (auto subscriberCount : vm["subscribers"].as<std::vector<unsigned int>>())
+        benchTrigger(out, count, subscriberCount);
+    },
+  });
+}
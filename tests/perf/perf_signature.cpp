@@ -0,0 +1,95 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+/*
+ * Measures how building and comparing signatures scales with the number of
+ * threads doing it: every thread builds signatures from a few strings, as
+ * messages of the same methods are deserialized, from strings that are all
+ * different, and scores the convertibility of a few signatures.
+ */
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <qi/signature.hpp>
+#include "perfmain.hpp"
+
+namespace po = boost::program_options;
+
+namespace
+{
+  /// Runs `op` `count` times on each of `threadCount` threads, and measures
+  /// the throughput of all of them.
+  template<typename Op>
+  void benchThreads(qi::DataPerfSuite& out, const std::string& name, unsigned int threadCount,
+                    unsigned int count, Op op)
+  {
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount);
+    qi::DataPerf dp;
+    dp.start(name + "_" + std::to_string(threadCount) + "Threads", threadCount * count);
+    for (unsigned int t = 0; t < threadCount; ++t)
+    {
+      threads.emplace_back([=] {
+        for (unsigned int i = 0; i < count; ++i)
+          op(t, i);
+      });
+    }
+    for (auto& thread : threads)
+      thread.join();
+    dp.stop();
+    out << dp;
+  }
+
+  const std::vector<std::string> knownSignatures = {
+    "(s)", "(i[d]{sm})", "(ss)", "[(sI)]", "{sm}", "(m)", "(I(sIs))<ServiceInfo,a,b>"
+  };
+
+  void buildKnown(unsigned int, unsigned int i)
+  {
+    qi::Signature(knownSignatures[i % knownSignatures.size()]);
+  }
+
+  void buildDistinct(unsigned int thread, unsigned int i)
+  {
+    qi::Signature("(is)<S" + std::to_string(thread) + "_" + std::to_string(i) + ",a,b>");
+  }
+
+  void scoreConvertibility(unsigned int, unsigned int i)
+  {
+    static const qi::Signature from("(i[d]{sm})");
+    static const std::vector<qi::Signature> to = {
+      qi::Signature("(m[m]{sm})"), qi::Signature("(f[f]{sm})"), qi::Signature("(s[d]{sm})")
+    };
+    from.isConvertibleTo(to[i % to.size()]);
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  po::options_description options;
+  options.add_options()
+    ("count", po::value<unsigned int>()->default_value(1000000),
+     "Number of operations per thread and benchmark.")
+    ("threads", po::value<unsigned int>()->default_value(
+       std::max(4u, std::thread::hardware_concurrency())),
+     "Maximum number of threads. Benchmarks run with 1, 2, 4... threads up to it.");
+
+  return qi::perf::perfMain(argc, argv, "perf_signature", qi::DataPerfSuite::OutputData_MsgPerSecond,
+                            options, {
+    [](qi::DataPerfSuite& out, const po::variables_map& vm) {
+      const auto count = vm["count"].as<unsigned int>();
+      const auto maxThreads = vm["threads"].as<unsigned int>();
+      for (unsigned int threads = 1; threads <= maxThreads; threads *= 2)
+      {
+        benchThreads(out, "BuildKnown", threads, count, &buildKnown);
+        benchThreads(out, "BuildDistinct", threads, count / 10, &buildDistinct);
+        benchThreads(out, "IsConvertibleTo", threads, count, &scoreConvertibility);
+      }
+    },
+  });
+}
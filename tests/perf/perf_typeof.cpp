@@ -0,0 +1,85 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+/*
+ * Measures how the lookups of types scale with the number of threads doing
+ * them: every thread gets the type of a few C++ types, or wraps values in
+ * AnyValues, which also looks their type up.
+ */
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <qi/anyvalue.hpp>
+#include "perfmain.hpp"
+
+namespace po = boost::program_options;
+
+namespace
+{
+  /// Runs `op` `count` times on each of `threadCount` threads, and measures
+  /// the throughput of all of them.
+  template<typename Op>
+  void benchThreads(qi::DataPerfSuite& out, const std::string& name, unsigned int threadCount,
+                    unsigned int count, Op op)
+  {
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount);
+    qi::DataPerf dp;
+    dp.start(name + "_" + std::to_string(threadCount) + "Threads", threadCount * count);
+    for (unsigned int t = 0; t < threadCount; ++t)
+    {
+      threads.emplace_back([=] {
+        for (unsigned int i = 0; i < count; ++i)
+          op(i);
+      });
+    }
+    for (auto& thread : threads)
+      thread.join();
+    dp.stop();
+    out << dp;
+  }
+
+  void typeOfSome(unsigned int)
+  {
+    qi::typeOf<int>();
+    qi::typeOf<std::string>();
+    qi::typeOf<std::vector<double>>();
+    qi::typeOf<std::map<std::string, qi::AnyValue>>();
+  }
+
+  void anyValueFrom(unsigned int i)
+  {
+    qi::AnyValue::from(static_cast<int>(i));
+    qi::AnyValue::from(static_cast<double>(i));
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  po::options_description options;
+  options.add_options()
+    ("count", po::value<unsigned int>()->default_value(1000000),
+     "Number of operations per thread and benchmark.")
+    ("threads", po::value<unsigned int>()->default_value(
+       std::max(4u, std::thread::hardware_concurrency())),
+     "Maximum number of threads. Benchmarks run with 1, 2, 4... threads up to it.");
+
+  return qi::perf::perfMain(argc, argv, "perf_typeof", qi::DataPerfSuite::OutputData_MsgPerSecond,
+                            options, {
+    [](qi::DataPerfSuite& out, const po::variables_map& vm) {
+      const auto count = vm["count"].as<unsigned int>();
+      const auto maxThreads = vm["threads"].as<unsigned int>();
+      for (unsigned int threads = 1; threads <= maxThreads; threads *= 2)
+      {
+        benchThreads(out, "TypeOf", threads, count, &typeOfSome);
+        benchThreads(out, "AnyValueFrom", threads, count, &anyValueFrom);
+      }
+    },
+  });
+}
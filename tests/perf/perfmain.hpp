@@ -0,0 +1,65 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#ifndef QI_TEST_PERFMAIN_HPP
+#define QI_TEST_PERFMAIN_HPP
+
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <qi/perf/dataperfsuite.hpp>
+
+namespace qi
+{
+namespace perf
+{
+  /// A benchmark of a perf program. It writes its results in `out`, and may
+  /// read the command line options of the program.
+  using Benchmark = std::function<void (DataPerfSuite& out,
+                                        const boost::program_options::variables_map& options)>;
+
+  /// Main function of the perf programs: parses the command line, then runs
+  /// the benchmarks in order and writes their results in a DataPerfSuite
+  /// named after the program.
+  ///
+  /// Besides `options`, the program accepts --help and the options of the
+  /// DataPerfSuite (see qi::detail::getPerfOptions()).
+  ///
+  /// @return the exit status of the program.
+  inline int perfMain(int argc, char* argv[], const std::string& name,
+                      DataPerfSuite::OutputData outputData,
+                      const boost::program_options::options_description& options,
+                      const std::vector<Benchmark>& benchmarks)
+  {
+    namespace po = boost::program_options;
+
+    po::options_description desc;
+    desc.add_options()
+      ("help,h", "Print this help.");
+    desc.add(options);
+    desc.add(qi::detail::getPerfOptions());
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+      std::cout << desc << std::endl;
+      return EXIT_SUCCESS;
+    }
+
+    DataPerfSuite out("qi", name, outputData, vm["output"].as<std::string>());
+    for (const auto& benchmark : benchmarks)
+      benchmark(out, vm);
+    out.close();
+    return EXIT_SUCCESS;
+  }
+} // namespace perf
+} // namespace qi
+
+#endif // QI_TEST_PERFMAIN_HPP
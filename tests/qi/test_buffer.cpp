@@ -6,7 +6,10 @@
  */
 
 #include <cstdlib>
+#include <stdexcept>
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 #include <algorithm>
 #include <random>
@@ -15,6 +18,7 @@
 #include <gtest/gtest.h>
 
 #include <qi/buffer.hpp>
+#include <qi/bufferview.hpp>
 #include <qi/numeric.hpp>
 
 #include <ka/range.hpp>
@@ -178,3 +182,105 @@ TEST(TestBuffer, TestAssignmentsAreDistinct)
   *asIntPtr(b0.data()) = 1234;
   ASSERT_EQ(993, *asIntPtr(b1.data()));
 }
+
+TEST(TestBuffer, CopyOfBigBufferCanBeWrittenTo)
+{
+  using namespace qi;
+  const std::vector<char> data(10000, 'a');
+  Buffer b0;
+  b0.write(data.data(), data.size());
+  Buffer b1 = b0;
+  // Writing after the copied content must not overflow the copy's storage.
+  ASSERT_TRUE(b1.write(data.data(), data.size()));
+  ASSERT_EQ(2 * data.size(), b1.size());
+  ASSERT_EQ(data.size(), b0.size());
+}
+
+TEST(TestBuffer, ReleasedMemoryIsReusedFromPool)
+{
+  using namespace qi;
+  const std::vector<char> data(10000, 'a');
+  {
+    // Warm up the pool.
+    Buffer b;
+    b.write(data.data(), data.size());
+  }
+  const auto before = bufferPoolStatistics();
+  {
+    Buffer b;
+    b.write(data.data(), data.size());
+  }
+  const auto after = bufferPoolStatistics();
+  // Both the buffer private data and its big data are reused.
+  ASSERT_LE(before.hits + 2u, after.hits);
+}
+
+TEST(TestBuffer, MemoryReleasedByAnotherThreadIsReusedByTheAllocatingThread)
+{
+  using namespace qi;
+  const std::vector<char> data(10000, 'a');
+  {
+    // Warm up the pool.
+    Buffer b;
+    b.write(data.data(), data.size());
+  }
+  {
+    auto b = std::make_shared<Buffer>();
+    b->write(data.data(), data.size());
+    // The buffer is released by another thread.
+    std::thread([](std::shared_ptr<Buffer>) {}, std::move(b)).join();
+  }
+  const auto before = bufferPoolStatistics();
+  {
+    Buffer b;
+    b.write(data.data(), data.size());
+  }
+  const auto after = bufferPoolStatistics();
+  // Both the buffer private data and its big data were returned to this
+  // thread and are reused.
+  ASSERT_LE(before.hits + 2u, after.hits);
+}
+
+TEST(TestBuffer, BigBufferWrittenInSmallChunksGrowsGeometrically)
+{
+  using namespace qi;
+  const std::vector<char> chunk(4096, 'a');
+  const std::size_t chunkCount = 2048u; // 8 MiB, above the largest pool class.
+  Buffer b;
+  const auto before = bufferPoolStatistics();
+  for (std::size_t i = 0u; i != chunkCount; ++i)
+    ASSERT_TRUE(b.write(chunk.data(), chunk.size()));
+  const auto after = bufferPoolStatistics();
+  ASSERT_EQ(chunkCount * chunk.size(), b.size());
+  // Each reallocation must at least double the capacity of the buffer
+  // instead of only making room for the new chunk.
+  const auto allocationCount = (after.hits + after.misses) - (before.hits + before.misses);
+  ASSERT_LT(allocationCount, 32u);
+}
+
+TEST(TestBufferView, OutlivesChangesOfItsBuffer)
+{
+  qi::Buffer buffer;
+  buffer.write("canard", 6);
+  qi::BufferView view(buffer, 2, 3);
+  qi::BufferView whole(buffer);
+
+  buffer.write(std::string(2000, 'x').data(), 2000);
+  EXPECT_EQ(6u + 2000u, buffer.size());
+  ASSERT_EQ(3u, view.size());
+  EXPECT_EQ("nar", std::string(view.data(), view.size()));
+
+  buffer = qi::Buffer();
+  EXPECT_EQ("canard", std::string(whole.data(), whole.size()));
+  EXPECT_EQ(view, whole.slice(2, 3));
+}
+
+TEST(TestBufferView, RangeOutOfTheBufferThrows)
+{
+  qi::Buffer buffer;
+  buffer.write("canard", 6);
+  EXPECT_THROW(qi::BufferView(buffer, 4, 3), std::out_of_range);
+  EXPECT_THROW(qi::BufferView(buffer).slice(7, 0), std::out_of_range);
+  EXPECT_NO_THROW(qi::BufferView(buffer).slice(6, 0));
+}
+
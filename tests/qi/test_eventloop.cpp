@@ -1,5 +1,6 @@
 #include <condition_variable>
 #include <mutex>
+#include <vector>
 #include <gtest/gtest.h>
 #include <qi/eventloop.hpp>
 #include <src/eventloop_p.hpp>
@@ -116,6 +117,40 @@ TEST(EventLoop, asyncFast)
   }
 }
 
+TEST(EventLoop, DelayedTasksRunInDeadlineOrder)
+{
+  qi::EventLoop loop{ gEventLoopName, 1, false };
+  std::mutex m;
+  std::vector<int> order;
+  std::vector<qi::Future<void>> futures;
+  const auto now = qi::SteadyClock::now();
+  for (int i : {3, 1, 4, 0, 2})
+  {
+    futures.push_back(loop.asyncAt([&, i] {
+      std::lock_guard<std::mutex> l{m};
+      order.push_back(i);
+    }, now + qi::MilliSeconds{ 10 * (i + 1) }));
+  }
+  for (auto& f : futures)
+    ASSERT_EQ(qi::FutureState_FinishedWithValue, f.wait(1000));
+  EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4}), order);
+}
+
+TEST(EventLoop, CancelingDelayedTasksDoesNotAffectOtherTasks)
+{
+  qi::EventLoop loop{ gEventLoopName, 1, false };
+  std::vector<qi::Future<void>> futures;
+  for (int i = 0; i < 100; ++i)
+    futures.push_back(loop.asyncDelay([] {}, qi::MilliSeconds{ 200 + i % 10 }));
+  for (std::size_t i = 0; i < futures.size(); i += 2)
+    futures[i].cancel();
+  for (std::size_t i = 0; i < futures.size(); ++i)
+  {
+    const auto expected = i % 2 ? qi::FutureState_FinishedWithValue : qi::FutureState_Canceled;
+    EXPECT_EQ(expected, futures[i].wait(1000));
+  }
+}
+
 // Algorithm:
 //  1) Set the eventloop maximum number of tries after max thread count
 //      has been reached.
@@ -250,6 +285,56 @@ TEST(EventLoopAsio, DynamicShrinking)
   ASSERT_EQ(minThreadCount, *(e-1));
 }
 
+TEST(EventLoopAsio, WorkStealingRunsTasksPostedFromInsideAndOutside)
+{
+  using namespace qi;
+  EventLoopAsio ev{4, "youp", false, EventLoopAsio::Scheduling::WorkStealing};
+
+  const int taskCount = 1000;
+  const int subTaskCount = 10;
+  std::atomic<int> executedCount{0};
+  std::vector<Future<void>> futures;
+  for (int i = 0; i < taskCount; ++i)
+  {
+    futures.push_back(ev.asyncCall(Duration{0}, [&] {
+      // Tasks posted from a worker go to its local queue.
+      for (int j = 0; j < subTaskCount; ++j)
+        ev.post(Duration{0}, [&] { ++executedCount; });
+      ++executedCount;
+    }));
+  }
+  futures.push_back(ev.asyncCall(MilliSeconds{10}, [&] { ++executedCount; }));
+
+  for (auto& f : futures)
+    ASSERT_EQ(FutureState_FinishedWithValue, f.wait(5000));
+
+  const int expectedCount = taskCount * (subTaskCount + 1) + 1;
+  const auto deadline = SteadyClock::now() + Seconds{5};
+  while (executedCount.load() != expectedCount && SteadyClock::now() < deadline)
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  EXPECT_EQ(expectedCount, executedCount.load());
+}
+
+TEST(EventLoopAsio, WorkStealingSpawnsThreadsOnOverload)
+{
+  using namespace qi;
+  const int minThreadCount = 1;
+  const int maxThreadCount = 4;
+  const int threadCount = 2;
+  const bool spawnOnOverload = true;
+  EventLoopAsio ev{threadCount, minThreadCount, maxThreadCount, "youp", spawnOnOverload,
+                   EventLoopAsio::Scheduling::WorkStealing};
+
+  while (ev.workerCount() != maxThreadCount)
+  {
+    ev.asyncCall(Duration{0}, []() {
+      std::this_thread::sleep_for(std::chrono::milliseconds{100});
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  }
+  EXPECT_EQ(maxThreadCount, ev.workerCount());
+}
+
 TEST(EventLoop, posInBetween)
 {
   using qi::detail::posInBetween;
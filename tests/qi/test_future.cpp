@@ -1602,3 +1602,51 @@ TEST(ToAnyValueFuture, Void)
   EXPECT_EQ(AnyValue::make<void>(), fut.value());
 }
 
+
+TEST(FutureCallbacks, CalledInConnectionOrder)
+{
+  // More callbacks than the ones stored inline in the future state.
+  const int callbackCount = 10;
+  qi::Promise<int> prom;
+  std::vector<int> calls;
+  for (int i = 0; i < callbackCount; ++i)
+    prom.future().connect([&calls, i](const qi::Future<int>&) { calls.push_back(i); },
+                          qi::FutureCallbackType_Sync);
+  prom.setValue(42);
+
+  ASSERT_EQ(static_cast<std::size_t>(callbackCount), calls.size());
+  for (int i = 0; i < callbackCount; ++i)
+    EXPECT_EQ(i, calls[i]);
+}
+
+TEST(FutureCallbacks, ConnectedConcurrentlyWithSetAreAllCalledOnce)
+{
+  const int threadCount = 4;
+  const int callbackCountPerThread = 50;
+  const int iterationCount = 100;
+  for (int iteration = 0; iteration < iterationCount; ++iteration)
+  {
+    qi::Promise<int> prom;
+    std::atomic<int> callCount{0};
+    std::atomic<int> wrongValueCount{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t)
+    {
+      threads.emplace_back([&] {
+        for (int i = 0; i < callbackCountPerThread; ++i)
+          prom.future().connect([&](const qi::Future<int>& f) {
+                                  if (f.value() != 42)
+                                    ++wrongValueCount;
+                                  ++callCount;
+                                },
+                                qi::FutureCallbackType_Sync);
+      });
+    }
+    prom.setValue(42);
+    for (auto& thread : threads)
+      thread.join();
+
+    ASSERT_EQ(threadCount * callbackCountPerThread, callCount.load());
+    ASSERT_EQ(0, wrongValueCount.load());
+  }
+}
@@ -9,7 +9,13 @@
 #include <qi/future.hpp>
 #include <qi/log.hpp>
 #include <qi/testutils/testutils.hpp>
+#include <algorithm>
 #include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace
 {
@@ -79,3 +85,67 @@ TEST_F(AsyncLog, cats)
   qiLogCategory("pan");
   qiLogWarningF("canard %s", 12);
 }
+
+TEST_F(AsyncLog, RecordsOfEachThreadAreDispatchedInOrder)
+{
+  static const auto category = "core.log.order";
+  static const int threadCount = 4;
+  static const int recordCount = 200;
+
+  std::mutex mutex;
+  std::vector<std::vector<int>> received(threadCount);
+  LogHandler handler("OrderHandler",
+                     [&](qi::LogLevel, qi::Clock::time_point, qi::SystemClock::time_point,
+                         const char* cat, const char* msg, const char*, const char*, int) {
+                       if (std::strcmp(cat, category) != 0)
+                         return;
+                       int thread = 0, index = 0;
+                       if (std::sscanf(msg, "%d %d", &thread, &index) != 2)
+                         return;
+                       std::lock_guard<std::mutex> lock(mutex);
+                       received[thread].push_back(index);
+                     },
+                     qi::LogLevel_Verbose);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < threadCount; ++t)
+    threads.emplace_back([t] {
+      qiLogCategory(category);
+      for (int i = 0; i < recordCount; ++i)
+        qiLogVerbose() << t << " " << i;
+    });
+  for (auto& thread : threads)
+    thread.join();
+  qi::log::flush();
+
+  std::lock_guard<std::mutex> lock(mutex);
+  for (const auto& indexes : received)
+  {
+    ASSERT_EQ(static_cast<std::size_t>(recordCount), indexes.size());
+    EXPECT_TRUE(std::is_sorted(indexes.begin(), indexes.end()));
+  }
+}
+
+TEST_F(AsyncLog, DroppedRecordsAreReported)
+{
+  qi::Promise<void> start;
+  std::atomic<bool> dropReported{ false };
+  LogHandler handler("DropHandler",
+                     [&](qi::LogLevel, qi::Clock::time_point, qi::SystemClock::time_point,
+                         const char* cat, const char* msg, const char*, const char*, int) {
+                       start.future().wait();
+                       if (std::strcmp(cat, "qi.log") == 0 && std::strstr(msg, "dropped"))
+                         dropReported = true;
+                     },
+                     qi::LogLevel_Verbose);
+
+  // The handler blocks the log thread, the buffer of this thread overflows.
+  qiLogCategory("core.log.drop");
+  const std::string longMessage(1000, 'x');
+  for (int i = 0; i < 1000; ++i)
+    qiLogVerbose() << longMessage;
+
+  start.setValue(nullptr);
+  qi::log::flush();
+  EXPECT_TRUE(dropReported.load());
+}
@@ -0,0 +1,244 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <gtest/gtest.h>
+#include <qi/log/binaryloghandler.hpp>
+#include <qi/os.hpp>
+
+namespace
+{
+  struct Record
+  {
+    qi::LogLevel level;
+    std::string category;
+    std::string file;
+    std::string function;
+    unsigned int line;
+    std::string message;
+  };
+
+  class Reader
+  {
+  public:
+    Reader(const std::vector<unsigned char>& data, std::size_t pos, std::size_t end)
+      : _data(data), _pos(pos), _end(end)
+    {
+    }
+
+    bool atEnd() const { return _pos >= _end; }
+
+    std::uint64_t varint()
+    {
+      std::uint64_t result = 0;
+      for (unsigned int shift = 0; _pos < _end; shift += 7)
+      {
+        const auto byte = _data[_pos++];
+        result |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if (byte < 0x80)
+          return result;
+      }
+      throw std::runtime_error("truncated varint");
+    }
+
+    std::string string()
+    {
+      const auto size = varint();
+      if (_pos + size > _end)
+        throw std::runtime_error("truncated string");
+      std::string result(_data.begin() + _pos, _data.begin() + _pos + size);
+      _pos += size;
+      return result;
+    }
+
+  private:
+    const std::vector<unsigned char>& _data;
+    std::size_t _pos;
+    std::size_t _end;
+  };
+
+  std::uint64_t loadLittleEndian(const unsigned char* src, std::size_t size)
+  {
+    std::uint64_t value = 0;
+    for (std::size_t i = 0; i < size; ++i)
+      value |= static_cast<std::uint64_t>(src[i]) << (8 * i);
+    return value;
+  }
+
+  std::vector<Record> decode(const std::string& path)
+  {
+    std::ifstream file(path.c_str(), std::ios::binary);
+    const std::vector<unsigned char> data{ std::istreambuf_iterator<char>(file),
+                                           std::istreambuf_iterator<char>() };
+    if (data.size() < 40 || std::string(data.begin(), data.begin() + 8) != "QILOGBIN")
+      throw std::runtime_error("not a binary log file");
+    const auto headerSize = loadLittleEndian(&data[12], 4);
+    const auto end = loadLittleEndian(&data[16], 8);
+    if (end != data.size())
+      throw std::runtime_error("file not truncated to its content");
+
+    std::map<std::uint64_t, std::string> categories;
+    std::map<std::uint64_t, Record> locations;
+    std::vector<Record> records;
+    Reader reader(data, headerSize, end);
+    while (!reader.atEnd())
+    {
+      switch (reader.varint())
+      {
+        case 0:
+        {
+          const auto id = reader.varint();
+          categories[id] = reader.string();
+          break;
+        }
+        case 1:
+        {
+          auto& location = locations[reader.varint()];
+          location.line = static_cast<unsigned int>(reader.varint());
+          location.file = reader.string();
+          location.function = reader.string();
+          break;
+        }
+        case 2:
+        {
+          reader.varint(); // date
+          reader.varint(); // system date
+          const auto levelCategory = reader.varint();
+          Record record = locations.at(reader.varint());
+          reader.varint(); // thread id
+          record.level = static_cast<qi::LogLevel>(levelCategory & 7);
+          record.category = categories.at(levelCategory >> 3);
+          record.message = reader.string();
+          records.push_back(record);
+          break;
+        }
+        default:
+          throw std::runtime_error("unknown entry");
+      }
+    }
+    return records;
+  }
+}
+
+class BinaryLogHandler : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    _dir = qi::os::mktmpdir("test-binaryloghandler");
+    _path = (boost::filesystem::path(_dir) / "log.bin").string();
+  }
+
+  void TearDown() override
+  {
+    boost::system::error_code ec;
+    boost::filesystem::remove_all(_dir, ec);
+  }
+
+  std::string _dir;
+  std::string _path;
+};
+
+TEST_F(BinaryLogHandler, WritesDecodableRecords)
+{
+  {
+    qi::log::BinaryLogHandler handler(_path);
+    const auto now = qi::Clock::now();
+    const auto systemNow = qi::SystemClock::now();
+    handler.log(qi::LogLevel_Info, now, systemNow, "cat.a", "first", "a.cpp", "fa", 12);
+    handler.log(qi::LogLevel_Error, now, systemNow, "cat.b", "second", "a.cpp", "fa", 12);
+    handler.log(qi::LogLevel_Warning, now, systemNow, "cat.a", "third", "b.cpp", "fb", 7);
+  }
+
+  const auto records = decode(_path);
+  ASSERT_EQ(3u, records.size());
+  EXPECT_EQ(qi::LogLevel_Info, records[0].level);
+  EXPECT_EQ("cat.a", records[0].category);
+  EXPECT_EQ("a.cpp", records[0].file);
+  EXPECT_EQ("fa", records[0].function);
+  EXPECT_EQ(12u, records[0].line);
+  EXPECT_EQ("first", records[0].message);
+  EXPECT_EQ(qi::LogLevel_Error, records[1].level);
+  EXPECT_EQ("cat.b", records[1].category);
+  EXPECT_EQ("second", records[1].message);
+  EXPECT_EQ("cat.a", records[2].category);
+  EXPECT_EQ("b.cpp", records[2].file);
+  EXPECT_EQ(7u, records[2].line);
+  EXPECT_EQ("third", records[2].message);
+}
+
+TEST_F(BinaryLogHandler, RotatesFilesWhenFull)
+{
+  static const std::size_t fileSize = 4096;
+  static const int recordCount = 1000;
+  const std::string message(100, 'x');
+  {
+    qi::log::BinaryLogHandler handler(_path, fileSize, 3);
+    for (int i = 0; i < recordCount; ++i)
+      handler.log(qi::LogLevel_Info, qi::Clock::now(), qi::SystemClock::now(), "cat",
+                  message.c_str(), __FILE__, __FUNCTION__, __LINE__);
+  }
+
+  for (const auto& path : { _path, _path + ".1", _path + ".2" })
+  {
+    ASSERT_TRUE(boost::filesystem::exists(path)) << path;
+    EXPECT_LE(boost::filesystem::file_size(path), fileSize);
+    // Each file defines the categories and locations it uses.
+    const auto records = decode(path);
+    ASSERT_FALSE(records.empty());
+    EXPECT_EQ("cat", records.front().category);
+    EXPECT_EQ(message, records.front().message);
+  }
+  EXPECT_FALSE(boost::filesystem::exists(_path + ".3"));
+}
+
+TEST_F(BinaryLogHandler, TruncatesMessagesLongerThanTheFile)
+{
+  static const std::size_t fileSize = 4096;
+  const std::string message(4 * fileSize, 'x');
+  {
+    qi::log::BinaryLogHandler handler(_path, fileSize);
+    handler.log(qi::LogLevel_Info, qi::Clock::now(), qi::SystemClock::now(), "cat",
+                message.c_str(), "a.cpp", "fa", 1);
+    handler.log(qi::LogLevel_Info, qi::Clock::now(), qi::SystemClock::now(), "cat",
+                "short", "a.cpp", "fa", 1);
+    EXPECT_EQ(0u, handler.droppedRecordCount());
+  }
+
+  EXPECT_LE(boost::filesystem::file_size(_path), fileSize);
+  const auto records = decode(_path);
+  ASSERT_EQ(2u, records.size());
+  EXPECT_LE(records[0].message.size(), fileSize / 2);
+  EXPECT_EQ(0u, message.compare(0, records[0].message.size(), records[0].message));
+  EXPECT_EQ("short", records[1].message);
+}
+
+TEST_F(BinaryLogHandler, DropsRecordsThatCannotFitInAFile)
+{
+  static const std::size_t fileSize = 4096;
+  const std::string function(2 * fileSize, 'f');
+  {
+    qi::log::BinaryLogHandler handler(_path, fileSize);
+    handler.log(qi::LogLevel_Info, qi::Clock::now(), qi::SystemClock::now(), "cat",
+                "first", "a.cpp", "fa", 1);
+    handler.log(qi::LogLevel_Info, qi::Clock::now(), qi::SystemClock::now(), "cat",
+                "dropped", "a.cpp", function.c_str(), 2);
+    handler.log(qi::LogLevel_Info, qi::Clock::now(), qi::SystemClock::now(), "cat",
+                "last", "a.cpp", "fa", 1);
+    EXPECT_EQ(1u, handler.droppedRecordCount());
+  }
+
+  EXPECT_LE(boost::filesystem::file_size(_path), fileSize);
+  const auto records = decode(_path);
+  ASSERT_EQ(1u, records.size());
+  EXPECT_EQ("last", records[0].message);
+  EXPECT_EQ("fa", records[0].function);
+}
@@ -5,10 +5,12 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <chrono>
 #include <future>
 #include <thread>
 #include <random>
+#include <vector>
 #include <boost/thread/mutex.hpp>
 
 #include <ka/errorhandling.hpp>
@@ -684,3 +686,69 @@ TEST(TestStrand, JoinStrandEndsScheduledTaskInError)
   startJoinProm.future().wait();
   strand.join();
 }
+
+TEST(TestStrand, TasksScheduledConcurrentlyWithJoinAreAllFinished)
+{
+  const int producerCount = 4;
+  const int taskCount = 2000;
+
+  qi::Strand strand;
+  std::vector<std::vector<qi::Future<void>>> futures(producerCount);
+  std::vector<std::thread> producers;
+  for (int p = 0; p < producerCount; ++p)
+  {
+    producers.emplace_back([&, p] {
+      for (int t = 0; t < taskCount; ++t)
+        futures[p].push_back(strand.async([]{}));
+    });
+  }
+  strand.join();
+  for (auto& producer : producers)
+    producer.join();
+
+  // A task is either executed or set in error by the join, none is left in
+  // the queue of the joined strand.
+  for (const auto& producerFutures : futures)
+    for (const auto& future : producerFutures)
+      ASSERT_NE(qi::FutureState_Running, future.wait(1000));
+}
+
+TEST(TestStrand, TasksPostedConcurrentlyAreAllExecutedSequentiallyInOrderPerProducer)
+{
+  const int producerCount = 8;
+  const int taskCount = 10000;
+
+  qi::Strand strand;
+  std::atomic<bool> running{false};
+  std::atomic<bool> overlapped{false};
+  std::vector<int> lastTask(producerCount, -1); // only accessed in the strand
+  std::atomic<int> outOfOrderCount{0};
+  std::atomic<int> executedCount{0};
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < producerCount; ++p)
+  {
+    producers.emplace_back([&, p] {
+      for (int t = 0; t < taskCount; ++t)
+      {
+        strand.post([&, p, t] {
+          if (running.exchange(true))
+            overlapped = true;
+          if (lastTask[p] != t - 1)
+            ++outOfOrderCount;
+          lastTask[p] = t;
+          ++executedCount;
+          running = false;
+        });
+      }
+    });
+  }
+  for (auto& producer : producers)
+    producer.join();
+
+  // Tasks are executed in order, so this one is executed after all the others.
+  ASSERT_EQ(qi::FutureState_FinishedWithValue, strand.async([]{}).wait(10000));
+  EXPECT_FALSE(overlapped);
+  EXPECT_EQ(0, outOfOrderCount.load());
+  EXPECT_EQ(producerCount * taskCount, executedCount.load());
+}
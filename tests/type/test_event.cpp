@@ -4,7 +4,9 @@
 */
 
 
+#include <chrono>
 #include <map>
+#include <thread>
 
 #include <ka/macro.hpp>
 #include <boost/algorithm/string.hpp>
@@ -241,3 +243,84 @@ TEST(TestTraceAnalyzer, BogusChildren)
   } while (std::next_permutation(permutator, permutator + 4));
   EXPECT_EQ(24U, count);
 }
+
+namespace
+{
+  int traceAdd(int a, int b)
+  {
+    return a + b;
+  }
+
+  std::vector<qi::CallTraceEvent> drainEventsOf(unsigned int objectUid, std::size_t count)
+  {
+    std::vector<qi::CallTraceEvent> result;
+    // The result of a call is recorded after its future is set.
+    for (int attempt = 0; attempt < 100 && result.size() < count; ++attempt)
+    {
+      std::vector<qi::CallTraceEvent> events;
+      qi::drainCallTraceEvents(events);
+      for (const auto& event : events)
+        if (event.objectUid == objectUid)
+          result.push_back(event);
+      if (result.size() < count)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return result;
+  }
+}
+
+TEST(TestTraceAnalyzer, BinaryTraceRecordsCallsAndSampledArguments)
+{
+  qi::DynamicObjectBuilder ob;
+  ob.advertiseMethod("add", &traceAdd);
+  qi::AnyObject obj = ob.object();
+  auto* manageable = obj.asGenericObject();
+  manageable->enableBinaryTrace(true);
+  manageable->setTraceSamplingPeriod(2);
+
+  static const int callCount = 4;
+  for (int i = 0; i < callCount; ++i)
+    ASSERT_EQ(i + 1, obj.call<int>("add", i, 1));
+
+  const auto events = drainEventsOf(manageable->traceUid(), 2 * callCount);
+  ASSERT_EQ(static_cast<std::size_t>(2 * callCount), events.size());
+  std::map<unsigned int, int> eventsPerCall;
+  int sampledCount = 0;
+  for (const auto& event : events)
+  {
+    ++eventsPerCall[event.id];
+    if (event.kind == EventTrace::Event_Call)
+    {
+      if (event.argumentsDigest != 0)
+        ++sampledCount;
+    }
+    else
+    {
+      EXPECT_EQ(EventTrace::Event_Result, event.kind);
+      EXPECT_EQ(0u, event.argumentsDigest);
+    }
+  }
+  EXPECT_EQ(static_cast<std::size_t>(callCount), eventsPerCall.size());
+  for (const auto& callEvents : eventsPerCall)
+    EXPECT_EQ(2, callEvents.second);
+  EXPECT_EQ(callCount / 2, sampledCount);
+}
+
+TEST(TestTraceAnalyzer, ReadsBinaryTraces)
+{
+  qi::DynamicObjectBuilder ob;
+  ob.advertiseMethod("add", &traceAdd);
+  qi::AnyObject obj = ob.object();
+  obj.asGenericObject()->enableBinaryTrace(true);
+  ASSERT_EQ(3, obj.call<int>("add", 1, 2));
+  obj.asGenericObject()->enableBinaryTrace(false);
+
+  qi::TraceAnalyzer ta;
+  for (const auto& event : drainEventsOf(obj.asGenericObject()->traceUid(), 2))
+    ta.addTrace(event);
+  const auto dump = ta.dumpTraces();
+  EXPECT_NE(std::string::npos, dump.find(':' + std::to_string(obj.asGenericObject()->traceUid()) + '.'))
+    << dump;
+  // Events of other objects, if any, are consumed as well.
+  ta.addRecordedTraces();
+}
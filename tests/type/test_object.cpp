@@ -900,6 +900,48 @@ TEST(TestObject, DISABLED_statisticsType)
   EXPECT_EQ(2u, stats[mid].count());
 }
 
+TEST(TestObject, statisticsPercentiles)
+{
+  qi::DynamicObjectBuilder gob;
+  const auto mid = gob.advertiseMethod("noop", []{});
+  qi::AnyObject obj = gob.object();
+  EXPECT_TRUE(obj.statsPercentiles().empty());
+
+  // Wall times of 1ms to 1s, user times of 1ms and system times of 0.
+  for (int i = 1; i <= 1000; ++i)
+    obj.asGenericObject()->pushStats(mid, i / 1000.f, 0.001f, 0.f);
+
+  const qi::ObjectStatistics stats = obj.stats();
+  ASSERT_EQ(1u, stats.count(mid));
+  const qi::MethodStatistics& m = stats.at(mid);
+  EXPECT_EQ(1000u, m.count());
+  EXPECT_FLOAT_EQ(0.001f, m.wall().minValue());
+  EXPECT_FLOAT_EQ(1.f, m.wall().maxValue());
+  EXPECT_NEAR(500.5f, m.wall().cumulatedValue(), 0.01f);
+
+  const auto percentiles = obj.call<qi::ObjectPercentiles>("statsPercentiles");
+  ASSERT_EQ(1u, percentiles.count(mid));
+  const qi::MethodPercentiles& p = percentiles.at(mid);
+  EXPECT_EQ(1000u, p.count());
+  EXPECT_NEAR(0.5f, p.wall().p50(), 0.5f * 0.02f);
+  EXPECT_NEAR(0.9f, p.wall().p90(), 0.9f * 0.02f);
+  EXPECT_NEAR(0.99f, p.wall().p99(), 0.99f * 0.02f);
+  EXPECT_NEAR(0.999f, p.wall().p999(), 0.999f * 0.02f);
+  EXPECT_NEAR(0.001f, p.user().p999(), 0.001f * 0.02f);
+  EXPECT_FLOAT_EQ(0.f, p.system().p50());
+
+  // A few slow calls show in the tail only.
+  for (int i = 0; i < 20; ++i)
+    obj.asGenericObject()->pushStats(mid, 10.f, 0.f, 0.f);
+  const qi::MethodPercentiles tail = obj.statsPercentiles().at(mid);
+  EXPECT_NEAR(0.51f, tail.wall().p50(), 0.51f * 0.02f);
+  EXPECT_NEAR(10.f, tail.wall().p99(), 10.f * 0.02f);
+
+  obj.clearStats();
+  EXPECT_TRUE(obj.statsPercentiles().empty());
+  EXPECT_TRUE(obj.stats().empty());
+}
+
 void pushTrace(std::vector<qi::EventTrace>& target,
     boost::mutex& mutex,
     const qi::EventTrace& trace)
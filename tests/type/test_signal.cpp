@@ -584,6 +584,38 @@ TEST(TestSignal, WithExecutionContext)
   ASSERT_TRUE(prom.future().value());
 }
 
+TEST(TestSignal, SubscriberConnectedDuringTriggerIsCalledFromNextTrigger)
+{
+  int firstCount = 0;
+  int secondCount = 0;
+  qi::Signal<void> signal;
+  signal.connect([&] {
+    if (++firstCount == 1)
+      signal.connect([&]{ ++secondCount; }).setCallType(qi::MetaCallType_Direct);
+  }).setCallType(qi::MetaCallType_Direct);
+
+  signal();
+  EXPECT_EQ(1, firstCount);
+  EXPECT_EQ(0, secondCount);
+
+  signal();
+  EXPECT_EQ(2, firstCount);
+  EXPECT_EQ(1, secondCount);
+}
+
+TEST(TestSignal, SubscriberDisconnectedDuringTriggerIsNotCalled)
+{
+  int count = 0;
+  qi::Signal<void> signal;
+  qi::SignalLink secondLink = qi::SignalBase::invalidSignalLink;
+  signal.connect([&] { signal.disconnect(secondLink); }).setCallType(qi::MetaCallType_Direct);
+  secondLink = signal.connect([&]{ ++count; }).setCallType(qi::MetaCallType_Direct);
+
+  signal();
+  EXPECT_EQ(0, count);
+  EXPECT_FALSE(signal.disconnect(secondLink));
+}
+
 // ===========================================================
 // Signal Spy
 // -----------------------------------------------------------
@@ -162,6 +162,51 @@ TEST(TestSignature, IsCompatible)
   EXPECT_GT(s3.isConvertibleTo("([m])"), s3.isConvertibleTo("(m)"));
 }
 
+TEST(TestSignature, IsCompatibleRepeatedly)
+{
+  // Scores are memoized: asking again, or through equal signatures built
+  // differently, gives the same answer.
+  const qi::Signature s("(i[d]{sm})");
+  const float toDynamic = s.isConvertibleTo("(m[m]{sm})");
+  const float toFloats = s.isConvertibleTo("(f[f]{sm})");
+  EXPECT_GT(toDynamic, 0.f);
+  EXPECT_GT(toFloats, 0.f);
+  EXPECT_EQ(0.f, s.isConvertibleTo("(s[d]{sm})"));
+  for (int i = 0; i < 3; ++i)
+  {
+    EXPECT_EQ(toDynamic, qi::Signature(s.toString()).isConvertibleTo("(m[m]{sm})"));
+    EXPECT_EQ(toFloats, s.isConvertibleTo(qi::Signature("(f[f]{sm})")));
+    EXPECT_EQ(0.f, s.isConvertibleTo("(s[d]{sm})"));
+  }
+}
+
+TEST(TestSignature, ChildrenEqualStandaloneSignatures)
+{
+  const qi::Signature s("([d]{sm}(ii)<Point,x,y>)");
+  ASSERT_EQ(3u, s.children().size());
+  EXPECT_EQ(qi::Signature("[d]"), s.children()[0]);
+  EXPECT_EQ("{sm}", s.children()[1].toString());
+  EXPECT_EQ("(ii)<Point,x,y>", s.children()[2].toString());
+  EXPECT_EQ("Point,x,y", s.children()[2].annotation());
+  EXPECT_EQ(qi::Signature("(i[d])"), qi::makeTupleSignature(std::vector<qi::TypeInterface*>{
+                                         qi::typeOf<int>(), qi::typeOf<std::vector<double>>() }));
+}
+
+TEST(TestSignature, ManyDistinctSignatures)
+{
+  // More signatures than the shared table holds: unused ones are evicted, and
+  // later ones are still parsed and scored correctly.
+  for (int i = 0; i < 20000; ++i)
+  {
+    const auto name = "S" + std::to_string(i);
+    const qi::Signature s("(is)<" + name + ",a,b>");
+    ASSERT_EQ(name + ",a,b", s.annotation());
+    ASSERT_EQ(2u, s.children().size());
+    ASSERT_GT(s.isConvertibleTo("(is)"), 0.f);
+    ASSERT_EQ(0.f, s.isConvertibleTo("(ss)"));
+  }
+}
+
 TEST(TestSignature, SignatureSplit)
 {
   std::vector<std::string> sigInfo;
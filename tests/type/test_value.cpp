@@ -7,6 +7,7 @@
 #include <map>
 #include <functional>
 #include <tuple>
+#include <thread>
 #include <gtest/gtest.h>
 #include <boost/optional.hpp>
 #include <boost/filesystem.hpp>
@@ -1414,3 +1415,85 @@ KA_WARNING_DISABLE(, missing-field-initializers)
 KA_WARNING_POP()
   EXPECT_EQ(typeOf<TypeParam>()->kind(), autoRef.kind());
 }
+
+namespace
+{
+  struct RegisteredAfterLookup
+  {
+    int value;
+  };
+}
+
+TEST(TypeOf, SeesTypesRegisteredAfterFirstLookup)
+{
+  qi::TypeInterface* const before = qi::typeOf<RegisteredAfterLookup>();
+  ASSERT_TRUE(before);
+  EXPECT_EQ(before, qi::typeOf<RegisteredAfterLookup>());
+
+  qi::TypeInterface* otherThreadBefore = nullptr;
+  std::thread([&] { otherThreadBefore = qi::typeOf<RegisteredAfterLookup>(); }).join();
+  EXPECT_EQ(before, otherThreadBefore);
+
+  static qi::TypeImpl<RegisteredAfterLookup> registered;
+  qi::registerType(qi::typeId<RegisteredAfterLookup>(), &registered);
+  EXPECT_EQ(&registered, qi::typeOf<RegisteredAfterLookup>());
+
+  qi::TypeInterface* otherThreadAfter = nullptr;
+  std::thread([&] { otherThreadAfter = qi::typeOf<RegisteredAfterLookup>(); }).join();
+  EXPECT_EQ(&registered, otherThreadAfter);
+}
+
+TEST(Value, SmallValuesCopyMoveAndSwap)
+{
+  AnyValue a = AnyValue::from(42);
+  AnyValue b = a;
+  b.set(43);
+  EXPECT_EQ(42, a.to<int>());
+  EXPECT_EQ(43, b.to<int>());
+
+  AnyValue c(std::move(b));
+  EXPECT_EQ(43, c.to<int>());
+  EXPECT_FALSE(b.isValid());
+
+  a.swap(c);
+  EXPECT_EQ(43, a.to<int>());
+  EXPECT_EQ(42, c.to<int>());
+
+  // Small values swapped with allocated ones.
+  AnyValue s = AnyValue::from(std::string("foo"));
+  s.swap(a);
+  EXPECT_EQ(43, s.to<int>());
+  EXPECT_EQ("foo", a.to<std::string>());
+
+  AnyReference released = s.release();
+  EXPECT_FALSE(s.isValid());
+  EXPECT_EQ(43, released.to<int>());
+  released.destroy();
+}
+
+TEST(Value, SmallValueReferencesModifyTheValue)
+{
+  AnyValue v = AnyValue::from(1.5);
+  AnyReference ref = v.asReference();
+  ref.setDouble(2.5);
+  EXPECT_EQ(2.5, v.to<double>());
+
+  v = v.asReference();
+  EXPECT_EQ(2.5, v.to<double>());
+}
+
+TEST(Value, SmallValuesInGrowingVector)
+{
+  AnyValueVector values;
+  for (int i = 0; i < 100; ++i)
+    values.push_back(i % 2 ? AnyValue::from(i) : AnyValue::from(std::to_string(i)));
+  const AnyValueVector copy = values;
+  for (int i = 0; i < 100; ++i)
+  {
+    if (i % 2)
+      EXPECT_EQ(i, copy[i].to<int>());
+    else
+      EXPECT_EQ(std::to_string(i), copy[i].to<std::string>());
+  }
+  EXPECT_EQ(values, copy);
+}
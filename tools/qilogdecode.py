@@ -0,0 +1,194 @@
+#!/usr/bin/env python
+##
+## Copyright (C) 2018 Softbank Robotics Europe
+## See COPYING for the license
+##
+
+"""Decode the files written by qi::log::BinaryLogHandler.
+
+Records are printed in the text format of the file and console log handlers,
+or in the format of qi::log::CsvLogHandler. Files are decoded in the order
+they are given: to decode a rotated log, pass the oldest file first, for
+example `qilogdecode.py log.bin.2 log.bin.1 log.bin`.
+"""
+
+from __future__ import print_function
+
+import argparse
+import struct
+import sys
+
+MAGIC = b"QILOGBIN"
+HEADER = struct.Struct("<8sIIQqq")
+
+TAG_CATEGORY = 0
+TAG_LOCATION = 1
+TAG_RECORD = 2
+
+LEVELS = ["[SILENT]", "[FATAL]", "[ERROR]", "[WARN ]", "[INFO ]", "[VERB ]", "[DEBUG]"]
+SHORT_LEVELS = ["[SILENT]", "[F]", "[E]", "[W]", "[I]", "[V]", "[D]"]
+
+# qi::LogContextAttr
+CONTEXT_VERBOSITY = 1 << 0
+CONTEXT_SHORT_VERBOSITY = 1 << 1
+CONTEXT_SYSTEM_DATE = 1 << 2
+CONTEXT_TID = 1 << 3
+CONTEXT_CATEGORY = 1 << 4
+CONTEXT_FILE = 1 << 5
+CONTEXT_FUNCTION = 1 << 6
+CONTEXT_RETURN = 1 << 7
+CONTEXT_DATE = 1 << 8
+DEFAULT_CONTEXT = CONTEXT_SHORT_VERBOSITY | CONTEXT_TID | CONTEXT_CATEGORY
+
+
+class DecodeError(Exception):
+    pass
+
+
+class Reader(object):
+    def __init__(self, data, pos, end):
+        self.data = data
+        self.pos = pos
+        self.end = end
+
+    def at_end(self):
+        return self.pos >= self.end
+
+    def varint(self):
+        result = 0
+        shift = 0
+        while True:
+            if self.pos >= self.end:
+                raise DecodeError("truncated varint")
+            byte = bytearray(self.data[self.pos:self.pos + 1])[0]
+            self.pos += 1
+            result |= (byte & 0x7f) << shift
+            if byte < 0x80:
+                return result
+            shift += 7
+
+    def zigzag(self):
+        value = self.varint()
+        return (value >> 1) ^ -(value & 1)
+
+    def string(self):
+        size = self.varint()
+        if self.pos + size > self.end:
+            raise DecodeError("truncated string")
+        value = self.data[self.pos:self.pos + size].decode("utf-8", "replace")
+        self.pos += size
+        return value
+
+
+def records(path):
+    """Yields (level, date, system date, tid, category, file, line, function,
+    message) for each record of the file, dates being in microseconds."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) < HEADER.size:
+        raise DecodeError("%s: file too small" % path)
+    magic, version, header_size, end, date, system_date = HEADER.unpack_from(data)
+    if magic != MAGIC:
+        raise DecodeError("%s: not a binary log file" % path)
+    if version != 1:
+        raise DecodeError("%s: unsupported version %d" % (path, version))
+
+    categories = {}
+    locations = {}
+    reader = Reader(data, header_size, min(end, len(data)))
+    while not reader.at_end():
+        tag = reader.varint()
+        if tag == TAG_CATEGORY:
+            cid = reader.varint()
+            categories[cid] = reader.string()
+        elif tag == TAG_LOCATION:
+            lid = reader.varint()
+            line = reader.varint()
+            locations[lid] = (reader.string(), line, reader.string())
+        elif tag == TAG_RECORD:
+            date += reader.zigzag()
+            system_date += reader.zigzag()
+            level_category = reader.varint()
+            location = locations.get(reader.varint(), ("", 0, ""))
+            tid = reader.varint()
+            message = reader.string()
+            yield (level_category & 7, date, system_date, tid,
+                   categories.get(level_category >> 3, ""),
+                   location[0], location[1], location[2], message)
+        else:
+            raise DecodeError("%s: unknown entry tag %d" % (path, tag))
+
+
+def date_to_string(us):
+    sec, usec = divmod(us, 1000000)
+    return "%d.%06d" % (sec, usec)
+
+
+def trim_newlines(message):
+    return message.rstrip("\r\n")
+
+
+def text_line(context, record):
+    level, date, system_date, tid, category, file_, line, function, message = record
+    out = []
+    if context & CONTEXT_VERBOSITY:
+        out.append(LEVELS[level] + " ")
+    if context & CONTEXT_SHORT_VERBOSITY:
+        out.append(SHORT_LEVELS[level] + " ")
+    if context & CONTEXT_DATE:
+        out.append(date_to_string(date) + " ")
+    if context & CONTEXT_SYSTEM_DATE:
+        out.append(date_to_string(system_date) + " ")
+    if context & CONTEXT_TID:
+        out.append("%d " % tid)
+    if context & CONTEXT_CATEGORY:
+        out.append(category + ": ")
+    if context & CONTEXT_FILE:
+        out.append(file_)
+        if line != 0:
+            out.append("(%d)" % line)
+        out.append(" ")
+    if context & CONTEXT_FUNCTION:
+        out.append(function + "() ")
+    if context & CONTEXT_RETURN:
+        out.append("\n")
+    out.append(trim_newlines(message) + "\n")
+    return "".join(out)
+
+
+CSV_HEADER = ("VERBOSITYID,VERBOSITY,SVERBOSITY,DATE,SYSTEM_DATE,THREAD_ID,"
+              "CATEGORY,FILE,LINE,FUNCTION,MSG\n")
+
+
+def csv_line(record):
+    level, date, system_date, tid, category, file_, line, function, message = record
+    return '%d,%s,%s,%s,%s,%d,"%s","%s",%s,"%s()","%s"\n' % (
+        level, LEVELS[level], SHORT_LEVELS[level], date_to_string(date),
+        date_to_string(system_date), tid, category, file_, line if line != 0 else "",
+        function, trim_newlines(message.replace('"', '""')))
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("files", nargs="+", help="binary log files")
+    parser.add_argument("--csv", action="store_true",
+                        help="print records in the CSV format")
+    parser.add_argument("--context", type=int, default=DEFAULT_CONTEXT,
+                        help="qi::LogContext flags of the text format (default: %(default)s)")
+    args = parser.parse_args(argv)
+
+    out = sys.stdout
+    if args.csv:
+        out.write(CSV_HEADER)
+    try:
+        for path in args.files:
+            for record in records(path):
+                out.write(csv_line(record) if args.csv else text_line(args.context, record))
+    except (DecodeError, IOError) as e:
+        print("qilogdecode: %s" % e, file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))